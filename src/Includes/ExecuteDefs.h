@@ -146,6 +146,20 @@ public:
   virtual bool registerTimer(const char *stdCode, uint32_t elapse) {
     return false;
   }
+
+  /*
+   *	注册订单超时
+   *	@stdCode	合约代码
+   *	@localid	本地订单号
+   *	@elapse		多久以后到期,单位毫秒
+   *
+   *	到期以后回调ExecuteUnit::on_order_expired,订单提前结束也不用注销
+   *	返回值		是否注册成功,不支持的执行器返回false,执行单元需要自己扫描
+   */
+  virtual bool registerOrderTimer(const char *stdCode, uint32_t localid,
+                                  uint32_t elapse) {
+    return false;
+  }
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -234,6 +248,12 @@ public:
    */
   virtual void on_channel_lost() = 0;
 
+  /*
+   *	订单超时回调,通过ExecuteContext::registerOrderTimer注册
+   *	localid	本地单号
+   */
+  virtual void on_order_expired(uint32_t localid) {}
+
   /*
    *	资金回报，只在交易通道初始化完成以后调用一次
    */
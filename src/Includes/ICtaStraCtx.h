@@ -18,6 +18,7 @@ class WTSCommodityInfo;
 class WTSTickData;
 struct WTSBarStruct;
 class WTSKlineSlice;
+class WTSKlineView;
 class WTSTickSlice;
 
 // typedef void(*FuncEnumPositionCallBack)(const char* stdCode, int32_t qty);
@@ -140,6 +141,15 @@ public:
   virtual WTSCommodityInfo *stra_get_comminfo(const char *stdCode) = 0;
   virtual WTSKlineSlice *stra_get_bars(const char *stdCode, const char *period,
                                        uint32_t count, bool isMain = false) = 0;
+  /*
+   *	获取K线数据,填充到调用方提供的视图中
+   *	和stra_get_bars逻辑一致,但是不会返回堆上的切片对象,适合在重算中频繁调用
+   *	@view	K线视图,引用底层数据缓存
+   *	返回是否获取成功
+   */
+  virtual bool stra_get_bars(const char *stdCode, const char *period,
+                             uint32_t count, WTSKlineView &view,
+                             bool isMain = false) = 0;
   virtual WTSTickSlice *stra_get_ticks(const char *stdCode, uint32_t count) = 0;
   virtual WTSTickData *stra_get_last_tick(const char *stdCode) = 0;
 
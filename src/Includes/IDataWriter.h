@@ -107,6 +107,11 @@ public:
 
   virtual WTSTickData *getCurTick(const char *code, const char *exchg = "") = 0;
 
+  /*
+   *	待处理的数据条数，用于监控落地模块是否积压
+   */
+  virtual uint32_t getQueueSize() { return 0; }
+
 protected:
   ExtDumpers _dumpers;
   IDataWriterSink *_sink;
@@ -9,6 +9,7 @@
  */
 #pragma once
 #include "FasterDefs.h"
+#include "IBaseDataMgr.h"
 #include "WTSTypes.h"
 #include <stdint.h>
 #include <string>
@@ -76,6 +77,17 @@ public:
 
 public:
   virtual IBaseDataMgr *getBaseDataMgr() = 0;
+
+  /*
+   *	根据代码获取合约信息
+   *	适配器可以在订阅的时候把合约预先解析好,行情回调里直接查表
+   *	@code	合约代码,不带市场前缀
+   *	@exchg	市场代码,可以为空
+   */
+  virtual WTSContractInfo *getContract(const char *code,
+                                       const char *exchg = "") {
+    return getBaseDataMgr()->getContract(code, exchg);
+  }
 };
 
 /*
@@ -11,6 +11,7 @@
 #pragma once
 #include <chrono>
 #include <deque>
+#include <memory>
 #include <stdlib.h>
 #include <string.h>
 #include <vector>
@@ -173,22 +174,196 @@ public:
   inline std::vector<double> &getDataRef() { return m_vecData; }
 };
 
+/*
+ *	数据视图
+ *	最多由两段连续内存拼接而成(历史+实时,或者环形缓存的尾段+头段)
+ *	视图本身是固定布局的值类型,不做任何堆内存分配,可以直接在栈上使用
+ *	视图不持有数据,生命周期依赖于底层的数据缓存
+ */
+template <typename T> class WTSBlockView {
+public:
+  static const uint32_t MAX_BLOCKS = 2;
+
+protected:
+  char _code[MAX_INSTRUMENT_LENGTH];
+  T *_addrs[MAX_BLOCKS];
+  uint32_t _sizes[MAX_BLOCKS];
+  uint32_t _block_cnt;
+  uint32_t _count;
+
+  inline int32_t translateIdx(int32_t idx) const {
+    if (idx < 0) {
+      return max(0, (int32_t)_count + idx);
+    }
+
+    return idx;
+  }
+
+public:
+  WTSBlockView() { reset(); }
+
+  inline void reset(const char *code = "") {
+    wt_strcpy(_code, code);
+    _addrs[0] = _addrs[1] = NULL;
+    _sizes[0] = _sizes[1] = 0;
+    _block_cnt = 0;
+    _count = 0;
+  }
+
+  /*
+   *	追加一段连续数据
+   *	超过两段则返回false
+   */
+  inline bool appendBlock(T *data, uint32_t count) {
+    if (data == NULL || count == 0)
+      return false;
+
+    if (_block_cnt >= MAX_BLOCKS)
+      return false;
+
+    _addrs[_block_cnt] = data;
+    _sizes[_block_cnt] = count;
+    _block_cnt++;
+    _count += count;
+    return true;
+  }
+
+  inline std::size_t get_block_counts() const { return _block_cnt; }
+
+  inline T *get_block_addr(std::size_t blkIdx) const {
+    if (blkIdx >= _block_cnt)
+      return NULL;
+
+    return _addrs[blkIdx];
+  }
+
+  inline uint32_t get_block_size(std::size_t blkIdx) const {
+    if (blkIdx >= _block_cnt)
+      return 0;
+
+    return _sizes[blkIdx];
+  }
+
+  inline T *at(int32_t idx) const {
+    if (_count == 0)
+      return NULL;
+
+    uint32_t uIdx = (uint32_t)translateIdx(idx);
+    if (uIdx < _sizes[0])
+      return _addrs[0] + uIdx;
+
+    uIdx -= _sizes[0];
+    if (uIdx < _sizes[1])
+      return _addrs[1] + uIdx;
+
+    return NULL;
+  }
+
+  inline int32_t size() const { return _count; }
+  inline bool empty() const { return _count == 0; }
+
+  inline const char *code() const { return _code; }
+  inline void setCode(const char *code) { wt_strcpy(_code, code); }
+};
+
+/*
+ *	K线数据视图
+ *	WTSKlineSlice的值类型版本
+ */
+class WTSKlineView : public WTSBlockView<WTSBarStruct> {
+private:
+  WTSKlinePeriod _period;
+  uint32_t _times;
+
+public:
+  WTSKlineView() : _period(KP_Minute1), _times(1) {}
+
+  inline void reset(const char *code = "", WTSKlinePeriod period = KP_Minute1,
+                    uint32_t times = 1) {
+    WTSBlockView<WTSBarStruct>::reset(code);
+    _period = period;
+    _times = times;
+  }
+
+  inline WTSKlinePeriod period() const { return _period; }
+  inline uint32_t times() const { return _times; }
+
+  double maxprice(int32_t head, int32_t tail) const {
+    head = translateIdx(head);
+    tail = translateIdx(tail);
+
+    int32_t begin = max(0, min(head, tail));
+    int32_t end = min(max(head, tail), size() - 1);
+
+    double maxValue = at(begin)->high;
+    for (int32_t i = begin; i <= end; i++) {
+      maxValue = max(maxValue, at(i)->high);
+    }
+    return maxValue;
+  }
+
+  double minprice(int32_t head, int32_t tail) const {
+    head = translateIdx(head);
+    tail = translateIdx(tail);
+
+    int32_t begin = max(0, min(head, tail));
+    int32_t end = min(max(head, tail), size() - 1);
+
+    double minValue = at(begin)->low;
+    for (int32_t i = begin; i <= end; i++) {
+      minValue = min(minValue, at(i)->low);
+    }
+    return minValue;
+  }
+};
+
+/*
+ *	Tick数据视图
+ *	WTSTickSlice的值类型版本
+ */
+typedef WTSBlockView<WTSTickStruct> WTSTickView;
+
+/*
+ *	切片引用的数据块
+ *	切片只记录数据的地址，数据块由读取模块的缓存管理
+ *	切片持有数据块的引用，缓存淘汰以后，切片释放之前数据仍然有效
+ */
+class WTSSliceHolder {
+private:
+  std::vector<std::shared_ptr<void>> _holders;
+
+public:
+  inline void keepAlive(const std::shared_ptr<void> &holder) {
+    if (holder)
+      _holders.emplace_back(holder);
+  }
+};
+
 /*
  *	K线数据切片
  *	这个比较特殊,因为要拼接当日和历史的
  *	所以有两个开始地址
  */
-class WTSKlineSlice : public WTSObject {
+class WTSKlineSlice : public WTSPoolObject<WTSKlineSlice>,
+                      public WTSSliceHolder {
+public:
+  // K线切片最多由历史和实时两段拼接而成
+  static const uint32_t MAX_BLOCKS = 2;
+
 private:
   char _code[MAX_INSTRUMENT_LENGTH];
   WTSKlinePeriod _period;
   uint32_t _times;
   typedef std::pair<WTSBarStruct *, uint32_t> BarBlock;
-  std::vector<BarBlock> _blocks;
+  BarBlock _blocks[MAX_BLOCKS];
+  uint32_t _block_cnt;
   uint32_t _count;
 
+  friend class ObjectPool<WTSKlineSlice>;
+
 protected:
-  WTSKlineSlice() : _period(KP_Minute1), _times(1), _count(0) {}
+  WTSKlineSlice()
+      : _period(KP_Minute1), _times(1), _block_cnt(0), _count(0) {}
 
   inline int32_t translateIdx(int32_t idx) const {
     int32_t totalCnt = _count;
@@ -203,13 +378,11 @@ public:
   static WTSKlineSlice *create(const char *code, WTSKlinePeriod period,
                                uint32_t times, WTSBarStruct *bars = NULL,
                                int32_t count = 0) {
-    WTSKlineSlice *pRet = new WTSKlineSlice;
+    WTSKlineSlice *pRet = WTSKlineSlice::allocate();
     wt_strcpy(pRet->_code, code);
     pRet->_period = period;
     pRet->_times = times;
-    if (bars)
-      pRet->_blocks.emplace_back(BarBlock(bars, count));
-    pRet->_count = count;
+    pRet->appendBlock(bars, count);
 
     return pRet;
   }
@@ -218,42 +391,32 @@ public:
     if (bars == NULL || count == 0)
       return false;
 
+    if (_block_cnt >= MAX_BLOCKS)
+      return false;
+
     _count += count;
-    _blocks.emplace_back(BarBlock(bars, count));
+    _blocks[_block_cnt++] = BarBlock(bars, count);
     return true;
   }
 
-  inline std::size_t get_block_counts() const { return _blocks.size(); }
+  inline std::size_t get_block_counts() const { return _block_cnt; }
 
   inline WTSBarStruct *get_block_addr(std::size_t blkIdx) {
-    if (blkIdx >= _blocks.size())
+    if (blkIdx >= _block_cnt)
       return NULL;
 
     return _blocks[blkIdx].first;
   }
 
   inline uint32_t get_block_size(std::size_t blkIdx) {
-    if (blkIdx >= _blocks.size())
+    if (blkIdx >= _block_cnt)
       return 0;
 
     return _blocks[blkIdx].second;
   }
 
   inline WTSBarStruct *at(int32_t idx) {
-    if (_count == 0)
-      return NULL;
-
-    idx = translateIdx(idx);
-    do {
-      for (auto &item : _blocks) {
-        if ((uint32_t)idx >= item.second)
-          idx -= item.second;
-        else
-          return item.first + idx;
-      }
-    } while (false);
-
-    return NULL;
+    return (WTSBarStruct *)((const WTSKlineSlice *)this)->at(idx);
   }
 
   inline const WTSBarStruct *at(int32_t idx) const {
@@ -261,17 +424,27 @@ public:
       return NULL;
 
     idx = translateIdx(idx);
-    do {
-      for (auto &item : _blocks) {
-        if ((uint32_t)idx >= item.second)
-          idx -= item.second;
-        else
-          return item.first + idx;
-      }
-    } while (false);
+    for (uint32_t i = 0; i < _block_cnt; i++) {
+      const BarBlock &item = _blocks[i];
+      if ((uint32_t)idx >= item.second)
+        idx -= item.second;
+      else
+        return item.first + idx;
+    }
+
     return NULL;
   }
 
+  /*
+   *	将切片填充到值类型的视图中
+   *	视图和切片一样引用底层缓存,不复制数据
+   */
+  inline void fillView(WTSKlineView &view) const {
+    view.reset(_code, _period, _times);
+    for (uint32_t i = 0; i < _block_cnt; i++)
+      view.appendBlock(_blocks[i].first, _blocks[i].second);
+  }
+
   /*
    *	查找指定范围内的最大价格
    *	@head 起始位置
@@ -769,7 +942,7 @@ public:
  */
 class WTSTickData : public WTSPoolObject<WTSTickData> {
 public:
-  WTSTickData() : m_pContract(NULL) {}
+  WTSTickData() : m_pContract(NULL), m_uRecvTime(0) {}
 
   /*
    *	创建一个tick数据对象
@@ -917,21 +1090,30 @@ public:
   inline void setContractInfo(WTSContractInfo *cInfo) { m_pContract = cInfo; }
   inline WTSContractInfo *getContractInfo() const { return m_pContract; }
 
+  /*
+   *	本地接收时间，单位微秒，用于统计处理延迟
+   */
+  inline void setRecvTime(uint64_t recvTime) { m_uRecvTime = recvTime; }
+  inline uint64_t getRecvTime() const { return m_uRecvTime; }
+
 private:
   WTSTickStruct m_tickStruct;
   WTSContractInfo *m_pContract;
+  uint64_t m_uRecvTime;
 };
 
-class WTSOrdQueData : public WTSObject {
+class WTSOrdQueData : public WTSPoolObject<WTSOrdQueData> {
 public:
+  WTSOrdQueData() : m_pContract(NULL) {}
+
   static inline WTSOrdQueData *create(const char *code) {
-    WTSOrdQueData *pRet = new WTSOrdQueData;
+    WTSOrdQueData *pRet = WTSOrdQueData::allocate();
     wt_strcpy(pRet->m_oqStruct.code, code);
     return pRet;
   }
 
   static inline WTSOrdQueData *create(WTSOrdQueStruct &ordQueData) {
-    WTSOrdQueData *pRet = new WTSOrdQueData;
+    WTSOrdQueData *pRet = WTSOrdQueData::allocate();
     memcpy(&pRet->m_oqStruct, &ordQueData, sizeof(WTSOrdQueStruct));
 
     return pRet;
@@ -955,16 +1137,18 @@ private:
   WTSContractInfo *m_pContract;
 };
 
-class WTSOrdDtlData : public WTSObject {
+class WTSOrdDtlData : public WTSPoolObject<WTSOrdDtlData> {
 public:
+  WTSOrdDtlData() : m_pContract(NULL) {}
+
   static inline WTSOrdDtlData *create(const char *code) {
-    WTSOrdDtlData *pRet = new WTSOrdDtlData;
+    WTSOrdDtlData *pRet = WTSOrdDtlData::allocate();
     wt_strcpy(pRet->m_odStruct.code, code);
     return pRet;
   }
 
   static inline WTSOrdDtlData *create(WTSOrdDtlStruct &odData) {
-    WTSOrdDtlData *pRet = new WTSOrdDtlData;
+    WTSOrdDtlData *pRet = WTSOrdDtlData::allocate();
     memcpy(&pRet->m_odStruct, &odData, sizeof(WTSOrdDtlStruct));
 
     return pRet;
@@ -988,16 +1172,18 @@ private:
   WTSContractInfo *m_pContract;
 };
 
-class WTSTransData : public WTSObject {
+class WTSTransData : public WTSPoolObject<WTSTransData> {
 public:
+  WTSTransData() : m_pContract(NULL) {}
+
   static inline WTSTransData *create(const char *code) {
-    WTSTransData *pRet = new WTSTransData;
+    WTSTransData *pRet = WTSTransData::allocate();
     wt_strcpy(pRet->m_tsStruct.code, code);
     return pRet;
   }
 
   static inline WTSTransData *create(WTSTransStruct &transData) {
-    WTSTransData *pRet = new WTSTransData;
+    WTSTransData *pRet = WTSTransData::allocate();
     memcpy(&pRet->m_tsStruct, &transData, sizeof(WTSTransStruct));
 
     return pRet;
@@ -1112,15 +1298,24 @@ public:
  *	@details 切片并没有真实的复制内存,而只是取了开始和结尾的下标
  *	这样使用虽然更快,但是使用场景要非常小心,因为他依赖于基础数据对象
  */
-class WTSTickSlice : public WTSObject {
+class WTSTickSlice : public WTSPoolObject<WTSTickSlice>,
+                     public WTSSliceHolder {
+public:
+  // 内置的数据块个数,超过以后才会使用额外的vector
+  static const uint32_t INLINE_BLOCKS = 2;
+
 private:
   char _code[MAX_INSTRUMENT_LENGTH];
   typedef std::pair<WTSTickStruct *, uint32_t> TickBlock;
-  std::vector<TickBlock> _blocks;
+  TickBlock _inline_blocks[INLINE_BLOCKS];
+  std::vector<TickBlock> _ext_blocks; // 按日期跨多个数据块时才会用到
+  uint32_t _block_cnt;
   uint32_t _count;
 
+  friend class ObjectPool<WTSTickSlice>;
+
 protected:
-  WTSTickSlice() { _blocks.clear(); }
+  WTSTickSlice() : _block_cnt(0), _count(0) {}
   inline int32_t translateIdx(int32_t idx) const {
     if (idx < 0) {
       return max(0, (int32_t)_count + idx);
@@ -1129,18 +1324,28 @@ protected:
     return idx;
   }
 
+  inline const TickBlock *blocks() const {
+    return _ext_blocks.empty() ? _inline_blocks : _ext_blocks.data();
+  }
+
+  inline void spillBlocks() {
+    if (!_ext_blocks.empty())
+      return;
+
+    _ext_blocks.reserve(_block_cnt * 2);
+    _ext_blocks.insert(_ext_blocks.end(), _inline_blocks,
+                       _inline_blocks + _block_cnt);
+  }
+
 public:
   static inline WTSTickSlice *
   create(const char *code, WTSTickStruct *ticks = NULL, uint32_t count = 0) {
     // if (ticks == NULL || count == 0)
     //	return NULL;
 
-    WTSTickSlice *slice = new WTSTickSlice();
+    WTSTickSlice *slice = WTSTickSlice::allocate();
     wt_strcpy(slice->_code, code);
-    if (ticks != NULL) {
-      slice->_blocks.emplace_back(TickBlock(ticks, count));
-      slice->_count = count;
-    }
+    slice->appendBlock(ticks, count);
 
     return slice;
   }
@@ -1150,7 +1355,13 @@ public:
       return false;
 
     _count += count;
-    _blocks.emplace_back(TickBlock(ticks, count));
+    if (_ext_blocks.empty() && _block_cnt < INLINE_BLOCKS) {
+      _inline_blocks[_block_cnt++] = TickBlock(ticks, count);
+    } else {
+      spillBlocks();
+      _ext_blocks.emplace_back(TickBlock(ticks, count));
+      _block_cnt++;
+    }
     return true;
   }
 
@@ -1159,25 +1370,37 @@ public:
     if (ticks == NULL || count == 0)
       return false;
 
+    if (idx > _block_cnt)
+      idx = _block_cnt;
+
     _count += count;
-    _blocks.insert(_blocks.begin() + idx, TickBlock(ticks, count));
+    if (_ext_blocks.empty() && _block_cnt < INLINE_BLOCKS) {
+      for (std::size_t i = _block_cnt; i > idx; i--)
+        _inline_blocks[i] = _inline_blocks[i - 1];
+      _inline_blocks[idx] = TickBlock(ticks, count);
+      _block_cnt++;
+    } else {
+      spillBlocks();
+      _ext_blocks.insert(_ext_blocks.begin() + idx, TickBlock(ticks, count));
+      _block_cnt++;
+    }
     return true;
   }
 
-  inline std::size_t get_block_counts() const { return _blocks.size(); }
+  inline std::size_t get_block_counts() const { return _block_cnt; }
 
   inline WTSTickStruct *get_block_addr(std::size_t blkIdx) {
-    if (blkIdx >= _blocks.size())
+    if (blkIdx >= _block_cnt)
       return NULL;
 
-    return _blocks[blkIdx].first;
+    return blocks()[blkIdx].first;
   }
 
   inline uint32_t get_block_size(std::size_t blkIdx) {
-    if (blkIdx >= _blocks.size())
+    if (blkIdx >= _block_cnt)
       return INVALID_UINT32;
 
-    return _blocks[blkIdx].second;
+    return blocks()[blkIdx].second;
   }
 
   inline uint32_t size() const { return _count; }
@@ -1189,16 +1412,31 @@ public:
       return NULL;
 
     idx = translateIdx(idx);
-    do {
-      for (auto &item : _blocks) {
-        if ((uint32_t)idx >= item.second)
-          idx -= item.second;
-        else
-          return item.first + idx;
-      }
-    } while (false);
+    const TickBlock *blks = blocks();
+    for (uint32_t i = 0; i < _block_cnt; i++) {
+      const TickBlock &item = blks[i];
+      if ((uint32_t)idx >= item.second)
+        idx -= item.second;
+      else
+        return item.first + idx;
+    }
     return NULL;
   }
+
+  /*
+   *	将切片填充到值类型的视图中
+   *	视图最多只能容纳两段数据,超出则返回false
+   */
+  inline bool fillView(WTSTickView &view) const {
+    view.reset(_code);
+    if (_block_cnt > WTSTickView::MAX_BLOCKS)
+      return false;
+
+    const TickBlock *blks = blocks();
+    for (uint32_t i = 0; i < _block_cnt; i++)
+      view.appendBlock(blks[i].first, blks[i].second);
+    return true;
+  }
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -1207,7 +1445,7 @@ public:
  *	@details 切片并没有真实的复制内存,而只是取了开始和结尾的下标
  *	这样使用虽然更快,但是使用场景要非常小心,因为他依赖于基础数据对象
  */
-class WTSOrdDtlSlice : public WTSObject {
+class WTSOrdDtlSlice : public WTSObject, public WTSSliceHolder {
 private:
   char m_strCode[MAX_INSTRUMENT_LENGTH];
   WTSOrdDtlStruct *m_ptrBegin;
@@ -1255,7 +1493,7 @@ public:
  *	@details 切片并没有真实的复制内存,而只是取了开始和结尾的下标
  *	这样使用虽然更快,但是使用场景要非常小心,因为他依赖于基础数据对象
  */
-class WTSOrdQueSlice : public WTSObject {
+class WTSOrdQueSlice : public WTSObject, public WTSSliceHolder {
 private:
   char m_strCode[MAX_INSTRUMENT_LENGTH];
   WTSOrdQueStruct *m_ptrBegin;
@@ -1303,7 +1541,7 @@ public:
  *	@details 切片并没有真实的复制内存,而只是取了开始和结尾的下标
  *	这样使用虽然更快,但是使用场景要非常小心,因为他依赖于基础数据对象
  */
-class WTSTransSlice : public WTSObject {
+class WTSTransSlice : public WTSObject, public WTSSliceHolder {
 private:
   char m_strCode[MAX_INSTRUMENT_LENGTH];
   WTSTransStruct *m_ptrBegin;
@@ -11,6 +11,7 @@
 #include <atomic>
 #include <boost/smart_ptr/detail/spinlock.hpp>
 #include <stdint.h>
+#include <vector>
 
 #include "../Share/ObjectPool.hpp"
 #include "../Share/SpinMutex.hpp"
@@ -49,32 +50,119 @@ protected:
 template <typename T> class WTSPoolObject : public WTSObject {
 private:
   typedef ObjectPool<T> MyPool;
-  MyPool *_pool;
-  SpinMutex *_mutex;
+
+  /*
+   *	每个线程一个内存池
+   *	本线程分配、本线程释放的对象直接归还内存池,不需要加锁
+   *	其他线程释放的对象,先析构,再把内存压入一个无锁链表,由所属线程在下次分配时统一回收
+   */
+  struct PoolState {
+    MyPool _pool;
+    std::atomic<void *> _remote_frees;
+
+    PoolState() : _remote_frees(nullptr) {}
+
+    inline void collect() {
+      if (_remote_frees.load(std::memory_order_relaxed) == nullptr)
+        return;
+
+      void *node = _remote_frees.exchange(nullptr, std::memory_order_acquire);
+      while (node != nullptr) {
+        void *next = *(void **)node;
+        _pool.deallocate(node);
+        node = next;
+      }
+    }
+
+    inline void push_remote(void *mem) {
+      void *head = _remote_frees.load(std::memory_order_relaxed);
+      do {
+        *(void **)mem = head;
+      } while (!_remote_frees.compare_exchange_weak(
+          head, mem, std::memory_order_release, std::memory_order_relaxed));
+    }
+  };
+
+  /*
+   *	退出线程留下的内存池状态
+   *	其他线程还可能往它的回收链表里归还内存,所以状态不销毁,交给这里持有
+   *	没有线程接手的时候由这里回收,新线程优先接手已有的状态
+   */
+  struct Orphans {
+    SpinMutex _mtx;
+    std::vector<PoolState *> _states;
+
+    static inline Orphans &inst() {
+      // 不析构,进程退出时还有线程在归还内存
+      static Orphans *orphans = new Orphans;
+      return *orphans;
+    }
+
+    inline void put(PoolState *state) {
+      SpinLock lock(_mtx);
+      _states.emplace_back(state);
+      for (PoolState *item : _states)
+        item->collect();
+    }
+
+    inline PoolState *take() {
+      SpinLock lock(_mtx);
+      if (_states.empty())
+        return NULL;
+
+      PoolState *state = _states.back();
+      _states.pop_back();
+      state->collect();
+      return state;
+    }
+  };
+
+  /*
+   *	By Wesley @ 2022.06.14
+   *	有用户反馈，这里使用了thread_local，线程销毁的话，内存池也销毁了
+   *	该用户在Trader里复现了这个bug，如果Trader底层销毁了一个API对象实例
+   *	那么这里内存池就已经析构了，如果有在系统中存储（retain）Trader创建的对象（WTSOrderInfo等），则会出现访问越界的问题
+   *
+   *	现在内存池状态放在堆上,线程退出时交给Orphans,不销毁内存池本身
+   *	还存活在其他线程里的对象,释放的时候仍然可以安全地归还
+   */
+  struct StateHolder {
+    PoolState *_state;
+
+    StateHolder() : _state(Orphans::inst().take()) {
+      if (_state == NULL)
+        _state = new PoolState;
+    }
+
+    ~StateHolder() {
+      // 之后本线程释放的对象也走回收链表
+      current_state() = NULL;
+      Orphans::inst().put(_state);
+    }
+  };
+
+  static inline PoolState *&current_state() {
+    thread_local static PoolState *state = NULL;
+    return state;
+  }
+
+  PoolState *_state;
 
 public:
-  WTSPoolObject() : _pool(NULL) {}
+  WTSPoolObject() : _state(NULL) {}
   virtual ~WTSPoolObject() {}
 
 public:
   static T *allocate() {
-    /*
-     *	By Wesley @ 2022.06.14
-     *	有用户反馈，这里使用了thread_local，线程销毁的话，内存池也销毁了
-     *	该用户在Trader里复现了这个bug，如果Trader底层销毁了一个API对象实例
-     *	那么这里内存池就已经析构了，如果有在系统中存储（retain）Trader创建的对象（WTSOrderInfo等），则会出现访问越界的问题
-     *	这里如果去掉thread_local，改成纯静态的，可能多线程并发的场景下也会有一些问题
-     *	总之如果要彻底安全，那么可能需要加一把锁才行，但是这样会带来性能开销
-     *	所以注释一下，如果有问题的可以参考一下
-     */
-    thread_local static MyPool pool;
-    thread_local static SpinMutex mtx;
-
-    mtx.lock();
-    T *ret = pool.construct();
-    mtx.unlock();
-    ret->_pool = &pool;
-    ret->_mutex = &mtx;
+    PoolState *&state = current_state();
+    if (state == NULL) {
+      thread_local static StateHolder holder;
+      state = holder._state;
+    }
+
+    state->collect();
+    T *ret = state->_pool.construct();
+    ret->_state = state;
     return ret;
   }
 
@@ -86,9 +174,14 @@ public:
     try {
       uint32_t cnt = m_uRefs.fetch_sub(1);
       if (cnt == 1) {
-        _mutex->lock();
-        _pool->destroy((T *)this);
-        _mutex->unlock();
+        PoolState *state = _state;
+        if (state == current_state()) {
+          state->_pool.destroy((T *)this);
+        } else {
+          T *pObj = (T *)this;
+          pObj->~T();
+          state->push_remote(pObj);
+        }
       }
     } catch (...) {
     }
@@ -15,25 +15,17 @@
 #include "../Includes/WTSVariant.hpp"
 #include "../Includes/WTSVersion.h"
 
+#include "../Share/CoarseClock.hpp"
 #include "../Share/ModuleHelper.hpp"
 #include "../Share/StdUtils.hpp"
 #include "../Share/TimeUtils.hpp"
 
 #include <boost/filesystem.hpp>
 
-// By Wesley @ 2022.01.05
-#include "../Share/fmtlib.h"
-template <typename... Args>
-inline void write_log(IParserSpi *sink, WTSLogLevel ll, const char *format,
-                      const Args &...args) {
-  if (sink == NULL)
-    return;
-
-  static thread_local char buffer[512] = {0};
-  fmtutil::format_to(buffer, format, args...);
+#include "../Share/ParserHelper.hpp"
 
-  sink->handleParserLog(ll, buffer);
-}
+typedef TickConverter<CtpFieldPolicy<CThostFtdcDepthMarketDataField>>
+    CtpTickConverter;
 
 extern "C" {
 EXPORT_FLAG IParserApi *createParser() {
@@ -49,26 +41,6 @@ EXPORT_FLAG void deleteParser(IParserApi *&parser) {
 }
 };
 
-uint32_t strToTime(const char *strTime) {
-  std::string str;
-  const char *pos = strTime;
-  while (strlen(pos) > 0) {
-    if (pos[0] != ':') {
-      str.append(pos, 1);
-    }
-    pos++;
-  }
-
-  return strtoul(str.c_str(), NULL, 10);
-}
-
-inline double checkValid(double val) {
-  if (val == DBL_MAX || val == FLT_MAX)
-    return 0;
-
-  return val;
-}
-
 ParserCTPOpt::ParserCTPOpt()
     : m_pUserAPI(NULL), m_iRequestID(0), m_uTradingDate(0),
       m_bLocalTime(false) {}
@@ -196,109 +168,27 @@ void ParserCTPOpt::OnRtnDepthMarketData(
 
   uint32_t actDate, actTime;
   if (m_bLocalTime) {
-    TimeUtils::getDateTime(actDate, actTime);
+    CoarseClock::one().getDateTime(actDate, actTime);
   } else {
-    actDate = strtoul(pDepthMarketData->ActionDay, NULL, 10);
+    actDate = strToDate(pDepthMarketData->ActionDay);
     actTime = strToTime(pDepthMarketData->UpdateTime) * 1000 +
               pDepthMarketData->UpdateMillisec;
   }
-  uint32_t actHour = actTime / 10000000;
-
-  if (actDate == m_uTradingDate && actHour >= 20) {
-    // 这样的时间是有问题,因为夜盘时发生日期不可能等于交易日
-    // 这就需要手动设置一下
-    uint32_t curDate, curTime;
-    TimeUtils::getDateTime(curDate, curTime);
-    uint32_t curHour = curTime / 10000000;
-
-    // 早上启动以后,会收到昨晚12点以前收盘的行情,这个时候可能会有发生日期=交易日的情况出现
-    // 这笔数据直接丢掉
-    if (curHour >= 3 && curHour < 9)
-      return;
-
-    actDate = curDate;
-
-    if (actHour == 23 && curHour == 0) {
-      // 行情时间慢于系统时间
-      actDate = TimeUtils::getNextDate(curDate, -1);
-    } else if (actHour == 0 && curHour == 23) {
-      // 系统时间慢于行情时间
-      actDate = TimeUtils::getNextDate(curDate, 1);
-    }
-  }
 
-  WTSContractInfo *cInfo = m_pBaseDataMgr->getContract(
+  if (!fixActionDate(actDate, actTime, m_uTradingDate))
+    return;
+
+  WTSContractInfo *contract = m_sink->getContract(
       pDepthMarketData->InstrumentID, pDepthMarketData->ExchangeID);
-  if (cInfo == NULL)
+  if (contract == NULL)
     return;
 
-  WTSCommodityInfo *pCommInfo = cInfo->getCommInfo();
-
-  // if (strcmp(contract->getExchg(), "CZCE") == 0)
-  //{
-  //	actTime += (uint32_t)(TimeUtils::getLocalTimeNow() % 1000);
-  // }
-
-  WTSTickData *tick = WTSTickData::create(pDepthMarketData->InstrumentID);
-  tick->setContractInfo(cInfo);
-  WTSTickStruct &quote = tick->getTickStruct();
-  strcpy(quote.exchg, pCommInfo->getExchg());
-
-  quote.action_date = actDate != 0 ? actDate : m_uTradingDate;
-  quote.action_time = actTime;
-
-  quote.price = checkValid(pDepthMarketData->LastPrice);
-  quote.open = checkValid(pDepthMarketData->OpenPrice);
-  quote.high = checkValid(pDepthMarketData->HighestPrice);
-  quote.low = checkValid(pDepthMarketData->LowestPrice);
-  quote.total_volume = pDepthMarketData->Volume;
-  quote.trading_date = m_uTradingDate;
-  if (pDepthMarketData->SettlementPrice != DBL_MAX)
-    quote.settle_price = checkValid(pDepthMarketData->SettlementPrice);
-  if (strcmp(quote.exchg, "CZCE") == 0) {
-    quote.total_turnover =
-        pDepthMarketData->Turnover * pCommInfo->getVolScale();
-  } else {
-    if (pDepthMarketData->Turnover != DBL_MAX)
-      quote.total_turnover = pDepthMarketData->Turnover;
-  }
+  if (actDate == 0)
+    actDate = m_uTradingDate;
 
-  quote.open_interest = (uint32_t)pDepthMarketData->OpenInterest;
-
-  quote.upper_limit = checkValid(pDepthMarketData->UpperLimitPrice);
-  quote.lower_limit = checkValid(pDepthMarketData->LowerLimitPrice);
-
-  quote.pre_close = checkValid(pDepthMarketData->PreClosePrice);
-  quote.pre_settle = checkValid(pDepthMarketData->PreSettlementPrice);
-  quote.pre_interest = (uint32_t)pDepthMarketData->PreOpenInterest;
-
-  // 委卖价格
-  quote.ask_prices[0] = checkValid(pDepthMarketData->AskPrice1);
-  quote.ask_prices[1] = checkValid(pDepthMarketData->AskPrice2);
-  quote.ask_prices[2] = checkValid(pDepthMarketData->AskPrice3);
-  quote.ask_prices[3] = checkValid(pDepthMarketData->AskPrice4);
-  quote.ask_prices[4] = checkValid(pDepthMarketData->AskPrice5);
-
-  // 委买价格
-  quote.bid_prices[0] = checkValid(pDepthMarketData->BidPrice1);
-  quote.bid_prices[1] = checkValid(pDepthMarketData->BidPrice2);
-  quote.bid_prices[2] = checkValid(pDepthMarketData->BidPrice3);
-  quote.bid_prices[3] = checkValid(pDepthMarketData->BidPrice4);
-  quote.bid_prices[4] = checkValid(pDepthMarketData->BidPrice5);
-
-  // 委卖量
-  quote.ask_qty[0] = pDepthMarketData->AskVolume1;
-  quote.ask_qty[1] = pDepthMarketData->AskVolume2;
-  quote.ask_qty[2] = pDepthMarketData->AskVolume3;
-  quote.ask_qty[3] = pDepthMarketData->AskVolume4;
-  quote.ask_qty[4] = pDepthMarketData->AskVolume5;
-
-  // 委买量
-  quote.bid_qty[0] = pDepthMarketData->BidVolume1;
-  quote.bid_qty[1] = pDepthMarketData->BidVolume2;
-  quote.bid_qty[2] = pDepthMarketData->BidVolume3;
-  quote.bid_qty[3] = pDepthMarketData->BidVolume4;
-  quote.bid_qty[4] = pDepthMarketData->BidVolume5;
+  WTSTickData *tick = CtpTickConverter::convert(
+      pDepthMarketData->InstrumentID, pDepthMarketData, contract, actDate,
+      actTime, m_uTradingDate);
 
   if (m_sink)
     m_sink->handleQuote(tick, 1);
@@ -10,18 +10,58 @@
 #include "ParserHuaX.h"
 #include "../Includes/WTSVersion.h"
 
-template <typename... Args>
-inline void write_log(IParserSpi *sink, WTSLogLevel ll, const char *format,
-                      const Args &...args) {
-  if (sink == NULL)
-    return;
-
-  static thread_local char buffer[512] = {0};
-  memset(buffer, 0, 512);
-  fmt::format_to(buffer, format, args...);
+#include "../Share/ParserHelper.hpp"
 
-  sink->handleParserLog(ll, buffer);
-}
+/*
+ *	华鑫行情结构体的字段映射,五档行情
+ */
+struct HuaXFieldPolicy {
+  typedef CTORATstpMarketDataField FieldType;
+
+  static inline void fill(WTSTickStruct &quote,
+                          const CTORATstpMarketDataField *pData,
+                          WTSCommodityInfo *commInfo) {
+    quote.price = checkValid(pData->LastPrice);
+    quote.open = checkValid(pData->OpenPrice);
+    quote.high = checkValid(pData->HighestPrice);
+    quote.low = checkValid(pData->LowestPrice);
+    quote.total_volume = (uint32_t)pData->Volume;
+    quote.total_turnover = pData->Turnover;
+
+    quote.upper_limit = checkValid(pData->UpperLimitPrice);
+    quote.lower_limit = checkValid(pData->LowerLimitPrice);
+
+    quote.pre_close = checkValid(pData->PreClosePrice);
+
+    // 委卖价格
+    quote.ask_prices[0] = checkValid(pData->AskPrice1);
+    quote.ask_prices[1] = checkValid(pData->AskPrice2);
+    quote.ask_prices[2] = checkValid(pData->AskPrice3);
+    quote.ask_prices[3] = checkValid(pData->AskPrice4);
+    quote.ask_prices[4] = checkValid(pData->AskPrice5);
+
+    // 委卖量
+    quote.ask_qty[0] = checkValid(pData->AskVolume1);
+    quote.ask_qty[1] = checkValid(pData->AskVolume2);
+    quote.ask_qty[2] = checkValid(pData->AskVolume3);
+    quote.ask_qty[3] = checkValid(pData->AskVolume4);
+    quote.ask_qty[4] = checkValid(pData->AskVolume5);
+
+    // 委买价格
+    quote.bid_prices[0] = checkValid(pData->BidPrice1);
+    quote.bid_prices[1] = checkValid(pData->BidPrice2);
+    quote.bid_prices[2] = checkValid(pData->BidPrice3);
+    quote.bid_prices[3] = checkValid(pData->BidPrice4);
+    quote.bid_prices[4] = checkValid(pData->BidPrice5);
+
+    // 委买量
+    quote.bid_qty[0] = checkValid(pData->BidVolume1);
+    quote.bid_qty[1] = checkValid(pData->BidVolume2);
+    quote.bid_qty[2] = checkValid(pData->BidVolume3);
+    quote.bid_qty[3] = checkValid(pData->BidVolume4);
+    quote.bid_qty[4] = checkValid(pData->BidVolume5);
+  }
+};
 
 extern "C" {
 EXPORT_FLAG IParserApi *createParser() {
@@ -37,26 +77,6 @@ EXPORT_FLAG void deleteParser(IParserApi *&parser) {
 }
 };
 
-inline uint32_t strToTime(const char *strTime) {
-  std::string str;
-  const char *pos = strTime;
-  while (strlen(pos) > 0) {
-    if (pos[0] != ':') {
-      str.append(pos, 1);
-    }
-    pos++;
-  }
-
-  return strtoul(str.c_str(), NULL, 10);
-}
-
-inline double checkValid(double val) {
-  if (val == DBL_MAX || val == FLT_MAX)
-    return 0;
-
-  return val;
-}
-
 ParserHuaX::ParserHuaX() : _api(NULL), _iRequestID(0), _uTradingDate(0) {}
 
 ParserHuaX::~ParserHuaX() { _api = NULL; }
@@ -355,15 +375,11 @@ void ParserHuaX::OnRtnMarketData(CTORATstpMarketDataField *market_data) {
     return;
   }
 
-  uint32_t actDate = (uint32_t)stoi(market_data->TradingDay);
-  auto time_vector = StrUtil::split(market_data->UpdateTime, ":");
-  uint32_t actTime{0};
-  for (std::string time_str : time_vector) {
-    actTime = actTime * 100;
-    actTime += std::stoi(time_str);
-  }
-  actTime = actTime * 1000 + market_data->UpdateMillisec;
-  std::string code, exchg;
+  uint32_t actDate = strToDate(market_data->TradingDay);
+  uint32_t actTime =
+      strToTime(market_data->UpdateTime) * 1000 + market_data->UpdateMillisec;
+
+  const char *exchg;
   if (market_data->ExchangeID == TORA_TSTP_EXD_SSE) {
     exchg = WT_MKT_SH_A;
   } else if (market_data->ExchangeID == TORA_TSTP_EXD_SZSE) {
@@ -371,65 +387,18 @@ void ParserHuaX::OnRtnMarketData(CTORATstpMarketDataField *market_data) {
   } else
     return;
 
-  code = market_data->SecurityID;
+  const char *code = market_data->SecurityID;
 
-  WTSContractInfo *ct = _pBaseDataMgr->getContract(code.c_str(), exchg.c_str());
+  WTSContractInfo *ct = _sink->getContract(code, exchg);
   if (ct == NULL) {
     if (_sink)
       write_log(_sink, LL_ERROR, "[ParserHuaX] Instrument {}.{} not exists...",
                 exchg, code);
     return;
   }
-  WTSCommodityInfo *commInfo = ct->getCommInfo();
-
-  WTSTickData *tick = WTSTickData::create(code.c_str());
-  tick->setContractInfo(ct);
-  WTSTickStruct &quote = tick->getTickStruct();
-  strcpy(quote.exchg, commInfo->getExchg());
-
-  quote.action_date = actDate;
-  quote.action_time = actTime;
-
-  quote.price = checkValid(market_data->LastPrice);
-  quote.open = checkValid(market_data->OpenPrice);
-  quote.high = checkValid(market_data->HighestPrice);
-  quote.low = checkValid(market_data->LowestPrice);
-  quote.total_volume = (uint32_t)market_data->Volume;
-  quote.trading_date = actDate;
-  quote.total_turnover = market_data->Turnover;
-
-  quote.upper_limit = checkValid(market_data->UpperLimitPrice);
-  quote.lower_limit = checkValid(market_data->LowerLimitPrice);
-
-  quote.pre_close = checkValid(market_data->PreClosePrice);
-
-  // 委卖价格
-  quote.ask_prices[0] = checkValid(market_data->AskPrice1);
-  quote.ask_prices[1] = checkValid(market_data->AskPrice2);
-  quote.ask_prices[2] = checkValid(market_data->AskPrice3);
-  quote.ask_prices[3] = checkValid(market_data->AskPrice4);
-  quote.ask_prices[4] = checkValid(market_data->AskPrice5);
-
-  // 委卖量
-  quote.ask_qty[0] = checkValid(market_data->AskVolume1);
-  quote.ask_qty[1] = checkValid(market_data->AskVolume2);
-  quote.ask_qty[2] = checkValid(market_data->AskVolume3);
-  quote.ask_qty[3] = checkValid(market_data->AskVolume4);
-  quote.ask_qty[4] = checkValid(market_data->AskVolume5);
-
-  // 委买价格
-  quote.bid_prices[0] = checkValid(market_data->BidPrice1);
-  quote.bid_prices[1] = checkValid(market_data->BidPrice2);
-  quote.bid_prices[2] = checkValid(market_data->BidPrice3);
-  quote.bid_prices[3] = checkValid(market_data->BidPrice4);
-  quote.bid_prices[4] = checkValid(market_data->BidPrice5);
-
-  // 委买量
-  quote.bid_qty[0] = checkValid(market_data->BidVolume1);
-  quote.bid_qty[1] = checkValid(market_data->BidVolume2);
-  quote.bid_qty[2] = checkValid(market_data->BidVolume3);
-  quote.bid_qty[3] = checkValid(market_data->BidVolume4);
-  quote.bid_qty[4] = checkValid(market_data->BidVolume5);
+
+  WTSTickData *tick = TickConverter<HuaXFieldPolicy>::convert(
+      code, market_data, ct, actDate, actTime, actDate);
 
   if (_sink)
     _sink->handleQuote(tick, 1);
@@ -24,19 +24,7 @@
 #endif
 #endif
 
-// By Wesley @ 2022.01.05
-#include "../Share/fmtlib.h"
-template <typename... Args>
-inline void write_log(IParserSpi *sink, WTSLogLevel ll, const char *format,
-                      const Args &...args) {
-  if (sink == NULL)
-    return;
-
-  static thread_local char buffer[512] = {0};
-  fmtutil::format_to(buffer, format, args...);
-
-  sink->handleParserLog(ll, buffer);
-}
+#include "../Share/ParserHelper.hpp"
 
 extern "C" {
 EXPORT_FLAG IParserApi *createParser() {
@@ -364,21 +352,17 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
   case MDS_MSGTYPE_L2_TRADE:
     /* 处理Level2逐笔成交消息 @see MdsL2TradeT */
     {
-      std::string code, exchg;
-      if (pRspMsg->trade.exchId == MDS_EXCH_SSE) {
-        exchg = "SSE";
-      } else {
-        exchg = "SZSE";
-      }
-      code = pRspMsg->trade.SecurityID;
+      const char *exchg =
+          (pRspMsg->trade.exchId == MDS_EXCH_SSE) ? "SSE" : "SZSE";
+      const char *code = pRspMsg->trade.SecurityID;
 
-      WTSContractInfo *ct = _bd_mgr->getContract(code.c_str(), exchg.c_str());
+      WTSContractInfo *ct = _sink->getContract(code, exchg);
       if (ct == NULL) {
         return;
       }
       WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-      WTSTransData *trans = WTSTransData::create(code.c_str());
+      WTSTransData *trans = WTSTransData::create(code);
       WTSTransStruct &ts = trans->getTransStruct();
       strcpy(ts.exchg, commInfo->getExchg());
 
@@ -410,21 +394,17 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
   case MDS_MSGTYPE_L2_SSE_ORDER:
     /* 处理Level2逐笔委托消息 @see MdsL2OrderT */
     {
-      std::string code, exchg;
-      if (pRspMsg->order.exchId == MDS_EXCH_SSE) {
-        exchg = "SSE";
-      } else {
-        exchg = "SZSE";
-      }
-      code = pRspMsg->order.SecurityID;
+      const char *exchg =
+          (pRspMsg->order.exchId == MDS_EXCH_SSE) ? "SSE" : "SZSE";
+      const char *code = pRspMsg->order.SecurityID;
 
-      WTSContractInfo *ct = _bd_mgr->getContract(code.c_str(), exchg.c_str());
+      WTSContractInfo *ct = _sink->getContract(code, exchg);
       if (ct == NULL) {
         return;
       }
       WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-      WTSOrdDtlData *ordDtl = WTSOrdDtlData::create(code.c_str());
+      WTSOrdDtlData *ordDtl = WTSOrdDtlData::create(code);
       WTSOrdDtlStruct &ts = ordDtl->getOrdDtlStruct();
       strcpy(ts.exchg, commInfo->getExchg());
 
@@ -453,15 +433,12 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
   case MDS_MSGTYPE_L2_MARKET_DATA_SNAPSHOT:
     /* 处理Level2快照行情消息 @see MdsL2StockSnapshotBodyT */
     {
-      std::string code, exchg;
-      if (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) {
-        exchg = "SSE";
-      } else {
-        exchg = "SZSE";
-      }
-      code = pRspMsg->mktDataSnapshot.l2Stock.SecurityID;
+      const char *exchg =
+          (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) ? "SSE"
+                                                                 : "SZSE";
+      const char *code = pRspMsg->mktDataSnapshot.l2Stock.SecurityID;
 
-      WTSContractInfo *ct = _bd_mgr->getContract(code.c_str(), exchg.c_str());
+      WTSContractInfo *ct = _sink->getContract(code, exchg);
       if (ct == NULL) {
         // if (_sink)
         //	write_log(_sink, LL_ERROR, "[ParserXTP] Instrument {}.{} not
@@ -470,7 +447,7 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
       }
       WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-      WTSTickData *tick = WTSTickData::create(code.c_str());
+      WTSTickData *tick = WTSTickData::create(code);
       tick->setContractInfo(ct);
       WTSTickStruct &quote = tick->getTickStruct();
       strcpy(quote.exchg, commInfo->getExchg());
@@ -520,15 +497,12 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
     /* 处理Level2委托队列消息(买一／卖一前五十笔委托明细) @see
      * MdsL2BestOrdersSnapshotBodyT */
     {
-      std::string code, exchg;
-      if (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) {
-        exchg = "SSE";
-      } else {
-        exchg = "SZSE";
-      }
-      code = pRspMsg->mktDataSnapshot.l2BestOrders.SecurityID;
+      const char *exchg =
+          (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) ? "SSE"
+                                                                 : "SZSE";
+      const char *code = pRspMsg->mktDataSnapshot.l2BestOrders.SecurityID;
 
-      WTSContractInfo *ct = _bd_mgr->getContract(code.c_str(), exchg.c_str());
+      WTSContractInfo *ct = _sink->getContract(code, exchg);
       if (ct == NULL) {
         // if (_sink)
         //	write_log(_sink, LL_ERROR, "[ParserXTP] Instrument {}.{} not
@@ -537,10 +511,10 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
       }
       WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-      WTSOrdQueData *buyQue = WTSOrdQueData::create(code.c_str());
+      WTSOrdQueData *buyQue = WTSOrdQueData::create(code);
       buyQue->setContractInfo(ct);
 
-      WTSOrdQueData *sellQue = WTSOrdQueData::create(code.c_str());
+      WTSOrdQueData *sellQue = WTSOrdQueData::create(code);
       sellQue->setContractInfo(ct);
 
       WTSOrdQueStruct &buyOS = buyQue->getOrdQueStruct();
@@ -600,15 +574,12 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
   case MDS_MSGTYPE_MARKET_DATA_SNAPSHOT_FULL_REFRESH:
     /* 处理Level1快照行情消息 @see MdsStockSnapshotBodyT */
     {
-      std::string code, exchg;
-      if (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) {
-        exchg = "SSE";
-      } else {
-        exchg = "SZSE";
-      }
-      code = pRspMsg->mktDataSnapshot.stock.SecurityID;
+      const char *exchg =
+          (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) ? "SSE"
+                                                                 : "SZSE";
+      const char *code = pRspMsg->mktDataSnapshot.stock.SecurityID;
 
-      WTSContractInfo *ct = _bd_mgr->getContract(code.c_str(), exchg.c_str());
+      WTSContractInfo *ct = _sink->getContract(code, exchg);
       if (ct == NULL) {
         // if (_sink)
         //	write_log(_sink, LL_ERROR, "[ParserXTP] Instrument {}.{} not
@@ -617,7 +588,7 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
       }
       WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-      WTSTickData *tick = WTSTickData::create(code.c_str());
+      WTSTickData *tick = WTSTickData::create(code);
       tick->setContractInfo(ct);
       WTSTickStruct &quote = tick->getTickStruct();
       strcpy(quote.exchg, commInfo->getExchg());
@@ -666,15 +637,12 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
   case MDS_MSGTYPE_OPTION_SNAPSHOT_FULL_REFRESH:
     /* 处理期权快照行情消息 @see MdsStockSnapshotBodyT */
     {
-      std::string code, exchg;
-      if (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) {
-        exchg = "SSE";
-      } else {
-        exchg = "SZSE";
-      }
-      code = pRspMsg->mktDataSnapshot.option.SecurityID;
+      const char *exchg =
+          (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) ? "SSE"
+                                                                 : "SZSE";
+      const char *code = pRspMsg->mktDataSnapshot.option.SecurityID;
 
-      WTSContractInfo *ct = _bd_mgr->getContract(code.c_str(), exchg.c_str());
+      WTSContractInfo *ct = _sink->getContract(code, exchg);
       if (ct == NULL) {
         // if (_sink)
         //	write_log(_sink, LL_ERROR, "[ParserXTP] Instrument {}.{} not
@@ -683,7 +651,7 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
       }
       WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-      WTSTickData *tick = WTSTickData::create(code.c_str());
+      WTSTickData *tick = WTSTickData::create(code);
       tick->setContractInfo(ct);
       WTSTickStruct &quote = tick->getTickStruct();
       strcpy(quote.exchg, commInfo->getExchg());
@@ -734,21 +702,18 @@ void ParserOES::doOnMessage(SMsgHeadT *pMsgHead, void *pMsgItem) {
   case MDS_MSGTYPE_INDEX_SNAPSHOT_FULL_REFRESH:
     /* 处理指数行情消息 @see MdsIndexSnapshotBodyT */
     {
-      std::string code, exchg;
-      if (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) {
-        exchg = "SSE";
-      } else {
-        exchg = "SZSE";
-      }
-      code = pRspMsg->mktDataSnapshot.index.SecurityID;
+      const char *exchg =
+          (pRspMsg->mktDataSnapshot.head.exchId == MDS_EXCH_SSE) ? "SSE"
+                                                                 : "SZSE";
+      const char *code = pRspMsg->mktDataSnapshot.index.SecurityID;
 
-      WTSContractInfo *ct = _bd_mgr->getContract(code.c_str(), exchg.c_str());
+      WTSContractInfo *ct = _sink->getContract(code, exchg);
       if (ct == NULL) {
         return;
       }
       WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-      WTSTickData *tick = WTSTickData::create(code.c_str());
+      WTSTickData *tick = WTSTickData::create(code);
       tick->setContractInfo(ct);
       WTSTickStruct &quote = tick->getTickStruct();
       strcpy(quote.exchg, commInfo->getExchg());
@@ -13,6 +13,12 @@
 
 #include <boost/bind.hpp>
 
+#ifdef _MSC_VER
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
 // By Wesley @ 2022.01.05
 #include "../Share/fmtlib.h"
 template <typename... Args>
@@ -33,8 +39,6 @@ inline void write_log(IParserSpi *sink, WTSLogLevel ll, const char *format,
 #define UDP_MSG_PUSHORDDTL 0x202 // 委托明细
 #define UDP_MSG_PUSHTRANS 0x203  // 逐笔成交
 
-#define NODATA_FLAG 0xfffffffffffffffe
-
 extern "C" {
 EXPORT_FLAG IParserApi *createParser() {
   ParserShm *parser = new ParserShm();
@@ -50,7 +54,8 @@ EXPORT_FLAG void deleteParser(IParserApi *&parser) {
 };
 
 ParserShm::ParserShm()
-    : _stopped(false), _sink(NULL), _queue(NULL), _check_span(0) {}
+    : _stopped(false), _sink(NULL), _check_span(0), _spin(false),
+      _connected(false) {}
 
 ParserShm::~ParserShm() {}
 
@@ -60,72 +65,107 @@ bool ParserShm::init(WTSVariant *config) {
   if (_gpsize == 0)
     _gpsize = 1000;
   _check_span = config->getUInt32("checkspan");
+  _spin = config->getBoolean("spin");
 
   return true;
 }
 
 void ParserShm::release() {}
 
+bool ParserShm::attach_queue() {
+  _mapfile.reset(new BoostMappingFile);
+  if (!_mapfile->map(_path.c_str()))
+    return false;
+
+  return _queue.attach(_mapfile->addr(), _mapfile->size());
+}
+
+inline void ParserShm::idle() {
+  if (_spin) {
+#ifdef _MSC_VER
+    _mm_pause();
+#else
+    __builtin_ia32_pause();
+#endif
+  } else if (_check_span != 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(_check_span));
+  } else {
+    std::this_thread::yield();
+  }
+}
+
 bool ParserShm::connect() {
   _thrd_parser.reset(new StdThread([this]() {
     write_log(_sink, LL_INFO, "[ParserShm] loading {} ...", _path);
-    while (!StdFile::exists(_path.c_str())) {
+    while (!_stopped) {
+      if (StdFile::exists(_path.c_str()) && attach_queue())
+        break;
+
       write_log(_sink, LL_WARN,
-                "[ParserShm] {} not exist yet, waiting for 2 seconds", _path);
+                "[ParserShm] {} not exist or not ready yet, waiting for 2 "
+                "seconds",
+                _path);
       std::this_thread::sleep_for(std::chrono::seconds(2));
-      continue;
     }
 
-    _mapfile.reset(new BoostMappingFile);
-    _mapfile->map(_path.c_str());
-    _queue = (CastQueue *)_mapfile->addr();
-    uint32_t cast_pid = _queue->_pid;
+    if (_stopped)
+      return;
+
+#ifdef _MSC_VER
+    uint32_t pid = _getpid();
+#else
+    uint32_t pid = getpid();
+#endif
+    uint32_t cast_pid = _queue.pid();
+    _reader.attach(&_queue, pid);
+    _connected = true;
 
     if (_sink) {
       _sink->handleEvent(WPE_Connect, 0);
       _sink->handleEvent(WPE_Login, 0);
     }
-    write_log(_sink, LL_INFO, "[ParserShm] {} loaded, start to receiving",
-              _path);
+    write_log(_sink, LL_INFO,
+              "[ParserShm] {} loaded, capacity: {}, start to receiving", _path,
+              _queue.capacity());
 
-    uint64_t lastIdx = UINT64_MAX;
+    ShmDataItem item;
+    uint64_t lost = 0;
     while (!_stopped) {
-      // 如果pid不同，说明datakit重启了
-      if (cast_pid != _queue->_pid) {
-        lastIdx = UINT64_MAX;
-        write_log(_sink, LL_WARN, "ShareMemory queue has been reset justnow");
-        cast_pid = _queue->_pid;
+      // pid为0说明datakit正在重建队列,等初始化完成再处理
+      uint32_t cur_pid = _queue.pid();
+      if (cur_pid == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        continue;
       }
 
-      if (_queue->_readable == UINT64_MAX) // 刚分配好，还没数据进来
-      {
-        lastIdx = NODATA_FLAG;
-        if (_check_span != 0)
-          std::this_thread::sleep_for(std::chrono::microseconds(_check_span));
+      // 如果pid不同，说明datakit重启了，队列大小也可能变了，要重新映射
+      if (cast_pid != cur_pid) {
+        write_log(_sink, LL_WARN,
+                  "[ParserShm] ShareMemory queue has been reset justnow");
+        _reader.detach();
+        while (!_stopped && !attach_queue())
+          std::this_thread::sleep_for(std::chrono::seconds(2));
+
+        if (_stopped)
+          break;
+
+        cast_pid = _queue.pid();
+        _reader.attach(&_queue, pid);
         continue;
       }
 
-      if (lastIdx == UINT64_MAX) // 有数据，第一次检查，则直接定位到最后一条数据
-      {
-        lastIdx = _queue->_readable;
-        if (_check_span != 0)
-          std::this_thread::sleep_for(std::chrono::microseconds(_check_span));
+      ShmCastReader::ReadResult ret = _reader.read(item, lost);
+      if (ret == ShmCastReader::SRR_Empty) {
+        idle();
         continue;
-      } else if (
-          lastIdx ==
-          NODATA_FLAG) // 之前没数据的时候检查了一次，现在有数据了，从0开始读取
-      {
-        lastIdx = 0;
-      } else if (lastIdx >= _queue->_readable) // 没有新的数据进来
-      {
-        if (_check_span != 0)
-          std::this_thread::sleep_for(std::chrono::microseconds(_check_span));
+      } else if (ret == ShmCastReader::SRR_Overrun) {
+        write_log(_sink, LL_WARN,
+                  "[ParserShm] {} items overwritten before being read, {} "
+                  "overruns and {} items lost in total",
+                  lost, _reader.overrun_count(), _reader.lost_count());
         continue;
-      } else {
-        lastIdx++; // 普通情况，下标递增
       }
 
-      DataItem &item = _queue->_items[lastIdx % _queue->_capacity];
       switch (item._type) {
       case 0: {
         const char *fullCode =
@@ -200,6 +240,10 @@ bool ParserShm::connect() {
         break;
       }
     }
+
+    // 退出的时候注销读进程登记信息
+    _reader.detach();
+    _connected = false;
   }));
 
   return true;
@@ -211,7 +255,7 @@ bool ParserShm::disconnect() {
   return true;
 }
 
-bool ParserShm::isConnected() { return _queue != NULL; }
+bool ParserShm::isConnected() { return _connected; }
 
 void ParserShm::subscribe(const CodeSet &vecSymbols) {
   auto cit = vecSymbols.begin();
@@ -11,6 +11,7 @@
 #include "../Includes/IParserApi.h"
 #include "../Includes/WTSStruct.h"
 #include "../Share/BoostMappingFile.hpp"
+#include "../Share/ShmCastQueue.hpp"
 #include "../Share/StdUtils.hpp"
 
 #include <boost/asio.hpp>
@@ -24,34 +25,6 @@ public:
   ParserShm();
   ~ParserShm();
 
-#pragma pack(push, 8)
-  typedef struct _DataItem {
-    uint32_t _type; // 数据类型， 0-tick,1-委托队列,2-逐笔委托,3-逐笔成交
-    union {
-      WTSTickStruct _tick;
-      WTSOrdQueStruct _queue;
-      WTSOrdDtlStruct _order;
-      WTSTransStruct _trans;
-    };
-
-    _DataItem() { memset(this, 0, sizeof(_DataItem)); }
-  } DataItem;
-
-  template <int N = 8 * 1024> struct _DataQueue {
-    uint64_t _capacity = N;
-    volatile uint64_t _readable;
-    volatile uint64_t _writable;
-    uint32_t _pid;
-    DataItem _items[N];
-
-    _DataQueue() : _readable(UINT64_MAX), _writable(0), _pid(0) {}
-  };
-
-  typedef _DataQueue<8 * 1024> CastQueue;
-
-#pragma pack(pop)
-
-public:
   virtual bool init(WTSVariant *config) override;
 
   virtual void release() override;
@@ -67,13 +40,27 @@ public:
 
   virtual void registerSpi(IParserSpi *listener) override;
 
+private:
+  /*
+   *	映射共享内存并挂载队列,写进程重启以后也要重新调用
+   */
+  bool attach_queue();
+
+  /*
+   *	没有新数据时的等待
+   */
+  inline void idle();
+
 private:
   std::string _path;
   typedef std::shared_ptr<BoostMappingFile> MappedFilePtr;
   MappedFilePtr _mapfile;
-  CastQueue *_queue;
+  ShmCastQueue _queue;
+  ShmCastReader _reader;
   uint32_t _gpsize;
   uint32_t _check_span;
+  bool _spin; // 是否忙等读取
+  bool _connected;
 
   IParserSpi *_sink;
   bool _stopped;
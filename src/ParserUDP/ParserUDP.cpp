@@ -11,6 +11,7 @@
 #include "../Includes/WTSDataDef.hpp"
 #include "../Includes/WTSVariant.hpp"
 
+#include <algorithm>
 #include <boost/bind.hpp>
 
 // By Wesley @ 2022.01.05
@@ -28,10 +29,18 @@ inline void write_log(IParserSpi *sink, WTSLogLevel ll, const char *format,
 }
 
 #define UDP_MSG_SUBSCRIBE 0x100
+#define UDP_MSG_RETRANSMIT 0x110    // 重传请求
 #define UDP_MSG_PUSHTICK 0x200
-#define UDP_MSG_PUSHORDQUE 0x201 // 委托队列
-#define UDP_MSG_PUSHORDDTL 0x202 // 委托明细
-#define UDP_MSG_PUSHTRANS 0x203  // 逐笔成交
+#define UDP_MSG_PUSHORDQUE 0x201    // 委托队列
+#define UDP_MSG_PUSHORDDTL 0x202    // 委托明细
+#define UDP_MSG_PUSHTRANS 0x203     // 逐笔成交
+#define UDP_MSG_PUSHTICKDELTA 0x204 // 增量编码的tick
+#define UDP_MSG_PUSHBATCH 0x300     // 批量数据
+#define UDP_MSG_PUSHSEQ 0x301       // 带序号的数据
+
+#define MAX_RETRANS_COUNT 256  // 单次请求重传的最大数据包个数
+#define MAX_MISSING_SEQS 65536 // 每个通道最多记录的缺失序号个数
+#define MAX_PENDING_REQS 64    // 发送队列里最多积压的重传请求个数
 
 #pragma pack(push, 1)
 
@@ -47,6 +56,30 @@ typedef struct _UDPReqPacket : UDPPacketHead {
 template <typename T> struct UDPDataPacket : UDPPacketHead {
   T _data;
 };
+
+// 批量数据包头,后面跟着_count个UDPDataPacket
+typedef struct _UDPBatchHead : UDPPacketHead {
+  uint16_t _count;
+  uint16_t _reserved;
+} UDPBatchHead;
+
+// 增量tick包头,后面跟着_len字节的编码数据
+typedef struct _UDPDeltaHead : UDPPacketHead {
+  uint16_t _len;
+} UDPDeltaHead;
+
+// 序号包头,后面跟着一个普通数据包或者批量数据包
+typedef struct _UDPSeqHead : UDPPacketHead {
+  uint32_t _channel;
+  uint64_t _seq;
+} UDPSeqHead;
+
+// 重传请求,放在UDPReqPacket的_data里
+typedef struct _UDPRetransReq {
+  uint32_t _channel;
+  uint64_t _from;
+  uint32_t _count;
+} UDPRetransReq;
 #pragma pack(pop)
 typedef UDPDataPacket<WTSTickStruct> UDPTickPacket;
 typedef UDPDataPacket<WTSOrdQueStruct> UDPOrdQuePacket;
@@ -69,7 +102,8 @@ EXPORT_FLAG void deleteParser(IParserApi *&parser) {
 
 ParserUDP::ParserUDP()
     : _b_socket(NULL), _s_socket(NULL), _strand(_io_service), _stopped(false),
-      _sink(NULL), _connecting(false), _s_inited(false) {}
+      _sink(NULL), _connecting(false), _s_inited(false), _retrans(false),
+      _sequenced(false), _delta_dropped(0) {}
 
 ParserUDP::~ParserUDP() {}
 
@@ -80,6 +114,7 @@ bool ParserUDP::init(WTSVariant *config) {
   _gpsize = config->getUInt32("gpsize");
   if (_gpsize == 0)
     _gpsize = 1000;
+  _retrans = config->getBoolean("retrans");
 
   ip::address addr = ip::address::from_string(_hots);
   _server_ep = ip::udp::endpoint(addr, _sport);
@@ -201,12 +236,14 @@ void ParserUDP::handle_write(const boost::system::error_code &e) {
     write_log(_sink, LL_ERROR,
               "[ParserUDP] Error occured while sending: {}({})",
               e.message().c_str(), e.value());
-  } else {
-    StdUniqueLock lock(_mtx_queue);
+  }
+
+  // 发送失败的数据包也要出队,否则后面的请求都会卡住
+  StdUniqueLock lock(_mtx_queue);
+  if (!_send_queue.empty())
     _send_queue.pop();
 
-    do_send();
-  }
+  do_send();
 }
 
 bool ParserUDP::connect() {
@@ -295,29 +332,202 @@ void ParserUDP::handle_read(const boost::system::error_code &e,
 }
 
 void ParserUDP::extract_buffer(uint32_t length, bool isBroad /* = true */) {
-  UDPPacketHead *header = NULL;
-  if (isBroad)
-    header = (UDPTickPacket *)_b_buffer.data();
-  else
-    header = (UDPTickPacket *)_s_buffer.data();
+  char *data = isBroad ? _b_buffer.data() : _s_buffer.data();
+  if (length < sizeof(UDPPacketHead))
+    return;
 
-  if (header->_type == UDP_MSG_PUSHTICK || header->_type == UDP_MSG_SUBSCRIBE) {
-    UDPTickPacket *packet = (UDPTickPacket *)header;
-    const char *fullCode =
-        fmtutil::format("{}.{}", packet->_data.exchg, packet->_data.code);
-    auto it = _set_subs.find(fullCode);
-    if (it != _set_subs.end()) {
-      WTSTickData *curTick = WTSTickData::create(packet->_data);
-      if (_sink)
-        _sink->handleQuote(curTick, 0);
+  UDPPacketHead *header = (UDPPacketHead *)data;
+  if (header->_type == UDP_MSG_PUSHSEQ) {
+    if (length < sizeof(UDPSeqHead))
+      return;
+
+    // 重复的数据包直接丢掉
+    UDPSeqHead *seqHead = (UDPSeqHead *)data;
+    if (!check_sequence(seqHead->_channel, seqHead->_seq))
+      return;
 
-      curTick->release();
+    extract_data(data + sizeof(UDPSeqHead), length - sizeof(UDPSeqHead));
+  } else {
+    extract_data(data, length);
+  }
+}
 
-      static uint32_t recv_cnt = 0;
-      recv_cnt++;
-      if (recv_cnt % _gpsize == 0)
-        write_log(_sink, LL_DEBUG, "[ParserUDP] {} ticks received in total",
-                  recv_cnt);
+bool ParserUDP::check_sequence(uint32_t channel, uint64_t seq) {
+  _sequenced = true;
+  ChannelStat &stat = _channels[channel];
+
+  // 第一个数据包,或者广播端重启了,从当前序号开始
+  if (stat._last_seq == 0 || seq == 1 ||
+      (seq < stat._last_seq && stat._last_seq - seq > MAX_MISSING_SEQS)) {
+    if (stat._last_seq != 0)
+      write_log(_sink, LL_WARN,
+                "[ParserUDP] Sequence of channel {} reset: #{} -> #{}",
+                channel, stat._last_seq, seq);
+    stat._last_seq = seq;
+    stat._missing.clear();
+    stat._recv_cnt++;
+    return true;
+  }
+
+  if (seq == stat._last_seq + 1) {
+    stat._last_seq = seq;
+    stat._recv_cnt++;
+    return true;
+  }
+
+  if (seq > stat._last_seq) {
+    // 出现缺口,记下缺失的序号,并请求重传
+    uint64_t from = stat._last_seq + 1;
+    uint64_t count = seq - from;
+    stat._lost_cnt += count;
+    stat._gap_cnt++;
+    // 缺口太大的时候只记最近的部分,更早的序号记了也会马上被挤掉
+    uint64_t start = (count > MAX_MISSING_SEQS) ? seq - MAX_MISSING_SEQS : from;
+    for (uint64_t s = start; s < seq; s++) {
+      stat._missing.insert(s);
+      if (stat._missing.size() > MAX_MISSING_SEQS)
+        stat._missing.erase(stat._missing.begin());
+    }
+    stat._last_seq = seq;
+    stat._recv_cnt++;
+
+    write_log(_sink, LL_WARN,
+              "[ParserUDP] Gap detected on channel {}: #{} - #{}, {} gaps, {} "
+              "lost, {} recovered, {} received in total",
+              channel, from, seq - 1, stat._gap_cnt, stat._lost_cnt,
+              stat._recovered_cnt, stat._recv_cnt);
+
+    if (_retrans) {
+      uint32_t reqCnt = (uint32_t)std::min(count, (uint64_t)MAX_RETRANS_COUNT);
+      request_retransmit(channel, from, reqCnt);
+    }
+    return true;
+  }
+
+  // 比当前序号小,如果是缺失的数据包,说明是重传或者乱序到达的
+  auto it = stat._missing.find(seq);
+  if (it != stat._missing.end()) {
+    stat._missing.erase(it);
+    stat._recovered_cnt++;
+    stat._recv_cnt++;
+    return true;
+  }
+
+  stat._dup_cnt++;
+  return false;
+}
+
+void ParserUDP::request_retransmit(uint32_t channel, uint64_t from,
+                                   uint32_t count) {
+  std::string data;
+  data.resize(sizeof(UDPReqPacket), 0);
+  UDPReqPacket *req = (UDPReqPacket *)data.data();
+  req->_type = UDP_MSG_RETRANSMIT;
+  UDPRetransReq *rtReq = (UDPRetransReq *)req->_data;
+  rtReq->_channel = channel;
+  rtReq->_from = from;
+  rtReq->_count = count;
+
+  bool bIdle = false;
+  {
+    // 订阅通道没建好或者发不出去的时候,积压的请求直接丢掉,不让队列一直涨
+    StdUniqueLock lock(_mtx_queue);
+    if (_s_socket == NULL || _send_queue.size() >= MAX_PENDING_REQS) {
+      write_log(_sink, LL_WARN,
+                "[ParserUDP] Retransmit request of channel {} from #{} "
+                "dropped, {} requests pending",
+                channel, from, _send_queue.size());
+      return;
+    }
+
+    bIdle = _send_queue.empty();
+    _send_queue.push(data);
+  }
+
+  // 没有正在发送的请求,才需要主动发送,否则在发送回调里会接着发
+  if (bIdle)
+    do_send();
+}
+
+void ParserUDP::extract_data(char *data, uint32_t length) {
+  UDPPacketHead *header = (UDPPacketHead *)data;
+  if (length < sizeof(UDPPacketHead))
+    return;
+
+  if (header->_type == UDP_MSG_PUSHTICKDELTA) {
+    if (length < sizeof(UDPDeltaHead) ||
+        length < sizeof(UDPDeltaHead) + ((UDPDeltaHead *)data)->_len)
+      return;
+  }
+
+  if (header->_type != UDP_MSG_PUSHBATCH) {
+    extract_packet(header);
+    return;
+  }
+
+  // 批量数据包,逐个拆出来处理
+  if (length < sizeof(UDPBatchHead))
+    return;
+
+  const UDPBatchHead *batch = (const UDPBatchHead *)data;
+  uint32_t offset = sizeof(UDPBatchHead);
+  for (uint16_t i = 0; i < batch->_count; i++) {
+    if (offset + sizeof(UDPPacketHead) > length)
+      break;
+
+    UDPPacketHead *item = (UDPPacketHead *)(data + offset);
+    uint32_t itemSize = 0;
+    switch (item->_type) {
+    case UDP_MSG_PUSHTICK:
+      itemSize = sizeof(UDPTickPacket);
+      break;
+    case UDP_MSG_PUSHORDDTL:
+      itemSize = sizeof(UDPOrdDtlPacket);
+      break;
+    case UDP_MSG_PUSHORDQUE:
+      itemSize = sizeof(UDPOrdQuePacket);
+      break;
+    case UDP_MSG_PUSHTRANS:
+      itemSize = sizeof(UDPTransPacket);
+      break;
+    case UDP_MSG_PUSHTICKDELTA:
+      // 增量tick是变长的
+      if (offset + sizeof(UDPDeltaHead) <= length)
+        itemSize = sizeof(UDPDeltaHead) + ((UDPDeltaHead *)item)->_len;
+      break;
+    default:
+      break;
+    }
+
+    if (itemSize == 0 || offset + itemSize > length) {
+      write_log(_sink, LL_WARN,
+                "[ParserUDP] Malformed batch packet, {} of {} items extracted",
+                i, batch->_count);
+      break;
+    }
+
+    extract_packet(item);
+    offset += itemSize;
+  }
+}
+
+void ParserUDP::extract_packet(UDPPacketHead *header) {
+  if (header->_type == UDP_MSG_PUSHTICK || header->_type == UDP_MSG_SUBSCRIBE) {
+    UDPTickPacket *packet = (UDPTickPacket *)header;
+    push_tick(packet->_data);
+  } else if (header->_type == UDP_MSG_PUSHTICKDELTA) {
+    // 先解码再过滤订阅,否则未订阅合约的增量状态会断掉
+    UDPDeltaHead *packet = (UDPDeltaHead *)header;
+    thread_local static WTSTickStruct tickStruct;
+    if (_tick_decoder.decode((const char *)header + sizeof(UDPDeltaHead),
+                             packet->_len, tickStruct)) {
+      push_tick(tickStruct);
+    } else if (_tick_decoder.dropped_count() - _delta_dropped >= _gpsize) {
+      _delta_dropped = _tick_decoder.dropped_count();
+      write_log(_sink, LL_WARN,
+                "[ParserUDP] {} delta ticks dropped in total while waiting "
+                "for keyframes",
+                _delta_dropped);
     }
   } else if (header->_type == UDP_MSG_PUSHORDDTL) {
     UDPOrdDtlPacket *packet = (UDPOrdDtlPacket *)header;
@@ -376,6 +586,36 @@ void ParserUDP::extract_buffer(uint32_t length, bool isBroad /* = true */) {
   }
 }
 
+void ParserUDP::push_tick(WTSTickStruct &tickStruct) {
+  const char *fullCode =
+      fmtutil::format("{}.{}", tickStruct.exchg, tickStruct.code);
+  auto it = _set_subs.find(fullCode);
+  if (it == _set_subs.end())
+    return;
+
+  // 重传或者乱序到达的快照比已经处理过的旧,就不能再推送了
+  if (_sequenced) {
+    uint64_t tickTime =
+        (uint64_t)tickStruct.action_date * 1000000000 + tickStruct.action_time;
+    uint64_t &lastTime = _tick_times[fullCode];
+    if (tickTime < lastTime)
+      return;
+    lastTime = tickTime;
+  }
+
+  WTSTickData *curTick = WTSTickData::create(tickStruct);
+  if (_sink)
+    _sink->handleQuote(curTick, 0);
+
+  curTick->release();
+
+  static uint32_t recv_cnt = 0;
+  recv_cnt++;
+  if (recv_cnt % _gpsize == 0)
+    write_log(_sink, LL_DEBUG, "[ParserUDP] {} ticks received in total",
+              recv_cnt);
+}
+
 void ParserUDP::doOnConnected() {
   if (_sink) {
     _sink->handleEvent(WPE_Connect, 0);
@@ -8,10 +8,13 @@
  * \brief
  */
 #pragma once
+#include "../Includes/FasterDefs.h"
 #include "../Includes/IParserApi.h"
 #include "../Share/StdUtils.hpp"
+#include "../Share/TickDeltaCodec.hpp"
 
 #include <queue>
+#include <set>
 
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
@@ -20,6 +23,8 @@
 USING_NS_WTP;
 using namespace boost::asio;
 
+struct UDPPacketHead;
+
 class ParserUDP : public IParserApi {
 public:
   ParserUDP();
@@ -53,6 +58,32 @@ private:
 
   void extract_buffer(uint32_t length, bool isBroad);
 
+  /*
+   *	处理去掉序号包头以后的数据,可能是单个数据包也可能是批量数据包
+   */
+  void extract_data(char *data, uint32_t length);
+
+  /*
+   *	检查序号,更新缺口统计
+   *	返回false表示是重复的数据包,需要丢弃
+   */
+  bool check_sequence(uint32_t channel, uint64_t seq);
+
+  /*
+   *	向广播端请求重传
+   */
+  void request_retransmit(uint32_t channel, uint64_t from, uint32_t count);
+
+  /*
+   *	处理单个数据包,批量数据包拆开以后逐个调用
+   */
+  void extract_packet(UDPPacketHead *header);
+
+  /*
+   *	推送一笔tick,未订阅的合约直接忽略
+   */
+  void push_tick(WTSTickStruct &tickStruct);
+
 private:
   void doOnConnected();
   void doOnDisconnected();
@@ -75,8 +106,9 @@ private:
   ip::udp::socket *_s_socket;
   bool _s_inited;
 
-  boost::array<char, 1024> _b_buffer;
-  boost::array<char, 1024> _s_buffer;
+  // 批量模式下一个数据报里有多条数据,按照UDP数据报的最大长度分配
+  boost::array<char, 64 * 1024> _b_buffer;
+  boost::array<char, 64 * 1024> _s_buffer;
 
   IParserSpi *_sink;
   bool _stopped;
@@ -88,4 +120,30 @@ private:
 
   StdUniqueMutex _mtx_queue;
   std::queue<std::string> _send_queue;
+
+  // 序号检查
+  typedef struct _ChannelStat {
+    uint64_t _last_seq;          // 收到的最大序号
+    uint64_t _recv_cnt;          // 收到的数据包个数
+    uint64_t _gap_cnt;           // 缺口次数
+    uint64_t _lost_cnt;          // 缺失的数据包个数
+    uint64_t _recovered_cnt;     // 重传或者乱序补回的数据包个数
+    uint64_t _dup_cnt;           // 重复的数据包个数
+    std::set<uint64_t> _missing; // 还没补回的序号
+
+    _ChannelStat()
+        : _last_seq(0), _recv_cnt(0), _gap_cnt(0), _lost_cnt(0),
+          _recovered_cnt(0), _dup_cnt(0) {}
+  } ChannelStat;
+  wt_hashmap<uint32_t, ChannelStat> _channels;
+
+  bool _retrans;   // 发现缺口以后是否请求重传
+  bool _sequenced; // 是否收到过带序号的数据
+
+  // 每个合约最后推送的tick时间,用于过滤重传回来的旧快照
+  wt_hashmap<std::string, uint64_t> _tick_times;
+
+  // 增量tick解码,要处理全部合约的数据才能保持状态连续
+  TickDeltaDecoder _tick_decoder;
+  uint64_t _delta_dropped;
 };
@@ -19,20 +19,46 @@
 
 #include <boost/filesystem.hpp>
 
-// By Wesley @ 2022.01.05
-#include "../Share/fmtlib.h"
-template <typename... Args>
-inline void write_log(IParserSpi *sink, WTSLogLevel ll, const char *format,
-                      const Args &...args) {
-  if (sink == NULL)
-    return;
+#include "../Share/ParserHelper.hpp"
 
-  static thread_local char buffer[512] = {0};
-  memset(buffer, 0, 512);
-  fmt::format_to(buffer, format, args...);
+/*
+ *	XTP快照的字段映射,十档行情
+ */
+struct XTPFieldPolicy {
+  typedef XTPMD FieldType;
+
+  static inline void fill(WTSTickStruct &quote, const XTPMD *pData,
+                          WTSCommodityInfo *commInfo) {
+    quote.price = checkValid(pData->last_price);
+    quote.open = checkValid(pData->open_price);
+    quote.high = checkValid(pData->high_price);
+    quote.low = checkValid(pData->low_price);
+    quote.total_volume = (uint32_t)pData->qty;
+    quote.total_turnover = pData->turnover;
+
+    if (commInfo->getCategoty() == CC_Future) {
+      quote.settle_price = pData->settl_price;
+      quote.open_interest = (uint32_t)pData->total_long_positon;
+
+      quote.pre_settle = checkValid(pData->pre_settl_price);
+      quote.pre_interest = (uint32_t)pData->pre_total_long_positon;
+    }
 
-  sink->handleParserLog(ll, buffer);
-}
+    quote.upper_limit = checkValid(pData->upper_limit_price);
+    quote.lower_limit = checkValid(pData->lower_limit_price);
+
+    quote.pre_close = checkValid(pData->pre_close_price);
+
+    // 委卖价格
+    for (int i = 0; i < 10; i++) {
+      quote.ask_prices[i] = checkValid(pData->ask[i]);
+      quote.ask_qty[i] = (uint32_t)pData->ask_qty[i];
+
+      quote.bid_prices[i] = checkValid(pData->bid[i]);
+      quote.bid_qty[i] = (uint32_t)pData->bid_qty[i];
+    }
+  }
+};
 
 extern "C" {
 EXPORT_FLAG IParserApi *createParser() {
@@ -48,26 +74,6 @@ EXPORT_FLAG void deleteParser(IParserApi *&parser) {
 }
 };
 
-inline uint32_t strToTime(const char *strTime) {
-  std::string str;
-  const char *pos = strTime;
-  while (strlen(pos) > 0) {
-    if (pos[0] != ':') {
-      str.append(pos, 1);
-    }
-    pos++;
-  }
-
-  return strtoul(str.c_str(), NULL, 10);
-}
-
-inline double checkValid(double val) {
-  if (val == DBL_MAX || val == FLT_MAX)
-    return 0;
-
-  return val;
-}
-
 ParserXTP::ParserXTP() : m_pUserAPI(NULL), m_iRequestID(0), m_uTradingDate(0) {}
 
 ParserXTP::~ParserXTP() { m_pUserAPI = NULL; }
@@ -180,19 +186,14 @@ void ParserXTP::OnTickByTick(XTPTBT *tbt_data) {
     return;
   }
 
-  std::string exchg;
-  if (tbt_data->exchange_id == XTP_EXCHANGE_SH) {
-    exchg = "SSE";
-  } else {
-    exchg = "SZSE";
-  }
+  const char *exchg =
+      (tbt_data->exchange_id == XTP_EXCHANGE_SH) ? "SSE" : "SZSE";
 
-  WTSContractInfo *ct =
-      m_pBaseDataMgr->getContract(tbt_data->ticker, exchg.c_str());
+  WTSContractInfo *ct = m_sink->getContract(tbt_data->ticker, exchg);
   if (ct == NULL) {
     if (m_sink)
       write_log(m_sink, LL_ERROR, "[ParserXTP] Instrument {}.{} not exists...",
-                exchg.c_str(), tbt_data->ticker);
+                exchg, tbt_data->ticker);
     return;
   }
   WTSCommodityInfo *commInfo = ct->getCommInfo();
@@ -258,70 +259,30 @@ void ParserXTP::OnDepthMarketData(XTPMD *market_data, int64_t bid1_qty[],
 
   uint32_t actDate = (uint32_t)(market_data->data_time / 1000000000);
   uint32_t actTime = market_data->data_time % 1000000000;
-  uint32_t actHour = actTime / 10000000;
 
-  std::string code, exchg;
-  if (market_data->exchange_id == XTP_EXCHANGE_SH) {
-    exchg = "SSE";
-  } else {
-    exchg = "SZSE";
-  }
-  code = market_data->ticker;
+  const char *exchg =
+      (market_data->exchange_id == XTP_EXCHANGE_SH) ? "SSE" : "SZSE";
+  const char *code = market_data->ticker;
 
-  WTSContractInfo *ct =
-      m_pBaseDataMgr->getContract(code.c_str(), exchg.c_str());
+  WTSContractInfo *ct = m_sink->getContract(code, exchg);
   if (ct == NULL) {
     if (m_sink)
       write_log(m_sink, LL_ERROR, "[ParserXTP] Instrument {}.{} not exists...",
-                exchg.c_str(), market_data->ticker);
+                exchg, market_data->ticker);
     return;
   }
   WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-  WTSTickData *tick = WTSTickData::create(code.c_str());
-  tick->setContractInfo(ct);
+  WTSTickData *tick = TickConverter<XTPFieldPolicy>::convert(
+      code, market_data, ct, actDate, actTime, m_uTradingDate);
   WTSTickStruct &quote = tick->getTickStruct();
-  strcpy(quote.exchg, commInfo->getExchg());
-
-  quote.action_date = actDate;
-  quote.action_time = actTime;
-
-  quote.price = checkValid(market_data->last_price);
-  quote.open = checkValid(market_data->open_price);
-  quote.high = checkValid(market_data->high_price);
-  quote.low = checkValid(market_data->low_price);
-  quote.total_volume = (uint32_t)market_data->qty;
-  quote.trading_date = m_uTradingDate;
-  quote.total_turnover = market_data->turnover;
-
-  if (commInfo->getCategoty() == CC_Future) {
-    quote.settle_price = market_data->settl_price;
-    quote.open_interest = (uint32_t)market_data->total_long_positon;
-
-    quote.pre_settle = checkValid(market_data->pre_settl_price);
-    quote.pre_interest = (uint32_t)market_data->pre_total_long_positon;
-  }
-
-  quote.upper_limit = checkValid(market_data->upper_limit_price);
-  quote.lower_limit = checkValid(market_data->lower_limit_price);
-
-  quote.pre_close = checkValid(market_data->pre_close_price);
-
-  // 委卖价格
-  for (int i = 0; i < 10; i++) {
-    quote.ask_prices[i] = checkValid(market_data->ask[i]);
-    quote.ask_qty[i] = (uint32_t)market_data->ask_qty[i];
-
-    quote.bid_prices[i] = checkValid(market_data->bid[i]);
-    quote.bid_qty[i] = (uint32_t)market_data->bid_qty[i];
-  }
 
   if (m_sink)
     m_sink->handleQuote(tick, 1);
 
   // 处理逐笔
   if (bid1_count > 0) {
-    WTSOrdQueData *buyQue = WTSOrdQueData::create(code.c_str());
+    WTSOrdQueData *buyQue = WTSOrdQueData::create(code);
     buyQue->setContractInfo(ct);
 
     WTSOrdQueStruct &buyOS = buyQue->getOrdQueStruct();
@@ -347,7 +308,7 @@ void ParserXTP::OnDepthMarketData(XTPMD *market_data, int64_t bid1_qty[],
   }
 
   if (ask1_count > 0) {
-    WTSOrdQueData *sellQue = WTSOrdQueData::create(code.c_str());
+    WTSOrdQueData *sellQue = WTSOrdQueData::create(code);
     sellQue->setContractInfo(ct);
 
     WTSOrdQueStruct &sellOS = sellQue->getOrdQueStruct();
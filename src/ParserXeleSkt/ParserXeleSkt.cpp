@@ -178,7 +178,7 @@ bool ParserXeleSkt::prepare() {
     CXeleShfeSnapShot *p =
         (CXeleShfeSnapShot *)(content.data() + sizeof(CXeleShfeMarketHead));
     int instrumentNo = p->InstrumentNo;
-    WTSContractInfo *ct = _bd_mgr->getContract(p->InstrumentID);
+    WTSContractInfo *ct = _sink->getContract(p->InstrumentID);
     if (ct != NULL) {
       auto it = _set_subs.find(ct->getFullCode());
       if (it != _set_subs.end()) {
@@ -20,20 +20,39 @@
 
 #include <boost/filesystem.hpp>
 
-// By Wesley @ 2022.01.05
-#include "../Share/fmtlib.h"
-template <typename... Args>
-inline void write_log(IParserSpi *sink, WTSLogLevel ll, const char *format,
-                      const Args &...args) {
-  if (sink == NULL)
-    return;
-
-  static thread_local char buffer[512] = {0};
-  memset(buffer, 0, 512);
-  fmt::format_to(buffer, format, args...);
+#include "../Share/ParserHelper.hpp"
 
-  sink->handleParserLog(ll, buffer);
-}
+/*
+ *	易达行情结构体的字段映射,只有一档行情
+ */
+struct YDFieldPolicy {
+  typedef YDMarketData FieldType;
+
+  static inline void fill(WTSTickStruct &quote, const YDMarketData *pData,
+                          WTSCommodityInfo *commInfo) {
+    quote.price = pData->LastPrice;
+    quote.total_volume = pData->Volume;
+    quote.total_turnover = pData->Turnover;
+
+    quote.open_interest = pData->OpenInterest;
+
+    quote.upper_limit = pData->UpperLimitPrice;
+    quote.lower_limit = pData->LowerLimitPrice;
+
+    quote.pre_close = pData->PreClosePrice;
+    quote.pre_settle = pData->PreSettlementPrice;
+    quote.pre_interest = pData->PreOpenInterest;
+
+    // 委卖价格
+    quote.ask_prices[0] = pData->AskPrice;
+    // 委买价格
+    quote.bid_prices[0] = pData->BidPrice;
+    // 委卖量
+    quote.ask_qty[0] = pData->AskVolume;
+    // 委买量
+    quote.bid_qty[0] = pData->BidVolume;
+  }
+};
 
 extern "C" {
 EXPORT_FLAG IParserApi *createParser() {
@@ -105,43 +124,15 @@ void ParserYD::notifyMarketData(const YDMarketData *pDepthMarketData) {
   const YDExchange *exchgInfo = instInfo->m_pExchange;
   uint32_t actDate = pDepthMarketData->TradingDay;
   uint32_t actTime = pDepthMarketData->TimeStamp;
-  uint32_t actHour = actTime / 10000000;
 
-  WTSContractInfo *contract = m_pBaseDataMgr->getContract(
+  WTSContractInfo *contract = m_sink->getContract(
       instInfo->InstrumentID, exchgInfo->ExchangeID);
   if (contract == NULL)
     return;
 
-  WTSTickData *tick = WTSTickData::create(instInfo->InstrumentID);
-  WTSTickStruct &quote = tick->getTickStruct();
-  wt_strcpy(quote.exchg, contract->getExchg());
-  tick->setContractInfo(contract);
-
-  quote.action_date = actDate;
-  quote.action_time = actTime;
-
-  quote.price = pDepthMarketData->LastPrice;
-  quote.total_volume = pDepthMarketData->Volume;
-  quote.trading_date = m_uTradingDate;
-  quote.total_turnover = pDepthMarketData->Turnover;
-
-  quote.open_interest = pDepthMarketData->OpenInterest;
-
-  quote.upper_limit = pDepthMarketData->UpperLimitPrice;
-  quote.lower_limit = pDepthMarketData->LowerLimitPrice;
-
-  quote.pre_close = pDepthMarketData->PreClosePrice;
-  quote.pre_settle = pDepthMarketData->PreSettlementPrice;
-  quote.pre_interest = pDepthMarketData->PreOpenInterest;
-
-  // 委卖价格
-  quote.ask_prices[0] = pDepthMarketData->AskPrice;
-  // 委买价格
-  quote.bid_prices[0] = pDepthMarketData->BidPrice;
-  // 委卖量
-  quote.ask_qty[0] = pDepthMarketData->AskVolume;
-  // 委买量
-  quote.bid_qty[0] = pDepthMarketData->BidVolume;
+  WTSTickData *tick = TickConverter<YDFieldPolicy>::convert(
+      instInfo->InstrumentID, pDepthMarketData, contract, actDate, actTime,
+      m_uTradingDate);
 
   if (m_sink)
     m_sink->handleQuote(tick, 1);
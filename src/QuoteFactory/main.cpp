@@ -2,6 +2,7 @@
 #include "../WtDtCore/IndexFactory.h"
 #include "../WtDtCore/ParserAdapter.h"
 #include "../WtDtCore/ShmCaster.h"
+#include "../WtDtCore/StatHelper.hpp"
 #include "../WtDtCore/StateMonitor.h"
 #include "../WtDtCore/UDPCaster.h"
 #include "../WtDtCore/WtHelper.h"
@@ -157,6 +158,17 @@ void initialize(const std::string &filename) {
     g_dataMgr.add_caster(&g_udpCaster);
   }
 
+  // 运行统计,定时导出各个通道的速率和延迟
+  WTSVariant *cfgStat = config->get("stats");
+  if (cfgStat && cfgStat->getBoolean("active")) {
+    std::string path = cfgStat->getCString("path");
+    if (path.empty())
+      path = "./stats.csv";
+    StatHelper::one().start_export(path.c_str(),
+                                   cfgStat->getUInt32("interval"));
+    WTSLogger::info("Runtime stats will be exported to {}", path);
+  }
+
   // By Wesley @ 2021.12.27
   // 全天候模式，不需要再使用状态机
   bool bAlldayMode = config->getBoolean("allday");
@@ -280,5 +292,6 @@ int main(int argc, char *argv[]) {
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
 
+  StatHelper::one().stop_export();
   return 0;
 }
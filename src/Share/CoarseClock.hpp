@@ -0,0 +1,124 @@
+﻿/*!
+ * \file CoarseClock.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief 粗粒度时钟
+ * 后台线程每毫秒刷新一次本地时间和日期,行情回调里直接读缓存
+ * 省掉每笔行情的系统时钟调用和localtime转换
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+
+#include "StdUtils.hpp"
+#include "TimeUtils.hpp"
+
+class CoarseClock {
+public:
+  static CoarseClock &one() {
+    static CoarseClock inst;
+    return inst;
+  }
+
+  ~CoarseClock() {
+    _stopped = true;
+    if (_thrd)
+      _thrd->join();
+  }
+
+  /*
+   *	本地时间戳,单位毫秒,同TimeUtils::getLocalTimeNow
+   */
+  inline int64_t getLocalTimeNow() const {
+    return _now.load(std::memory_order_relaxed);
+  }
+
+  /*
+   *	本地日期和时间,格式同TimeUtils::getDateTime
+   *	@date	如20240318
+   *	@time	精确到毫秒,如93015500
+   */
+  inline void getDateTime(uint32_t &date, uint32_t &time) const {
+    uint64_t stamp = _stamp.load(std::memory_order_acquire);
+    date = (uint32_t)(stamp / STAMP_SCALE);
+    time = (uint32_t)(stamp % STAMP_SCALE);
+  }
+
+  inline uint32_t getCurDate() const {
+    return (uint32_t)(_stamp.load(std::memory_order_acquire) / STAMP_SCALE);
+  }
+
+  /*
+   *	日期时间转成时间戳,同TimeUtils::makeTime
+   *	当天的用缓存的零点时间直接计算,其他日期再调mktime
+   */
+  inline int64_t makeTime(uint32_t date, uint32_t time) const {
+    uint64_t day = _day.load(std::memory_order_acquire);
+    if ((uint32_t)(day & DATE_MASK) != date)
+      return TimeUtils::makeTime(date, time);
+
+    int64_t secs = (time / 10000000) * 3600 + (time % 10000000) / 100000 * 60 +
+                   (time % 100000) / 1000;
+    return ((int64_t)(day >> DATE_BITS) + secs) * 1000 + time % 1000;
+  }
+
+private:
+  CoarseClock()
+      : _now(0), _stamp(0), _day(0), _last_sec(0), _sec_base(0),
+        _stopped(false) {
+    refresh();
+    _thrd.reset(new StdThread([this]() {
+      while (!_stopped) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        refresh();
+      }
+    }));
+  }
+
+  void refresh() {
+    int64_t now = TimeUtils::getLocalTimeNow();
+    int64_t sec = now / 1000;
+
+    // 秒数变了才需要重新做localtime转换
+    if (sec != _last_sec) {
+      time_t t = (time_t)sec;
+      tm *tNow = localtime(&t);
+      uint32_t date = (tNow->tm_year + 1900) * 10000 +
+                      (tNow->tm_mon + 1) * 100 + tNow->tm_mday;
+      uint32_t hhmmss =
+          tNow->tm_hour * 10000 + tNow->tm_min * 100 + tNow->tm_sec;
+
+      _sec_base = date * STAMP_SCALE + hhmmss * 1000;
+      _last_sec = sec;
+
+      // 日期变了才重新计算零点,和TimeUtils::makeTime的算法保持一致
+      uint64_t day = _day.load(std::memory_order_relaxed);
+      if ((uint32_t)(day & DATE_MASK) != date) {
+        uint64_t dayStart = TimeUtils::makeTime(date, 0) / 1000;
+        _day.store((dayStart << DATE_BITS) | date, std::memory_order_release);
+      }
+    }
+
+    _stamp.store(_sec_base + now % 1000, std::memory_order_release);
+    _now.store(now, std::memory_order_relaxed);
+  }
+
+private:
+  static const uint64_t STAMP_SCALE = 1000000000; // 日期*STAMP_SCALE+时间
+  static const uint32_t DATE_BITS = 25;           // 日期占低25位,高位为零点秒数
+  static const uint64_t DATE_MASK = (1 << DATE_BITS) - 1;
+
+  std::atomic<int64_t> _now;
+  std::atomic<uint64_t> _stamp; // 日期和时间打包在一起,保证一次读到的是一致的
+  std::atomic<uint64_t> _day;   // 当天零点的秒数和日期打包在一起
+
+  // 以下只在刷新线程里使用
+  int64_t _last_sec;
+  uint64_t _sec_base;
+
+  std::atomic<bool> _stopped; // 析构的时候在其他线程设置
+  StdThreadPtr _thrd;
+};
@@ -0,0 +1,114 @@
+﻿/*!
+ * \file ContractTable.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief 行情接入用的合约句柄表
+ * 订阅的时候把合约代码预先解析成WTSContractInfo
+ * 行情回调里直接按代码查表,不用再到基础数据管理器里按市场逐级查找
+ * 合约代码按哈希值驻留成整数ID,查表不用构造std::string
+ */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "../Includes/FasterDefs.h"
+#include "../Includes/IBaseDataMgr.h"
+#include "../Includes/WTSContractInfo.hpp"
+
+NS_WTP_BEGIN
+class ContractTable {
+public:
+  static const uint32_t INVALID_HANDLE = UINT32_MAX;
+
+  /*
+   *	根据订阅的合约列表建表
+   *	@codes	合约代码,格式为EXCHG.CODE
+   *	建表要在订阅之前完成,收到行情以后只读,句柄在建表以后保持不变
+   */
+  void build(IBaseDataMgr *bdMgr, const CodeSet &codes) {
+    _index.clear();
+    _handles.clear();
+    for (const std::string &fullCode : codes) {
+      std::string exchg, code;
+      std::size_t pos = fullCode.find('.');
+      if (pos != std::string::npos) {
+        exchg = fullCode.substr(0, pos);
+        code = fullCode.substr(pos + 1);
+      } else {
+        code = fullCode;
+      }
+
+      WTSContractInfo *cInfo = bdMgr->getContract(code.c_str(), exchg.c_str());
+      if (cInfo == NULL)
+        continue;
+
+      // 不同市场有相同代码的,或者哈希值冲突的,标记为NULL,再按市场查找
+      uint64_t cid = code_id(code.c_str());
+      auto it = _index.find(cid);
+      if (it == _index.end()) {
+        _index[cid] = (uint32_t)_handles.size();
+        _handles.emplace_back(cInfo);
+      } else if (_handles[it->second] != cInfo) {
+        _handles[it->second] = NULL;
+      }
+    }
+  }
+
+  /*
+   *	按代码查找合约
+   *	@exchg	市场代码,为空则不检查
+   *	没有预先解析的返回NULL,由调用方再到基础数据里查找
+   */
+  inline WTSContractInfo *get(const char *code, const char *exchg = "") const {
+    return at(handle(code, exchg));
+  }
+
+  inline std::size_t size() const { return _handles.size(); }
+
+private:
+  /*
+   *	按代码查找合约在表里的下标
+   *	@exchg	市场代码,为空则不检查
+   *	没有预先解析的返回INVALID_HANDLE
+   */
+  inline uint32_t handle(const char *code, const char *exchg = "") const {
+    auto it = _index.find(code_id(code));
+    if (it == _index.end())
+      return INVALID_HANDLE;
+
+    WTSContractInfo *cInfo = _handles[it->second];
+    if (cInfo == NULL || strcmp(cInfo->getCode(), code) != 0)
+      return INVALID_HANDLE;
+
+    if (exchg[0] != '\0' && strcmp(cInfo->getExchg(), exchg) != 0)
+      return INVALID_HANDLE;
+
+    return it->second;
+  }
+
+  /*
+   *	按下标取合约
+   */
+  inline WTSContractInfo *at(uint32_t handle) const {
+    return (handle < _handles.size()) ? _handles[handle] : NULL;
+  }
+
+  // FNV-1a,直接对C字符串计算,冲突的情况由handle里比较代码兜底
+  static inline uint64_t code_id(const char *code) {
+    uint64_t h = 14695981039346656037ULL;
+    for (; *code != '\0'; code++) {
+      h ^= (uint8_t)*code;
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+private:
+  wt_hashmap<uint64_t, uint32_t> _index; // 代码ID到句柄的映射
+  std::vector<WTSContractInfo *> _handles;
+};
+NS_WTP_END
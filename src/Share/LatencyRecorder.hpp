@@ -0,0 +1,264 @@
+﻿/*!
+ * \file LatencyRecorder.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/04/10
+ *
+ * \brief 延迟测试的分段计时
+ * 每一轮测试在各个打点位置用rdtsc记录时间戳,轮次结束以后按阶段算出耗时,
+ * 预热轮次的样本直接丢掉,样本缓冲区在测试开始前一次分配好
+ * 测试结束以后按阶段统计分位数,结果写成json,用于比较不同机器和编译参数
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "BoostFile.hpp"
+#include "CpuHelper.hpp"
+#include "fmtlib.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+
+class LatencyRecorder {
+public:
+  typedef struct _StageStat {
+    std::string _name;
+    std::size_t _count = 0;
+    double _mean = 0;
+    double _p50 = 0;
+    double _p99 = 0;
+    double _p999 = 0;
+    double _max = 0;
+  } StageStat;
+
+  LatencyRecorder() : _cycles_per_ns(1.0), _times(0), _warmup(0), _round(0) {}
+
+  /*
+   *	读时间戳计数器,没有rdtsc的平台退化为steady_clock的纳秒数
+   */
+  static inline uint64_t now_cycles() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  /*
+   *	用steady_clock校准时间戳计数器的频率
+   *	@millisecs	校准时长,单位毫秒
+   */
+  static double calibrate(uint32_t millisecs = 200) {
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = now_cycles();
+    auto until = t0 + std::chrono::milliseconds(millisecs);
+    while (std::chrono::steady_clock::now() < until)
+      ;
+    uint64_t c1 = now_cycles();
+    auto t1 = std::chrono::steady_clock::now();
+
+    double ns =
+        (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+            .count();
+    return (ns > 0 && c1 > c0) ? (c1 - c0) / ns : 1.0;
+  }
+
+  /*
+   *	@points	打点的个数,stamp的时候用下标
+   *	@times	正式测试的轮数,样本缓冲区按这个大小预分配
+   *	@warmup	预热的轮数
+   */
+  void init(uint32_t points, uint32_t times, uint32_t warmup) {
+    _stamps.assign(points, 0);
+    _times = times;
+    _warmup = warmup;
+    _round = 0;
+
+    _cycles_per_ns = calibrate();
+  }
+
+  /*
+   *	添加统计阶段,耗时为to点减去from点,任一点没有打到的轮次不计入
+   */
+  void add_stage(const char *name, uint32_t from, uint32_t to) {
+    _stages.emplace_back(Stage{name, from, to});
+    _stages.back()._samples.reserve(_times);
+  }
+
+  inline void begin_round() { std::fill(_stamps.begin(), _stamps.end(), 0); }
+
+  inline void stamp(uint32_t point) { _stamps[point] = now_cycles(); }
+
+  inline void end_round() {
+    if (_round++ < _warmup)
+      return;
+
+    for (Stage &stage : _stages) {
+      uint64_t from = _stamps[stage._from];
+      uint64_t to = _stamps[stage._to];
+      if (from == 0 || to < from)
+        continue;
+
+      stage._samples.emplace_back(to - from);
+    }
+  }
+
+  inline double cycles_per_ns() const { return _cycles_per_ns; }
+
+  /*
+   *	按阶段统计分位数,单位纳秒
+   */
+  std::vector<StageStat> summary() {
+    std::vector<StageStat> ret;
+    for (Stage &stage : _stages) {
+      StageStat stat;
+      stat._name = stage._name;
+      std::vector<uint64_t> &samples = stage._samples;
+      stat._count = samples.size();
+      if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        double total = 0;
+        for (uint64_t v : samples)
+          total += v;
+
+        stat._mean = to_ns(total / samples.size());
+        stat._p50 = to_ns(percentile(samples, 0.5));
+        stat._p99 = to_ns(percentile(samples, 0.99));
+        stat._p999 = to_ns(percentile(samples, 0.999));
+        stat._max = to_ns(samples.back());
+      }
+      ret.emplace_back(stat);
+    }
+
+    return ret;
+  }
+
+  /*
+   *	把统计结果写成json
+   *	@engine	引擎名称
+   *	@core	测试线程绑定的核心,0表示没有绑定
+   */
+  bool dump(const char *filename, const char *engine, uint32_t core) {
+    namespace rj = rapidjson;
+    rj::Document root(rj::kObjectType);
+    rj::Document::AllocatorType &allocator = root.GetAllocator();
+
+    root.AddMember("engine", rj::Value(engine, allocator), allocator);
+    root.AddMember("compiler", rj::Value(compiler().c_str(), allocator),
+                   allocator);
+    root.AddMember("flags", rj::Value(build_flags().c_str(), allocator),
+                   allocator);
+    root.AddMember("cpu_cores", CpuHelper::get_cpu_cores(), allocator);
+    root.AddMember("core", core, allocator);
+    root.AddMember("cycles_per_ns", _cycles_per_ns, allocator);
+    root.AddMember("times", _times, allocator);
+    root.AddMember("warmup", _warmup, allocator);
+
+    rj::Value jStages(rj::kArrayType);
+    for (const StageStat &stat : summary()) {
+      rj::Value jItem(rj::kObjectType);
+      jItem.AddMember("stage", rj::Value(stat._name.c_str(), allocator),
+                      allocator);
+      jItem.AddMember("count", (uint64_t)stat._count, allocator);
+      jItem.AddMember("mean", stat._mean, allocator);
+      jItem.AddMember("p50", stat._p50, allocator);
+      jItem.AddMember("p99", stat._p99, allocator);
+      jItem.AddMember("p999", stat._p999, allocator);
+      jItem.AddMember("max", stat._max, allocator);
+      jStages.PushBack(jItem, allocator);
+    }
+    root.AddMember("stages", jStages, allocator);
+
+    BoostFile bf;
+    if (!bf.create_new_file(filename))
+      return false;
+
+    rj::StringBuffer sb;
+    rj::PrettyWriter<rj::StringBuffer> writer(sb);
+    root.Accept(writer);
+    bf.write_file(sb.GetString());
+    bf.close_file();
+    return true;
+  }
+
+  static std::string compiler() {
+#if defined(_MSC_VER)
+    return fmt::format("msvc {}", _MSC_VER);
+#elif defined(__clang__)
+    return fmt::format("clang {}", __clang_version__);
+#elif defined(__GNUC__)
+    return fmt::format("gcc {}", __VERSION__);
+#else
+    return "unknown";
+#endif
+  }
+
+  /*
+   *	影响延迟的编译选项,从预定义宏里取
+   */
+  static std::string build_flags() {
+    std::string ret;
+#ifdef NDEBUG
+    ret += "NDEBUG ";
+#endif
+#ifdef __OPTIMIZE__
+    ret += "__OPTIMIZE__ ";
+#endif
+#ifdef __SSE4_2__
+    ret += "SSE4.2 ";
+#endif
+#ifdef __AVX2__
+    ret += "AVX2 ";
+#endif
+#ifdef __AVX512F__
+    ret += "AVX512F ";
+#endif
+#ifdef __ARM_NEON
+    ret += "NEON ";
+#endif
+    if (!ret.empty())
+      ret.pop_back();
+    return ret;
+  }
+
+private:
+  inline double to_ns(double cycles) const { return cycles / _cycles_per_ns; }
+
+  // 最近秩法取分位数,样本已经排好序
+  static inline double percentile(const std::vector<uint64_t> &samples,
+                                  double p) {
+    std::size_t rank = (std::size_t)std::ceil(p * samples.size());
+    rank = std::max<std::size_t>(rank, 1);
+    return (double)samples[std::min(rank, samples.size()) - 1];
+  }
+
+private:
+  typedef struct _Stage {
+    std::string _name;
+    uint32_t _from;
+    uint32_t _to;
+    std::vector<uint64_t> _samples;
+  } Stage;
+
+  std::vector<uint64_t> _stamps;
+  std::vector<Stage> _stages;
+
+  double _cycles_per_ns;
+  uint32_t _times;
+  uint32_t _warmup;
+  uint64_t _round;
+};
@@ -23,6 +23,9 @@ public:
     _pool.free(pobj);
   }
 
+  // 归还已经析构过的对象内存
+  void deallocate(void *mem) { _pool.free(mem); }
+
   // 手动释放未使用的内存
   void release() { _pool.release_memory(); }
 };
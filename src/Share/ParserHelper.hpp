@@ -0,0 +1,206 @@
+﻿/*!
+ * \file ParserHelper.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/25
+ *
+ * \brief 行情接入模块公用的辅助函数和tick转换模板
+ * 各个ParserXXX共用日志、价格校验、时间解析和夜盘日期修正
+ * 行情结构体到WTSTickStruct的字段映射由策略类完成,
+ * 转换过程中不分配堆内存,直接写入内存池分配的WTSTickData
+ */
+#pragma once
+#include <float.h>
+#include <string.h>
+
+#include "../Includes/IParserApi.h"
+#include "../Includes/WTSContractInfo.hpp"
+#include "../Includes/WTSDataDef.hpp"
+#include "CoarseClock.hpp"
+#include "TimeUtils.hpp"
+#include "fmtlib.h"
+
+USING_NS_WTP;
+
+template <typename... Args>
+inline void write_log(IParserSpi *sink, WTSLogLevel ll, const char *format,
+                      const Args &...args) {
+  if (sink == NULL)
+    return;
+
+  static thread_local char buffer[512] = {0};
+  fmtutil::format_to(buffer, format, args...);
+
+  sink->handleParserLog(ll, buffer);
+}
+
+/*
+ *	价格校验,无效值(DBL_MAX/FLT_MAX)返回0
+ */
+inline double checkValid(double val) {
+  if (val == DBL_MAX || val == FLT_MAX)
+    return 0;
+
+  return val;
+}
+
+/*
+ *	解析时间字符串,如"09:30:15"返回93015
+ *	跳过所有非数字字符,不用临时缓冲区
+ */
+inline uint32_t strToTime(const char *strTime) {
+  uint32_t ret = 0;
+  for (const char *p = strTime; *p != '\0'; p++) {
+    if (*p >= '0' && *p <= '9')
+      ret = ret * 10 + (*p - '0');
+  }
+
+  return ret;
+}
+
+/*
+ *	解析日期字符串,如"20240325"返回20240325,遇到非数字字符结束
+ */
+inline uint32_t strToDate(const char *strDate) {
+  uint32_t ret = 0;
+  for (const char *p = strDate; *p >= '0' && *p <= '9'; p++)
+    ret = ret * 10 + (*p - '0');
+
+  return ret;
+}
+
+/*
+ *	夜盘日期修正
+ *	@actDate	行情的发生日期,修正以后直接改写
+ *	@actTime	行情的发生时间,精确到毫秒
+ *	@tradingDate	当前交易日
+ *	返回false表示这笔行情需要丢掉
+ */
+inline bool fixActionDate(uint32_t &actDate, uint32_t actTime,
+                          uint32_t tradingDate) {
+  uint32_t actHour = actTime / 10000000;
+
+  // 夜盘时发生日期不可能等于交易日,这样的时间需要手动设置一下
+  if (actDate != tradingDate || actHour < 20)
+    return true;
+
+  uint32_t curDate, curTime;
+  CoarseClock::one().getDateTime(curDate, curTime);
+  uint32_t curHour = curTime / 10000000;
+
+  // 早上启动以后,会收到昨晚12点以前收盘的行情,这个时候可能会有发生日期=交易日的情况出现
+  // 这笔数据直接丢掉
+  if (curHour >= 3 && curHour < 9)
+    return false;
+
+  actDate = curDate;
+
+  if (actHour == 23 && curHour == 0) {
+    // 行情时间慢于系统时间
+    actDate = TimeUtils::getNextDate(curDate, -1);
+  } else if (actHour == 0 && curHour == 23) {
+    // 系统时间慢于行情时间
+    actDate = TimeUtils::getNextDate(curDate, 1);
+  }
+
+  return true;
+}
+
+/*
+ *	CTP系行情结构体的字段映射
+ *	CTP、CTPMini、CTPOpt、BA的CThostFtdcDepthMarketDataField
+ *	和飞马的CUstpFtdcDepthMarketDataField字段名一致,共用这一个策略
+ *	其他接口参照这个写一个策略类,提供FieldType和fill即可
+ */
+template <typename Field> struct CtpFieldPolicy {
+  typedef Field FieldType;
+
+  static inline void fill(WTSTickStruct &quote, const Field *pData,
+                          WTSCommodityInfo *commInfo) {
+    quote.price = checkValid(pData->LastPrice);
+    quote.open = checkValid(pData->OpenPrice);
+    quote.high = checkValid(pData->HighestPrice);
+    quote.low = checkValid(pData->LowestPrice);
+    quote.total_volume = pData->Volume;
+    if (pData->SettlementPrice != DBL_MAX)
+      quote.settle_price = checkValid(pData->SettlementPrice);
+    if (strcmp(quote.exchg, "CZCE") == 0) {
+      quote.total_turnover = pData->Turnover * commInfo->getVolScale();
+    } else {
+      if (pData->Turnover != DBL_MAX)
+        quote.total_turnover = pData->Turnover;
+    }
+
+    quote.open_interest = (double)pData->OpenInterest;
+
+    quote.upper_limit = checkValid(pData->UpperLimitPrice);
+    quote.lower_limit = checkValid(pData->LowerLimitPrice);
+
+    quote.pre_close = checkValid(pData->PreClosePrice);
+    quote.pre_settle = checkValid(pData->PreSettlementPrice);
+    quote.pre_interest = (double)pData->PreOpenInterest;
+
+    // 委卖价格
+    quote.ask_prices[0] = checkValid(pData->AskPrice1);
+    quote.ask_prices[1] = checkValid(pData->AskPrice2);
+    quote.ask_prices[2] = checkValid(pData->AskPrice3);
+    quote.ask_prices[3] = checkValid(pData->AskPrice4);
+    quote.ask_prices[4] = checkValid(pData->AskPrice5);
+
+    // 委买价格
+    quote.bid_prices[0] = checkValid(pData->BidPrice1);
+    quote.bid_prices[1] = checkValid(pData->BidPrice2);
+    quote.bid_prices[2] = checkValid(pData->BidPrice3);
+    quote.bid_prices[3] = checkValid(pData->BidPrice4);
+    quote.bid_prices[4] = checkValid(pData->BidPrice5);
+
+    // 委卖量
+    quote.ask_qty[0] = pData->AskVolume1;
+    quote.ask_qty[1] = pData->AskVolume2;
+    quote.ask_qty[2] = pData->AskVolume3;
+    quote.ask_qty[3] = pData->AskVolume4;
+    quote.ask_qty[4] = pData->AskVolume5;
+
+    // 委买量
+    quote.bid_qty[0] = pData->BidVolume1;
+    quote.bid_qty[1] = pData->BidVolume2;
+    quote.bid_qty[2] = pData->BidVolume3;
+    quote.bid_qty[3] = pData->BidVolume4;
+    quote.bid_qty[4] = pData->BidVolume5;
+  }
+};
+
+/*
+ *	tick转换
+ *	从内存池分配WTSTickData,填好合约、市场、日期时间,
+ *	其余字段交给策略类Policy::fill直接写入tick结构体
+ */
+template <typename Policy> class TickConverter {
+public:
+  typedef typename Policy::FieldType FieldType;
+
+  /*
+   *	@code	合约代码
+   *	@cInfo	合约信息,调用方已经检查过不为空
+   *	返回的tick由调用方release
+   */
+  static inline WTSTickData *convert(const char *code, const FieldType *pData,
+                                     WTSContractInfo *cInfo, uint32_t actDate,
+                                     uint32_t actTime, uint32_t tradingDate) {
+    WTSCommodityInfo *commInfo = cInfo->getCommInfo();
+
+    WTSTickData *tick = WTSTickData::create(code);
+    tick->setContractInfo(cInfo);
+
+    WTSTickStruct &quote = tick->getTickStruct();
+    wt_strcpy(quote.exchg, commInfo->getExchg());
+
+    quote.action_date = actDate;
+    quote.action_time = actTime;
+    quote.trading_date = tradingDate;
+
+    Policy::fill(quote, pData, commInfo);
+    return tick;
+  }
+};
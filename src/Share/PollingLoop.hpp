@@ -0,0 +1,179 @@
+﻿/*!
+ * \file PollingLoop.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief 单线程轮询的事件循环
+ * 每个投递线程独占一个SPSC队列,消费线程绑定到指定的CPU核心上轮询所有队列
+ * 所有事件都在同一个线程里处理,处理逻辑不需要再加锁
+ */
+#pragma once
+#include <functional>
+#include <map>
+#include <string.h>
+#include <vector>
+
+#include "SpinMutex.hpp"
+#include "SpscQueue.hpp"
+#include "StdUtils.hpp"
+
+// CpuHelper内部引用了系统头文件,要放在最后
+#include "CpuHelper.hpp"
+
+template <typename T> class PollingLoop {
+public:
+  typedef std::function<void(T &)> EventHandler;
+  typedef std::function<void()> IdleHandler;
+
+  PollingLoop()
+      : _capacity(8192), _core(-1), _busy(true), _stopped(true),
+        _loop_thrd_id() {}
+
+  ~PollingLoop() {
+    stop();
+    for (SpscQueue<T> *que : _queues)
+      delete que;
+    _queues.clear();
+  }
+
+public:
+  /*
+   *	初始化
+   *	@capacity	每个投递线程的队列容量
+   *	@core		绑定的CPU核心,小于0则不绑定
+   *	@busy		是否忙等,为false则空闲时让出时间片
+   */
+  inline void init(std::size_t capacity, int32_t core, bool busy) {
+    _capacity = capacity;
+    _core = core;
+    _busy = busy;
+  }
+
+  inline bool is_running() const { return !_stopped; }
+
+  /*
+   *	当前线程是否是事件循环线程
+   */
+  inline bool in_loop_thread() const {
+    return std::this_thread::get_id() ==
+           _loop_thrd_id.load(std::memory_order_relaxed);
+  }
+
+  /*
+   *	投递事件,可以在任意线程调用
+   *	队列满了会自旋等待消费线程处理
+   *	在事件循环线程里投递的直接处理,否则队列满了会等自己消费,造成死锁
+   */
+  inline void post(const T &evt) {
+    if (in_loop_thread()) {
+      T copied = evt;
+      _handler(copied);
+      return;
+    }
+
+    SpscQueue<T> *que = local_queue();
+    while (!que->push(evt)) {
+#ifdef _MSC_VER
+      _mm_pause();
+#else
+      __builtin_ia32_pause();
+#endif
+    }
+  }
+
+  void start(EventHandler handler, IdleHandler idler = nullptr) {
+    if (!_stopped)
+      return;
+
+    _handler = handler;
+    _stopped = false;
+    _thrd.reset(new StdThread([this, handler, idler]() {
+      _loop_thrd_id.store(std::this_thread::get_id());
+      if (_core >= 0)
+        CpuHelper::bind_core((uint32_t)_core);
+
+      T evt;
+      std::vector<SpscQueue<T> *> queues;
+      std::size_t known = 0;
+      while (!_stopped) {
+        // 有新的投递线程加入,才需要刷新队列列表
+        if (_queue_cnt.load(std::memory_order_acquire) != known) {
+          SpinLock lock(_mtx);
+          queues = _queues;
+          known = queues.size();
+        }
+
+        bool bHasEvent = false;
+        for (SpscQueue<T> *que : queues) {
+          while (que->pop(evt)) {
+            handler(evt);
+            bHasEvent = true;
+          }
+        }
+
+        if (bHasEvent)
+          continue;
+
+        if (idler)
+          idler();
+
+        if (!_busy)
+          std::this_thread::yield();
+      }
+
+      // 退出前把剩余的事件处理完
+      for (SpscQueue<T> *que : queues) {
+        while (que->pop(evt))
+          handler(evt);
+      }
+    }));
+  }
+
+  void stop() {
+    if (_stopped)
+      return;
+
+    _stopped = true;
+    if (_thrd)
+      _thrd->join();
+    _thrd.reset();
+  }
+
+private:
+  inline SpscQueue<T> *local_queue() {
+    thread_local static PollingLoop *owner = NULL;
+    thread_local static SpscQueue<T> *que = NULL;
+    if (owner == this)
+      return que;
+
+    SpinLock lock(_mtx);
+    auto it = _thrd_queues.find(std::this_thread::get_id());
+    if (it != _thrd_queues.end()) {
+      que = it->second;
+    } else {
+      que = new SpscQueue<T>(_capacity);
+      _thrd_queues[std::this_thread::get_id()] = que;
+      _queues.emplace_back(que);
+      _queue_cnt.store(_queues.size(), std::memory_order_release);
+    }
+    owner = this;
+    return que;
+  }
+
+private:
+  std::size_t _capacity;
+  int32_t _core;
+  bool _busy;
+
+  EventHandler _handler;
+  std::atomic<bool> _stopped;
+  StdThreadPtr _thrd;
+  std::atomic<std::thread::id> _loop_thrd_id;
+
+  SpinMutex _mtx;
+  std::vector<SpscQueue<T> *> _queues;
+  std::map<std::thread::id, SpscQueue<T> *> _thrd_queues;
+  std::atomic<std::size_t> _queue_cnt = {0};
+};
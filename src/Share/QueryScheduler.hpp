@@ -0,0 +1,224 @@
+﻿/*!
+ * \file QueryScheduler.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/28
+ *
+ * \brief 交易通道的查询调度器
+ * 用令牌桶控制查询频率,和柜台的查询流控保持一致
+ * 同一时间只有一笔查询在途,收到最后一笔回报以后再发下一笔
+ * 在途查询超时没有收到最后一笔回报的,丢掉这笔查询,继续发下一笔
+ * 每笔查询分配一个请求号,超时以后迟到的回报按请求号识别出来丢掉
+ * 工作线程按下一个令牌的到期时间等待,没有查询的时候不占用CPU
+ * 调度器的锁只在查询线程和投递查询的时候使用,下单撤单不经过这里
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <stdint.h>
+#include <string>
+
+#include "StdUtils.hpp"
+
+class QueryScheduler {
+public:
+  typedef enum {
+    QR_Sent,    // 已发出,等待回报
+    QR_Limited, // 被柜台流控,稍后重发
+    QR_Failed   // 发送失败,直接丢掉
+  } QueryResult;
+
+  /*
+   *	@reqID	调度器分配的请求号,发查询的时候带上,回报的时候传给on_finished
+   */
+  typedef std::function<QueryResult(uint32_t reqID)> QueryTask;
+  typedef std::chrono::steady_clock Clock;
+
+  /*
+   *	在途查询超时的回调,在调度线程里调用
+   *	@name	超时的查询名称
+   */
+  typedef std::function<void(const char *name, uint32_t millisecs)>
+      TimeoutHandler;
+
+  QueryScheduler()
+      : _rate(1.0), _burst(1.0), _tokens(1.0), _in_query(false),
+        _query_seq(0), _timeout(0), _stopped(true) {}
+
+  ~QueryScheduler() { stop(); }
+
+  /*
+   *	启动调度线程
+   *	@rate	每秒允许的查询次数
+   *	@burst	令牌桶容量,即允许连续发出的查询笔数
+   */
+  void start(double rate, uint32_t burst) {
+    if (_thrd)
+      return;
+
+    _rate = (rate <= 0) ? 1.0 : rate;
+    _burst = (burst == 0) ? 1.0 : (double)burst;
+    _tokens = _burst;
+    _last_fill = Clock::now();
+    _stopped = false;
+    _thrd.reset(new StdThread([this]() { run(); }));
+  }
+
+  /*
+   *	设置在途查询的超时时间,要在start之前调用
+   *	@millisecs	超时毫秒数,0表示不检查超时
+   */
+  void set_timeout(uint32_t millisecs, TimeoutHandler cb = nullptr) {
+    StdUniqueLock lock(_mtx);
+    _timeout = millisecs;
+    _timeout_cb = cb;
+  }
+
+  void stop() {
+    if (!_thrd)
+      return;
+
+    {
+      StdUniqueLock lock(_mtx);
+      _stopped = true;
+      _cond.notify_all();
+    }
+    _thrd->join();
+    _thrd.reset();
+  }
+
+  /*
+   *	@name	查询名称,超时的时候用于日志,要用常量字符串
+   */
+  void post(QueryTask task, const char *name = "query") {
+    StdUniqueLock lock(_mtx);
+    _queue.emplace_back(QueryItem{std::move(task), name});
+    _cond.notify_all();
+  }
+
+  /*
+   *	在途的查询已经收到最后一笔回报
+   *	@reqID	回报里带的请求号,不是在途的那笔说明已经超时丢掉了,直接忽略
+   */
+  void on_finished(uint32_t reqID) {
+    StdUniqueLock lock(_mtx);
+    if (!_in_query || reqID != _query_seq)
+      return;
+
+    _in_query = false;
+    _cond.notify_all();
+  }
+
+  /*
+   *	清空待发的查询,断线重连以后重新查询
+   *	在途的查询也一并丢掉,之后再收到它的回报会被忽略
+   */
+  void clear() {
+    StdUniqueLock lock(_mtx);
+    _queue.clear();
+    _in_query = false;
+  }
+
+  std::size_t size() {
+    StdUniqueLock lock(_mtx);
+    return _queue.size();
+  }
+
+private:
+  inline void refill(Clock::time_point now) {
+    double elapse = std::chrono::duration<double>(now - _last_fill).count();
+    _tokens = std::min(_burst, _tokens + elapse * _rate);
+    _last_fill = now;
+  }
+
+  void run() {
+    StdUniqueLock lock(_mtx);
+    while (!_stopped) {
+      if (_in_query && _timeout > 0) {
+        // 等到在途查询超时,期间收到回报会被唤醒
+        uint32_t seq = _query_seq;
+        Clock::time_point deadline =
+            _sent_at + std::chrono::milliseconds(_timeout);
+        if (_cond.wait_until(lock, deadline) != std::cv_status::timeout ||
+            !_in_query || seq != _query_seq)
+          continue;
+
+        _in_query = false;
+        if (_timeout_cb) {
+          std::string name = _query_name;
+          TimeoutHandler cb = _timeout_cb;
+          lock.unlock();
+          cb(name.c_str(), _timeout);
+          lock.lock();
+        }
+        continue;
+      }
+
+      if (_queue.empty() || _in_query) {
+        _cond.wait(lock);
+        continue;
+      }
+
+      // 令牌不够,等到下一个令牌到期再发
+      Clock::time_point now = Clock::now();
+      refill(now);
+      if (_tokens < 1.0) {
+        auto wait = std::chrono::duration<double>((1.0 - _tokens) / _rate);
+        _cond.wait_until(
+            lock, now + std::chrono::duration_cast<Clock::duration>(wait));
+        continue;
+      }
+
+      _tokens -= 1.0;
+      QueryItem item = std::move(_queue.front());
+      _queue.pop_front();
+      _in_query = true;
+      uint32_t reqID = ++_query_seq;
+      _query_name = item._name;
+
+      // 发查询的时候不持有锁,回报线程可以直接调用on_finished
+      lock.unlock();
+      QueryResult ret = item._task(reqID);
+      lock.lock();
+
+      if (ret == QR_Sent) {
+        _sent_at = Clock::now();
+        continue;
+      }
+
+      _in_query = false;
+      if (ret == QR_Limited) {
+        // 被流控了,放回队头,令牌清零,等下一个令牌再发
+        _queue.emplace_front(std::move(item));
+        _tokens = 0;
+      }
+    }
+  }
+
+private:
+  double _rate;
+  double _burst;
+  double _tokens;
+  Clock::time_point _last_fill;
+
+  typedef struct _QueryItem {
+    QueryTask _task;
+    const char *_name;
+  } QueryItem;
+  std::deque<QueryItem> _queue;
+  bool _in_query;
+  uint32_t _query_seq;        // 在途查询的请求号,每发出一笔加1
+  std::string _query_name;    // 在途查询的名称
+  Clock::time_point _sent_at; // 在途查询的发出时间
+
+  uint32_t _timeout; // 毫秒
+  TimeoutHandler _timeout_cb;
+  bool _stopped;
+
+  StdUniqueMutex _mtx;
+  StdCondVariable _cond;
+  StdThreadPtr _thrd;
+};
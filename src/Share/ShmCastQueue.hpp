@@ -0,0 +1,313 @@
+﻿/*!
+ * \file ShmCastQueue.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief 共享内存广播队列
+ * 一个写进程,多个读进程,每个槽位用序号做seqlock
+ * 读进程各自维护读取位置,被覆盖的数据能检测出来并计数,不会读到写了一半的数据
+ */
+#pragma once
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <string.h>
+
+#include "../Includes/WTSStruct.h"
+
+NS_WTP_BEGIN
+
+#define SHM_CAST_MAGIC 0x57545351 // WTSQ
+#define SHM_CAST_VERSION 2
+#define SHM_CAST_MAX_READERS 64
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "atomic<uint64_t> must be lock free for shared memory");
+
+#pragma pack(push, 8)
+typedef struct _ShmDataItem {
+  uint32_t _type; // 数据类型， 0-tick,1-委托队列,2-逐笔委托,3-逐笔成交
+  union {
+    WTSTickStruct _tick;
+    WTSOrdQueStruct _queue;
+    WTSOrdDtlStruct _order;
+    WTSTransStruct _trans;
+  };
+
+  _ShmDataItem() { memset(this, 0, sizeof(_ShmDataItem)); }
+} ShmDataItem;
+#pragma pack(pop)
+
+/*
+ *	槽位
+ *	_seq为偶数2*(n+1)表示第n条数据已经写完,为奇数2*n+1表示第n条数据正在写入
+ */
+typedef struct alignas(64) _ShmCastSlot {
+  std::atomic<uint64_t> _seq;
+  ShmDataItem _item;
+} ShmCastSlot;
+
+/*
+ *	读进程登记信息,写进程和监控工具可以据此查看各个读进程的进度
+ */
+typedef struct alignas(64) _ShmReaderInfo {
+  std::atomic<uint32_t> _pid;
+  std::atomic<uint64_t> _cursor;   // 下一条要读的序号
+  std::atomic<uint64_t> _recv;     // 读到的数据条数
+  std::atomic<uint64_t> _overruns; // 被覆盖的次数
+  std::atomic<uint64_t> _lost;     // 被覆盖丢掉的数据条数
+} ShmReaderInfo;
+
+typedef struct _ShmCastHeader {
+  uint32_t _magic;
+  uint32_t _version;
+  uint64_t _capacity; // 2的整数次幂
+  // 写进程的pid,写进程重启以后会变化,为0表示队列正在初始化
+  // 初始化时最先清零、最后写入,读进程只在pid非0时挂载
+  std::atomic<uint32_t> _pid;
+  uint32_t _item_size;
+
+  alignas(64) std::atomic<uint64_t> _writable; // 下一条要写的序号
+  ShmReaderInfo _readers[SHM_CAST_MAX_READERS];
+} ShmCastHeader;
+
+class ShmCastQueue {
+public:
+  ShmCastQueue() : _header(NULL), _slots(NULL), _mask(0) {}
+
+  static inline uint64_t round_capacity(uint64_t capacity) {
+    uint64_t realCap = 2;
+    while (realCap < capacity)
+      realCap <<= 1;
+    return realCap;
+  }
+
+  static inline std::size_t mem_size(uint64_t capacity) {
+    return sizeof(ShmCastHeader) +
+           sizeof(ShmCastSlot) * (std::size_t)round_capacity(capacity);
+  }
+
+public:
+  /*
+   *	写进程初始化队列,会清空原有数据
+   *	@addr	映射内存的首地址,大小至少为mem_size(capacity)
+   */
+  inline void create(void *addr, uint64_t capacity, uint32_t pid) {
+    capacity = round_capacity(capacity);
+    // 先把原来的pid清零,读进程看到0就不会再读这块内存
+    ShmCastHeader *old = (ShmCastHeader *)addr;
+    if (old->_magic == SHM_CAST_MAGIC)
+      old->_pid.store(0, std::memory_order_release);
+
+    _header = new (addr) ShmCastHeader();
+    _header->_magic = SHM_CAST_MAGIC;
+    _header->_version = SHM_CAST_VERSION;
+    _header->_capacity = capacity;
+    _header->_item_size = sizeof(ShmDataItem);
+    _header->_writable.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < SHM_CAST_MAX_READERS; i++) {
+      ShmReaderInfo &rInfo = _header->_readers[i];
+      rInfo._pid.store(0, std::memory_order_relaxed);
+      rInfo._cursor.store(0, std::memory_order_relaxed);
+      rInfo._recv.store(0, std::memory_order_relaxed);
+      rInfo._overruns.store(0, std::memory_order_relaxed);
+      rInfo._lost.store(0, std::memory_order_relaxed);
+    }
+
+    _slots = (ShmCastSlot *)((char *)addr + sizeof(ShmCastHeader));
+    for (uint64_t i = 0; i < capacity; i++)
+      _slots[i]._seq.store(0, std::memory_order_relaxed);
+    _mask = capacity - 1;
+
+    // pid最后写,读进程看到pid变化时队列已经初始化好了
+    _header->_pid.store(pid, std::memory_order_release);
+  }
+
+  /*
+   *	读进程挂载队列,写进程还没有初始化完成的时候返回false
+   *	@size	映射内存的大小,用于校验
+   */
+  inline bool attach(void *addr, std::size_t size) {
+    if (size < sizeof(ShmCastHeader))
+      return false;
+
+    ShmCastHeader *header = (ShmCastHeader *)addr;
+    if (header->_pid.load(std::memory_order_acquire) == 0)
+      return false;
+
+    if (header->_magic != SHM_CAST_MAGIC ||
+        header->_version != SHM_CAST_VERSION ||
+        header->_item_size != sizeof(ShmDataItem))
+      return false;
+
+    // 容量必须是不小于2的2的整数次幂,否则掩码不对,会越界
+    uint64_t capacity = header->_capacity;
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+      return false;
+
+    if (size < mem_size(capacity))
+      return false;
+
+    _header = header;
+    _slots = (ShmCastSlot *)((char *)addr + sizeof(ShmCastHeader));
+    _mask = capacity - 1;
+    return true;
+  }
+
+  inline bool valid() const { return _header != NULL; }
+
+  inline ShmCastHeader *header() { return _header; }
+
+  inline uint64_t capacity() const { return _mask + 1; }
+
+  inline uint32_t pid() const {
+    return _header->_pid.load(std::memory_order_acquire);
+  }
+
+  inline uint64_t writable() const {
+    return _header->_writable.load(std::memory_order_acquire);
+  }
+
+  /*
+   *	写入一条数据
+   *	序号用原子操作分配,多个线程同时写也是安全的
+   */
+  inline uint64_t publish(uint32_t type, const void *data, std::size_t len) {
+    uint64_t seq = _header->_writable.fetch_add(1, std::memory_order_acq_rel);
+    ShmCastSlot &slot = _slots[seq & _mask];
+
+    slot._seq.store(2 * seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot._item._type = type;
+    memcpy(&slot._item._tick, data, len);
+
+    slot._seq.store(2 * seq + 2, std::memory_order_release);
+    return seq;
+  }
+
+  inline ShmCastSlot &slot(uint64_t seq) { return _slots[seq & _mask]; }
+
+private:
+  ShmCastHeader *_header;
+  ShmCastSlot *_slots;
+  uint64_t _mask;
+};
+
+/*
+ *	读取游标,每个读进程一个
+ */
+class ShmCastReader {
+public:
+  typedef enum tagReadResult {
+    SRR_Data = 0, // 读到了数据
+    SRR_Empty,    // 没有新的数据
+    SRR_Overrun   // 数据已经被覆盖,游标已经跳到了新的位置
+  } ReadResult;
+
+  ShmCastReader()
+      : _queue(NULL), _info(NULL), _cursor(0), _recv(0), _overruns(0),
+        _lost(0) {}
+
+  ~ShmCastReader() { detach(); }
+
+public:
+  /*
+   *	挂到队列上,从最新的位置开始读
+   *	@pid	当前进程的pid,用于在共享内存里登记读进程
+   */
+  inline void attach(ShmCastQueue *queue, uint32_t pid) {
+    detach();
+
+    _queue = queue;
+    _cursor = queue->writable();
+
+    // 登记读进程,登记满了不影响读取
+    ShmCastHeader *header = queue->header();
+    for (uint32_t i = 0; i < SHM_CAST_MAX_READERS; i++) {
+      ShmReaderInfo &rInfo = header->_readers[i];
+      uint32_t expected = 0;
+      if (rInfo._pid.compare_exchange_strong(expected, pid) ||
+          expected == pid) {
+        _info = &rInfo;
+        _info->_cursor.store(_cursor, std::memory_order_relaxed);
+        _info->_recv.store(0, std::memory_order_relaxed);
+        _info->_overruns.store(0, std::memory_order_relaxed);
+        _info->_lost.store(0, std::memory_order_relaxed);
+        break;
+      }
+    }
+  }
+
+  inline void detach() {
+    if (_info)
+      _info->_pid.store(0, std::memory_order_release);
+    _info = NULL;
+    _queue = NULL;
+  }
+
+  /*
+   *	读取下一条数据
+   *	@item	读到的数据拷贝到这里,只有返回SRR_Data时有效
+   *	@lost	返回SRR_Overrun时,跳过的数据条数
+   */
+  inline ReadResult read(ShmDataItem &item, uint64_t &lost) {
+    ShmCastSlot &slot = _queue->slot(_cursor);
+    uint64_t ready = 2 * _cursor + 2;
+
+    uint64_t s1 = slot._seq.load(std::memory_order_acquire);
+    if (s1 < ready) // 还没写或者正在写
+      return SRR_Empty;
+
+    if (s1 == ready) {
+      memcpy(&item, &slot._item, sizeof(ShmDataItem));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint64_t s2 = slot._seq.load(std::memory_order_relaxed);
+      if (s1 == s2) {
+        _cursor++;
+        _recv++;
+        if (_info) {
+          _info->_cursor.store(_cursor, std::memory_order_relaxed);
+          _info->_recv.store(_recv, std::memory_order_relaxed);
+        }
+        return SRR_Data;
+      }
+    }
+
+    // 读的过程中被覆盖了,跳到最新数据之前半个队列的位置,给写进程留出余量
+    uint64_t newest = _queue->writable();
+    uint64_t half = _queue->capacity() / 2;
+    uint64_t resume = newest > half ? newest - half : 0;
+    if (resume <= _cursor)
+      resume = _cursor + 1;
+
+    lost = resume - _cursor;
+    _lost += lost;
+    _overruns++;
+    _cursor = resume;
+    if (_info) {
+      _info->_cursor.store(_cursor, std::memory_order_relaxed);
+      _info->_overruns.store(_overruns, std::memory_order_relaxed);
+      _info->_lost.store(_lost, std::memory_order_relaxed);
+    }
+    return SRR_Overrun;
+  }
+
+  inline uint64_t cursor() const { return _cursor; }
+  inline uint64_t recv_count() const { return _recv; }
+  inline uint64_t overrun_count() const { return _overruns; }
+  inline uint64_t lost_count() const { return _lost; }
+
+private:
+  ShmCastQueue *_queue;
+  ShmReaderInfo *_info;
+  uint64_t _cursor;
+
+  uint64_t _recv;
+  uint64_t _overruns;
+  uint64_t _lost;
+};
+
+NS_WTP_END
@@ -0,0 +1,90 @@
+﻿/*!
+ * \file SpscQueue.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief 单生产者单消费者的无锁环形队列
+ * 容量会被调整为2的整数次幂,读写下标各自独占一个缓存行
+ */
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+template <typename T> class SpscQueue {
+public:
+  SpscQueue(std::size_t capacity = 8192) : _head(0), _tail(0) {
+    std::size_t realCap = 2;
+    while (realCap < capacity)
+      realCap <<= 1;
+
+    _mask = realCap - 1;
+    _items.resize(realCap);
+    _cached_head = 0;
+    _cached_tail = 0;
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+public:
+  /*
+   *	写入一条数据,只能在生产者线程调用
+   *	队列满了返回false
+   */
+  inline bool push(const T &item) {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _cached_head > _mask) {
+      _cached_head = _head.load(std::memory_order_acquire);
+      if (tail - _cached_head > _mask)
+        return false;
+    }
+
+    _items[tail & _mask] = item;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*
+   *	读取一条数据,只能在消费者线程调用
+   *	队列为空返回false
+   */
+  inline bool pop(T &item) {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    if (head == _cached_tail) {
+      _cached_tail = _tail.load(std::memory_order_acquire);
+      if (head == _cached_tail)
+        return false;
+    }
+
+    item = _items[head & _mask];
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  inline bool empty() const {
+    return _head.load(std::memory_order_acquire) ==
+           _tail.load(std::memory_order_acquire);
+  }
+
+  inline std::size_t size() const {
+    return _tail.load(std::memory_order_acquire) -
+           _head.load(std::memory_order_acquire);
+  }
+
+  inline std::size_t capacity() const { return _mask + 1; }
+
+private:
+  std::vector<T> _items;
+  std::size_t _mask;
+
+  alignas(64) std::atomic<std::size_t> _head; // 消费者读取位置
+  std::size_t _cached_tail;                   // 消费者缓存的写入位置
+
+  alignas(64) std::atomic<std::size_t> _tail; // 生产者写入位置
+  std::size_t _cached_head;                   // 生产者缓存的读取位置
+
+  char _padding[64 - sizeof(std::size_t) * 2];
+};
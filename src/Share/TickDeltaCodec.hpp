@@ -0,0 +1,395 @@
+﻿/*!
+ * \file TickDeltaCodec.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief tick数据的增量编码
+ * 每个合约和上一笔tick比较,只编码变化的字段
+ * 价格和数量按照1/10000的精度转成整数后做差值,用zigzag+varint编码
+ * 不能无损转换的字段直接写原始的8个字节
+ * 每隔一定笔数输出一个关键帧(和全0的tick比较),接收端丢包以后可以从关键帧恢复
+ *
+ * 编码格式:
+ * flag(1字节) | 合约序号(varint) | 市场(长度+内容) | 代码(长度+内容)
+ * | 变化位图(varint) | 原始值位图(varint) | 变化的字段...
+ */
+#pragma once
+#include <atomic>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#include "../Includes/FasterDefs.h"
+#include "../Includes/WTSStruct.h"
+
+NS_WTP_BEGIN
+
+#define TICK_DELTA_MAX_SIZE 1024     // 编码后的最大长度
+#define TICK_DELTA_FLAG_KEYFRAME 0x1 // 关键帧
+#define TICK_DELTA_SCALE 10000.0     // 定点化精度
+#define TICK_DELTA_MAX_VALUE 9.0e14  // 能定点化的最大值
+
+namespace tick_delta {
+// 参与编码的double字段
+static const size_t DOUBLE_FIELDS[] = {
+    offsetof(WTSTickStruct, price), offsetof(WTSTickStruct, open),
+    offsetof(WTSTickStruct, high), offsetof(WTSTickStruct, low),
+    offsetof(WTSTickStruct, settle_price), offsetof(WTSTickStruct, upper_limit),
+    offsetof(WTSTickStruct, lower_limit), offsetof(WTSTickStruct, total_volume),
+    offsetof(WTSTickStruct, volume), offsetof(WTSTickStruct, total_turnover),
+    offsetof(WTSTickStruct, turn_over), offsetof(WTSTickStruct, open_interest),
+    offsetof(WTSTickStruct, diff_interest), offsetof(WTSTickStruct, pre_close),
+    offsetof(WTSTickStruct, pre_settle), offsetof(WTSTickStruct, pre_interest)};
+static const uint32_t DOUBLE_FIELD_CNT =
+    sizeof(DOUBLE_FIELDS) / sizeof(size_t);
+
+// 参与编码的uint32字段
+static const size_t UINT_FIELDS[] = {offsetof(WTSTickStruct, trading_date),
+                                     offsetof(WTSTickStruct, action_date),
+                                     offsetof(WTSTickStruct, action_time)};
+static const uint32_t UINT_FIELD_CNT = sizeof(UINT_FIELDS) / sizeof(size_t);
+
+// 盘口一共40个double字段,紧跟在普通double字段后面
+static const uint32_t BOOK_FIELD_CNT = 40;
+static const uint32_t BOOK_BASE = DOUBLE_FIELD_CNT;
+static const uint32_t UINT_BASE = BOOK_BASE + BOOK_FIELD_CNT;
+static const uint32_t FIELD_CNT = UINT_BASE + UINT_FIELD_CNT;
+static_assert(FIELD_CNT <= 64, "too many fields for a 64-bit bitmap");
+
+inline double *double_field(WTSTickStruct &tick, uint32_t idx) {
+  if (idx < BOOK_BASE)
+    return (double *)((char *)&tick + DOUBLE_FIELDS[idx]);
+  return &tick.bid_prices[0] + (idx - BOOK_BASE);
+}
+
+inline uint32_t *uint_field(WTSTickStruct &tick, uint32_t idx) {
+  return (uint32_t *)((char *)&tick + UINT_FIELDS[idx - UINT_BASE]);
+}
+
+inline uint32_t write_varint(char *buf, uint64_t val) {
+  uint32_t len = 0;
+  while (val >= 0x80) {
+    buf[len++] = (char)(val | 0x80);
+    val >>= 7;
+  }
+  buf[len++] = (char)val;
+  return len;
+}
+
+inline bool read_varint(const char *buf, uint32_t len, uint32_t &pos,
+                        uint64_t &val) {
+  val = 0;
+  for (uint32_t shift = 0; shift < 64 && pos < len; shift += 7) {
+    uint8_t b = (uint8_t)buf[pos++];
+    val |= (uint64_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+inline uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/*
+ *	尝试把double无损地转成定点整数
+ */
+inline bool to_fixed(double val, int64_t &fixed) {
+  if (!std::isfinite(val) || fabs(val) >= TICK_DELTA_MAX_VALUE)
+    return false;
+
+  fixed = llround(val * TICK_DELTA_SCALE);
+  return (double)fixed / TICK_DELTA_SCALE == val;
+}
+
+inline uint32_t write_str(char *buf, const char *str, uint32_t maxLen) {
+  uint32_t len = (uint32_t)strnlen(str, maxLen - 1);
+  buf[0] = (char)len;
+  memcpy(buf + 1, str, len);
+  return len + 1;
+}
+
+inline bool read_str(const char *buf, uint32_t len, uint32_t &pos, char *str,
+                     uint32_t maxLen) {
+  if (pos >= len)
+    return false;
+
+  uint32_t sLen = (uint8_t)buf[pos++];
+  if (sLen >= maxLen || pos + sLen > len)
+    return false;
+
+  memcpy(str, buf + pos, sLen);
+  str[sLen] = '\0';
+  pos += sLen;
+  return true;
+}
+
+// 合约键,市场和代码定长存放,查表不用每笔都构造std::string
+typedef struct _CodeKey {
+  char _exchg[MAX_EXCHANGE_LENGTH];
+  char _code[MAX_INSTRUMENT_LENGTH];
+
+  _CodeKey(const char *exchg, const char *code) {
+    memset(this, 0, sizeof(_CodeKey));
+    memcpy(_exchg, exchg, strnlen(exchg, MAX_EXCHANGE_LENGTH - 1));
+    memcpy(_code, code, strnlen(code, MAX_INSTRUMENT_LENGTH - 1));
+  }
+
+  inline bool operator==(const _CodeKey &rhs) const {
+    return memcmp(this, &rhs, sizeof(_CodeKey)) == 0;
+  }
+} CodeKey;
+
+// FNV-1a
+struct CodeKeyHash {
+  inline size_t operator()(const CodeKey &key) const {
+    const uint8_t *p = (const uint8_t *)&key;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < sizeof(CodeKey); i++) {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+    }
+    return (size_t)h;
+  }
+};
+} // namespace tick_delta
+
+class TickDeltaEncoder {
+public:
+  /*
+   *	@keyframeSpan	每个合约每隔多少笔输出一个关键帧
+   */
+  TickDeltaEncoder(uint32_t keyframeSpan = 100)
+      : _keyframe_span(keyframeSpan == 0 ? 1 : keyframeSpan), _kf_epoch(0) {}
+
+  inline void set_keyframe_span(uint32_t span) {
+    _keyframe_span = (span == 0) ? 1 : span;
+  }
+
+  /*
+   *	要求每个合约的下一笔都输出关键帧,可以在其他线程调用
+   *	接收端丢包以后重传回去的增量帧接不上,要靠关键帧恢复
+   */
+  inline void request_keyframes() {
+    _kf_epoch.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /*
+   *	编码一笔tick
+   *	@buf	输出缓冲区,长度至少为TICK_DELTA_MAX_SIZE
+   *	返回编码后的长度
+   */
+  inline uint32_t encode(const WTSTickStruct &tick, char *buf) {
+    using namespace tick_delta;
+
+    CodeState &state = _states[CodeKey(tick.exchg, tick.code)];
+
+    uint32_t epoch = _kf_epoch.load(std::memory_order_relaxed);
+    bool bKeyFrame =
+        (state._seq % _keyframe_span == 0) || (state._epoch != epoch);
+    state._epoch = epoch;
+    static const WTSTickStruct ZERO_TICK;
+    WTSTickStruct &prev = bKeyFrame ? (WTSTickStruct &)ZERO_TICK : state._tick;
+    WTSTickStruct &cur = (WTSTickStruct &)tick;
+
+    uint32_t pos = 0;
+    buf[pos++] = bKeyFrame ? TICK_DELTA_FLAG_KEYFRAME : 0;
+    pos += write_varint(buf + pos, state._seq);
+    pos += write_str(buf + pos, tick.exchg, MAX_EXCHANGE_LENGTH);
+    pos += write_str(buf + pos, tick.code, MAX_INSTRUMENT_LENGTH);
+
+    // 先算出位图,再写字段
+    uint64_t changed = 0;
+    uint64_t raw = 0;
+    int64_t deltas[FIELD_CNT];
+    for (uint32_t i = 0; i < UINT_BASE; i++) {
+      double curVal = *double_field(cur, i);
+      double preVal = *double_field(prev, i);
+      if (memcmp(&curVal, &preVal, sizeof(double)) == 0)
+        continue;
+
+      changed |= (uint64_t)1 << i;
+      int64_t curFixed, preFixed;
+      if (to_fixed(curVal, curFixed) && to_fixed(preVal, preFixed))
+        deltas[i] = curFixed - preFixed;
+      else
+        raw |= (uint64_t)1 << i;
+    }
+
+    for (uint32_t i = UINT_BASE; i < FIELD_CNT; i++) {
+      uint32_t curVal = *uint_field(cur, i);
+      uint32_t preVal = *uint_field(prev, i);
+      if (curVal == preVal)
+        continue;
+
+      changed |= (uint64_t)1 << i;
+      deltas[i] = (int64_t)curVal - (int64_t)preVal;
+    }
+
+    pos += write_varint(buf + pos, changed);
+    pos += write_varint(buf + pos, raw);
+    for (uint32_t i = 0; i < FIELD_CNT; i++) {
+      uint64_t mask = (uint64_t)1 << i;
+      if ((changed & mask) == 0)
+        continue;
+
+      if (raw & mask) {
+        memcpy(buf + pos, double_field(cur, i), sizeof(double));
+        pos += sizeof(double);
+      } else {
+        pos += write_varint(buf + pos, zigzag(deltas[i]));
+      }
+    }
+
+    memcpy(&state._tick, &tick, sizeof(WTSTickStruct));
+    state._seq++;
+    return pos;
+  }
+
+  /*
+   *	清除全部合约的状态,下一笔都会输出关键帧
+   */
+  inline void reset() { _states.clear(); }
+
+private:
+  typedef struct _CodeState {
+    uint64_t _seq;
+    uint32_t _epoch; // 上一次输出时的关键帧轮次
+    WTSTickStruct _tick;
+
+    _CodeState() : _seq(0), _epoch(0) {}
+  } CodeState;
+
+  wt_hashmap<tick_delta::CodeKey, CodeState, tick_delta::CodeKeyHash> _states;
+  uint32_t _keyframe_span;
+  std::atomic<uint32_t> _kf_epoch; // 关键帧轮次,变化以后全部合约输出关键帧
+};
+
+class TickDeltaDecoder {
+public:
+  TickDeltaDecoder() : _decoded(0), _dropped(0), _stale(0) {}
+
+  /*
+   *	解码一笔tick
+   *	增量帧对应的前一笔数据丢了,会返回false,直到收到下一个关键帧
+   *	重复或者乱序到达的旧数据直接丢掉,不影响当前的解码状态
+   */
+  inline bool decode(const char *buf, uint32_t len, WTSTickStruct &tick) {
+    using namespace tick_delta;
+
+    uint32_t pos = 0;
+    if (len == 0)
+      return false;
+
+    uint8_t flag = (uint8_t)buf[pos++];
+    bool bKeyFrame = (flag & TICK_DELTA_FLAG_KEYFRAME) != 0;
+    uint64_t seq = 0;
+    char exchg[MAX_EXCHANGE_LENGTH] = {0};
+    char code[MAX_INSTRUMENT_LENGTH] = {0};
+    if (!read_varint(buf, len, pos, seq) ||
+        !read_str(buf, len, pos, exchg, MAX_EXCHANGE_LENGTH) ||
+        !read_str(buf, len, pos, code, MAX_INSTRUMENT_LENGTH)) {
+      _dropped++;
+      return false;
+    }
+
+    CodeState &state = _states[CodeKey(exchg, code)];
+    if (state._valid && seq <= state._seq) {
+      _stale++;
+      return false;
+    }
+
+    if (!bKeyFrame && (!state._valid || state._seq + 1 != seq)) {
+      // 前面的数据丢了,等下一个关键帧
+      state._valid = false;
+      _dropped++;
+      return false;
+    }
+
+    if (bKeyFrame)
+      memset((void *)&tick, 0, sizeof(WTSTickStruct));
+    else
+      memcpy(&tick, &state._tick, sizeof(WTSTickStruct));
+    strcpy(tick.exchg, exchg);
+    strcpy(tick.code, code);
+
+    uint64_t changed = 0;
+    uint64_t raw = 0;
+    if (!read_varint(buf, len, pos, changed) ||
+        !read_varint(buf, len, pos, raw)) {
+      state._valid = false;
+      _dropped++;
+      return false;
+    }
+
+    for (uint32_t i = 0; i < FIELD_CNT; i++) {
+      uint64_t mask = (uint64_t)1 << i;
+      if ((changed & mask) == 0)
+        continue;
+
+      if (raw & mask) {
+        if (pos + sizeof(double) > len || i >= UINT_BASE) {
+          state._valid = false;
+          _dropped++;
+          return false;
+        }
+        memcpy(double_field(tick, i), buf + pos, sizeof(double));
+        pos += sizeof(double);
+        continue;
+      }
+
+      uint64_t val = 0;
+      if (!read_varint(buf, len, pos, val)) {
+        state._valid = false;
+        _dropped++;
+        return false;
+      }
+
+      int64_t delta = unzigzag(val);
+      if (i < UINT_BASE) {
+        double *field = double_field(tick, i);
+        int64_t preFixed = 0;
+        to_fixed(*field, preFixed);
+        *field = (double)(preFixed + delta) / TICK_DELTA_SCALE;
+      } else {
+        uint32_t *field = uint_field(tick, i);
+        *field = (uint32_t)((int64_t)*field + delta);
+      }
+    }
+
+    memcpy(&state._tick, &tick, sizeof(WTSTickStruct));
+    state._seq = seq;
+    state._valid = true;
+    _decoded++;
+    return true;
+  }
+
+  inline uint64_t decoded_count() const { return _decoded; }
+  inline uint64_t dropped_count() const { return _dropped; }
+  inline uint64_t stale_count() const { return _stale; }
+
+private:
+  typedef struct _CodeState {
+    uint64_t _seq;
+    bool _valid;
+    WTSTickStruct _tick;
+
+    _CodeState() : _seq(0), _valid(false) {}
+  } CodeState;
+
+  wt_hashmap<tick_delta::CodeKey, CodeState, tick_delta::CodeKeyHash> _states;
+  uint64_t _decoded;
+  uint64_t _dropped;
+  uint64_t _stale;
+};
+
+NS_WTP_END
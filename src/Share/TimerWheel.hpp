@@ -0,0 +1,138 @@
+﻿/*!
+ * \file TimerWheel.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/04/02
+ *
+ * \brief 分层时间轮
+ * 第一层256格,往上每层64格,每一格的跨度等于下一层转一圈
+ * 登记和到期都是O(1),上层的定时器在下层转完一圈的时候往下搬一格
+ * 到期的定时器不需要每次全部扫描,只检查走过的格子
+ * 本身不加锁,由调用方保证线程安全
+ */
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+template <typename T> class TimerWheel {
+public:
+  /*
+   *	@resolution	时间轮的精度,单位毫秒
+   */
+  TimerWheel(uint32_t resolution = 100)
+      : _resolution(resolution == 0 ? 1 : resolution), _cur(0), _count(0) {}
+
+  /*
+   *	登记定时器
+   *	@now	当前时间,单位毫秒
+   *	@elapse	多久以后到期,单位毫秒
+   *	@data	到期的时候回调的数据
+   */
+  void schedule(uint64_t now, uint32_t elapse, const T &data) {
+    // 没有定时器的时候,直接把时间轮拨到当前时间
+    uint64_t curTick = now / _resolution;
+    if (_count == 0 && curTick > _cur)
+      _cur = curTick;
+
+    uint64_t expire = (now + elapse + _resolution - 1) / _resolution;
+    if (expire <= _cur)
+      expire = _cur + 1;
+
+    _count++;
+    place(Node{expire, data});
+  }
+
+  /*
+   *	把时间轮拨到当前时间,到期的定时器依次调用cb(data)
+   */
+  template <typename Callback> void advance(uint64_t now, Callback cb) {
+    uint64_t target = now / _resolution;
+    while (_cur < target) {
+      if (_count == 0) {
+        _cur = target;
+        break;
+      }
+
+      _cur++;
+      uint32_t idx = (uint32_t)(_cur & L0_MASK);
+      if (idx == 0)
+        cascade(1);
+
+      std::vector<Node> &slot = _wheels[0][idx];
+      if (slot.empty())
+        continue;
+
+      _fired.swap(slot);
+      for (Node &node : _fired) {
+        _count--;
+        cb(node._data);
+      }
+      _fired.clear();
+    }
+  }
+
+  inline std::size_t size() const { return _count; }
+  inline bool empty() const { return _count == 0; }
+
+private:
+  enum {
+    L0_BITS = 8,
+    LN_BITS = 6,
+    LEVELS = 4,
+    L0_SIZE = 1 << L0_BITS,
+    LN_SIZE = 1 << LN_BITS,
+    L0_MASK = L0_SIZE - 1,
+    LN_MASK = LN_SIZE - 1
+  };
+
+  typedef struct _Node {
+    uint64_t _expire; // 到期的格子序号
+    T _data;
+  } Node;
+
+  inline static uint32_t shift(uint32_t level) {
+    return L0_BITS + LN_BITS * (level - 1);
+  }
+
+  void place(Node &&node) {
+    uint64_t delta = node._expire - _cur;
+    if (delta < L0_SIZE) {
+      _wheels[0][node._expire & L0_MASK].emplace_back(std::move(node));
+      return;
+    }
+
+    for (uint32_t level = 1; level < LEVELS; level++) {
+      uint32_t bits = shift(level) + LN_BITS;
+      uint64_t expire = node._expire;
+      // 超出最上层的范围,先放在最上层的最后一格,搬下来的时候再重新计算
+      if (level == LEVELS - 1 && delta >= ((uint64_t)1 << bits))
+        expire = _cur + ((uint64_t)1 << bits) - 1;
+
+      if (delta < ((uint64_t)1 << bits) || level == LEVELS - 1) {
+        uint32_t idx = (uint32_t)(expire >> shift(level)) & LN_MASK;
+        _wheels[level][idx].emplace_back(std::move(node));
+        return;
+      }
+    }
+  }
+
+  void cascade(uint32_t level) {
+    uint32_t idx = (uint32_t)(_cur >> shift(level)) & LN_MASK;
+    if (idx == 0 && level + 1 < LEVELS)
+      cascade(level + 1);
+
+    std::vector<Node> nodes;
+    nodes.swap(_wheels[level][idx]);
+    for (Node &node : nodes)
+      place(std::move(node));
+  }
+
+private:
+  uint32_t _resolution;
+  uint64_t _cur; // 当前格子序号,即当前时间/精度
+  std::size_t _count;
+
+  std::vector<Node> _wheels[LEVELS][L0_SIZE];
+  std::vector<Node> _fired;
+};
@@ -0,0 +1,52 @@
+﻿#include "../WtDataStorage/BlockCache.hpp"
+#include "gtest/gtest/gtest.h"
+
+#include <thread>
+
+USING_NS_WTP;
+
+TEST(test_block_cache, test_lru_evict) {
+  BlockCache cache;
+  cache.set_budget(BlockCache::SHARD_COUNT * 100);
+
+  // 同一个key反复替换，占用不会累加
+  for (int i = 0; i < 10; i++)
+    cache.put("a", std::make_shared<std::string>(60, 'a'), 60);
+  EXPECT_EQ(cache.used(), 60u);
+
+  // 被淘汰的数据块如果还有引用，仍然有效
+  std::shared_ptr<std::string> held = cache.get<std::string>("a");
+  for (int i = 0; i < 1000; i++) {
+    std::string key = std::to_string(i);
+    cache.put(key, std::make_shared<std::string>(60, 'x'), 60);
+  }
+
+  EXPECT_FALSE(cache.get<std::string>("a"));
+  EXPECT_EQ(held->size(), 60u);
+  EXPECT_LE(cache.used(), (std::size_t)BlockCache::SHARD_COUNT * 100);
+  EXPECT_TRUE(cache.get<std::string>("999"));
+}
+
+TEST(test_block_cache, test_concurrent) {
+  BlockCache cache;
+  cache.set_budget(1024 * 1024);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < 10000; i++) {
+        std::string key = std::to_string((i * 7 + t) % 500);
+        std::shared_ptr<std::string> data = cache.get<std::string>(key);
+        if (data)
+          EXPECT_EQ(*data, key);
+        else
+          cache.put(key, std::make_shared<std::string>(key), 1024);
+      }
+    });
+  }
+
+  for (auto &t : threads)
+    t.join();
+
+  EXPECT_LE(cache.used(), (std::size_t)1024 * 1024);
+}
@@ -0,0 +1,22 @@
+﻿#include "../Share/CoarseClock.hpp"
+#include "gtest/gtest/gtest.h"
+
+TEST(test_coarse_clock, test_datetime) {
+  CoarseClock &clock = CoarseClock::one();
+
+  // 缓存的时间最多落后刷新间隔,这里留足余量
+  int64_t diff = TimeUtils::getLocalTimeNow() - clock.getLocalTimeNow();
+  EXPECT_GE(diff, 0);
+  EXPECT_LT(diff, 1000);
+
+  uint32_t date, time;
+  clock.getDateTime(date, time);
+  EXPECT_EQ(date, clock.getCurDate());
+  EXPECT_EQ(clock.makeTime(date, time), TimeUtils::makeTime(date, time));
+  EXPECT_EQ(clock.makeTime(date, 93015500),
+            TimeUtils::makeTime(date, 93015500));
+
+  // 非当天的日期走mktime
+  EXPECT_EQ(clock.makeTime(20200318, 145959999),
+            TimeUtils::makeTime(20200318, 145959999));
+}
@@ -65,4 +65,66 @@ private:
 //	uint64_t time_b = ticker.nano_seconds();
 //	printf("boost::object_pool: %I64d - optimized_object_pool: %I64d\n",
 //time_a, time_b);
-// }
\ No newline at end of file
+// }
+
+#include "../Includes/WTSDataDef.hpp"
+#include <set>
+#include <thread>
+
+USING_NS_WTP;
+
+TEST(test_object_pool, test_cross_thread_release) {
+  std::vector<WTSTransData *> items;
+  std::thread producer([&items]() {
+    for (uint32_t i = 0; i < 10000; i++)
+      items.emplace_back(WTSTransData::create("SSE.600000"));
+  });
+  producer.join();
+
+  // 生产线程已经退出,对象仍然可以正常访问和释放
+  for (WTSTransData *item : items) {
+    EXPECT_STREQ(item->code(), "SSE.600000");
+    item->release();
+  }
+
+  std::vector<WTSOrdDtlData *> details;
+  for (uint32_t i = 0; i < 10000; i++)
+    details.emplace_back(WTSOrdDtlData::create("SZSE.000001"));
+
+  std::thread consumer([&details]() {
+    for (WTSOrdDtlData *item : details)
+      item->release();
+  });
+  consumer.join();
+
+  // 其他线程归还的内存会在下次分配时回收
+  WTSOrdDtlData *item = WTSOrdDtlData::create("SZSE.000002");
+  EXPECT_STREQ(item->code(), "SZSE.000002");
+  item->release();
+}
+
+TEST(test_object_pool, test_orphan_state) {
+  std::vector<WTSTransData *> items;
+  std::thread producer([&items]() {
+    for (uint32_t i = 0; i < 100; i++)
+      items.emplace_back(WTSTransData::create("SSE.600001"));
+  });
+  producer.join();
+
+  // 生产线程退出以后才归还,内存挂在它留下的状态上
+  std::set<void *> freed;
+  for (WTSTransData *item : items) {
+    freed.insert(item);
+    item->release();
+  }
+
+  // 新线程接手留下的状态,归还的内存可以再分配出来
+  bool bReused = false;
+  std::thread adopter([&freed, &bReused]() {
+    WTSTransData *item = WTSTransData::create("SSE.600002");
+    bReused = freed.find(item) != freed.end();
+    item->release();
+  });
+  adopter.join();
+  EXPECT_TRUE(bReused);
+}
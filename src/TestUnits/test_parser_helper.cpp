@@ -0,0 +1,68 @@
+﻿#include "../Share/ParserHelper.hpp"
+#include "gtest/gtest/gtest.h"
+
+namespace {
+// 模拟CTP系的行情结构体,只保留策略类用到的字段
+struct FakeDepthField {
+  double LastPrice, OpenPrice, HighestPrice, LowestPrice;
+  int Volume;
+  double Turnover, SettlementPrice, OpenInterest, PreOpenInterest;
+  double UpperLimitPrice, LowerLimitPrice, PreClosePrice, PreSettlementPrice;
+  double AskPrice1, AskPrice2, AskPrice3, AskPrice4, AskPrice5;
+  double BidPrice1, BidPrice2, BidPrice3, BidPrice4, BidPrice5;
+  int AskVolume1, AskVolume2, AskVolume3, AskVolume4, AskVolume5;
+  int BidVolume1, BidVolume2, BidVolume3, BidVolume4, BidVolume5;
+};
+} // namespace
+
+TEST(test_parser_helper, test_parse) {
+  EXPECT_EQ(strToTime("09:30:15"), 93015u);
+  EXPECT_EQ(strToTime("21:00:00"), 210000u);
+  EXPECT_EQ(strToTime(""), 0u);
+
+  EXPECT_EQ(strToDate("20240325"), 20240325u);
+  EXPECT_EQ(strToDate(""), 0u);
+
+  EXPECT_EQ(checkValid(DBL_MAX), 0);
+  EXPECT_EQ(checkValid(FLT_MAX), 0);
+  EXPECT_EQ(checkValid(3500.5), 3500.5);
+}
+
+TEST(test_parser_helper, test_fix_date) {
+  // 日盘和发生日期不等于交易日的不修正
+  uint32_t actDate = 20240325;
+  EXPECT_TRUE(fixActionDate(actDate, 93015500, 20240325));
+  EXPECT_EQ(actDate, 20240325u);
+
+  actDate = 20240322;
+  EXPECT_TRUE(fixActionDate(actDate, 210000000, 20240325));
+  EXPECT_EQ(actDate, 20240322u);
+}
+
+TEST(test_parser_helper, test_ctp_policy) {
+  FakeDepthField field;
+  memset(&field, 0, sizeof(field));
+  field.LastPrice = 3500;
+  field.HighestPrice = DBL_MAX;
+  field.Volume = 100;
+  field.Turnover = 3500000;
+  field.SettlementPrice = DBL_MAX;
+  field.OpenInterest = 2000;
+  field.AskPrice1 = 3501;
+  field.AskPrice5 = DBL_MAX;
+  field.BidVolume1 = 7;
+
+  WTSTickStruct quote;
+  strcpy(quote.exchg, "SHFE");
+  CtpFieldPolicy<FakeDepthField>::fill(quote, &field, NULL);
+
+  EXPECT_EQ(quote.price, 3500);
+  EXPECT_EQ(quote.high, 0);
+  EXPECT_EQ(quote.total_volume, 100);
+  EXPECT_EQ(quote.total_turnover, 3500000);
+  EXPECT_EQ(quote.settle_price, 0);
+  EXPECT_EQ(quote.open_interest, 2000);
+  EXPECT_EQ(quote.ask_prices[0], 3501);
+  EXPECT_EQ(quote.ask_prices[4], 0);
+  EXPECT_EQ(quote.bid_qty[0], 7);
+}
@@ -0,0 +1,147 @@
+﻿#include "../Share/QueryScheduler.hpp"
+#include "gtest/gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+TEST(test_query_scheduler, test_rate_limit) {
+  QueryScheduler scheduler;
+  std::vector<int> executed;
+  StdUniqueMutex mtx;
+
+  // 每秒100笔,不允许突发,5笔查询至少要40毫秒
+  auto start = QueryScheduler::Clock::now();
+  for (int i = 0; i < 5; i++) {
+    scheduler.post([&, i](uint32_t) {
+      StdUniqueLock lock(mtx);
+      executed.push_back(i);
+      return QueryScheduler::QR_Failed;
+    });
+  }
+  scheduler.start(100, 1);
+
+  while (scheduler.size() > 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  scheduler.stop();
+
+  auto elapse = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    QueryScheduler::Clock::now() - start)
+                    .count();
+  EXPECT_GE(elapse, 35);
+  ASSERT_EQ(executed.size(), 5u);
+  for (int i = 0; i < 5; i++)
+    EXPECT_EQ(executed[i], i);
+}
+
+TEST(test_query_scheduler, test_in_flight) {
+  QueryScheduler scheduler;
+  std::atomic<int> sent(0);
+  std::atomic<int> limited(1);
+  std::atomic<uint32_t> lastID(0);
+
+  // 第一笔先被流控一次,重发成功以后要等回报才能发第二笔
+  scheduler.post([&](uint32_t reqID) {
+    if (limited.fetch_sub(1) > 0)
+      return QueryScheduler::QR_Limited;
+    sent++;
+    lastID = reqID;
+    return QueryScheduler::QR_Sent;
+  });
+  scheduler.post([&](uint32_t reqID) {
+    sent++;
+    lastID = reqID;
+    return QueryScheduler::QR_Sent;
+  });
+  scheduler.start(1000, 10);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(sent, 1);
+  EXPECT_EQ(scheduler.size(), 1u);
+
+  scheduler.on_finished(lastID);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(sent, 2);
+  EXPECT_EQ(scheduler.size(), 0u);
+  scheduler.stop();
+}
+
+TEST(test_query_scheduler, test_timeout) {
+  QueryScheduler scheduler;
+  std::atomic<int> sent(0);
+  std::atomic<int> timeouts(0);
+  std::string dropped;
+  StdUniqueMutex mtx;
+
+  // 第一笔一直没有回报,超时以后丢掉,第二笔照常发出
+  scheduler.set_timeout(30, [&](const char *name, uint32_t millisecs) {
+    StdUniqueLock lock(mtx);
+    EXPECT_EQ(millisecs, 30u);
+    dropped = name;
+    timeouts++;
+  });
+  scheduler.post(
+      [&](uint32_t) {
+        sent++;
+        return QueryScheduler::QR_Sent;
+      },
+      "positions");
+  scheduler.post(
+      [&](uint32_t) {
+        sent++;
+        return QueryScheduler::QR_Sent;
+      },
+      "orders");
+  scheduler.start(1000, 10);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(sent, 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  EXPECT_EQ(sent, 2);
+  EXPECT_EQ(timeouts, 1);
+  {
+    StdUniqueLock lock(mtx);
+    EXPECT_EQ(dropped, "positions");
+  }
+
+  // 按时收到回报的不算超时
+  scheduler.on_finished(2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(timeouts, 1);
+  scheduler.stop();
+}
+
+TEST(test_query_scheduler, test_stale_finish) {
+  QueryScheduler scheduler;
+  std::vector<uint32_t> ids;
+  StdUniqueMutex mtx;
+
+  // 第一笔超时以后才收到回报,不能把第二笔的在途状态清掉
+  scheduler.set_timeout(100);
+  for (int i = 0; i < 3; i++) {
+    scheduler.post([&](uint32_t reqID) {
+      StdUniqueLock lock(mtx);
+      ids.push_back(reqID);
+      return QueryScheduler::QR_Sent;
+    });
+  }
+  scheduler.start(1000, 10);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(130));
+  std::vector<uint32_t> sent;
+  {
+    StdUniqueLock lock(mtx);
+    sent = ids;
+  }
+  ASSERT_EQ(sent.size(), 2u);
+  EXPECT_NE(sent[0], sent[1]);
+
+  scheduler.on_finished(sent[0]);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(scheduler.size(), 1u);
+
+  scheduler.on_finished(sent[1]);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(scheduler.size(), 0u);
+  scheduler.stop();
+}
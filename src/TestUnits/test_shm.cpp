@@ -1,6 +1,11 @@
-﻿#include "../WtShareHelper/WtShareHelper.h"
+﻿#include "../Share/ShmCastQueue.hpp"
+#include "../WtShareHelper/WtShareHelper.h"
 #include "gtest/gtest/gtest.h"
 
+#include <vector>
+
+USING_NS_WTP;
+
 TEST(test_shm, test_sharehelper) {
   EXPECT_TRUE(init_slave("uft", "E:\\deploy_uft\\uft_test\\.share"));
 
@@ -22,3 +27,69 @@ TEST(test_shm, test_sharehelper) {
   EXPECT_EQ(get_uint32("uft", "uft_demo", "second"), 10);
   EXPECT_EQ(get_double("uft", "uft_demo", "lots"), 1.0);
 }
+
+TEST(test_shm, test_cast_queue_overrun) {
+  std::vector<uint64_t> mem(ShmCastQueue::mem_size(8) / sizeof(uint64_t) + 8);
+  ShmCastQueue writer;
+  writer.create(mem.data(), 8, 1);
+
+  ShmCastQueue queue;
+  EXPECT_TRUE(queue.attach(mem.data(), ShmCastQueue::mem_size(8)));
+  EXPECT_EQ(queue.capacity(), 8);
+
+  ShmCastReader reader;
+  reader.attach(&queue, 2);
+
+  WTSTickStruct tick;
+  ShmDataItem item;
+  uint64_t lost = 0;
+  for (uint32_t i = 0; i < 3; i++) {
+    tick.volume = i;
+    writer.publish(0, &tick, sizeof(tick));
+  }
+  for (uint32_t i = 0; i < 3; i++) {
+    EXPECT_EQ(reader.read(item, lost), ShmCastReader::SRR_Data);
+    EXPECT_EQ(item._tick.volume, i);
+  }
+  EXPECT_EQ(reader.read(item, lost), ShmCastReader::SRR_Empty);
+
+  // 写入超过容量的数据,读取时要能检测到被覆盖
+  for (uint32_t i = 3; i < 23; i++) {
+    tick.volume = i;
+    writer.publish(0, &tick, sizeof(tick));
+  }
+  EXPECT_EQ(reader.read(item, lost), ShmCastReader::SRR_Overrun);
+  EXPECT_EQ(lost, 16);
+  for (uint32_t i = 19; i < 23; i++) {
+    EXPECT_EQ(reader.read(item, lost), ShmCastReader::SRR_Data);
+    EXPECT_EQ(item._tick.volume, i);
+  }
+  EXPECT_EQ(reader.read(item, lost), ShmCastReader::SRR_Empty);
+  EXPECT_EQ(reader.overrun_count(), 1);
+  EXPECT_EQ(reader.lost_count(), 16);
+  EXPECT_EQ(queue.header()->_readers[0]._pid.load(), 2);
+}
+
+TEST(test_shm, test_cast_queue_attach_check) {
+  std::vector<uint64_t> mem(ShmCastQueue::mem_size(8) / sizeof(uint64_t) + 8);
+  std::size_t size = ShmCastQueue::mem_size(8);
+  ShmCastQueue writer;
+  writer.create(mem.data(), 8, 1);
+
+  // 写进程正在初始化,pid为0的时候不能挂载
+  ShmCastHeader *header = writer.header();
+  header->_pid.store(0);
+  ShmCastQueue queue;
+  EXPECT_FALSE(queue.attach(mem.data(), size));
+
+  // 容量不对的不能挂载
+  header->_pid.store(1);
+  header->_capacity = 0;
+  EXPECT_FALSE(queue.attach(mem.data(), size));
+  header->_capacity = 6;
+  EXPECT_FALSE(queue.attach(mem.data(), size));
+
+  header->_capacity = 8;
+  EXPECT_TRUE(queue.attach(mem.data(), size));
+  EXPECT_EQ(queue.pid(), 1);
+}
@@ -0,0 +1,26 @@
+﻿#include "../WtDtCore/StatHelper.hpp"
+#include "gtest/gtest/gtest.h"
+
+TEST(test_stat_helper, test_channel) {
+  StatHelper &helper = StatHelper::one();
+  StatHelper::ChannelStat *parser =
+      helper.get_channel("test_parser", StatHelper::CT_Parser);
+  EXPECT_EQ(parser, helper.get_channel("test_parser", StatHelper::CT_Parser));
+  EXPECT_NE(parser, helper.get_channel("test_parser", StatHelper::CT_Caster));
+
+  StatHelper::ChannelStat *writer =
+      helper.get_channel("test_writer", StatHelper::CT_Writer);
+  parser->add_count(10);
+  writer->add_latency(100);
+  writer->add_latency(300);
+  writer->set_depth(5);
+
+  std::string snap = helper.snapshot();
+  EXPECT_NE(snap.find("parser,test_parser,10,"), std::string::npos);
+  EXPECT_NE(snap.find("writer,test_writer,0,"), std::string::npos);
+  EXPECT_NE(snap.find(",0,200,300,5\n"), std::string::npos);
+
+  // 延迟是区间值，下一次快照重新统计
+  snap = helper.snapshot();
+  EXPECT_NE(snap.find(",0,0,0,5\n"), std::string::npos);
+}
@@ -0,0 +1,121 @@
+﻿#include "../Share/TickDeltaCodec.hpp"
+#include "gtest/gtest/gtest.h"
+
+USING_NS_WTP;
+
+TEST(test_tick_delta, test_round_trip) {
+  TickDeltaEncoder encoder(10);
+  TickDeltaDecoder decoder;
+
+  WTSTickStruct tick;
+  strcpy(tick.exchg, "SHFE");
+  strcpy(tick.code, "rb2405");
+  tick.pre_close = 3500;
+  tick.trading_date = 20240318;
+  tick.action_date = 20240318;
+  tick.action_time = 90000000;
+
+  char buf[TICK_DELTA_MAX_SIZE];
+  for (uint32_t i = 0; i < 50; i++) {
+    tick.price = 3500 + (i % 7) * 0.2;
+    tick.volume = i;
+    tick.total_volume += tick.volume;
+    tick.bid_prices[0] = tick.price - 0.2;
+    tick.ask_prices[0] = tick.price + 0.2;
+    tick.diff_interest = 1.0 / 3; // 不能定点化,按原始值编码
+    tick.action_time += 500;
+
+    uint32_t len = encoder.encode(tick, buf);
+    EXPECT_LE(len, (uint32_t)TICK_DELTA_MAX_SIZE);
+
+    // 丢掉第15笔,之后要等到第20笔的关键帧才能恢复
+    if (i == 15)
+      continue;
+
+    WTSTickStruct out;
+    bool bOK = decoder.decode(buf, len, out);
+    EXPECT_EQ(bOK, i < 15 || i >= 20);
+    if (bOK) {
+      EXPECT_EQ(memcmp(&out, &tick, sizeof(WTSTickStruct)), 0);
+    }
+  }
+
+  EXPECT_EQ(decoder.dropped_count(), 4);
+}
+
+TEST(test_tick_delta, test_stale_frame) {
+  TickDeltaEncoder encoder(10);
+  TickDeltaDecoder decoder;
+
+  WTSTickStruct tick;
+  strcpy(tick.exchg, "SHFE");
+  strcpy(tick.code, "rb2405");
+  tick.action_date = 20240318;
+  tick.action_time = 90000000;
+
+  char bufs[5][TICK_DELTA_MAX_SIZE];
+  uint32_t lens[5];
+  WTSTickStruct ticks[5];
+  for (uint32_t i = 0; i < 5; i++) {
+    tick.price = 3500 + i;
+    tick.action_time += 500;
+    lens[i] = encoder.encode(tick, bufs[i]);
+    ticks[i] = tick;
+  }
+
+  WTSTickStruct out;
+  EXPECT_TRUE(decoder.decode(bufs[0], lens[0], out));
+  EXPECT_TRUE(decoder.decode(bufs[1], lens[1], out));
+  EXPECT_TRUE(decoder.decode(bufs[2], lens[2], out));
+
+  // 重复和乱序到达的旧数据丢掉,后面的增量帧照常解码
+  EXPECT_FALSE(decoder.decode(bufs[1], lens[1], out));
+  EXPECT_FALSE(decoder.decode(bufs[0], lens[0], out));
+  EXPECT_FALSE(decoder.decode(bufs[2], lens[2], out));
+
+  EXPECT_TRUE(decoder.decode(bufs[3], lens[3], out));
+  EXPECT_EQ(memcmp(&out, &ticks[3], sizeof(WTSTickStruct)), 0);
+  EXPECT_TRUE(decoder.decode(bufs[4], lens[4], out));
+  EXPECT_EQ(memcmp(&out, &ticks[4], sizeof(WTSTickStruct)), 0);
+
+  EXPECT_EQ(decoder.stale_count(), 3);
+  EXPECT_EQ(decoder.dropped_count(), 0);
+}
+
+TEST(test_tick_delta, test_requested_keyframe) {
+  TickDeltaEncoder encoder(100);
+  TickDeltaDecoder decoder;
+
+  WTSTickStruct tick;
+  strcpy(tick.exchg, "SHFE");
+  strcpy(tick.code, "rb2405");
+  tick.action_date = 20240318;
+  tick.action_time = 90000000;
+
+  char buf[TICK_DELTA_MAX_SIZE];
+  WTSTickStruct out;
+  for (uint32_t i = 0; i < 5; i++) {
+    tick.price = 3500 + i;
+    tick.action_time += 500;
+    uint32_t len = encoder.encode(tick, buf);
+    // 丢掉第3笔,后面的增量帧都解不出来
+    if (i != 2) {
+      EXPECT_EQ(decoder.decode(buf, len, out), i < 2);
+    }
+  }
+
+  // 收到重传请求以后,下一笔是关键帧,解码恢复
+  encoder.request_keyframes();
+  tick.price = 3510;
+  tick.action_time += 500;
+  uint32_t len = encoder.encode(tick, buf);
+  EXPECT_EQ(buf[0] & TICK_DELTA_FLAG_KEYFRAME, TICK_DELTA_FLAG_KEYFRAME);
+  EXPECT_TRUE(decoder.decode(buf, len, out));
+  EXPECT_EQ(memcmp(&out, &tick, sizeof(WTSTickStruct)), 0);
+
+  // 之后恢复成增量帧
+  tick.action_time += 500;
+  len = encoder.encode(tick, buf);
+  EXPECT_EQ(buf[0] & TICK_DELTA_FLAG_KEYFRAME, 0);
+  EXPECT_TRUE(decoder.decode(buf, len, out));
+}
@@ -0,0 +1,61 @@
+﻿#include "../Share/TimerWheel.hpp"
+#include "gtest/gtest/gtest.h"
+
+#include <map>
+#include <vector>
+
+TEST(test_timer_wheel, test_fire_in_order) {
+  TimerWheel<uint32_t> wheel(10);
+  uint64_t now = 1700000000000;
+
+  wheel.schedule(now, 50, 1);
+  wheel.schedule(now, 20, 2);
+  wheel.schedule(now, 5000, 3); // 超过第一层,要从上层搬下来
+  EXPECT_EQ(wheel.size(), 3);
+
+  std::vector<uint32_t> fired;
+  auto cb = [&fired](uint32_t id) { fired.push_back(id); };
+
+  wheel.advance(now + 10, cb);
+  EXPECT_TRUE(fired.empty());
+
+  wheel.advance(now + 60, cb);
+  ASSERT_EQ(fired.size(), 2);
+  EXPECT_EQ(fired[0], 2);
+  EXPECT_EQ(fired[1], 1);
+
+  wheel.advance(now + 4990, cb);
+  EXPECT_EQ(fired.size(), 2);
+
+  wheel.advance(now + 5000, cb);
+  ASSERT_EQ(fired.size(), 3);
+  EXPECT_EQ(fired[2], 3);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(test_timer_wheel, test_long_deadlines) {
+  TimerWheel<uint32_t> wheel(1);
+  uint64_t now = 1700000000000;
+
+  // 覆盖各层和超出最上层的情况,到期时间不能早于登记的时间
+  std::map<uint32_t, uint64_t> deadlines;
+  uint32_t elapses[] = {100, 25500, 25700, 1638400, 1700000, 104857600,
+                        3600000, 86400000};
+  uint32_t id = 0;
+  for (uint32_t elapse : elapses) {
+    wheel.schedule(now, elapse, id);
+    deadlines[id] = now + elapse;
+    id++;
+  }
+
+  std::map<uint32_t, uint64_t> fired;
+  for (uint64_t t = now; t <= now + 110000000; t += 1000) {
+    wheel.advance(t, [&fired, t](uint32_t id) { fired[id] = t; });
+  }
+
+  ASSERT_EQ(fired.size(), deadlines.size());
+  for (auto &v : deadlines) {
+    EXPECT_GE(fired[v.first], v.second);
+    EXPECT_LT(fired[v.first], v.second + 1000);
+  }
+}
@@ -48,6 +48,19 @@ uint32_t strToTime(const char *strTime) {
   return strtoul(str.c_str(), NULL, 10);
 }
 
+/*
+ *	查询接口的返回值转换
+ *	-2为未处理请求超过许可数,-3为每秒发送请求数超过许可数,都是被流控了
+ */
+inline QueryScheduler::QueryResult wrapQueryResult(int iResult) {
+  if (iResult == 0)
+    return QueryScheduler::QR_Sent;
+  else if (iResult == -2 || iResult == -3)
+    return QueryScheduler::QR_Limited;
+  else
+    return QueryScheduler::QR_Failed;
+}
+
 extern "C" {
 EXPORT_FLAG ITraderApi *createTrader() {
   TraderCTP *instance = new TraderCTP();
@@ -65,8 +78,8 @@ EXPORT_FLAG void deleteTrader(ITraderApi *&trader) {
 TraderCTP::TraderCTP()
     : m_pUserAPI(NULL), m_mapPosition(NULL), m_ayOrders(NULL), m_ayTrades(NULL),
       m_ayPosDetail(NULL), m_wrapperState(WS_NOTLOGIN), m_uLastQryTime(0),
-      m_iRequestID(0), m_bQuickStart(false), m_bInQuery(false),
-      m_bStopped(false), m_lastQryTime(0) {}
+      m_iRequestID(0), m_bQuickStart(false), m_dQryRate(1.0),
+      m_uQryBurst(1), m_uQryTimeout(10000) {}
 
 TraderCTP::~TraderCTP() {}
 
@@ -116,12 +129,18 @@ bool TraderCTP::init(WTSVariant *params) {
 
   m_bQuickStart = params->getBoolean("quick");
 
+  // CTP默认每秒只允许1笔查询
+  if (params->has("qryrate"))
+    m_dQryRate = params->getDouble("qryrate");
+  if (params->has("qryburst"))
+    m_uQryBurst = params->getUInt32("qryburst");
+  if (params->has("qrytimeout"))
+    m_uQryTimeout = params->getUInt32("qrytimeout");
+
   return true;
 }
 
 void TraderCTP::release() {
-  m_bStopped = true;
-
   if (m_pUserAPI) {
     // m_pUserAPI->RegisterSpi(NULL);
     m_pUserAPI->Release();
@@ -165,42 +184,20 @@ void TraderCTP::connect() {
     m_pUserAPI->Init();
   }
 
-  if (m_thrdWorker == NULL) {
-    m_thrdWorker.reset(new StdThread([this]() {
-      while (!m_bStopped) {
-        if (m_queQuery.empty() || m_bInQuery) {
-          std::this_thread::sleep_for(std::chrono::milliseconds(1));
-          continue;
-        }
-
-        uint64_t curTime = TimeUtils::getLocalTimeNow();
-        if (curTime - m_lastQryTime < 1000) {
-          std::this_thread::sleep_for(std::chrono::milliseconds(50));
-          continue;
-        }
-
-        m_bInQuery = true;
-        CommonExecuter &handler = m_queQuery.front();
-        handler();
-
-        {
-          StdUniqueLock lock(m_mtxQuery);
-          m_queQuery.pop();
-        }
-
-        m_lastQryTime = TimeUtils::getLocalTimeNow();
-      }
-    }));
-  }
+  // 最后一笔回报一直没到的查询,超时以后丢掉,否则后面的查询都发不出去
+  m_qryScheduler.set_timeout(
+      m_uQryTimeout, [this](const char *name, uint32_t millisecs) {
+        write_log(m_sink, LL_WARN,
+                  "[TraderCTP][{}-{}] Query of {} dropped, no response "
+                  "received in {} ms",
+                  m_strBroker.c_str(), m_strUser.c_str(), name, millisecs);
+      });
+  m_qryScheduler.start(m_dQryRate, m_uQryBurst);
 }
 
 void TraderCTP::disconnect() {
-  m_queQuery.push([this]() { release(); });
-
-  if (m_thrdWorker) {
-    m_thrdWorker->join();
-    m_thrdWorker = NULL;
-  }
+  m_qryScheduler.stop();
+  release();
 }
 
 bool TraderCTP::makeEntrustID(char *buffer, int length) {
@@ -395,18 +392,15 @@ int TraderCTP::queryAccount() {
     return -1;
   }
 
-  {
-    StdUniqueLock lock(m_mtxQuery);
-    m_queQuery.push([this]() {
-      CThostFtdcQryTradingAccountField req;
-      memset(&req, 0, sizeof(req));
-      wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
-      wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
-      m_pUserAPI->ReqQryTradingAccount(&req, genRequestID());
-    });
-  }
-
-  // triggerQuery();
+  m_qryScheduler.post(
+      [this](uint32_t reqID) {
+        CThostFtdcQryTradingAccountField req;
+        memset(&req, 0, sizeof(req));
+        wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
+        wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
+        return wrapQueryResult(m_pUserAPI->ReqQryTradingAccount(&req, reqID));
+      },
+      "account");
 
   return 0;
 }
@@ -416,18 +410,15 @@ int TraderCTP::queryPositions() {
     return -1;
   }
 
-  {
-    StdUniqueLock lock(m_mtxQuery);
-    m_queQuery.push([this]() {
-      CThostFtdcQryInvestorPositionField req;
-      memset(&req, 0, sizeof(req));
-      wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
-      wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
-      m_pUserAPI->ReqQryInvestorPosition(&req, genRequestID());
-    });
-  }
-
-  // triggerQuery();
+  m_qryScheduler.post(
+      [this](uint32_t reqID) {
+        CThostFtdcQryInvestorPositionField req;
+        memset(&req, 0, sizeof(req));
+        wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
+        wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
+        return wrapQueryResult(m_pUserAPI->ReqQryInvestorPosition(&req, reqID));
+      },
+      "positions");
 
   return 0;
 }
@@ -437,19 +428,16 @@ int TraderCTP::queryOrders() {
     return -1;
   }
 
-  {
-    StdUniqueLock lock(m_mtxQuery);
-    m_queQuery.push([this]() {
-      CThostFtdcQryOrderField req;
-      memset(&req, 0, sizeof(req));
-      wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
-      wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
+  m_qryScheduler.post(
+      [this](uint32_t reqID) {
+        CThostFtdcQryOrderField req;
+        memset(&req, 0, sizeof(req));
+        wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
+        wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
 
-      m_pUserAPI->ReqQryOrder(&req, genRequestID());
-    });
-
-    // triggerQuery();
-  }
+        return wrapQueryResult(m_pUserAPI->ReqQryOrder(&req, reqID));
+      },
+      "orders");
 
   return 0;
 }
@@ -459,19 +447,16 @@ int TraderCTP::queryTrades() {
     return -1;
   }
 
-  {
-    StdUniqueLock lock(m_mtxQuery);
-    m_queQuery.push([this]() {
-      CThostFtdcQryTradeField req;
-      memset(&req, 0, sizeof(req));
-      wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
-      wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
-
-      m_pUserAPI->ReqQryTrade(&req, genRequestID());
-    });
-  }
+  m_qryScheduler.post(
+      [this](uint32_t reqID) {
+        CThostFtdcQryTradeField req;
+        memset(&req, 0, sizeof(req));
+        wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
+        wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
 
-  // triggerQuery();
+        return wrapQueryResult(m_pUserAPI->ReqQryTrade(&req, reqID));
+      },
+      "trades");
 
   return 0;
 }
@@ -482,18 +467,17 @@ int TraderCTP::querySettlement(uint32_t uDate) {
   }
 
   m_strSettleInfo.clear();
-  StdUniqueLock lock(m_mtxQuery);
-  m_queQuery.push([this, uDate]() {
-    CThostFtdcQrySettlementInfoField req;
-    memset(&req, 0, sizeof(req));
-    wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
-    wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
-    fmt::format_to(req.TradingDay, "{}", uDate);
-
-    m_pUserAPI->ReqQrySettlementInfo(&req, genRequestID());
-  });
-
-  // triggerQuery();
+  m_qryScheduler.post(
+      [this, uDate](uint32_t reqID) {
+        CThostFtdcQrySettlementInfoField req;
+        memset(&req, 0, sizeof(req));
+        wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
+        wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
+        fmt::format_to(req.TradingDay, "{}", uDate);
+
+        return wrapQueryResult(m_pUserAPI->ReqQrySettlementInfo(&req, reqID));
+      },
+      "settlement");
 
   return 0;
 }
@@ -505,6 +489,8 @@ void TraderCTP::OnFrontConnected() {
 
 void TraderCTP::OnFrontDisconnected(int nReason) {
   m_wrapperState = WS_NOTLOGIN;
+  // 断线以后在途的查询不会再有回报,待发的查询重连以后重新发起
+  m_qryScheduler.clear();
   if (m_sink)
     m_sink->handleEvent(WTE_Close, nReason);
 }
@@ -604,10 +590,8 @@ void TraderCTP::OnRspUserLogout(CThostFtdcUserLogoutField *pUserLogout,
 void TraderCTP::OnRspQrySettlementInfoConfirm(
     CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm,
     CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {
-  if (bIsLast) {
-    m_bInQuery = false;
-    // triggerQuery();
-  }
+  if (bIsLast)
+    m_qryScheduler.on_finished(nRequestID);
 
   if (!IsErrorRspInfo(pRspInfo)) {
     if (pSettlementInfoConfirm != NULL) {
@@ -693,10 +677,8 @@ void TraderCTP::OnRspOrderAction(
 void TraderCTP::OnRspQryTradingAccount(
     CThostFtdcTradingAccountField *pTradingAccount,
     CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {
-  if (bIsLast) {
-    m_bInQuery = false;
-    // triggerQuery();
-  }
+  if (bIsLast)
+    m_qryScheduler.on_finished(nRequestID);
 
   if (bIsLast && !IsErrorRspInfo(pRspInfo)) {
     WTSAccountInfo *accountInfo = WTSAccountInfo::create();
@@ -728,10 +710,8 @@ void TraderCTP::OnRspQryTradingAccount(
 void TraderCTP::OnRspQryInvestorPosition(
     CThostFtdcInvestorPositionField *pInvestorPosition,
     CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {
-  if (bIsLast) {
-    m_bInQuery = false;
-    // triggerQuery();
-  }
+  if (bIsLast)
+    m_qryScheduler.on_finished(nRequestID);
 
   if (!IsErrorRspInfo(pRspInfo) && pInvestorPosition) {
     if (NULL == m_mapPosition)
@@ -853,10 +833,8 @@ void TraderCTP::OnRspQryInvestorPosition(
 void TraderCTP::OnRspQrySettlementInfo(
     CThostFtdcSettlementInfoField *pSettlementInfo,
     CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {
-  if (bIsLast) {
-    m_bInQuery = false;
-    // triggerQuery();
-  }
+  if (bIsLast)
+    m_qryScheduler.on_finished(nRequestID);
 
   if (!IsErrorRspInfo(pRspInfo) && pSettlementInfo) {
     m_strSettleInfo += pSettlementInfo->Content;
@@ -871,10 +849,8 @@ void TraderCTP::OnRspQrySettlementInfo(
 void TraderCTP::OnRspQryTrade(CThostFtdcTradeField *pTrade,
                               CThostFtdcRspInfoField *pRspInfo, int nRequestID,
                               bool bIsLast) {
-  if (bIsLast) {
-    m_bInQuery = false;
-    // triggerQuery();
-  }
+  if (bIsLast)
+    m_qryScheduler.on_finished(nRequestID);
 
   if (!IsErrorRspInfo(pRspInfo) && pTrade) {
     if (NULL == m_ayTrades)
@@ -898,10 +874,8 @@ void TraderCTP::OnRspQryTrade(CThostFtdcTradeField *pTrade,
 void TraderCTP::OnRspQryOrder(CThostFtdcOrderField *pOrder,
                               CThostFtdcRspInfoField *pRspInfo, int nRequestID,
                               bool bIsLast) {
-  if (bIsLast) {
-    m_bInQuery = false;
-    // triggerQuery();
-  }
+  if (bIsLast)
+    m_qryScheduler.on_finished(nRequestID);
 
   if (!IsErrorRspInfo(pRspInfo) && pOrder) {
     if (NULL == m_ayOrders)
@@ -1313,26 +1287,23 @@ int TraderCTP::queryConfirm() {
     return -1;
   }
 
-  {
-    StdUniqueLock lock(m_mtxQuery);
-    m_queQuery.push([this]() {
-      CThostFtdcQrySettlementInfoConfirmField req;
-      memset(&req, 0, sizeof(req));
-      wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
-      wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
-
-      int iResult =
-          m_pUserAPI->ReqQrySettlementInfoConfirm(&req, genRequestID());
-      if (iResult != 0) {
-        write_log(m_sink, LL_ERROR,
-                  "[TraderCTP][{}-{}] Sending query of settlement data "
-                  "confirming state failed: {}",
-                  m_strBroker.c_str(), m_strUser.c_str(), iResult);
-      }
-    });
-  }
-
-  // triggerQuery();
+  m_qryScheduler.post(
+      [this](uint32_t reqID) {
+        CThostFtdcQrySettlementInfoConfirmField req;
+        memset(&req, 0, sizeof(req));
+        wt_strcpy(req.BrokerID, m_strBroker.c_str(), m_strBroker.size());
+        wt_strcpy(req.InvestorID, m_strUser.c_str(), m_strUser.size());
+
+        int iResult = m_pUserAPI->ReqQrySettlementInfoConfirm(&req, reqID);
+        if (iResult != 0) {
+          write_log(m_sink, LL_ERROR,
+                    "[TraderCTP][{}-{}] Sending query of settlement data "
+                    "confirming state failed: {}",
+                    m_strBroker.c_str(), m_strUser.c_str(), iResult);
+        }
+        return wrapQueryResult(iResult);
+      },
+      "confirm");
 
   return 0;
 }
@@ -1375,35 +1346,3 @@ int TraderCTP::authenticate() {
 
   return 0;
 }
-
-/*
-void TraderCTP::triggerQuery()
-{
-        m_strandIO->post([this](){
-                if (m_queQuery.empty() || m_bInQuery)
-                        return;
-
-                uint64_t curTime = TimeUtils::getLocalTimeNow();
-                if (curTime - m_lastQryTime < 1000)
-                {
-                        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                        m_strandIO->post([this](){
-                                triggerQuery();
-                        });
-                        return;
-                }
-
-
-                m_bInQuery = true;
-                CommonExecuter& handler = m_queQuery.front();
-                handler();
-
-                {
-                        StdUniqueLock lock(m_mtxQuery);
-                        m_queQuery.pop();
-                }
-
-                m_lastQryTime = TimeUtils::getLocalTimeNow();
-        });
-}
-*/
\ No newline at end of file
@@ -9,7 +9,6 @@
  */
 #pragma once
 
-#include <queue>
 #include <stdint.h>
 #include <string>
 
@@ -20,6 +19,7 @@
 #include "../API/CTP6.3.15/ThostFtdcTraderApi.h"
 
 #include "../Share/DLLHelper.hpp"
+#include "../Share/QueryScheduler.hpp"
 #include "../Share/StdUtils.hpp"
 #include "../Share/WtKVCache.hpp"
 
@@ -238,14 +238,11 @@ protected:
 
   IBaseDataMgr *m_bdMgr;
 
-  typedef std::queue<CommonExecuter> QueryQue;
-  QueryQue m_queQuery;
-  bool m_bInQuery;
-  StdUniqueMutex m_mtxQuery;
-  uint64_t m_lastQryTime;
-
-  bool m_bStopped;
-  StdThreadPtr m_thrdWorker;
+  // 查询调度器,查询单独排队限速,不和下单撤单共用锁
+  QueryScheduler m_qryScheduler;
+  double m_dQryRate;      // 每秒查询次数
+  uint32_t m_uQryBurst;   // 允许连续发出的查询笔数
+  uint32_t m_uQryTimeout; // 在途查询的超时毫秒数
 
   std::string m_strModule;
   DllHandle m_hInstCTP;
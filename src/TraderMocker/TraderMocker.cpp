@@ -11,6 +11,9 @@
 #include "../Share/TimeUtils.hpp"
 #include "../Share/decimal.h"
 
+#include "../WTSUtils/WTSCmpHelper.hpp"
+#include "../WtDataStorage/DataDefine.h"
+
 #include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 
@@ -31,6 +34,63 @@ inline void write_log(ITraderSpi *sink, WTSLogLevel ll, const char *format,
   sink->handleTraderLog(ll, buffer);
 }
 
+#define UDP_MSG_PUSHTICK 0x200
+#pragma pack(push, 1)
+
+typedef struct UDPPacketHead {
+  uint32_t _type;
+} UDPPacketHead;
+// UDP请求包
+typedef struct _UDPReqPacket : UDPPacketHead {
+  char _data[1020];
+} UDPReqPacket;
+
+// UDPTick数据包
+template <typename T> struct UDPDataPacket : UDPPacketHead {
+  T _data;
+};
+#pragma pack(pop)
+typedef UDPDataPacket<WTSTickStruct> UDPTickPacket;
+
+/*
+ *	处理dsb文件中的tick数据块
+ *	去掉块头,压缩的先解压,老结构体转成新结构体
+ */
+static bool proc_tick_block(std::string &content) {
+  BlockHeader *header = (BlockHeader *)content.data();
+  bool bCmped = header->is_compressed();
+  bool bOldVer = header->is_old_version();
+
+  std::string buffer;
+  if (bCmped) {
+    BlockHeaderV2 *blkV2 = (BlockHeaderV2 *)content.data();
+    if (content.size() < BLOCK_HEADERV2_SIZE ||
+        content.size() != (BLOCK_HEADERV2_SIZE + blkV2->_size))
+      return false;
+
+    buffer = WTSCmpHelper::uncompress_data(
+        content.data() + BLOCK_HEADERV2_SIZE, blkV2->_size);
+  } else {
+    buffer.append(content.data() + BLOCK_HEADER_SIZE,
+                  content.size() - BLOCK_HEADER_SIZE);
+  }
+
+  if (bOldVer) {
+    std::size_t tcnt = buffer.size() / sizeof(WTSTickStructOld);
+    std::string bufV2;
+    bufV2.resize(sizeof(WTSTickStruct) * tcnt);
+    WTSTickStruct *newTick = (WTSTickStruct *)bufV2.data();
+    WTSTickStructOld *oldTick = (WTSTickStructOld *)buffer.data();
+    for (std::size_t i = 0; i < tcnt; i++) {
+      newTick[i] = oldTick[i];
+    }
+    buffer.swap(bufV2);
+  }
+
+  content.swap(buffer);
+  return true;
+}
+
 extern "C" {
 EXPORT_FLAG ITraderApi *createTrader() {
   TraderMocker *instance = new TraderMocker();
@@ -73,7 +133,9 @@ std::vector<uint32_t> splitVolume(uint32_t vol, uint32_t minQty = 1,
 TraderMocker::TraderMocker()
     : _terminated(false), _listener(NULL), _ticks(NULL), _orders(NULL),
       _awaits(NULL), _trades(NULL), _b_socket(NULL), _max_tick_time(0),
-      _last_match_time(0) {
+      _last_match_time(0), _replay(false), _replay_date(0), _replay_speed(1.0),
+      _replay_delay(0), _order_latency(0), _cancel_latency(0),
+      _latency_jitter(0), _queue_model(0), _replay_now(0), _c_socket(NULL) {
   _auto_order_id = (uint32_t)((TimeUtils::getLocalTimeNow() -
                                TimeUtils::makeTime(20200101, 0)) /
                               1000 * 100);
@@ -86,6 +148,17 @@ TraderMocker::TraderMocker()
 }
 
 TraderMocker::~TraderMocker() {
+  for (auto &v : _events) {
+    ReplayEvent &evt = v.second;
+    if (evt._entrust)
+      evt._entrust->release();
+    if (evt._order)
+      evt._order->release();
+    if (evt._action)
+      evt._action->release();
+  }
+  _events.clear();
+
   if (_orders)
     _orders->release();
 
@@ -120,7 +193,8 @@ int TraderMocker::orderInsert(WTSEntrust *entrust) {
   }
 
   entrust->retain();
-  _io_service.post([this, entrust]() {
+  int64_t insertTime = _replay ? _ticker.nano_seconds() : 0;
+  _io_service.post([this, entrust, insertTime]() {
     StdUniqueLock lock(_mutex_api);
 
     WTSContractInfo *ct = entrust->getContractInfo();
@@ -255,28 +329,28 @@ int TraderMocker::orderInsert(WTSEntrust *entrust) {
       ordInfo->setPriceType(entrust->getPriceType());
       ordInfo->setOrderFlag(entrust->getOrderFlag());
 
-      if (_listener != NULL) {
-        _listener->onRspEntrust(entrust, NULL);
-        _listener->onPushOrder(ordInfo);
-      }
-
-      _codes.insert(ct->getFullCode());
+      if (_replay) {
+        {
+          SpinLock lock(_mtx_timings);
+          OrderTiming timing;
+          wt_strcpy(timing._code, ct->getFullCode());
+          wt_strcpy(timing._order_id, ordInfo->getOrderID());
+          timing._insert = insertTime;
+          auto it = _cast_times.find(ct->getFullCode());
+          if (it != _cast_times.end())
+            timing._tick_to_order = insertTime - it->second;
+          _timing_ids[ordInfo->getOrderID()] = _timings.size();
+          _timings.emplace_back(timing);
+        }
 
-      if (_listener) {
-        write_log(_listener, LL_INFO, "共有{}个品种有待撮合订单",
-                  _codes.size());
+        // 回放模式下,订单经过报单延迟以后才到达撮合
+        entrust->retain();
+        uint64_t arrive = _replay_now + make_latency(_order_latency);
+        SpinLock lock(_mtx_events);
+        _events.emplace(arrive, ReplayEvent{entrust, ordInfo, NULL});
+      } else {
+        accept_order(entrust, ordInfo);
       }
-
-      if (_orders == NULL)
-        _orders = WTSArray::create();
-      _orders->append(ordInfo, false);
-
-      if (_awaits == NULL)
-        _awaits = OrderCache::create();
-
-      _awaits->add(ordInfo->getOrderID(), ordInfo, true);
-
-      save_positions();
     } else {
       WTSError *err = WTSError::create(WEC_ORDERINSERT, msg.c_str());
       if (_listener != NULL) {
@@ -290,6 +364,125 @@ int TraderMocker::orderInsert(WTSEntrust *entrust) {
   return 0;
 }
 
+void TraderMocker::accept_order(WTSEntrust *entrust, WTSOrderInfo *ordInfo) {
+  int64_t ackTime = _replay ? _ticker.nano_seconds() : 0;
+  if (_listener != NULL) {
+    _listener->onRspEntrust(entrust, NULL);
+    _listener->onPushOrder(ordInfo);
+  }
+
+  if (_replay) {
+    SpinLock lock(_mtx_timings);
+    OrderTiming *timing = getTiming(ordInfo->getOrderID());
+    if (timing != NULL) {
+      timing->_ack = ackTime;
+      timing->_ack_cost = _ticker.nano_seconds() - ackTime;
+    }
+  } else {
+    _codes.insert(ordInfo->getContractInfo()->getFullCode());
+
+    if (_listener) {
+      write_log(_listener, LL_INFO, "共有{}个品种有待撮合订单",
+                _codes.size());
+    }
+  }
+
+  if (_orders == NULL)
+    _orders = WTSArray::create();
+  _orders->append(ordInfo, false);
+
+  if (_awaits == NULL)
+    _awaits = OrderCache::create();
+
+  _awaits->add(ordInfo->getOrderID(), ordInfo, true);
+
+  // 回放的时候不每笔都写文件,回放结束再保存
+  if (!_replay)
+    save_positions();
+}
+
+bool TraderMocker::fill_order(WTSOrderInfo *ordInfo, WTSContractInfo *ct,
+                              double price, double qty, uint64_t tradeTime) {
+  WTSCommodityInfo *commInfo = ct->getCommInfo();
+
+  WTSTradeInfo *trade = WTSTradeInfo::create(ct->getCode(), ct->getExchg());
+  trade->setDirection(ordInfo->getDirection());
+  trade->setOffsetType(ordInfo->getOffsetType());
+  trade->setContractInfo(ct);
+
+  trade->setPrice(price);
+  trade->setVolume(qty);
+
+  trade->setRefOrder(ordInfo->getOrderID());
+
+  char str[64];
+  fmtutil::format_to(str, "mt.{}.{}", _mocker_id, makeTradeID());
+  trade->setTradeID(str);
+
+  trade->setTradeTime(tradeTime);
+  trade->setUserTag(ordInfo->getUserTag());
+
+  // 更新订单数据
+  bool bDone = false;
+  ordInfo->setVolLeft(ordInfo->getVolLeft() - qty);
+  ordInfo->setVolTraded(ordInfo->getVolTraded() + qty);
+  if (decimal::eq(ordInfo->getVolLeft(), 0)) {
+    ordInfo->setOrderState(WOS_AllTraded);
+    ordInfo->setStateMsg("AllTrd");
+    bDone = true;
+  } else {
+    ordInfo->setOrderState(WOS_PartTraded_Queuing);
+    ordInfo->setStateMsg("PartTrd");
+  }
+
+  // 持仓和下单检查共用,和回报一起锁起来
+  StdUniqueLock lock(_mutex_api);
+  PosItem &pItem = _positions[ct->getFullCode()];
+  // 第一次的话要给代码和交易所赋值
+  if (strlen(pItem._code) == 0) {
+    strcpy(pItem._code, ct->getCode());
+    strcpy(pItem._exchg, ct->getExchg());
+  }
+
+  if (commInfo->getCoverMode() == CM_None) {
+
+  } else {
+    if (ordInfo->getDirection() == WDT_LONG) {
+      if (ordInfo->getOffsetType() == WOT_OPEN) {
+        pItem._long._volume += qty;
+      } else {
+        pItem._long._volume -= qty;
+        pItem._long._frozen -= qty;
+      }
+    } else {
+      if (ordInfo->getOffsetType() == WOT_OPEN) {
+        pItem._short._volume += qty;
+      } else {
+        pItem._short._volume -= qty;
+        pItem._short._frozen -= qty;
+      }
+    }
+  }
+
+  if (_listener) {
+    _listener->onPushOrder(ordInfo);
+    _listener->onPushTrade(trade);
+  }
+
+  if (_replay) {
+    SpinLock lck(_mtx_timings);
+    OrderTiming *timing = getTiming(ordInfo->getOrderID());
+    if (timing != NULL && timing->_trade == 0)
+      timing->_trade = _ticker.nano_seconds();
+  }
+
+  if (_trades == NULL)
+    _trades = WTSArray::create();
+
+  _trades->append(trade, false);
+  return bDone;
+}
+
 int32_t TraderMocker::match_once() {
   if (_terminated || _orders == NULL || _orders->size() == 0 || _ticks == NULL)
     return 0;
@@ -308,8 +501,6 @@ int32_t TraderMocker::match_once() {
     if (ct == NULL)
       continue;
 
-    WTSCommodityInfo *commInfo = ct->getCommInfo();
-
     WTSTickData *curTick = (WTSTickData *)_ticks->grab(fullcode);
     if (curTick && strcmp(curTick->code(), ct->getCode()) == 0) {
       StdUniqueLock lock(_mtx_awaits);
@@ -364,74 +555,9 @@ int32_t TraderMocker::match_once() {
           std::vector<uint32_t> ayVol = splitVolume(
               (uint32_t)maxVolume, (uint32_t)_min_qty, (uint32_t)_max_qty);
           for (uint32_t curVol : ayVol) {
-
-            WTSTradeInfo *trade =
-                WTSTradeInfo::create(curTick->code(), curTick->exchg());
-            trade->setDirection(ordInfo->getDirection());
-            trade->setOffsetType(ordInfo->getOffsetType());
-            trade->setContractInfo(ct);
-
-            trade->setPrice(uPrice);
-            trade->setVolume(curVol);
-
-            trade->setRefOrder(ordInfo->getOrderID());
-
-            char str[64];
-            fmtutil::format_to(str, "mt.{}.{}", _mocker_id, makeTradeID());
-            trade->setTradeID(str);
-
-            trade->setTradeTime(TimeUtils::getLocalTimeNow());
-            trade->setUserTag(ordInfo->getUserTag());
-
-            // 更新订单数据
-            ordInfo->setVolLeft(ordInfo->getVolLeft() - curVol);
-            ordInfo->setVolTraded(ordInfo->getVolTraded() - curVol);
-            if (decimal::eq(ordInfo->getVolLeft(), 0)) {
-              ordInfo->setOrderState(WOS_AllTraded);
-              ordInfo->setStateMsg("AllTrd");
+            if (fill_order(ordInfo, ct, uPrice, curVol,
+                           TimeUtils::getLocalTimeNow()))
               to_erase.emplace_back(ordInfo->getOrderID());
-            } else {
-              ordInfo->setOrderState(WOS_PartTraded_Queuing);
-              ordInfo->setStateMsg("PartTrd");
-            }
-
-            PosItem &pItem = _positions[ct->getFullCode()];
-            // 第一次的话要给代码和交易所赋值
-            if (strlen(pItem._code) == 0) {
-              strcpy(pItem._code, ct->getCode());
-              strcpy(pItem._exchg, ct->getExchg());
-            }
-
-            if (commInfo->getCoverMode() == CM_None) {
-
-            } else {
-              if (ordInfo->getDirection() == WDT_LONG) {
-                if (ordInfo->getOffsetType() == WOT_OPEN) {
-                  pItem._long._volume += curVol;
-                } else {
-                  pItem._long._volume -= curVol;
-                  pItem._long._frozen -= curVol;
-                }
-              } else {
-                if (ordInfo->getOffsetType() == WOT_OPEN) {
-                  pItem._short._volume += curVol;
-                } else {
-                  pItem._short._volume -= curVol;
-                  pItem._short._frozen -= curVol;
-                }
-              }
-            }
-
-            if (_listener) {
-              StdUniqueLock lock(_mutex_api);
-              _listener->onPushOrder(ordInfo);
-              _listener->onPushTrade(trade);
-            }
-
-            if (_trades == NULL)
-              _trades = WTSArray::create();
-
-            _trades->append(trade, false);
           }
         }
 
@@ -459,6 +585,316 @@ int32_t TraderMocker::match_once() {
   return count;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// 回放模式
+bool TraderMocker::load_replay_ticks() {
+  for (const std::string &fullcode : _replay_codes) {
+    auto pos = fullcode.find(".");
+    if (pos == std::string::npos)
+      continue;
+
+    std::string exchg = fullcode.substr(0, pos);
+    std::string code = fullcode.substr(pos + 1);
+    std::string filename =
+        fmtutil::format("{}ticks/{}/{}/{}.dsb", _replay_folder.c_str(),
+                        exchg.c_str(), _replay_date, code.c_str());
+    if (!StdFile::exists(filename.c_str())) {
+      write_log(_listener, LL_ERROR, "[TraderMocker]回放数据文件{}不存在",
+                filename.c_str());
+      continue;
+    }
+
+    std::string content;
+    StdFile::read_file_content(filename.c_str(), content);
+    if (content.size() < BLOCK_HEADER_SIZE || !proc_tick_block(content)) {
+      write_log(_listener, LL_ERROR, "[TraderMocker]回放数据文件{}校验失败",
+                filename.c_str());
+      continue;
+    }
+
+    std::size_t tcnt = content.size() / sizeof(WTSTickStruct);
+    const WTSTickStruct *ticks = (const WTSTickStruct *)content.data();
+    std::size_t offset = _replay_ticks.size();
+    _replay_ticks.insert(_replay_ticks.end(), ticks, ticks + tcnt);
+    for (std::size_t i = offset; i < _replay_ticks.size(); i++) {
+      wt_strcpy(_replay_ticks[i].exchg, exchg.c_str());
+      wt_strcpy(_replay_ticks[i].code, code.c_str());
+    }
+
+    write_log(_listener, LL_INFO, "[TraderMocker]{}共加载{}条回放数据",
+              fullcode.c_str(), tcnt);
+  }
+
+  // 多个合约的tick按时间归并,同一时间的保持文件中的顺序
+  std::stable_sort(_replay_ticks.begin(), _replay_ticks.end(),
+                   [](const WTSTickStruct &a, const WTSTickStruct &b) {
+                     if (a.action_date != b.action_date)
+                       return a.action_date < b.action_date;
+                     return a.action_time < b.action_time;
+                   });
+
+  return !_replay_ticks.empty();
+}
+
+void TraderMocker::replay_loop() {
+  // 等引擎和策略初始化完成再开始回放
+  for (uint32_t i = 0; i < _replay_delay * 10 && !_terminated; i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  if (!load_replay_ticks()) {
+    write_log(_listener, LL_ERROR, "[TraderMocker]没有可以回放的数据");
+    return;
+  }
+
+  write_log(_listener, LL_INFO, "[TraderMocker]开始回放{}条tick数据",
+            _replay_ticks.size());
+
+  TimeUtils::Ticker ticker;
+  uint64_t startTime = 0;
+  for (const WTSTickStruct &curTick : _replay_ticks) {
+    if (_terminated)
+      break;
+
+    uint64_t simTime =
+        TimeUtils::makeTime(curTick.action_date, curTick.action_time);
+    if (startTime == 0)
+      startTime = simTime;
+
+    // 按回放速度等到这笔行情的时间
+    if (_replay_speed > 0) {
+      int64_t target = (int64_t)((simTime - startTime) / _replay_speed);
+      int64_t elapse = ticker.milli_seconds();
+      if (target > elapse)
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(target - elapse));
+    }
+
+    {
+      StdUniqueLock lock(_mtx_awaits);
+      // 先处理已经到达的报单和撤单,再用新的行情撮合挂单
+      replay_events(simTime);
+      replay_match(curTick, simTime);
+      _replay_now = simTime;
+    }
+
+    cast_tick(curTick);
+  }
+
+  // 在途的报单和撤单也处理完
+  {
+    StdUniqueLock lock(_mtx_awaits);
+    replay_events(UINT64_MAX);
+  }
+
+  {
+    StdUniqueLock lock(_mutex_api);
+    save_positions();
+  }
+
+  dump_timings();
+}
+
+void TraderMocker::replay_events(uint64_t simTime) {
+  std::vector<std::pair<uint64_t, ReplayEvent>> events;
+  {
+    SpinLock lock(_mtx_events);
+    auto end = _events.upper_bound(simTime);
+    events.assign(_events.begin(), end);
+    _events.erase(_events.begin(), end);
+  }
+
+  for (auto &v : events) {
+    ReplayEvent &evt = v.second;
+    if (evt._action != NULL) {
+      cancel_order(evt._action);
+      evt._action->release();
+      continue;
+    }
+
+    WTSOrderInfo *ordInfo = evt._order;
+    {
+      StdUniqueLock lock(_mutex_api);
+      accept_order(evt._entrust, ordInfo);
+    }
+    evt._entrust->release();
+
+    // 到达以后先和当前盘口撮合,没有成交完的挂单开始排队
+    auto it = _books.find(ordInfo->getContractInfo()->getFullCode());
+    if (it == _books.end())
+      continue;
+
+    if (replay_order(ordInfo, it->second, v.first, true)) {
+      _queue_ahead.erase(ordInfo->getOrderID());
+      _awaits->remove(ordInfo->getOrderID());
+    }
+  }
+}
+
+bool TraderMocker::replay_order(WTSOrderInfo *ordInfo, WTSTickStruct &book,
+                                uint64_t simTime, bool bArrive) {
+  WTSContractInfo *ct = ordInfo->getContractInfo();
+  bool isBuy = (ordInfo->getDirection() == WDT_LONG &&
+                ordInfo->getOffsetType() == WOT_OPEN) ||
+               (ordInfo->getDirection() != WDT_LONG &&
+                ordInfo->getOffsetType() != WOT_OPEN);
+  bool isLimit = ordInfo->getPriceType() == WPT_LIMITPRICE;
+  double target = ordInfo->getPrice();
+
+  // 价格达到对手价的,直接和对手盘成交,同一笔行情里对手盘的量会被消耗掉
+  double oppPx = isBuy ? book.ask_prices[0] : book.bid_prices[0];
+  double &oppQty = isBuy ? book.ask_qty[0] : book.bid_qty[0];
+  if (decimal::gt(oppPx, 0) && decimal::gt(oppQty, 0) &&
+      (!isLimit ||
+       (isBuy ? decimal::ge(target, oppPx) : decimal::le(target, oppPx)))) {
+    double qty = min(oppQty, ordInfo->getVolLeft());
+    oppQty -= qty;
+    return fill_order(ordInfo, ct, oppPx, qty, simTime);
+  }
+
+  if (_queue_model == 0 || !isLimit)
+    return false;
+
+  if (bArrive) {
+    // 排在同价位已有挂单的后面,挂在盘口以外的价位不用排队
+    double ahead = 0;
+    for (uint32_t i = 0; i < 10; i++) {
+      double px = isBuy ? book.bid_prices[i] : book.ask_prices[i];
+      if (decimal::eq(px, target)) {
+        ahead = isBuy ? book.bid_qty[i] : book.ask_qty[i];
+        break;
+      }
+    }
+    _queue_ahead[ordInfo->getOrderID()] = ahead;
+    return false;
+  }
+
+  // 最新价在挂单价或者更优的价位成交,成交量先消耗前面的排队量
+  bool isWorse = isBuy ? decimal::gt(book.price, target)
+                       : decimal::lt(book.price, target);
+  if (decimal::eq(book.volume, 0) || isWorse)
+    return false;
+
+  double &ahead = _queue_ahead[ordInfo->getOrderID()];
+  ahead -= book.volume;
+  if (decimal::ge(ahead, 0))
+    return false;
+
+  double qty = min(-ahead, ordInfo->getVolLeft());
+  ahead = 0;
+  return fill_order(ordInfo, ct, target, qty, simTime);
+}
+
+void TraderMocker::replay_match(const WTSTickStruct &curTick,
+                                uint64_t simTime) {
+  thread_local static char fullcode[64] = {0};
+  fmtutil::format_to(fullcode, "{}.{}", curTick.exchg, curTick.code);
+  WTSTickStruct &book = _books[fullcode];
+  book = curTick;
+
+  if (_awaits == NULL || _awaits->size() == 0)
+    return;
+
+  std::vector<std::string> to_erase;
+  for (auto it = _awaits->begin(); it != _awaits->end(); it++) {
+    WTSOrderInfo *ordInfo = (WTSOrderInfo *)it->second;
+    if (decimal::eq(ordInfo->getVolLeft(), 0) ||
+        strcmp(ordInfo->getCode(), curTick.code) != 0 ||
+        strcmp(ordInfo->getExchg(), curTick.exchg) != 0)
+      continue;
+
+    if (replay_order(ordInfo, book, simTime, false))
+      to_erase.emplace_back(ordInfo->getOrderID());
+  }
+
+  for (const std::string &oid : to_erase) {
+    _queue_ahead.erase(oid);
+    _awaits->remove(oid);
+  }
+}
+
+void TraderMocker::cast_tick(const WTSTickStruct &curTick) {
+  thread_local static char fullcode[64] = {0};
+  fmtutil::format_to(fullcode, "{}.{}", curTick.exchg, curTick.code);
+  {
+    SpinLock lock(_mtx_timings);
+    _cast_times[fullcode] = _ticker.nano_seconds();
+  }
+
+  if (_c_socket == NULL)
+    return;
+
+  UDPTickPacket packet;
+  packet._type = UDP_MSG_PUSHTICK;
+  memcpy(&packet._data, &curTick, sizeof(WTSTickStruct));
+
+  boost::system::error_code ec;
+  _c_socket->send_to(boost::asio::buffer(&packet, sizeof(UDPTickPacket)),
+                     _cast_ep, 0, ec);
+}
+
+uint32_t TraderMocker::make_latency(uint32_t base) {
+  if (_latency_jitter == 0)
+    return base;
+
+  return base + _rand_engine() % (_latency_jitter + 1);
+}
+
+TraderMocker::OrderTiming *TraderMocker::getTiming(const char *orderid) {
+  auto it = _timing_ids.find(orderid);
+  if (it == _timing_ids.end())
+    return NULL;
+
+  return &_timings[it->second];
+}
+
+void TraderMocker::dump_timings() {
+  std::vector<OrderTiming> timings;
+  {
+    SpinLock lock(_mtx_timings);
+    timings = _timings;
+  }
+
+  std::stringstream ss;
+  ss << "code,orderid,tick_to_order,order_to_ack,ack_cost,order_to_trade,"
+        "cancel_to_ack"
+     << std::endl;
+
+  std::vector<int64_t> t2o, costs;
+  for (const OrderTiming &t : timings) {
+    int64_t toAck = (t._ack == 0) ? 0 : (t._ack - t._insert);
+    int64_t toTrade = (t._trade == 0) ? 0 : (t._trade - t._insert);
+    int64_t toCancel = (t._canceled == 0) ? 0 : (t._canceled - t._cancel);
+    ss << t._code << "," << t._order_id << "," << t._tick_to_order << ","
+       << toAck << "," << t._ack_cost << "," << toTrade << "," << toCancel
+       << std::endl;
+
+    if (t._tick_to_order > 0)
+      t2o.emplace_back(t._tick_to_order);
+    if (t._ack != 0)
+      costs.emplace_back(t._ack_cost);
+  }
+
+  std::string filename =
+      fmtutil::format("./mocker_{}/timings_{}.csv", _mocker_id, _replay_date);
+  StdFile::write_file_content(filename.c_str(), ss.str());
+
+  auto percentile = [](std::vector<int64_t> &ay, double pct) -> int64_t {
+    if (ay.empty())
+      return 0;
+
+    std::size_t idx = (std::size_t)(pct * (ay.size() - 1));
+    std::nth_element(ay.begin(), ay.begin() + idx, ay.end());
+    return ay[idx];
+  };
+
+  write_log(_listener, LL_INFO,
+            "[TraderMocker]回放结束,共{}笔订单,行情到委托耗时(ns) p50 {} p99 "
+            "{},委托回报处理耗时(ns) p50 {} p99 {},明细已写入{}",
+            timings.size(), percentile(t2o, 0.5), percentile(t2o, 0.99),
+            percentile(costs, 0.5), percentile(costs, 0.99),
+            filename.c_str());
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 bool TraderMocker::init(WTSVariant *params) {
@@ -480,6 +916,49 @@ bool TraderMocker::init(WTSVariant *params) {
   if (decimal::eq(_min_qty, 0))
     _min_qty = 1;
 
+  /*
+   *	回放模式
+   *	folder: 历史数据目录,读取folder/ticks/交易所/日期/合约.dsb
+   *	date: 回放日期
+   *	codes: 回放的合约列表,格式如SHFE.rb2405
+   *	speed: 回放速度,1为按行情节奏,0为不等待,默认为1
+   *	delay: 登录以后等待多少秒开始回放,默认为5秒
+   *	order_latency/cancel_latency: 报单和撤单到达撮合的延迟,毫秒
+   *	jitter: 延迟的随机抖动,毫秒,seed为随机数种子
+   *	queue: 0-只和对手价撮合,1-限价单按价位排队,最新价成交量先消耗前面的排队量
+   *	cast_host/cast_port: 回放的行情通过UDP转发给ParserUDP的地址
+   */
+  WTSVariant *cfgReplay = params->get("replay");
+  if (cfgReplay != NULL && cfgReplay->getBoolean("active")) {
+    _replay = true;
+    _replay_folder = StrUtil::standardisePath(cfgReplay->getCString("folder"));
+    _replay_date = cfgReplay->getUInt32("date");
+    WTSVariant *cfgCodes = cfgReplay->get("codes");
+    if (cfgCodes != NULL) {
+      for (uint32_t i = 0; i < cfgCodes->size(); i++)
+        _replay_codes.emplace_back(cfgCodes->get(i)->asCString());
+    }
+
+    if (cfgReplay->has("speed"))
+      _replay_speed = cfgReplay->getDouble("speed");
+    _replay_delay =
+        cfgReplay->has("delay") ? cfgReplay->getUInt32("delay") : 5;
+    _order_latency = cfgReplay->getUInt32("order_latency");
+    _cancel_latency = cfgReplay->getUInt32("cancel_latency");
+    _latency_jitter = cfgReplay->getUInt32("jitter");
+    _queue_model = cfgReplay->getUInt32("queue");
+    _rand_engine.seed(cfgReplay->getUInt32("seed"));
+
+    int32_t castPort = cfgReplay->getInt32("cast_port");
+    if (castPort > 0) {
+      const char *castHost = cfgReplay->getCString("cast_host");
+      _cast_ep = boost::asio::ip::udp::endpoint(
+          boost::asio::ip::address::from_string(
+              strlen(castHost) == 0 ? "127.0.0.1" : castHost),
+          castPort);
+    }
+  }
+
   // 加载持仓数据
   std::stringstream ss;
   ss << "./mocker_" << _mocker_id << "/";
@@ -586,7 +1065,18 @@ void TraderMocker::release() {
     _thrd_match->join();
   }
 
+  if (_thrd_replay) {
+    _thrd_replay->join();
+  }
+
+  if (_c_socket != NULL) {
+    _c_socket->close();
+    delete _c_socket;
+    _c_socket = NULL;
+  }
+
   if (_thrd_worker) {
+    _io_work.reset();
     _io_service.stop();
     _thrd_worker->join();
   }
@@ -620,7 +1110,17 @@ void TraderMocker::reconn_udp() {
 }
 
 void TraderMocker::connect() {
-  reconn_udp();
+  if (_replay) {
+    // 回放模式不接收UDP行情,用work让io_service保持运行
+    _io_work.reset(new boost::asio::io_service::work(_io_service));
+    if (_cast_ep.port() != 0) {
+      _c_socket = new boost::asio::ip::udp::socket(_io_service);
+      _c_socket->open(_cast_ep.protocol());
+      _c_socket->set_option(boost::asio::ip::udp::socket::broadcast(true));
+    }
+  } else {
+    reconn_udp();
+  }
 
   _thrd_worker.reset(
       new StdThread(boost::bind(&boost::asio::io_service::run, &_io_service)));
@@ -644,20 +1144,30 @@ void TraderMocker::disconnect() {
   if (_thrd_match) {
     _thrd_match->join();
   }
+
+  if (_thrd_replay) {
+    _thrd_replay->join();
+  }
 }
 
-bool TraderMocker::isConnected() { return _thrd_match != NULL; }
+bool TraderMocker::isConnected() {
+  return _thrd_match != NULL || _thrd_replay != NULL;
+}
 
 int TraderMocker::login(const char *user, const char *pass,
                         const char *productInfo) {
-  _thrd_match.reset(new StdThread([this]() {
-    while (!_terminated) {
-      match_once();
+  if (_replay) {
+    _thrd_replay.reset(new StdThread([this]() { replay_loop(); }));
+  } else {
+    _thrd_match.reset(new StdThread([this]() {
+      while (!_terminated) {
+        match_once();
 
-      // 等待5毫秒
-      std::this_thread::sleep_for(std::chrono::milliseconds(5));
-    }
-  }));
+        // 等待5毫秒
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      }
+    }));
+  }
 
   _io_service.post([this]() {
     StdUniqueLock lock(_mutex_api);
@@ -673,76 +1183,105 @@ int TraderMocker::logout() { return 0; }
 
 int TraderMocker::orderAction(WTSEntrustAction *action) {
   action->retain();
+  int64_t cancelTime = _replay ? _ticker.nano_seconds() : 0;
 
-  _io_service.post([this, action]() {
-    StdUniqueLock lck(
-        _mtx_awaits); // 一定要把awaits锁起来,不然可能会导致一边撮合一边撤单
-    WTSOrderInfo *ordInfo = (WTSOrderInfo *)_awaits->grab(action->getOrderID());
+  _io_service.post([this, action, cancelTime]() {
+    if (_replay) {
+      {
+        SpinLock lock(_mtx_timings);
+        OrderTiming *timing = getTiming(action->getOrderID());
+        if (timing != NULL && timing->_cancel == 0)
+          timing->_cancel = cancelTime;
+      }
 
-    /*
-     *	撤单也要考虑几个问题
-     *	1、是否处于可以撤销的状态
-     *	2、如果是开仓,则直接撤销
-     *	3、如果是平仓,要释放冻结
-     */
-    if (ordInfo == NULL) {
-      write_log(_listener, LL_ERROR, "订单{}不存在或者已完成",
-                action->getOrderID());
-      WTSError *err =
-          WTSError::create(WEC_ORDERCANCEL, "订单不存在或者处于不可撤销状态");
-      if (_listener)
-        _listener->onTraderError(err);
-      err->release();
+      // 回放模式下,撤单经过撤单延迟以后才到达撮合
+      uint64_t arrive = _replay_now + make_latency(_cancel_latency);
+      SpinLock lock(_mtx_events);
+      _events.emplace(arrive, ReplayEvent{NULL, NULL, action});
       return;
     }
 
-    WTSContractInfo *ct = ordInfo->getContractInfo();
-    WTSCommodityInfo *commInfo = ct->getCommInfo();
+    StdUniqueLock lck(
+        _mtx_awaits); // 一定要把awaits锁起来,不然可能会导致一边撮合一边撤单
+    cancel_order(action);
+    action->release();
+  });
 
-    bool bPass = false;
-    do {
-      // 开仓委托直接撤单
-      if (ordInfo->getOffsetType() == WOT_OPEN) {
-        bPass = true;
-        break;
-      }
+  return 0;
+}
 
-      // 不区分开平的,也直接撤销
-      if (commInfo->getCoverMode() == CM_None) {
-        bPass = true;
-        break;
-      }
+void TraderMocker::cancel_order(WTSEntrustAction *action) {
+  WTSOrderInfo *ordInfo = (WTSOrderInfo *)_awaits->grab(action->getOrderID());
+
+  /*
+   *	撤单也要考虑几个问题
+   *	1、是否处于可以撤销的状态
+   *	2、如果是开仓,则直接撤销
+   *	3、如果是平仓,要释放冻结
+   */
+  if (ordInfo == NULL) {
+    write_log(_listener, LL_ERROR, "订单{}不存在或者已完成",
+              action->getOrderID());
+    WTSError *err =
+        WTSError::create(WEC_ORDERCANCEL, "订单不存在或者处于不可撤销状态");
+    if (_listener)
+      _listener->onTraderError(err);
+    err->release();
+    return;
+  }
 
-      // 释放冻结持仓
-      PosItem &pItem = _positions[ct->getFullCode()];
-      bool isLong = ordInfo->getDirection() == WDT_LONG;
-      if (isLong) {
-        pItem._long._frozen -= ordInfo->getVolLeft();
-      } else {
-        pItem._short._frozen -= ordInfo->getVolLeft();
-      }
-      bPass = true;
+  WTSContractInfo *ct = ordInfo->getContractInfo();
+  WTSCommodityInfo *commInfo = ct->getCommInfo();
 
-    } while (false);
+  bool bPass = false;
+  do {
+    // 开仓委托直接撤单
+    if (ordInfo->getOffsetType() == WOT_OPEN) {
+      bPass = true;
+      break;
+    }
 
-    ordInfo->setStateMsg("撤单成功");
-    ordInfo->setOrderState(WOS_Canceled);
-    // ordInfo->setVolLeft(0);
+    // 不区分开平的,也直接撤销
+    if (commInfo->getCoverMode() == CM_None) {
+      bPass = true;
+      break;
+    }
 
-    if (_listener) {
-      StdUniqueLock lock(_mutex_api);
-      _listener->onPushOrder(ordInfo);
+    // 释放冻结持仓
+    PosItem &pItem = _positions[ct->getFullCode()];
+    bool isLong = ordInfo->getDirection() == WDT_LONG;
+    if (isLong) {
+      pItem._long._frozen -= ordInfo->getVolLeft();
+    } else {
+      pItem._short._frozen -= ordInfo->getVolLeft();
     }
+    bPass = true;
 
-    ordInfo->release();
-    action->release();
+  } while (false);
 
-    _awaits->remove(action->getOrderID());
+  ordInfo->setStateMsg("撤单成功");
+  ordInfo->setOrderState(WOS_Canceled);
+  // ordInfo->setVolLeft(0);
 
-    save_positions();
-  });
+  if (_listener) {
+    StdUniqueLock lock(_mutex_api);
+    _listener->onPushOrder(ordInfo);
+  }
 
-  return 0;
+  if (_replay) {
+    _queue_ahead.erase(ordInfo->getOrderID());
+
+    SpinLock lock(_mtx_timings);
+    OrderTiming *timing = getTiming(ordInfo->getOrderID());
+    if (timing != NULL)
+      timing->_canceled = _ticker.nano_seconds();
+  }
+
+  _awaits->remove(action->getOrderID());
+  ordInfo->release();
+
+  if (!_replay)
+    save_positions();
 }
 
 int TraderMocker::queryAccount() {
@@ -871,23 +1410,6 @@ void TraderMocker::handle_read(const boost::system::error_code &e,
   }
 }
 
-#define UDP_MSG_PUSHTICK 0x200
-#pragma pack(push, 1)
-
-typedef struct UDPPacketHead {
-  uint32_t _type;
-} UDPPacketHead;
-// UDP请求包
-typedef struct _UDPReqPacket : UDPPacketHead {
-  char _data[1020];
-} UDPReqPacket;
-
-// UDPTick数据包
-template <typename T> struct UDPDataPacket : UDPPacketHead {
-  T _data;
-};
-#pragma pack(pop)
-typedef UDPDataPacket<WTSTickStruct> UDPTickPacket;
 void TraderMocker::extract_buffer(uint32_t length, bool isBroad /* = true */) {
   UDPPacketHead *header = (UDPTickPacket *)_b_buffer.data();
 
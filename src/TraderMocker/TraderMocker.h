@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include <atomic>
+#include <map>
+#include <random>
 
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
@@ -8,10 +10,15 @@
 #include "../Includes/FasterDefs.h"
 #include "../Includes/ITraderApi.h"
 #include "../Includes/WTSCollection.hpp"
+#include "../Includes/WTSStruct.h"
+#include "../Share/SpinMutex.hpp"
 #include "../Share/StdUtils.hpp"
+#include "../Share/TimeUtils.hpp"
 
 NS_WTP_BEGIN
 class WTSTickData;
+class WTSOrderInfo;
+class WTSContractInfo;
 NS_WTP_END
 
 USING_NS_WTP;
@@ -36,6 +43,93 @@ private:
   void load_positions();
   void save_positions();
 
+  /*
+   *	订单通过检查,推送回报并加入待撮合队列
+   *	调用方需要持有_mutex_api
+   */
+  void accept_order(WTSEntrust *entrust, WTSOrderInfo *ordInfo);
+
+  /*
+   *	撤单处理,调用方需要持有_mtx_awaits
+   */
+  void cancel_order(WTSEntrustAction *action);
+
+  /*
+   *	按指定价格和数量成交一笔,更新订单和持仓并推送回报
+   *	返回订单是否已经全部成交
+   */
+  bool fill_order(WTSOrderInfo *ordInfo, WTSContractInfo *ct, double price,
+                  double qty, uint64_t tradeTime);
+
+private:
+  //////////////////////////////////////////////////////////////////////////
+  // 回放模式
+  // 读取dsb历史tick,按时间顺序驱动撮合,同时通过UDP转发给ParserUDP,
+  // 报单和撤单按配置的延迟到达撮合,记录每笔订单的往返耗时
+  bool load_replay_ticks();
+  void replay_loop();
+  void replay_events(uint64_t simTime);
+  void replay_match(const WTSTickStruct &curTick, uint64_t simTime);
+  /*
+   *	用盘口撮合一笔订单,返回订单是否已经全部成交
+   *	bArrive	订单是否刚到达,刚到达的只和对手价撮合并计算排队位置
+   */
+  bool replay_order(WTSOrderInfo *ordInfo, WTSTickStruct &book,
+                    uint64_t simTime, bool bArrive);
+  void cast_tick(const WTSTickStruct &curTick);
+  uint32_t make_latency(uint32_t base);
+  void dump_timings();
+
+  bool _replay;
+  StdThreadPtr _thrd_replay;
+  std::vector<WTSTickStruct> _replay_ticks;
+  std::string _replay_folder;
+  uint32_t _replay_date;
+  std::vector<std::string> _replay_codes;
+  double _replay_speed;      // 回放速度,1为按行情节奏,0为不等待
+  uint32_t _replay_delay;    // 登录以后等待多少秒开始回放
+  uint32_t _order_latency;   // 报单延迟,毫秒
+  uint32_t _cancel_latency;  // 撤单延迟,毫秒
+  uint32_t _latency_jitter;  // 延迟的随机抖动,毫秒
+  uint32_t _queue_model;     // 0-只和对手价撮合,1-限价单按价位排队
+  std::mt19937 _rand_engine; // 固定种子,保证每次回放结果一致
+
+  std::atomic<uint64_t> _replay_now; // 当前回放到的行情时间,毫秒
+  typedef wt_hashmap<std::string, WTSTickStruct> BookMap;
+  BookMap _books;                                // 各合约的最新盘口
+  wt_hashmap<std::string, double> _queue_ahead; // 挂单前面的排队量
+
+  // 到达撮合的报单和撤单,按到达时间排序
+  typedef struct _ReplayEvent {
+    WTSEntrust *_entrust;
+    WTSOrderInfo *_order;
+    WTSEntrustAction *_action;
+  } ReplayEvent;
+  std::multimap<uint64_t, ReplayEvent> _events;
+  SpinMutex _mtx_events;
+
+  // 每笔订单的耗时记录,纳秒,从_ticker启动开始计时
+  typedef struct _OrderTiming {
+    char _code[MAX_INSTRUMENT_LENGTH];
+    char _order_id[64];
+    int64_t _tick_to_order; // 行情发出到收到委托
+    int64_t _insert;        // 收到委托
+    int64_t _ack;           // 开始推送委托回报
+    int64_t _ack_cost;      // 委托回报的处理耗时
+    int64_t _trade;         // 首笔成交回报处理完成
+    int64_t _cancel;        // 收到撤单
+    int64_t _canceled;      // 撤单回报处理完成
+
+    _OrderTiming() { memset(this, 0, sizeof(_OrderTiming)); }
+  } OrderTiming;
+  std::vector<OrderTiming> _timings;
+  wt_hashmap<std::string, std::size_t> _timing_ids;
+  wt_hashmap<std::string, int64_t> _cast_times; // 各合约最后一笔行情的发出时间
+  SpinMutex _mtx_timings;
+  TimeUtils::Ticker _ticker;
+
+  OrderTiming *getTiming(const char *orderid);
+
 private:
   StdThreadPtr _thrd_match;
   bool _terminated;
@@ -99,6 +193,10 @@ private:
 
   boost::array<char, 1024> _b_buffer;
 
+  boost::asio::ip::udp::endpoint _cast_ep; // 回放行情的转发地址
+  boost::asio::ip::udp::socket *_c_socket;
+  std::shared_ptr<boost::asio::io_service::work> _io_work;
+
   void handle_read(const boost::system::error_code &e,
                    std::size_t bytes_transferred, bool isBroad);
 
@@ -1733,6 +1733,22 @@ WTSKlineSlice *CtaMocker::stra_get_bars(const char *stdCode, const char *period,
   return kline;
 }
 
+bool CtaMocker::stra_get_bars(const char *stdCode,
+                              const char *period, uint32_t count,
+                              WTSKlineView &view,
+                              bool isMain /* = false */) {
+  // 切片对象从对象池分配,这里只把数据块地址拷贝到视图中就归还
+  WTSKlineSlice *kline = stra_get_bars(stdCode, period, count, isMain);
+  if (kline == NULL) {
+    view.reset(stdCode);
+    return false;
+  }
+
+  kline->fillView(view);
+  kline->release();
+  return true;
+}
+
 WTSTickSlice *CtaMocker::stra_get_ticks(const char *stdCode, uint32_t count) {
   return _replayer->get_tick_slice(stdCode, count);
 }
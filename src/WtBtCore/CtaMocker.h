@@ -195,6 +195,9 @@ public:
   virtual WTSKlineSlice *stra_get_bars(const char *stdCode, const char *period,
                                        uint32_t count,
                                        bool isMain = false) override;
+  virtual bool stra_get_bars(const char *stdCode, const char *period,
+                             uint32_t count, WTSKlineView &view,
+                             bool isMain = false) override;
   virtual WTSTickSlice *stra_get_ticks(const char *stdCode,
                                        uint32_t count) override;
   virtual WTSTickData *stra_get_last_tick(const char *stdCode) override;
@@ -199,14 +199,8 @@ void CtaStraBaseCtx::save_userdata() {
     filename += _name;
     filename += ".json";
 
-    BoostFile bf;
-    if (bf.create_new_file(filename.c_str())) {
-      rj::StringBuffer sb;
-      rj::PrettyWriter<rj::StringBuffer> writer(sb);
-      root.Accept(writer);
-      bf.write_file(sb.GetString());
-      bf.close_file();
-    }
+    _engine->get_state_saver().save(filename.c_str(),
+                                    WtStateSaver::json_serializer(root));
   }
 }
 
@@ -578,14 +572,8 @@ void CtaStraBaseCtx::save_data(uint32_t flag /* = 0xFFFFFFFF */) {
     filename += _name;
     filename += ".json";
 
-    BoostFile bf;
-    if (bf.create_new_file(filename.c_str())) {
-      rj::StringBuffer sb;
-      rj::PrettyWriter<rj::StringBuffer> writer(sb);
-      root.Accept(writer);
-      bf.write_file(sb.GetString());
-      bf.close_file();
-    }
+    _engine->get_state_saver().save(filename.c_str(),
+                                    WtStateSaver::json_serializer(root));
   }
 }
 
@@ -1528,6 +1516,22 @@ WTSKlineSlice *CtaStraBaseCtx::stra_get_bars(const char *stdCode,
   return kline;
 }
 
+bool CtaStraBaseCtx::stra_get_bars(const char *stdCode,
+                                   const char *period, uint32_t count,
+                                   WTSKlineView &view,
+                                   bool isMain /* = false */) {
+  // 切片对象从对象池分配,这里只把数据块地址拷贝到视图中就归还
+  WTSKlineSlice *kline = stra_get_bars(stdCode, period, count, isMain);
+  if (kline == NULL) {
+    view.reset(stdCode);
+    return false;
+  }
+
+  kline->fillView(view);
+  kline->release();
+  return true;
+}
+
 WTSTickSlice *CtaStraBaseCtx::stra_get_ticks(const char *stdCode,
                                              uint32_t count) {
   WTSTickSlice *ret = _engine->get_tick_slice(_context_id, stdCode, count);
@@ -0,0 +1,159 @@
+﻿/*!
+ * \file ExecNetting.cpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/04/08
+ *
+ * \brief
+ */
+#include "ExecNetting.h"
+#include "TraderAdapter.h"
+
+#include "../Includes/WTSVariant.hpp"
+#include "../Share/CodeHelper.hpp"
+#include "../Share/decimal.h"
+
+#include "../WTSTools/WTSLogger.h"
+
+#include <algorithm>
+
+USING_NS_WTP;
+
+ExecNetting::ExecNetting(TraderAdapter *adapter)
+    : _adapter(adapter), _rule(NR_Full), _min_qty(0) {}
+
+bool ExecNetting::init(WTSVariant *cfg) {
+  if (cfg == NULL)
+    return false;
+
+  std::string rule = cfg->getString("rule");
+  _rule = (rule == "idle") ? NR_Idle : NR_Full;
+  _min_qty = cfg->getDouble("min_qty");
+
+  WTSVariant *cfgItem = cfg->get("excludes");
+  if (cfgItem) {
+    if (cfgItem->type() == WTSVariant::VT_String)
+      _excludes.insert(cfgItem->asCString());
+    else if (cfgItem->type() == WTSVariant::VT_Array) {
+      for (uint32_t i = 0; i < cfgItem->size(); i++)
+        _excludes.insert(cfgItem->get(i)->asCString());
+    }
+  }
+
+  WTSLogger::log_dyn("trader", _adapter->id(), LL_INFO,
+                     "[{}] Netting of executers activated, rule: {}, "
+                     "min_qty: {}, excludes: {}",
+                     _adapter->id(), _rule == NR_Idle ? "idle" : "full",
+                     _min_qty, _excludes.size());
+  return true;
+}
+
+void ExecNetting::removeMember(INettingSink *sink) {
+  SpinLock lock(_mtx);
+  for (auto &v : _books) {
+    PendingBook &book = v.second;
+    book.erase(std::remove_if(book.begin(), book.end(),
+                              [sink](const PendingItem &item) {
+                                return item._sink == sink;
+                              }),
+               book.end());
+  }
+}
+
+bool ExecNetting::isExcluded(const char *stdCode) {
+  if (_excludes.empty())
+    return false;
+
+  if (_excludes.find(stdCode) != _excludes.end())
+    return true;
+
+  thread_local static char fullPid[64] = {0};
+  CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, NULL);
+  fmtutil::format_to(fullPid, "{}.{}", cInfo._exchg, cInfo._product);
+  return _excludes.find(fullPid) != _excludes.end();
+}
+
+void ExecNetting::update(INettingSink *sink, const char *stdCode,
+                         double pending) {
+  SpinLock lock(_mtx);
+  PendingBook &book = _books[stdCode];
+  for (PendingItem &item : book) {
+    if (item._sink == sink) {
+      item._pending = pending;
+      return;
+    }
+  }
+
+  book.emplace_back(PendingItem{sink, pending});
+}
+
+double ExecNetting::cross(INettingSink *sink, const char *stdCode,
+                          double pending) {
+  // 有在途订单的时候不对冲,剩下的量等下次目标变化再处理
+  bool bCross = !decimal::eq(pending, 0) && !isExcluded(stdCode);
+  if (bCross && _rule == NR_Idle &&
+      !decimal::eq(_adapter->getUndoneQty(stdCode), 0))
+    bCross = false;
+
+  typedef struct _NettedItem {
+    INettingSink *_sink;
+    double _qty;
+  } NettedItem;
+  std::vector<NettedItem> netted;
+  double left = 0;
+  {
+    // 登记和对冲在同一个临界区里做,对冲从登记以后的值开始
+    SpinLock lock(_mtx);
+    PendingBook &book = _books[stdCode];
+    PendingItem *self = NULL;
+    for (PendingItem &item : book) {
+      if (item._sink == sink)
+        self = &item;
+    }
+
+    if (self == NULL) {
+      book.emplace_back(PendingItem{sink, pending});
+      self = &book.back();
+    } else {
+      self->_pending = pending;
+    }
+
+    if (!bCross)
+      return 0;
+
+    left = self->_pending;
+    for (PendingItem &item : book) {
+      if (item._sink == sink)
+        continue;
+
+      // 只和方向相反的待执行量对冲
+      if (decimal::eq(left, 0))
+        break;
+      if (!decimal::lt(left * item._pending, 0))
+        continue;
+
+      double qty = std::min(std::abs(left), std::abs(item._pending));
+      if (decimal::lt(qty, _min_qty))
+        continue;
+
+      qty = (left > 0) ? qty : -qty;
+      left -= qty;
+      item._pending += qty;
+      netted.emplace_back(NettedItem{item._sink, -qty});
+    }
+
+    self->_pending = left;
+  }
+
+  // 回调的时候不持有锁,对方可能会再来更新待执行量
+  for (const NettedItem &item : netted) {
+    WTSLogger::log_dyn("trader", _adapter->id(), LL_INFO,
+                       "[{}] {} netted between {} and {}: {}", _adapter->id(),
+                       stdCode, sink->netting_id(), item._sink->netting_id(),
+                       -item._qty);
+    item._sink->on_netted(stdCode, item._qty);
+  }
+
+  return pending - left;
+}
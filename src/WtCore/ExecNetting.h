@@ -0,0 +1,91 @@
+﻿/*!
+ * \file ExecNetting.h
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/04/08
+ *
+ * \brief 同一个交易通道下多个执行器的轧差模块
+ * 每个执行器登记自己每个合约还没执行的数量,带方向
+ * 新的目标下达的时候,先和其他执行器方向相反的待执行量内部对冲,
+ * 只有对冲剩下的部分才交给执行单元下单
+ */
+#pragma once
+#include "../Includes/FasterDefs.h"
+#include "../Share/SpinMutex.hpp"
+
+#include <vector>
+
+NS_WTP_BEGIN
+class WTSVariant;
+class TraderAdapter;
+
+class INettingSink {
+public:
+  /*
+   *	执行器名称,用于日志
+   */
+  virtual const char *netting_id() = 0;
+
+  /*
+   *	待执行量被其他执行器对冲掉
+   *	@qty	对冲掉的数量,带方向,正数表示买入的部分已经完成
+   */
+  virtual void on_netted(const char *stdCode, double qty) = 0;
+};
+
+class ExecNetting {
+public:
+  typedef enum {
+    NR_Full, // 待执行量全部参与对冲
+    NR_Idle  // 合约没有未完成订单的时候才对冲,避免和在途订单的成交冲突
+  } NettingRule;
+
+  ExecNetting(TraderAdapter *adapter);
+
+  /*
+   *	读取对冲规则
+   *	rule: full/idle,默认full
+   *	min_qty: 单次对冲的最小数量
+   *	excludes: 不参与对冲的品种或合约,格式如CFFEX.IF
+   */
+  bool init(WTSVariant *cfg);
+
+  /*
+   *	执行器退出的时候清掉它登记的待执行量
+   */
+  void removeMember(INettingSink *sink);
+
+  /*
+   *	登记新的待执行量并和其他执行器对冲
+   *	@pending	新的待执行量,带方向
+   *	返回对冲掉的数量,调用方从自己的待执行量里扣掉
+   */
+  double cross(INettingSink *sink, const char *stdCode, double pending);
+
+  /*
+   *	只更新待执行量,不对冲,成交回报的时候调用
+   */
+  void update(INettingSink *sink, const char *stdCode, double pending);
+
+private:
+  bool isExcluded(const char *stdCode);
+
+private:
+  typedef struct _PendingItem {
+    INettingSink *_sink;
+    double _pending;
+  } PendingItem;
+  typedef std::vector<PendingItem> PendingBook;
+
+  TraderAdapter *_adapter;
+  NettingRule _rule;
+  double _min_qty;
+
+  wt_hashset<std::string> _excludes;
+
+  SpinMutex _mtx;
+  wt_hashmap<std::string, PendingBook> _books; // 合约代码到待执行量的映射
+};
+
+NS_WTP_END
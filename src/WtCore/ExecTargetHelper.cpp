@@ -0,0 +1,50 @@
+﻿/*!
+ * \file ExecTargetHelper.cpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/04/08
+ *
+ * \brief
+ */
+#include "ExecTargetHelper.h"
+#include "TraderAdapter.h"
+
+#include "../Share/decimal.h"
+
+#include "../WTSTools/WTSLogger.h"
+
+USING_NS_WTP;
+
+bool ExecTargetHelper::dispatch(const char *execName, TraderAdapter *trader,
+                                ThreadPoolPtr &pool, ExecuteUnitPtr &unit,
+                                const char *stdCode, double oldVol,
+                                double newVol, double scale) {
+  // 账户的理论持仓要经过修正
+  double traderTarget = round(newVol * scale);
+
+  if (!decimal::eq(oldVol, newVol)) {
+    WTSLogger::log_dyn(
+        "executer", execName, LL_INFO,
+        "Target position of {} changed: {} -> {} : {} with scale{}", stdCode,
+        oldVol, newVol, traderTarget, scale);
+  }
+
+  if (trader && !trader->checkOrderLimits(stdCode)) {
+    WTSLogger::log_dyn("executer", execName, LL_WARN,
+                       "{} is disabled due to entrust limit control ",
+                       stdCode);
+    return false;
+  }
+
+  if (pool) {
+    std::string code = stdCode;
+    pool->schedule([unit, code, traderTarget]() {
+      unit->self()->set_position(code.c_str(), traderTarget);
+    });
+  } else {
+    unit->self()->set_position(stdCode, traderTarget);
+  }
+
+  return true;
+}
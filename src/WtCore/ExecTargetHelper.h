@@ -0,0 +1,36 @@
+﻿/*!
+ * \file ExecTargetHelper.h
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/04/08
+ *
+ * \brief 执行器下达目标仓位的公共逻辑
+ * 本地执行器和套利执行器的全量和增量下达都走这里
+ */
+#pragma once
+#include "WtExecuterFactory.h"
+
+#include "../Share/threadpool.hpp"
+
+NS_WTP_BEGIN
+class TraderAdapter;
+
+class ExecTargetHelper {
+public:
+  typedef std::shared_ptr<boost::threadpool::pool> ThreadPoolPtr;
+
+  /*
+   *	把新的目标仓位交给执行单元
+   *	@execName	执行器名称,用于日志
+   *	@oldVol		原来的目标仓位,没有变化的时候不输出日志
+   *	@newVol		新的目标仓位,下达前按scale修正
+   *	返回false表示合约被流量风控拦下,目标仓位没有下达
+   */
+  static bool dispatch(const char *execName, TraderAdapter *trader,
+                       ThreadPoolPtr &pool, ExecuteUnitPtr &unit,
+                       const char *stdCode, double oldVol, double newVol,
+                       double scale);
+};
+
+NS_WTP_END
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "../Includes/FasterDefs.h"
+#include <atomic>
 #include <stdint.h>
 
 NS_WTP_BEGIN
@@ -17,14 +18,36 @@ public:
   virtual uint32_t get_trading_day() = 0;
 };
 
+/*
+ *	目标仓位变化项
+ *	_code指向执行器管理器内部缓存的合约代码,只在回调期间有效
+ *	_applied由执行器回填,没有下达的合约下次提交还会再发
+ */
+typedef struct _ExecTargetItem {
+  const char *_code;
+  double _target;
+  bool _applied;
+} ExecTargetItem;
+
 class IExecCommand {
 public:
-  IExecCommand(const char *name) : _stub(NULL), _name(name) {}
+  IExecCommand(const char *name)
+      : _stub(NULL), _name(name), _full_sync(false) {}
   /*
    *	设置目标仓位
    */
   virtual void set_position(const wt_hashmap<std::string, double> &targets) {}
 
+  /*
+   *	批量更新目标仓位
+   *	只包含和上一次提交相比有变化的合约,不在列表中的合约目标仓位保持不变
+   *	被风控拦下的合约把_applied置为false,执行器管理器不记为已提交
+   *	返回false表示不支持增量更新,执行器管理器会改为调用set_position
+   */
+  virtual bool update_targets(ExecTargetItem *items, uint32_t count) {
+    return false;
+  }
+
   /*
    *	合约仓位变动
    */
@@ -41,8 +64,20 @@ public:
 
   inline void setName(const char *name) { _name = name; }
 
+  /*
+   *	执行器状态重置以后调用,下次提交目标仓位走全量
+   *	可能在交易通道的线程调用
+   */
+  inline void require_full_sync() { _full_sync = true; }
+
+  /*
+   *	读取并清除全量同步标记
+   */
+  inline bool check_full_sync() { return _full_sync.exchange(false); }
+
 protected:
   IExecuterStub *_stub;
   std::string _name;
+  std::atomic<bool> _full_sync;
 };
 NS_WTP_END
\ No newline at end of file
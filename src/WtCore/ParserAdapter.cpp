@@ -13,6 +13,7 @@
 #include "WtHelper.h"
 
 #include "../Share/CodeHelper.hpp"
+#include "../Share/CoarseClock.hpp"
 #include "../Share/TimeUtils.hpp"
 
 #include "../Includes/IBaseDataMgr.h"
@@ -58,6 +59,7 @@ bool ParserAdapter::initExt(const char *id, IParserApi *api, IParserStub *stub,
 
       ayContract->release();
 
+      _contracts.build(_bd_mgr, contractSet);
       _parser_api->subscribe(contractSet);
       contractSet.clear();
     } else {
@@ -214,6 +216,7 @@ bool ParserAdapter::init(const char *id, WTSVariant *cfg, IParserStub *stub,
         ayContract->release();
       }
 
+      _contracts.build(_bd_mgr, contractSet);
       _parser_api->subscribe(contractSet);
       contractSet.clear();
     } else {
@@ -257,6 +260,14 @@ bool ParserAdapter::run() {
 
 // 合理毫秒数时间差
 const int RESONABLE_MILLISECS = 60 * 60 * 1000;
+WTSContractInfo *ParserAdapter::getContract(const char *code,
+                                             const char *exchg /* = "" */) {
+  WTSContractInfo *cInfo = _contracts.get(code, exchg);
+  if (cInfo == NULL)
+    cInfo = _bd_mgr->getContract(code, exchg);
+  return cInfo;
+}
+
 void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag) {
   if (quote == NULL || _stopped || quote->actiondate() == 0 ||
       quote->tradingdate() == 0)
@@ -268,7 +279,7 @@ void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag) {
 
   WTSContractInfo *cInfo = quote->getContractInfo();
   if (cInfo == NULL) {
-    cInfo = _bd_mgr->getContract(quote->code(), quote->exchg());
+    cInfo = getContract(quote->code(), quote->exchg());
     quote->setContractInfo(cInfo);
   }
 
@@ -279,9 +290,9 @@ void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag) {
   WTSSessionInfo *sInfo = commInfo->getSessionInfo();
 
   if (_check_time) {
-    int64_t tick_time =
-        TimeUtils::makeTime(quote->actiondate(), quote->actiontime());
-    int64_t local_time = TimeUtils::getLocalTimeNow();
+    int64_t tick_time = CoarseClock::one().makeTime(quote->actiondate(),
+                                                    quote->actiontime());
+    int64_t local_time = CoarseClock::one().getLocalTimeNow();
 
     /*
      *	By Wesley @ 2022.04.20
@@ -13,6 +13,7 @@
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/IParserApi.h"
+#include "../Share/ContractTable.hpp"
 
 NS_WTP_BEGIN
 class WTSVariant;
@@ -78,6 +79,12 @@ public:
 
   virtual IBaseDataMgr *getBaseDataMgr() override { return _bd_mgr; }
 
+  /*
+   *	先查订阅时预先解析好的合约表,查不到再到基础数据里查找
+   */
+  virtual WTSContractInfo *getContract(const char *code,
+                                       const char *exchg = "") override;
+
 private:
   IParserApi *_parser_api;
   FuncDeleteParser _remover;
@@ -101,6 +108,8 @@ private:
   IParserStub *_stub;
   WTSVariant *_cfg;
   std::string _id;
+
+  ContractTable _contracts; // 订阅的合约表
 };
 
 typedef std::shared_ptr<ParserAdapter> ParserAdapterPtr;
@@ -165,14 +165,8 @@ void SelStraBaseCtx::save_userdata() {
     filename += _name;
     filename += ".json";
 
-    BoostFile bf;
-    if (bf.create_new_file(filename.c_str())) {
-      rj::StringBuffer sb;
-      rj::PrettyWriter<rj::StringBuffer> writer(sb);
-      root.Accept(writer);
-      bf.write_file(sb.GetString());
-      bf.close_file();
-    }
+    _engine->get_state_saver().save(filename.c_str(),
+                                    WtStateSaver::json_serializer(root));
   }
 }
 
@@ -434,14 +428,8 @@ void SelStraBaseCtx::save_data(uint32_t flag /* = 0xFFFFFFFF */) {
     filename += _name;
     filename += ".json";
 
-    BoostFile bf;
-    if (bf.create_new_file(filename.c_str())) {
-      rj::StringBuffer sb;
-      rj::PrettyWriter<rj::StringBuffer> writer(sb);
-      root.Accept(writer);
-      bf.write_file(sb.GetString());
-      bf.close_file();
-    }
+    _engine->get_state_saver().save(filename.c_str(),
+                                    WtStateSaver::json_serializer(root));
   }
 }
 
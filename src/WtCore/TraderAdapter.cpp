@@ -11,6 +11,7 @@
 #include "../Includes/RiskMonDefs.h"
 #include "ActionPolicyMgr.h"
 #include "EventNotifier.h"
+#include "ExecNetting.h"
 #include "ITrdNotifySink.h"
 #include "WtHelper.h"
 #include "WtLocalExecuter.h"
@@ -71,11 +72,24 @@ inline const char *formatAction(WTSDirectionType dType, WTSOffsetType oType) {
 TraderAdapter::TraderAdapter(EventNotifier *caster /* = NULL */)
     : _id(""), _cfg(NULL), _state(AS_NOTLOGIN), _trader_api(NULL),
       _orders(NULL), _stat_map(NULL), _risk_mon_enabled(false),
-      _save_data(false), _notifier(caster), _ignore_sefmatch(false) {}
+      _need_price(false), _save_data(false), _notifier(caster),
+      _ignore_sefmatch(false), _netting(NULL) {
+  _stat_map = TradeStatMap::create();
+}
 
 TraderAdapter::~TraderAdapter() {
+  for (CodeSlot *slot : _slots) {
+    if (slot->_orders)
+      slot->_orders->release();
+    delete slot;
+  }
+  _slots.clear();
+
   if (_stat_map)
     _stat_map->release();
+
+  if (_netting)
+    delete _netting;
 }
 
 bool TraderAdapter::init(const char *id, WTSVariant *params,
@@ -125,6 +139,23 @@ bool TraderAdapter::init(const char *id, WTSVariant *params,
         rParam._order_stat_timespan =
             vProdItem->getUInt32("order_stat_timespan");
 
+        rParam._max_order_qty = vProdItem->getDouble("max_order_qty");
+        rParam._max_order_notional =
+            vProdItem->getDouble("max_order_notional");
+        rParam._price_band = vProdItem->getDouble("price_band");
+
+        // 把配置编译成规则掩码,没有配置的规则下单时直接跳过
+        rParam._rules = RR_OrderRate;
+        if (rParam._max_order_qty > 0)
+          rParam._rules |= RR_OrderQty;
+        if (rParam._max_order_notional > 0)
+          rParam._rules |= RR_Notional;
+        if (rParam._price_band > 0)
+          rParam._rules |= RR_PriceBand;
+
+        if (rParam._rules & RR_NeedPrice)
+          _need_price = true;
+
         WTSLogger::log_dyn(
             "trader", _id.c_str(), LL_INFO,
             "[{}] Risk control rule {} of trading channel loaded", _id.c_str(),
@@ -150,6 +181,13 @@ bool TraderAdapter::init(const char *id, WTSVariant *params,
                        _id.c_str());
   }
 
+  // 同一通道下多个执行器的目标先轧差再下单
+  WTSVariant *cfgNetting = params->get("netting");
+  if (cfgNetting && cfgNetting->getBoolean("active")) {
+    _netting = new ExecNetting(this);
+    _netting->init(cfgNetting);
+  }
+
   if (params->getString("module").empty())
     return false;
 
@@ -316,9 +354,15 @@ void TraderAdapter::saveData(WTSArray *ayFunds /* = NULL */) {
     double	s_preavail;
      */
 
-    for (auto it = _positions.begin(); it != _positions.end(); it++) {
-      const char *stdCode = it->first.c_str();
-      const PosItem &pInfo = it->second;
+    std::vector<CodeSlot *> slots;
+    getAllSlots(slots);
+    for (CodeSlot *slot : slots) {
+      const char *stdCode = slot->_code.c_str();
+      const PosItem &pInfo = slot->_pos;
+      // 只下过单没有持仓的合约不用保存
+      if (decimal::eq(pInfo.total_pos(true), 0) &&
+          decimal::eq(pInfo.total_pos(false), 0))
+        continue;
 
       rj::Value pItem(rj::kObjectType);
       pItem.AddMember("code", rj::Value(stdCode, allocator), allocator);
@@ -390,16 +434,54 @@ TraderAdapter::getRiskParams(const char *stdCode) {
     return &it->second;
 
   it = _risk_params_map.find("default");
+  if (it == _risk_params_map.end())
+    return NULL;
+
   return &it->second;
 }
 
+TraderAdapter::CodeSlot *TraderAdapter::getSlot(const char *stdCode,
+                                                bool bCreate /* = true */) {
+  SpinLock lock(_mtx_slots);
+  auto it = _slot_ids.find(stdCode);
+  if (it != _slot_ids.end())
+    return _slots[it->second];
+
+  if (!bCreate)
+    return NULL;
+
+  CodeSlot *slot = new CodeSlot();
+  slot->_code = stdCode;
+  slot->_orders = OrderMap::create();
+
+  WTSTradeStateInfo *statInfo = (WTSTradeStateInfo *)_stat_map->get(stdCode);
+  if (statInfo == NULL) {
+    statInfo = WTSTradeStateInfo::create(stdCode);
+    _stat_map->add(stdCode, statInfo, false);
+  }
+  slot->_stat = statInfo;
+
+  // 风控参数在init的时候已经加载,这里直接绑定到槽位上
+  // 窗口内除最近一次以外的次数超过边界才算超限,所以容量为边界+2
+  slot->_rules = _ignore_sefmatch ? 0 : RR_SelfMatch;
+  if (_risk_mon_enabled) {
+    slot->_risk = getRiskParams(stdCode);
+    if (slot->_risk) {
+      slot->_rules |= slot->_risk->_rules;
+      slot->_order_times.reset(slot->_risk->_order_times_boundary + 2);
+      slot->_cancel_times.reset(slot->_risk->_cancel_times_boundary + 2);
+    }
+  }
+
+  _slot_ids[stdCode] = (uint32_t)_slots.size();
+  _slots.emplace_back(slot);
+  return slot;
+}
+
 bool TraderAdapter::run() {
   if (_trader_api == NULL)
     return false;
 
-  if (_stat_map == NULL)
-    _stat_map = TradeStatMap::create();
-
   _trader_api->registerSpi(this);
 
   _trader_api->connect();
@@ -416,12 +498,12 @@ void TraderAdapter::release() {
 
 double TraderAdapter::getPosition(const char *stdCode, bool bValidOnly,
                                   int32_t flag /* = 3 */) {
-  auto it = _positions.find(stdCode);
-  if (it == _positions.end())
+  CodeSlot *slot = getSlot(stdCode, false);
+  if (slot == NULL)
     return 0;
 
   double ret = 0;
-  const PosItem &pItem = it->second;
+  const PosItem &pItem = slot->_pos;
   if (flag & 1) {
     if (bValidOnly)
       ret += (pItem.l_newavail + pItem.l_preavail);
@@ -439,9 +521,11 @@ double TraderAdapter::getPosition(const char *stdCode, bool bValidOnly,
 }
 
 void TraderAdapter::enumPosition(FuncEnumChnlPosCallBack cb) {
-  for (auto &v : _positions) {
-    const char *stdCode = v.first.c_str();
-    const PosItem &pItem = v.second;
+  std::vector<CodeSlot *> slots;
+  getAllSlots(slots);
+  for (CodeSlot *slot : slots) {
+    const char *stdCode = slot->_code.c_str();
+    const PosItem &pItem = slot->_pos;
     if (decimal::gt(pItem.l_prevol + pItem.l_newvol, 0))
       cb(stdCode, true, pItem.l_prevol, pItem.l_preavail, pItem.l_newvol,
          pItem.l_newavail);
@@ -456,26 +540,32 @@ OrderMap *TraderAdapter::getOrders(const char *stdCode) {
     return NULL;
 
   bool isAll = strlen(stdCode) == 0;
+  CodeSlot *slot = NULL;
+  if (!isAll) {
+    slot = getSlot(stdCode, false);
+    if (slot == NULL)
+      return OrderMap::create();
+  }
 
   SpinLock lock(_mtx_orders);
+  OrderMap *src = isAll ? _orders : slot->_orders;
   OrderMap *ret = OrderMap::create();
-  for (auto it = _orders->begin(); it != _orders->end(); it++) {
-    uint32_t localid = it->first;
-    WTSOrderInfo *ordInfo = (WTSOrderInfo *)it->second;
-
-    if (isAll || strcmp(ordInfo->getCode(), stdCode) == 0)
-      ret->add(localid, ordInfo);
-  }
+  for (auto it = src->begin(); it != src->end(); it++)
+    ret->add(it->first, it->second);
   return ret;
 }
 
-uint32_t TraderAdapter::doEntrust(WTSEntrust *entrust) {
-  _trader_api->makeEntrustID(entrust->getEntrustID(), 64);
-
+uint32_t TraderAdapter::doEntrust(WTSEntrust *entrust, const char *stdCode) {
   WTSContractInfo *cInfo = entrust->getContractInfo();
   if (cInfo == NULL)
     cInfo = getContract(entrust->getCode());
 
+  CodeSlot *slot = getSlot(stdCode);
+  if (!checkEntrust(slot, entrust, cInfo))
+    return UINT_MAX;
+
+  _trader_api->makeEntrustID(entrust->getEntrustID(), 64);
+
   entrust->setCode(cInfo->getCode());
   entrust->setExchange(cInfo->getExchg());
 
@@ -491,22 +581,22 @@ uint32_t TraderAdapter::doEntrust(WTSEntrust *entrust) {
                        "[{}] Order placing failed: {}", _id.c_str(), ret);
     return UINT_MAX;
   } else {
-    int64_t now = TimeUtils::getLocalTimeNow();
-    _order_time_cache[entrust->getCode()].emplace_back(now);
+    // 按标准代码记录,和checkOrderLimits查找的一致
+    slot->_order_times.push(TimeUtils::getLocalTimeNow());
   }
   return localid;
 }
 
-void TraderAdapter::updateUndone(const char *stdCode, double qty,
+void TraderAdapter::updateUndone(CodeSlot *slot, double qty,
                                  bool bOuput /* = false */) {
-  double &undone = _undone_qty[stdCode];
-  double oldQty = undone;
-  undone += qty;
+  double oldQty = slot->_undone;
+  slot->_undone += qty;
 
   if (bOuput)
     WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO,
                        "[{}] {} qty of undone order updated, {} -> {}",
-                       _id.c_str(), stdCode, oldQty, undone);
+                       _id.c_str(), slot->_code.c_str(), oldQty,
+                       slot->_undone);
 }
 
 WTSContractInfo *TraderAdapter::getContract(const char *stdCode) {
@@ -523,124 +613,199 @@ bool TraderAdapter::checkCancelLimits(const char *stdCode) {
   if (!_risk_mon_enabled)
     return true;
 
-  if (_exclude_codes.find(stdCode) != _exclude_codes.end())
+  return checkCancelLimits(getSlot(stdCode));
+}
+
+bool TraderAdapter::checkCancelLimits(CodeSlot *slot) {
+  if (!_risk_mon_enabled)
+    return true;
+
+  if (slot->_excluded)
     return false;
 
-  const RiskParams *riskPara = getRiskParams(stdCode);
+  const RiskParams *riskPara = slot->_risk;
   if (riskPara == NULL)
     return true;
 
-  WTSTradeStateInfo *statInfo = (WTSTradeStateInfo *)_stat_map->get(stdCode);
-  if (statInfo && riskPara->_cancel_total_limits != 0 &&
+  const char *stdCode = slot->_code.c_str();
+  WTSTradeStateInfo *statInfo = slot->_stat;
+  if (riskPara->_cancel_total_limits != 0 &&
       statInfo->total_cancels() >= riskPara->_cancel_total_limits) {
     WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
                        "[{}] {} cancel {} times totaly, beyond boundary {} "
                        "times, adding to excluding list",
                        _id.c_str(), stdCode, statInfo->total_cancels(),
                        riskPara->_cancel_total_limits);
-    _exclude_codes.insert(stdCode);
+    slot->_excluded = true;
     return false;
   }
 
   // 撤单频率检查
-  auto it = _cancel_time_cache.find(stdCode);
-  if (it != _cancel_time_cache.end()) {
-    TimeCacheList &cache = (TimeCacheList &)it->second;
-    uint32_t cnt = cache.size();
-    if (cnt >= riskPara->_cancel_times_boundary) {
-      uint64_t eTime = cache[cnt - 1];
-      uint64_t sTime = eTime - riskPara->_cancel_stat_timespan * 1000;
-      auto tit = std::lower_bound(cache.begin(), cache.end(), sTime);
-      auto sIdx = tit - cache.begin();
-      auto times = cnt - sIdx - 1;
-      if (times > riskPara->_cancel_times_boundary) {
-        WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
-                           "[{}] {} cancel {} times within {} seconds, beyond "
-                           "boundary {} times, adding to excluding list",
-                           _id.c_str(), stdCode, times,
-                           riskPara->_cancel_stat_timespan,
-                           riskPara->_cancel_times_boundary);
-        _exclude_codes.insert(stdCode);
-        return false;
-      }
-
-      // 这里必须要清理一下, 没有特别好的办法
-      // 不然随着时间推移, vector长度会越来越长
-      if (tit != cache.begin()) {
-        cache.erase(cache.begin(), tit);
-      }
-    }
+  // 窗口已满,且最早一次还在统计时间内,说明撤单次数超过了边界
+  const TimeWindow &window = slot->_cancel_times;
+  if (window.full() &&
+      window.span() <= (uint64_t)riskPara->_cancel_stat_timespan * 1000) {
+    WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
+                       "[{}] {} cancel {} times within {} seconds, beyond "
+                       "boundary {} times, adding to excluding list",
+                       _id.c_str(), stdCode, window._count - 1,
+                       riskPara->_cancel_stat_timespan,
+                       riskPara->_cancel_times_boundary);
+    slot->_excluded = true;
+    return false;
   }
 
   return true;
 }
 
-bool TraderAdapter::isTradeEnabled(const char *stdCode) const {
+bool TraderAdapter::isTradeEnabled(const char *stdCode) {
   if (!_risk_mon_enabled)
     return true;
 
-  if (_exclude_codes.find(stdCode) != _exclude_codes.end())
-    return false;
-
-  return true;
+  CodeSlot *slot = getSlot(stdCode, false);
+  return (slot == NULL) || !slot->_excluded;
 }
 
 bool TraderAdapter::checkOrderLimits(const char *stdCode) {
   if (!_risk_mon_enabled)
     return true;
 
-  if (_exclude_codes.find(stdCode) != _exclude_codes.end())
+  return checkOrderLimits(getSlot(stdCode));
+}
+
+bool TraderAdapter::checkOrderLimits(CodeSlot *slot) {
+  if (!_risk_mon_enabled)
+    return true;
+
+  if (slot->_excluded)
     return false;
 
-  const RiskParams *riskPara = getRiskParams(stdCode);
+  const RiskParams *riskPara = slot->_risk;
   if (riskPara == NULL)
     return true;
 
-  WTSTradeStateInfo *statInfo = (WTSTradeStateInfo *)_stat_map->get(stdCode);
-  if (statInfo && riskPara->_order_total_limits != 0 &&
+  const char *stdCode = slot->_code.c_str();
+  WTSTradeStateInfo *statInfo = slot->_stat;
+  if (riskPara->_order_total_limits != 0 &&
       statInfo->total_orders() >= riskPara->_order_total_limits) {
     WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
                        "[{}] {} entrust {} times totally, beyond boundary {} "
                        "times, adding to excluding list",
                        _id.c_str(), stdCode, statInfo->total_orders(),
                        riskPara->_order_total_limits);
-    _exclude_codes.insert(stdCode);
+    slot->_excluded = true;
     return false;
   }
 
-  // 撤单频率检查
-  auto it = _order_time_cache.find(stdCode);
-  if (it != _order_time_cache.end()) {
-    TimeCacheList &cache = (TimeCacheList &)it->second;
-    uint32_t cnt = cache.size();
-    if (cnt >= riskPara->_order_times_boundary) {
-      uint64_t eTime = cache[cnt - 1];
-      uint64_t sTime = eTime - riskPara->_order_stat_timespan * 1000;
-      auto tit = std::lower_bound(cache.begin(), cache.end(), sTime);
-      auto sIdx = tit - cache.begin();
-      auto times = cnt - sIdx - 1;
-      if (times > riskPara->_order_times_boundary) {
-        WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
-                           "[{}] {} entrust {} times within {} seconds, beyond "
-                           "boundary {} times, adding to excluding list",
-                           _id.c_str(), stdCode, times,
-                           riskPara->_order_stat_timespan,
-                           riskPara->_order_times_boundary);
-        _exclude_codes.insert(stdCode);
-        return false;
-      }
+  // 下单频率检查
+  const TimeWindow &window = slot->_order_times;
+  if (window.full() &&
+      window.span() <= (uint64_t)riskPara->_order_stat_timespan * 1000) {
+    WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
+                       "[{}] {} entrust {} times within {} seconds, beyond "
+                       "boundary {} times, adding to excluding list",
+                       _id.c_str(), stdCode, window._count - 1,
+                       riskPara->_order_stat_timespan,
+                       riskPara->_order_times_boundary);
+    slot->_excluded = true;
+    return false;
+  }
 
-      // 这里必须要清理一下, 没有特别好的办法
-      // 不然随着时间推移, vector长度会越来越长
-      if (tit != cache.begin()) {
-        cache.erase(cache.begin(), tit);
-      }
+  return true;
+}
+
+bool TraderAdapter::checkEntrust(CodeSlot *slot, WTSEntrust *entrust,
+                                 WTSContractInfo *cInfo) {
+  uint32_t rules = slot->_rules;
+  if (rules == 0)
+    return true;
+
+  const char *stdCode = slot->_code.c_str();
+  if ((rules & RR_SelfMatch) && slot->_self_matched) {
+    WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
+                       "[{0}] Order of {1} rejected: {1} is in self matches",
+                       _id.c_str(), stdCode);
+    return false;
+  }
+
+  // 除了自成交,其他规则都来自流量风控参数,规则打开了参数一定不为空
+  const RiskParams *riskPara = slot->_risk;
+  double qty = entrust->getVolume();
+  double price = entrust->getPrice();
+  if ((rules & RR_OrderQty) && decimal::gt(qty, riskPara->_max_order_qty)) {
+    WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
+                       "[{}] Order of {} rejected: qty {} beyond limit {}",
+                       _id.c_str(), stdCode, qty, riskPara->_max_order_qty);
+    return false;
+  }
+
+  // 价格类规则没有最新价无法检查,直接拒绝,不能放过
+  double lastPx = slot->_last_price;
+  if ((rules & RR_NeedPrice) && decimal::eq(lastPx, 0)) {
+    WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
+                       "[{}] Order of {} rejected: no last price for price "
+                       "checking",
+                       _id.c_str(), stdCode);
+    return false;
+  }
+
+  // 市价单按最新价估算金额
+  if (rules & RR_Notional) {
+    double curPx = decimal::eq(price, 0) ? lastPx : price;
+    double notional = qty * curPx * cInfo->getCommInfo()->getVolScale();
+    if (decimal::gt(notional, riskPara->_max_order_notional)) {
+      WTSLogger::log_dyn(
+          "trader", _id.c_str(), LL_ERROR,
+          "[{}] Order of {} rejected: notional {} beyond limit {}",
+          _id.c_str(), stdCode, notional, riskPara->_max_order_notional);
+      return false;
+    }
+  }
+
+  // 市价单不检查价格偏离
+  if ((rules & RR_PriceBand) && !decimal::eq(price, 0)) {
+    double deviation = fabs(price - lastPx) / lastPx;
+    if (decimal::gt(deviation, riskPara->_price_band)) {
+      WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
+                         "[{}] Order of {} rejected: price {} deviates {} "
+                         "from last price {}, beyond band {}",
+                         _id.c_str(), stdCode, price, deviation, lastPx,
+                         riskPara->_price_band);
+      return false;
     }
   }
 
+  if ((rules & RR_OrderRate) && !checkOrderLimits(slot)) {
+    WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR,
+                       "[{0}] Order of {1} rejected: {1} is in excluding list",
+                       _id.c_str(), stdCode);
+    return false;
+  }
+
   return true;
 }
 
+void TraderAdapter::updatePrice(const char *stdCode, double price) {
+  if (!_need_price)
+    return;
+
+  // 只给绑定了依赖价格规则的合约记最新价,槽位在第一笔行情的时候建好,
+  // 这样第一笔委托就有价格可用
+  CodeSlot *slot = getSlot(stdCode, false);
+  if (slot == NULL) {
+    const RiskParams *riskPara = getRiskParams(stdCode);
+    if (riskPara == NULL || (riskPara->_rules & RR_NeedPrice) == 0)
+      return;
+
+    slot = getSlot(stdCode);
+  }
+
+  if ((slot->_rules & RR_NeedPrice) == 0)
+    return;
+
+  slot->_last_price = price;
+}
+
 OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
                             int flag, bool bForceClose,
                             WTSContractInfo *cInfo /* = NULL */) {
@@ -648,7 +813,8 @@ OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
   if (qty == 0)
     return ret;
 
-  if (isSelfMatched(stdCode)) {
+  CodeSlot *slot = getSlot(stdCode);
+  if ((slot->_rules & RR_SelfMatch) && slot->_self_matched) {
     WTSLogger::log_dyn(
         "trader", _id.c_str(), LL_ERROR,
         "[{0}] Instructions on {1} are forbidden: {1} is in self matches",
@@ -673,15 +839,11 @@ OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
                      "[{}] Buying {} of quantity {}", _id.c_str(), stdCode,
                      qty);
 
-  updateUndone(stdCode, qty, true);
+  // 先按全部数量记未完成,被风控拦下或者没有发出去的子单再扣回来
+  updateUndone(slot, qty, true);
 
-  const PosItem &pItem = _positions[stdCode];
-  WTSTradeStateInfo *statInfo = (WTSTradeStateInfo *)_stat_map->get(stdCode);
-  if (statInfo == NULL) {
-    statInfo = WTSTradeStateInfo::create(stdCode);
-    _stat_map->add(stdCode, statInfo, false);
-  }
-  TradeStatInfo &statItem = statInfo->statInfo();
+  const PosItem &pItem = slot->_pos;
+  TradeStatInfo &statItem = slot->_stat->statInfo();
 
   const ActionRuleGroup &ruleGP =
       _policy_mgr->getActionRules(commInfo->getFullPid());
@@ -729,7 +891,10 @@ OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
       for (;;) {
         double curQty = min(leftQty, unitQty);
         uint32_t localid = openLong(stdCode, price, curQty, flag, cInfo);
-        ret.emplace_back(localid);
+        if (localid == UINT_MAX)
+          updateUndone(slot, -curQty, true);
+        else
+          ret.emplace_back(localid);
 
         leftQty -= curQty;
 
@@ -771,7 +936,10 @@ OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
               closeShort(stdCode, price, curQty,
                          (commInfo->getCoverMode() == CM_CoverToday), flag,
                          cInfo); // 如果不支持平今, 则直接下平仓标记即可
-          ret.emplace_back(localid);
+          if (localid == UINT_MAX)
+            updateUndone(slot, -curQty, true);
+          else
+            ret.emplace_back(localid);
 
           leftQty -= curQty;
 
@@ -816,7 +984,10 @@ OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
           uint32_t localid =
               closeShort(stdCode, price, curQty, false, flag,
                          cInfo); // 如果不支持平今, 则直接下平仓标记即可
-          ret.emplace_back(localid);
+          if (localid == UINT_MAX)
+            updateUndone(slot, -curQty, true);
+          else
+            ret.emplace_back(localid);
 
           leftQty -= curQty;
 
@@ -853,7 +1024,10 @@ OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
             double curQty = min(leftQty, unitQty);
             uint32_t localid =
                 closeShort(stdCode, price, curQty, false, flag, cInfo);
-            ret.emplace_back(localid);
+            if (localid == UINT_MAX)
+              updateUndone(slot, -curQty, true);
+            else
+              ret.emplace_back(localid);
 
             leftQty -= curQty;
 
@@ -878,7 +1052,10 @@ OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
             double curQty = min(leftQty, unitQty);
             uint32_t localid =
                 closeShort(stdCode, price, curQty, false, flag, cInfo);
-            ret.emplace_back(localid);
+            if (localid == UINT_MAX)
+              updateUndone(slot, -curQty, true);
+            else
+              ret.emplace_back(localid);
 
             leftQty -= curQty;
 
@@ -904,7 +1081,10 @@ OrderIDs TraderAdapter::buy(const char *stdCode, double price, double qty,
             double curQty = min(leftQty, unitQty);
             uint32_t localid =
                 closeShort(stdCode, price, curQty, true, flag, cInfo);
-            ret.emplace_back(localid);
+            if (localid == UINT_MAX)
+              updateUndone(slot, -curQty, true);
+            else
+              ret.emplace_back(localid);
 
             leftQty -= curQty;
 
@@ -943,7 +1123,8 @@ OrderIDs TraderAdapter::sell(const char *stdCode, double price, double qty,
   if (qty == 0)
     return ret;
 
-  if (isSelfMatched(stdCode)) {
+  CodeSlot *slot = getSlot(stdCode);
+  if ((slot->_rules & RR_SelfMatch) && slot->_self_matched) {
     WTSLogger::log_dyn(
         "trader", _id.c_str(), LL_ERROR,
         "[{0}] Instructions on {1} are forbidden: {1} is in self matches",
@@ -968,15 +1149,11 @@ OrderIDs TraderAdapter::sell(const char *stdCode, double price, double qty,
                      "[{}] Selling {} of quantity {}", _id.c_str(), stdCode,
                      qty);
 
-  updateUndone(stdCode, -qty, true);
+  // 先按全部数量记未完成,被风控拦下或者没有发出去的子单再扣回来
+  updateUndone(slot, -qty, true);
 
-  const PosItem &pItem = _positions[stdCode];
-  WTSTradeStateInfo *statInfo = (WTSTradeStateInfo *)_stat_map->get(stdCode);
-  if (statInfo == NULL) {
-    statInfo = WTSTradeStateInfo::create(stdCode);
-    _stat_map->add(stdCode, statInfo, false);
-  }
-  TradeStatInfo &statItem = statInfo->statInfo();
+  const PosItem &pItem = slot->_pos;
+  TradeStatInfo &statItem = slot->_stat->statInfo();
 
   const ActionRuleGroup &ruleGP =
       _policy_mgr->getActionRules(commInfo->getFullPid());
@@ -1024,7 +1201,10 @@ OrderIDs TraderAdapter::sell(const char *stdCode, double price, double qty,
       for (;;) {
         double curQty = min(leftQty, unitQty);
         uint32_t localid = openShort(stdCode, price, curQty, flag, cInfo);
-        ret.emplace_back(localid);
+        if (localid == UINT_MAX)
+          updateUndone(slot, curQty, true);
+        else
+          ret.emplace_back(localid);
 
         leftQty -= curQty;
 
@@ -1065,7 +1245,10 @@ OrderIDs TraderAdapter::sell(const char *stdCode, double price, double qty,
               closeLong(stdCode, price, curQty,
                         (commInfo->getCoverMode() == CM_CoverToday), flag,
                         cInfo); // 如果不支持平今, 则直接下平仓标记即可
-          ret.emplace_back(localid);
+          if (localid == UINT_MAX)
+            updateUndone(slot, curQty, true);
+          else
+            ret.emplace_back(localid);
 
           leftQty -= curQty;
 
@@ -1108,7 +1291,10 @@ OrderIDs TraderAdapter::sell(const char *stdCode, double price, double qty,
           uint32_t localid =
               closeLong(stdCode, price, curQty, false, flag,
                         cInfo); // 如果不支持平今, 则直接下平仓标记即可
-          ret.emplace_back(localid);
+          if (localid == UINT_MAX)
+            updateUndone(slot, curQty, true);
+          else
+            ret.emplace_back(localid);
 
           leftQty -= curQty;
 
@@ -1142,7 +1328,10 @@ OrderIDs TraderAdapter::sell(const char *stdCode, double price, double qty,
             double curQty = min(leftQty, unitQty);
             uint32_t localid =
                 closeLong(stdCode, price, curQty, false, flag, cInfo);
-            ret.emplace_back(localid);
+            if (localid == UINT_MAX)
+              updateUndone(slot, curQty, true);
+            else
+              ret.emplace_back(localid);
 
             leftQty -= curQty;
 
@@ -1167,7 +1356,10 @@ OrderIDs TraderAdapter::sell(const char *stdCode, double price, double qty,
               double curQty = min(leftQty, unitQty);
               uint32_t localid =
                   closeLong(stdCode, price, curQty, false, flag, cInfo);
-              ret.emplace_back(localid);
+              if (localid == UINT_MAX)
+                updateUndone(slot, curQty, true);
+              else
+                ret.emplace_back(localid);
 
               leftQty -= curQty;
 
@@ -1193,7 +1385,10 @@ OrderIDs TraderAdapter::sell(const char *stdCode, double price, double qty,
               double curQty = min(leftQty, unitQty);
               uint32_t localid =
                   closeLong(stdCode, price, curQty, true, flag, cInfo);
-              ret.emplace_back(localid);
+              if (localid == UINT_MAX)
+                updateUndone(slot, curQty, true);
+              else
+                ret.emplace_back(localid);
 
               leftQty -= curQty;
 
@@ -1243,7 +1438,8 @@ bool TraderAdapter::doCancel(WTSOrderInfo *ordInfo) {
     stdCode = CodeHelper::rawFlatCodeToStdCode(
         cInfo->getCode(), cInfo->getExchg(), cInfo->getProduct());
   // 撤单频率检查
-  if (!checkCancelLimits(stdCode.c_str()))
+  CodeSlot *slot = getSlot(stdCode.c_str());
+  if (!checkCancelLimits(slot))
     return false;
 
   WTSEntrustAction *action =
@@ -1253,6 +1449,9 @@ bool TraderAdapter::doCancel(WTSOrderInfo *ordInfo) {
   int ret = _trader_api->orderAction(action);
   bool isSent = (ret >= 0);
   action->release();
+
+  if (isSent)
+    slot->_cancel_times.push(TimeUtils::getLocalTimeNow());
   return isSent;
 }
 
@@ -1269,10 +1468,6 @@ bool TraderAdapter::cancel(uint32_t localid) {
   }
 
   bool bRet = doCancel(ordInfo);
-
-  _cancel_time_cache[ordInfo->getCode()].emplace_back(
-      TimeUtils::getLocalTimeNow());
-
   ordInfo->release();
 
   return bRet;
@@ -1280,37 +1475,35 @@ bool TraderAdapter::cancel(uint32_t localid) {
 
 OrderIDs TraderAdapter::cancel(const char *stdCode, bool isBuy,
                                double qty /* = 0 */) {
-  CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, NULL);
-
   OrderIDs ret;
 
-  double actQty = 0;
-  bool isAll = strlen(stdCode) == 0;
-  if (_orders != NULL && _orders->size() > 0) {
-    for (auto it = _orders->begin(); it != _orders->end(); it++) {
-      WTSOrderInfo *orderInfo = (WTSOrderInfo *)it->second;
-      if (!orderInfo->isAlive())
-        continue;
-
-      bool bBuy = (orderInfo->getDirection() == WDT_LONG &&
-                   orderInfo->getOffsetType() == WOT_OPEN) ||
-                  (orderInfo->getDirection() == WDT_SHORT &&
-                   orderInfo->getOffsetType() != WOT_OPEN);
-      if (bBuy != isBuy)
-        continue;
-
-      if (isAll || strcmp(orderInfo->getCode(), cInfo._code) == 0) {
-        if (doCancel(orderInfo)) {
-          actQty += orderInfo->getVolLeft();
-          ret.emplace_back(it->first);
-          //_cancel_time_cache[orderInfo->getCode()].emplace_back(TimeUtils::getLocalTimeNow());
-        }
-      }
+  // 先复制一份该合约的活动订单,撤单回报可能会在其他线程修改订单表
+  OrderMap *ordMap = getOrders(stdCode);
+  if (ordMap == NULL)
+    return ret;
 
-      if (!decimal::eq(qty, 0) && decimal::ge(actQty, qty))
-        break;
+  double actQty = 0;
+  for (auto it = ordMap->begin(); it != ordMap->end(); it++) {
+    WTSOrderInfo *orderInfo = (WTSOrderInfo *)it->second;
+    if (!orderInfo->isAlive())
+      continue;
+
+    bool bBuy = (orderInfo->getDirection() == WDT_LONG &&
+                 orderInfo->getOffsetType() == WOT_OPEN) ||
+                (orderInfo->getDirection() == WDT_SHORT &&
+                 orderInfo->getOffsetType() != WOT_OPEN);
+    if (bBuy != isBuy)
+      continue;
+
+    if (doCancel(orderInfo)) {
+      actQty += orderInfo->getVolLeft();
+      ret.emplace_back(it->first);
     }
+
+    if (!decimal::eq(qty, 0) && decimal::ge(actQty, qty))
+      break;
   }
+  ordMap->release();
 
   return ret;
 }
@@ -1329,7 +1522,7 @@ uint32_t TraderAdapter::openLong(const char *stdCode, double price, double qty,
   entrust->setDirection(WDT_LONG);
   entrust->setOffsetType(WOT_OPEN);
 
-  uint32_t ret = doEntrust(entrust);
+  uint32_t ret = doEntrust(entrust, stdCode);
   entrust->release();
   return ret;
 }
@@ -1348,7 +1541,7 @@ uint32_t TraderAdapter::openShort(const char *stdCode, double price, double qty,
   entrust->setDirection(WDT_SHORT);
   entrust->setOffsetType(WOT_OPEN);
 
-  uint32_t ret = doEntrust(entrust);
+  uint32_t ret = doEntrust(entrust, stdCode);
   entrust->release();
   return ret;
 }
@@ -1367,7 +1560,7 @@ uint32_t TraderAdapter::closeLong(const char *stdCode, double price, double qty,
   entrust->setDirection(WDT_LONG);
   entrust->setOffsetType(isToday ? WOT_CLOSETODAY : WOT_CLOSE);
 
-  uint32_t ret = doEntrust(entrust);
+  uint32_t ret = doEntrust(entrust, stdCode);
   entrust->release();
   return ret;
 }
@@ -1386,7 +1579,7 @@ uint32_t TraderAdapter::closeShort(const char *stdCode, double price,
   entrust->setDirection(WDT_SHORT);
   entrust->setOffsetType(isToday ? WOT_CLOSETODAY : WOT_CLOSE);
 
-  uint32_t ret = doEntrust(entrust);
+  uint32_t ret = doEntrust(entrust, stdCode);
   entrust->release();
   return ret;
 }
@@ -1474,12 +1667,12 @@ void TraderAdapter::onRspEntrust(WTSEntrust *entrust, WTSError *err) {
     // 所以这里加一个检查未完成单的逻辑
     // 如果有错单，正常情况下未完成单一定不为0
     // 如果未完成订单为0，则说明这一次是重复通知，则不再处理了
-    double oldQty = _undone_qty[stdCode];
-    if (decimal::eq(oldQty, 0))
+    CodeSlot *slot = getSlot(stdCode.c_str());
+    if (decimal::eq(slot->_undone, 0))
       return;
 
     bool isBuy = (isLong && isOpen) || (!isLong && !isOpen);
-    updateUndone(stdCode.c_str(), qty * (isBuy ? -1 : 1), true);
+    updateUndone(slot, qty * (isBuy ? -1 : 1), true);
 
     if (strlen(entrust->getUserTag()) > 0) {
       char *userTag = (char *)entrust->getUserTag();
@@ -1554,7 +1747,7 @@ void TraderAdapter::onRspPosition(const WTSArray *ayPositions) {
       else
         stdCode = CodeHelper::rawFlatCodeToStdCode(
             cInfo->getCode(), cInfo->getExchg(), cInfo->getProduct());
-      PosItem &pos = _positions[stdCode];
+      PosItem &pos = getSlot(stdCode.c_str())->_pos;
       if (pItem->getDirection() == WDT_LONG) {
         pos.l_newavail = pItem->getAvailNewPos();
         pos.l_newvol = pItem->getNewPosition();
@@ -1568,9 +1761,11 @@ void TraderAdapter::onRspPosition(const WTSArray *ayPositions) {
       }
     }
 
-    for (auto it = _positions.begin(); it != _positions.end(); it++) {
-      const char *stdCode = it->first.c_str();
-      const PosItem &pItem = it->second;
+    std::vector<CodeSlot *> slots;
+    getAllSlots(slots);
+    for (CodeSlot *slot : slots) {
+      const char *stdCode = slot->_code.c_str();
+      const PosItem &pItem = slot->_pos;
       printPosition(stdCode, pItem);
       for (auto sink : _sinks) {
         sink->on_position(stdCode, true, pItem.l_prevol, pItem.l_preavail,
@@ -1596,7 +1791,11 @@ void TraderAdapter::onRspOrders(const WTSArray *ayOrders) {
     if (_orders == NULL)
       _orders = OrderMap::create();
 
-    _undone_qty.clear();
+    // 未完成数量以查询结果为准,先全部清零
+    std::vector<CodeSlot *> slots;
+    getAllSlots(slots);
+    for (CodeSlot *slot : slots)
+      slot->_undone = 0;
 
     for (auto it = ayOrders->begin(); it != ayOrders->end(); it++) {
       WTSOrderInfo *orderInfo = (WTSOrderInfo *)(*it);
@@ -1627,13 +1826,8 @@ void TraderAdapter::onRspOrders(const WTSArray *ayOrders) {
 
       _orderids.insert(orderInfo->getOrderID());
 
-      WTSTradeStateInfo *statInfo =
-          (WTSTradeStateInfo *)_stat_map->get(stdCode.c_str());
-      if (statInfo == NULL) {
-        statInfo = WTSTradeStateInfo::create(stdCode.c_str());
-        _stat_map->add(stdCode, statInfo, false);
-      }
-      TradeStatInfo &statItem = statInfo->statInfo();
+      CodeSlot *slot = getSlot(stdCode.c_str());
+      TradeStatInfo &statItem = slot->_stat->statInfo();
       if (isBuy) {
         statItem.b_orders++;
         statItem.b_ordqty += orderInfo->getVolume();
@@ -1690,19 +1884,20 @@ void TraderAdapter::onRspOrders(const WTSArray *ayOrders) {
       {
         SpinLock lock(_mtx_orders);
         _orders->add(localid, orderInfo);
+        slot->_orders->add(localid, orderInfo);
       }
 
-      double &curQty = _undone_qty[stdCode];
-      curQty += orderInfo->getVolLeft() * (isBuy ? 1 : -1);
+      slot->_undone += orderInfo->getVolLeft() * (isBuy ? 1 : -1);
     }
 
-    for (auto it = _undone_qty.begin(); it != _undone_qty.end(); it++) {
-      const char *stdCode = it->first.c_str();
-      const double &curQty = _undone_qty[stdCode];
+    getAllSlots(slots);
+    for (CodeSlot *slot : slots) {
+      if (decimal::eq(slot->_undone, 0))
+        continue;
 
       WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO,
-                         "[{}]{} undone quantity {}", _id.c_str(), stdCode,
-                         curQty);
+                         "[{}]{} undone quantity {}", _id.c_str(),
+                         slot->_code.c_str(), slot->_undone);
     }
   }
 
@@ -1747,13 +1942,8 @@ void TraderAdapter::onRspTrades(const WTSArray *ayTrades) {
         stdCode = CodeHelper::rawFlatCodeToStdCode(
             cInfo->getCode(), cInfo->getExchg(), commInfo->getProduct());
 
-      WTSTradeStateInfo *statInfo =
-          (WTSTradeStateInfo *)_stat_map->get(stdCode.c_str());
-      if (statInfo == NULL) {
-        statInfo = WTSTradeStateInfo::create(stdCode.c_str());
-        _stat_map->add(stdCode, statInfo, false);
-      }
-      TradeStatInfo &statItem = statInfo->statInfo();
+      CodeSlot *slot = getSlot(stdCode.c_str());
+      TradeStatInfo &statItem = slot->_stat->statInfo();
 
       bool isLong = (tInfo->getDirection() == WDT_LONG);
       bool isOpen = (tInfo->getOffsetType() == WOT_OPEN);
@@ -1821,7 +2011,7 @@ bool TraderAdapter::checkSelfMatch(const char *stdCode, WTSTradeInfo *tInfo) {
                          "[{0}] Self matching detected on {1}!!! Instructions "
                          "on {1} will be forbidden!!!",
                          _id.c_str(), stdCode);
-      _self_matches.insert(stdCode);
+      getSlot(stdCode)->_self_matched = true;
       return true;
     } else {
       // 关联订单一样，说明是重复推送，不用管了
@@ -1877,15 +2067,11 @@ void TraderAdapter::onPushOrder(WTSOrderInfo *orderInfo) {
                (orderInfo->getDirection() == WDT_SHORT &&
                 orderInfo->getOffsetType() != WOT_OPEN);
 
+  CodeSlot *slot = getSlot(stdCode.c_str());
+
   // 撤销的话, 要更新统计数据
   if (orderInfo->getOrderState() == WOS_Canceled) {
-    WTSTradeStateInfo *statInfo =
-        (WTSTradeStateInfo *)_stat_map->get(stdCode.c_str());
-    if (statInfo == NULL) {
-      statInfo = WTSTradeStateInfo::create(stdCode.c_str());
-      _stat_map->add(stdCode, statInfo, false);
-    }
-    TradeStatInfo &statItem = statInfo->statInfo();
+    TradeStatInfo &statItem = slot->_stat->statInfo();
     if (isBuy) {
       if (orderInfo->isError()) // 错单要和撤单区分开
       {
@@ -1939,13 +2125,7 @@ void TraderAdapter::onPushOrder(WTSOrderInfo *orderInfo) {
       // 先把订单号缓存起来, 防止重复处理
       _orderids.insert(orderInfo->getOrderID());
 
-      WTSTradeStateInfo *statInfo =
-          (WTSTradeStateInfo *)_stat_map->get(stdCode.c_str());
-      if (statInfo == NULL) {
-        statInfo = WTSTradeStateInfo::create(stdCode.c_str());
-        _stat_map->add(stdCode, statInfo, false);
-      }
-      TradeStatInfo &statItem = statInfo->statInfo();
+      TradeStatInfo &statItem = slot->_stat->statInfo();
       if (isBuy) {
         statItem.b_orders++;
         statItem.b_ordqty += orderInfo->getVolume();
@@ -1961,7 +2141,7 @@ void TraderAdapter::onPushOrder(WTSOrderInfo *orderInfo) {
         bool isToday = (orderInfo->getOffsetType() == WOT_CLOSETODAY);
         double qty = orderInfo->getVolume();
 
-        PosItem &pItem = _positions[stdCode];
+        PosItem &pItem = slot->_pos;
         if (isLong) // 平多
         {
           if (isToday) {
@@ -2011,7 +2191,7 @@ void TraderAdapter::onPushOrder(WTSOrderInfo *orderInfo) {
       bool isToday = (orderInfo->getOffsetType() == WOT_CLOSETODAY);
       double qty = orderInfo->getVolume() - orderInfo->getVolTraded();
 
-      PosItem &pItem = _positions[stdCode];
+      PosItem &pItem = slot->_pos;
       if (isLong) // 平多
       {
         if (isToday) {
@@ -2058,7 +2238,7 @@ void TraderAdapter::onPushOrder(WTSOrderInfo *orderInfo) {
 
       bool isBuy = (isLong && isOpen) || (!isLong && !isOpen);
 
-      updateUndone(stdCode.c_str(), qty * (isBuy ? -1 : 1), true);
+      updateUndone(slot, qty * (isBuy ? -1 : 1), true);
 
       WTSLogger::log_dyn(
           "trader", _id.c_str(), LL_INFO,
@@ -2076,11 +2256,13 @@ void TraderAdapter::onPushOrder(WTSOrderInfo *orderInfo) {
       SpinLock lock(_mtx_orders);
       if (!orderInfo->isAlive() && _orders) {
         _orders->remove(localid);
+        slot->_orders->remove(localid);
       } else {
         if (_orders == NULL)
           _orders = OrderMap::create();
 
         _orders->add(localid, orderInfo);
+        slot->_orders->add(localid, orderInfo);
       }
     }
 
@@ -2134,15 +2316,9 @@ void TraderAdapter::onPushTrade(WTSTradeInfo *tradeRecord) {
                      _id.c_str(), stdCode.c_str(), tradeRecord->getUserTag(),
                      tradeRecord->getVolume(), tradeRecord->getPrice());
 
-  PosItem &pItem = _positions[stdCode];
-  WTSTradeStateInfo *statInfo =
-      (WTSTradeStateInfo *)_stat_map->get(stdCode.c_str());
-  if (statInfo == NULL) {
-    statInfo = WTSTradeStateInfo::create(stdCode.c_str());
-    _stat_map->add(stdCode, statInfo, false);
-  }
-
-  TradeStatInfo &statItem = statInfo->statInfo();
+  CodeSlot *slot = getSlot(stdCode.c_str());
+  PosItem &pItem = slot->_pos;
+  TradeStatInfo &statItem = slot->_stat->statInfo();
   double vol = tradeRecord->getVolume();
   if (isLong) {
     if (isOpen) {
@@ -2197,7 +2373,7 @@ void TraderAdapter::onPushTrade(WTSTradeInfo *tradeRecord) {
     userTag += _order_pattern.size() + 1;
     localid = strtoul(userTag, NULL, 10);
 
-    updateUndone(stdCode.c_str(), vol * (isBuy ? -1 : 1), true);
+    updateUndone(slot, vol * (isBuy ? -1 : 1), true);
   }
 
   for (auto sink : _sinks)
@@ -2290,4 +2466,10 @@ void TraderAdapterMgr::refresh_funds() {
   for (auto it = _adapters.begin(); it != _adapters.end(); it++) {
     it->second->queryFund();
   }
+}
+
+void TraderAdapterMgr::update_price(const char *stdCode, double price) {
+  for (auto it = _adapters.begin(); it != _adapters.end(); it++) {
+    it->second->updatePrice(stdCode, price);
+  }
 }
\ No newline at end of file
@@ -24,8 +24,10 @@ class WTSContractInfo;
 class WTSCommodityInfo;
 class WtLocalExecuter;
 class EventNotifier;
+class WTSTradeStateInfo;
 
 class ITrdNotifySink;
+class ExecNetting;
 
 typedef std::function<void(const char *, bool, double, double, double, double)>
     FuncEnumChnlPosCallBack;
@@ -77,6 +79,19 @@ public:
 
   } PosItem;
 
+  /*
+   *	事前风控规则,按位组合
+   *	配置在加载的时候编译成规则掩码,下单时只检查掩码里打开的规则
+   */
+  typedef enum tagRiskRule {
+    RR_OrderQty = 0x01,   // 单笔最大委托数量
+    RR_Notional = 0x02,   // 单笔最大委托金额
+    RR_PriceBand = 0x04,  // 委托价偏离最新价的最大比例
+    RR_OrderRate = 0x08,  // 下单频率和总笔数
+    RR_SelfMatch = 0x10,  // 自成交以后禁止交易
+    RR_NeedPrice = RR_Notional | RR_PriceBand
+  } RiskRule;
+
   typedef struct _RiskParams {
     uint32_t _order_times_boundary;
     uint32_t _order_stat_timespan;
@@ -86,9 +101,87 @@ public:
     uint32_t _cancel_stat_timespan;
     uint32_t _cancel_total_limits;
 
+    double _max_order_qty;      // 单笔最大委托数量
+    double _max_order_notional; // 单笔最大委托金额
+    double _price_band;         // 偏离最新价的最大比例
+
+    uint32_t _rules; // 规则掩码
+
     _RiskParams() { memset(this, 0, sizeof(_RiskParams)); }
   } RiskParams;
 
+  /*
+   *	定长的时间窗口,环形保存最近若干次操作的时间
+   *	容量在合约槽位创建的时候按风控参数确定,之后不再增长
+   */
+  typedef struct _TimeWindow {
+    std::vector<uint64_t> _stamps;
+    uint32_t _head; // 下一次写入的位置
+    uint32_t _count;
+
+    _TimeWindow() : _head(0), _count(0) {}
+
+    void reset(uint32_t capacity) {
+      _stamps.assign(capacity, 0);
+      _head = 0;
+      _count = 0;
+    }
+
+    inline void push(uint64_t stamp) {
+      if (_stamps.empty())
+        return;
+
+      _stamps[_head] = stamp;
+      _head = (_head + 1) % _stamps.size();
+      if (_count < _stamps.size())
+        _count++;
+    }
+
+    inline bool full() const {
+      return !_stamps.empty() && _count == _stamps.size();
+    }
+
+    /*
+     *	最早一次和最近一次的时间间隔,单位毫秒
+     */
+    inline uint64_t span() const {
+      if (_count == 0)
+        return 0;
+
+      uint32_t cap = (uint32_t)_stamps.size();
+      uint32_t newest = (_head + cap - 1) % cap;
+      uint32_t oldest = (_count < cap) ? 0 : _head;
+      return _stamps[newest] - _stamps[oldest];
+    }
+  } TimeWindow;
+
+  /*
+   *	合约槽位,一个合约的持仓、未完成数量、风控状态和活动订单都放在一起
+   *	槽位创建以后不会释放,回调和下单撤单只需要查找一次
+   */
+  typedef struct _CodeSlot {
+    std::string _code;
+    PosItem _pos;
+    double _undone; // 未完成数量
+
+    WTSTradeStateInfo *_stat; // 统计数据,由_stat_map持有
+    const RiskParams *_risk;  // 流量风控参数,没有配置则为NULL
+
+    uint32_t _rules;    // 事前风控规则掩码
+    double _last_price; // 最新价,价格类规则使用
+    bool _excluded;     // 被风控了,进入排除队列
+    bool _self_matched; // 发生了自成交
+
+    TimeWindow _order_times;  // 下单时间窗口
+    TimeWindow _cancel_times; // 撤单时间窗口
+
+    OrderMap *_orders; // 该合约的活动订单
+
+    _CodeSlot()
+        : _undone(0), _stat(NULL), _risk(NULL), _rules(0), _last_price(0),
+          _excluded(false), _self_matched(false), _orders(NULL) {}
+  } CodeSlot;
+
 public:
   bool init(const char *id, WTSVariant *params, IBaseDataMgr *bdMgr,
             ActionPolicyMgr *policyMgr);
@@ -105,14 +198,39 @@ public:
 
   void addSink(ITrdNotifySink *sink) { _sinks.insert(sink); }
 
+  /*
+   *	执行器轧差模块,没有开启的时候返回NULL
+   */
+  inline ExecNetting *netting() { return _netting; }
+
   inline bool isReady() const { return _state == AS_ALLREADY; }
 
   void queryFund();
 
 private:
-  uint32_t doEntrust(WTSEntrust *entrust);
+  uint32_t doEntrust(WTSEntrust *entrust, const char *stdCode);
   bool doCancel(WTSOrderInfo *ordInfo);
 
+  /*
+   *	按标准代码查找合约槽位,bCreate为true时没有则创建
+   */
+  CodeSlot *getSlot(const char *stdCode, bool bCreate = true);
+
+  inline void getAllSlots(std::vector<CodeSlot *> &slots) {
+    SpinLock lock(_mtx_slots);
+    slots = _slots;
+  }
+
+  bool checkCancelLimits(CodeSlot *slot);
+  bool checkOrderLimits(CodeSlot *slot);
+
+  /*
+   *	事前风控检查,每一笔委托发出之前调用
+   *	按槽位上的规则掩码依次检查,没有规则的合约直接返回
+   */
+  bool checkEntrust(CodeSlot *slot, WTSEntrust *entrust,
+                    WTSContractInfo *cInfo);
+
   inline void printPosition(const char *stdCode, const PosItem &pItem);
 
   inline WTSContractInfo *getContract(const char *stdCode);
@@ -129,17 +247,14 @@ private:
 
   void saveData(WTSArray *ayFunds = NULL);
 
-  inline void updateUndone(const char *stdCode, double qty, bool bOuput = true);
+  inline void updateUndone(CodeSlot *slot, double qty, bool bOuput = true);
 
 public:
   double getPosition(const char *stdCode, bool bValidOnly, int32_t flag = 3);
   OrderMap *getOrders(const char *stdCode);
   double getUndoneQty(const char *stdCode) {
-    auto it = _undone_qty.find(stdCode);
-    if (it != _undone_qty.end())
-      return it->second;
-
-    return 0;
+    CodeSlot *slot = getSlot(stdCode, false);
+    return (slot == NULL) ? 0 : slot->_undone;
   }
 
   void enumPosition(FuncEnumChnlPosCallBack cb);
@@ -160,20 +275,25 @@ public:
   bool cancel(uint32_t localid);
   OrderIDs cancel(const char *stdCode, bool isBuy, double qty = 0);
 
-  inline bool isTradeEnabled(const char *stdCode) const;
+  inline bool isTradeEnabled(const char *stdCode);
 
   bool checkCancelLimits(const char *stdCode);
   bool checkOrderLimits(const char *stdCode);
 
   bool checkSelfMatch(const char *stdCode, WTSTradeInfo *tInfo);
 
+  /*
+   *	更新最新价,只有配置了价格类规则才会记录
+   */
+  void updatePrice(const char *stdCode, double price);
+
   inline bool isSelfMatched(const char *stdCode) {
     // 如果忽略自成交，则直接返回false
     if (_ignore_sefmatch)
       return false;
 
-    auto it = _self_matches.find(stdCode);
-    return it != _self_matches.end();
+    CodeSlot *slot = getSlot(stdCode, false);
+    return (slot != NULL) && slot->_self_matched;
   }
 
 public:
@@ -220,19 +340,22 @@ private:
   EventNotifier *_notifier;
 
   wt_hashset<ITrdNotifySink *> _sinks;
+  ExecNetting *_netting; // 同一通道下多个执行器的轧差
 
   IBaseDataMgr *_bd_mgr;
   ActionPolicyMgr *_policy_mgr;
 
-  wt_hashmap<std::string, PosItem> _positions;
+  // 合约槽位表,槽位按首次出现的顺序编号
+  SpinMutex _mtx_slots;
+  std::vector<CodeSlot *> _slots;
+  wt_hashmap<std::string, uint32_t> _slot_ids;
 
   SpinMutex _mtx_orders;
   OrderMap *_orders;
   wt_hashset<std::string> _orderids; // 主要用于标记有没有处理过该订单
 
   wt_hashmap<std::string, std::string>
-      _trade_refs;                       // 用于记录成交单和订单的匹配
-  wt_hashset<std::string> _self_matches; // 自成交的合约
+      _trade_refs; // 用于记录成交单和订单的匹配
 
   /*
    *	By Wesley @ 2023.03.16
@@ -240,23 +363,13 @@ private:
    */
   bool _ignore_sefmatch; // 忽略自成交限制
 
-  wt_hashmap<std::string, double> _undone_qty; // 未完成数量
-
   typedef WTSHashMap<std::string> TradeStatMap;
   TradeStatMap *_stat_map; // 统计数据
 
-  // 这两个缓存时间内的容器,主要是为了控制瞬间流量而设置的
-  typedef std::vector<uint64_t> TimeCacheList;
-  typedef wt_hashmap<std::string, TimeCacheList> CodeTimeCacheMap;
-  CodeTimeCacheMap _order_time_cache;  // 下单时间缓存
-  CodeTimeCacheMap _cancel_time_cache; // 撤单时间缓存
-
-  // 如果被风控了,就会进入到排除队列
-  wt_hashset<std::string> _exclude_codes;
-
   typedef wt_hashmap<std::string, RiskParams> RiskParamsMap;
   RiskParamsMap _risk_params_map;
   bool _risk_mon_enabled;
+  bool _need_price; // 有价格类规则,需要接收最新价
 
   bool _save_data;           // 是否保存交易日志
   BoostFilePtr _trades_log;  // 交易数据日志
@@ -283,6 +396,8 @@ public:
 
   void refresh_funds();
 
+  void update_price(const char *stdCode, double price);
+
 private:
   TraderAdapterMap _adapters;
 };
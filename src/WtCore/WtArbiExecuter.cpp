@@ -8,6 +8,7 @@
  * \brief
  */
 #include "WtArbiExecuter.h"
+#include "ExecTargetHelper.h"
 #include "TraderAdapter.h"
 #include "WtEngine.h"
 
@@ -48,6 +49,11 @@ bool WtArbiExecuter::init(WTSVariant *params) {
   _scale = params->getDouble("scale");
   _strict_sync = params->getBoolean("strict_sync");
 
+  // 套利执行单元按整个账户的持仓执行,算不出本执行器自己的待执行量,不能参与轧差
+  if (params->getBoolean("netting"))
+    WTSLogger::log_dyn("executer", _name.c_str(), LL_WARN,
+                       "Netting is not supported by arbi executers, ignored");
+
   uint32_t poolsize = params->getUInt32("poolsize");
   if (poolsize > 0) {
     _pool.reset(new boost::threadpool::pool(poolsize));
@@ -313,31 +319,10 @@ void WtArbiExecuter::set_position(
 
     double oldVol = _target_pos[stdCode];
     _target_pos[stdCode] = newVol;
-    // 账户的理论持仓要经过修正
-    double traderTarget = round(newVol * _scale);
-
-    if (!decimal::eq(oldVol, newVol)) {
-      WTSLogger::log_dyn(
-          "executer", _name.c_str(), LL_INFO,
-          "Target position of {} changed: {} -> {} : {} with scale{}", stdCode,
-          oldVol, newVol, traderTarget, _scale);
-    }
-
-    if (_trader && !_trader->checkOrderLimits(stdCode)) {
-      WTSLogger::log_dyn("executer", _name.c_str(), LL_WARN,
-                         "{} is disabled due to entrust limit control ",
-                         stdCode);
-      continue;
-    }
-
-    if (_pool) {
-      std::string code = stdCode;
-      _pool->schedule([unit, code, traderTarget]() {
-        unit->self()->set_position(code.c_str(), traderTarget);
-      });
-    } else {
-      unit->self()->set_position(stdCode, traderTarget);
-    }
+    // 被风控拦下的合约没有下达,下次提交还要走全量
+    if (!ExecTargetHelper::dispatch(_name.c_str(), _trader, _pool, unit,
+                                    stdCode, oldVol, newVol, _scale))
+      require_full_sync();
   }
 
   // 在原来的目标头寸中，但是不在新的目标头寸中，则需要自动设置为0
@@ -393,6 +378,24 @@ void WtArbiExecuter::set_position(
   }
 }
 
+bool WtArbiExecuter::update_targets(ExecTargetItem *items, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    ExecTargetItem &item = items[i];
+    ExecuteUnitPtr unit = getUnit(item._code);
+    if (unit == NULL)
+      continue;
+
+    double &curVol = _target_pos[item._code];
+    double oldVol = curVol;
+    curVol = item._target;
+    item._applied = ExecTargetHelper::dispatch(_name.c_str(), _trader, _pool,
+                                               unit, item._code, oldVol,
+                                               item._target, _scale);
+  }
+
+  return true;
+}
+
 void WtArbiExecuter::on_tick(const char *stdCode, WTSTickData *newTick) {
   ExecuteUnitPtr unit = getUnit(stdCode, false);
   if (unit == NULL)
@@ -467,6 +470,8 @@ void WtArbiExecuter::on_entrust(uint32_t localid, const char *stdCode,
 
 void WtArbiExecuter::on_channel_ready() {
   _channel_ready = true;
+  // 通道重连以后执行单元的状态重置了,下次提交目标仓位走全量
+  require_full_sync();
   SpinLock lock(_mtx_units);
   for (auto it = _unit_map.begin(); it != _unit_map.end(); it++) {
     ExecuteUnitPtr &unitPtr = (ExecuteUnitPtr &)it->second;
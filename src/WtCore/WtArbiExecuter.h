@@ -75,6 +75,11 @@ public:
   virtual void
   set_position(const wt_hashmap<std::string, double> &targets) override;
 
+  /*
+   *	批量更新有变化的目标仓位
+   */
+  virtual bool update_targets(ExecTargetItem *items, uint32_t count) override;
+
   /*
    *	合约仓位变动
    */
@@ -198,6 +198,8 @@ void WtCtaEngine::on_init() {
 
 void WtCtaEngine::on_session_begin() {
   WTSLogger::info("Trading day {} begun", _cur_tdate);
+  _exec_mgr.clear_committed_targets();
+
   for (auto it = _ctx_map.begin(); it != _ctx_map.end(); it++) {
     CtaContextPtr &ctx = (CtaContextPtr &)it->second;
     ctx->on_session_begin(_cur_tdate);
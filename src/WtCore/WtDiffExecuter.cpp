@@ -30,9 +30,14 @@ USING_NS_WTP;
 WtDiffExecuter::WtDiffExecuter(WtExecuterFactory *factory, const char *name,
                                IDataManager *dataMgr, IBaseDataMgr *bdMgr)
     : IExecCommand(name), _factory(factory), _data_mgr(dataMgr),
-      _channel_ready(false), _scale(1.0), _trader(NULL), _bd_mgr(bdMgr) {}
+      _channel_ready(false), _scale(1.0), _trader(NULL), _bd_mgr(bdMgr),
+      _use_netting(false), _netting(NULL), _own_tdate(0),
+      _inserting(0) {}
 
 WtDiffExecuter::~WtDiffExecuter() {
+  if (_netting)
+    _netting->removeMember(this);
+
   if (_pool)
     _pool->wait();
 }
@@ -42,6 +47,14 @@ void WtDiffExecuter::setTrader(TraderAdapter *adapter) {
   // 设置的时候读取一下trader的状态
   if (_trader)
     _channel_ready = _trader->isReady();
+
+  if (_trader && _use_netting) {
+    _netting = _trader->netting();
+    if (_netting == NULL)
+      WTSLogger::log_dyn("executer", _name.c_str(), LL_WARN,
+                         "[{}] Netting of trader {} not activated", _name,
+                         _trader->id());
+  }
 }
 
 bool WtDiffExecuter::init(WTSVariant *params) {
@@ -52,6 +65,7 @@ bool WtDiffExecuter::init(WTSVariant *params) {
   _config->retain();
 
   _scale = params->getDouble("scale");
+  _use_netting = params->getBoolean("netting");
 
   uint32_t poolsize = params->getUInt32("poolsize");
   if (poolsize > 0) {
@@ -62,8 +76,8 @@ bool WtDiffExecuter::init(WTSVariant *params) {
 
   WTSLogger::log_dyn(
       "executer", _name.c_str(), LL_INFO,
-      "[{}] Diff executer inited, scale: {}, thread poolsize: {}", _name,
-      _scale, poolsize);
+      "[{}] Diff executer inited, scale: {}, thread poolsize: {}, netting: {}",
+      _name, _scale, poolsize, _use_netting);
 
   return true;
 }
@@ -124,6 +138,7 @@ void WtDiffExecuter::load_data() {
 }
 
 void WtDiffExecuter::save_data() {
+  StdLocker<StdRecurMutex> lock(_mtx_diff);
   std::string filename = WtHelper::getExecDataDir();
   filename += _name + ".json";
 
@@ -173,6 +188,142 @@ void WtDiffExecuter::save_data() {
   }
 }
 
+double WtDiffExecuter::net_diff(const char *stdCode, double thisDiff) {
+  if (_netting == NULL)
+    return thisDiff;
+
+  double crossed = _netting->cross(this, stdCode, thisDiff);
+  if (decimal::eq(crossed, 0))
+    return thisDiff;
+
+  StdLocker<StdRecurMutex> lock(_mtx_diff);
+  double &curDiff = _diff_pos[stdCode];
+  double prevDiff = curDiff;
+  curDiff -= crossed;
+  WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
+                     "[{}] {} of {} netted with other executers, diff postion "
+                     "changed: {} -> {}",
+                     _name, crossed, stdCode, prevDiff, curDiff);
+  return curDiff;
+}
+
+bool WtDiffExecuter::on_own_trade(uint32_t localid, const char *stdCode,
+                                  bool isBuy, double vol) {
+  SpinLock lock(_mtx_ids);
+  auto it = _own_ids.find(localid);
+  if (it == _own_ids.end()) {
+    // 还在下单,可能是自己的订单号还没登记,先缓存等下单返回以后认领
+    if (_inserting > 0)
+      _early_trades.emplace_back(EarlyTrade{localid, stdCode, isBuy, vol});
+    return false;
+  }
+
+  // 成交回报可能在订单终结的回报之后才到,成交收齐了再清掉
+  OwnOrder &order = it->second;
+  order._traded += vol;
+  if (order._expected >= 0 && !decimal::lt(order._traded, order._expected))
+    _own_ids.erase(it);
+  return true;
+}
+
+void WtDiffExecuter::on_own_order(uint32_t localid, double totalQty,
+                                  double leftQty) {
+  SpinLock lock(_mtx_ids);
+  auto it = _own_ids.find(localid);
+  if (it == _own_ids.end()) {
+    if (_inserting > 0)
+      _early_done[localid] = totalQty - leftQty;
+    return;
+  }
+
+  OwnOrder &order = it->second;
+  order._expected = totalQty - leftQty;
+  if (!decimal::lt(order._traded, order._expected))
+    _own_ids.erase(it);
+}
+
+void WtDiffExecuter::begin_own_orders() {
+  if (_netting == NULL)
+    return;
+
+  SpinLock lock(_mtx_ids);
+  _inserting++;
+}
+
+void WtDiffExecuter::add_own_orders(const OrderIDs &ids) {
+  if (_netting == NULL)
+    return;
+
+  std::vector<EarlyTrade> claimed;
+  uint32_t tDate = (_stub != NULL) ? _stub->get_trading_day() : 0;
+  {
+    SpinLock lock(_mtx_ids);
+    // 换了交易日,之前的订单不会再有回报了
+    if (tDate != _own_tdate) {
+      _own_ids.clear();
+      _own_tdate = tDate;
+    }
+
+    for (uint32_t localid : ids) {
+      OwnOrder order{0, -1};
+      auto dit = _early_done.find(localid);
+      if (dit != _early_done.end()) {
+        order._expected = dit->second;
+        _early_done.erase(dit);
+      }
+
+      for (auto it = _early_trades.begin(); it != _early_trades.end();) {
+        if (it->_localid == localid) {
+          order._traded += it->_vol;
+          claimed.emplace_back(std::move(*it));
+          it = _early_trades.erase(it);
+        } else {
+          it++;
+        }
+      }
+
+      if (order._expected < 0 || decimal::lt(order._traded, order._expected))
+        _own_ids[localid] = order;
+    }
+
+    // 没有在下单的调用了,剩下的都是其他执行器的回报
+    _inserting--;
+    if (_inserting == 0) {
+      _early_trades.clear();
+      _early_done.clear();
+    }
+  }
+
+  // 下单返回之前到的成交,补记到差量上
+  for (const EarlyTrade &trd : claimed) {
+    WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
+                       "[{}] Trade of order {} arrived before placing "
+                       "returned, claimed later",
+                       _name, trd._localid);
+    update_diff_by_trade(trd._code.c_str(), trd._isBuy, trd._vol);
+  }
+}
+
+void WtDiffExecuter::update_diff_by_trade(const char *stdCode, bool isBuy,
+                                          double vol) {
+  double thisDiff = 0;
+  {
+    StdLocker<StdRecurMutex> lock(_mtx_diff);
+    double &curDiff = _diff_pos[stdCode];
+    double prevDiff = curDiff;
+    curDiff -= vol * (isBuy ? 1 : -1);
+    thisDiff = curDiff;
+
+    WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
+                       "[{}] Diff of {} updated by trade: {} -> {}", _name,
+                       stdCode, prevDiff, curDiff);
+    save_data();
+  }
+
+  if (_netting)
+    _netting->update(this, stdCode, thisDiff);
+}
+
 ExecuteUnitPtr WtDiffExecuter::getUnit(const char *stdCode,
                                        bool bAutoCreate /* = true */) {
   CodeHelper::CodeInfo codeInfo = CodeHelper::extractStdCode(stdCode, NULL);
@@ -257,7 +408,10 @@ OrderIDs WtDiffExecuter::buy(const char *stdCode, double price, double qty,
   if (!_channel_ready)
     return OrderIDs();
 
-  return _trader->buy(stdCode, price, qty, 0, bForceClose);
+  begin_own_orders();
+  OrderIDs ids = _trader->buy(stdCode, price, qty, 0, bForceClose);
+  add_own_orders(ids);
+  return ids;
 }
 
 OrderIDs WtDiffExecuter::sell(const char *stdCode, double price, double qty,
@@ -265,7 +419,10 @@ OrderIDs WtDiffExecuter::sell(const char *stdCode, double price, double qty,
   if (!_channel_ready)
     return OrderIDs();
 
-  return _trader->sell(stdCode, price, qty, 0, bForceClose);
+  begin_own_orders();
+  OrderIDs ids = _trader->sell(stdCode, price, qty, 0, bForceClose);
+  add_own_orders(ids);
+  return ids;
 }
 
 bool WtDiffExecuter::cancel(uint32_t localid) {
@@ -318,22 +475,29 @@ void WtDiffExecuter::on_position_changed(const char *stdCode, double diffPos) {
 
   diffPos = round(diffPos * _scale);
 
-  double oldVol = _target_pos[stdCode];
-  double &targetPos = _target_pos[stdCode];
-  targetPos += diffPos;
+  double thisDiff = 0;
+  {
+    StdLocker<StdRecurMutex> lock(_mtx_diff);
+    double oldVol = _target_pos[stdCode];
+    double &targetPos = _target_pos[stdCode];
+    targetPos += diffPos;
+
+    /*
+     *	By Sunseeeeeker @ 2023.01.10
+     *	更新差量
+     */
+    double &curDiff = _diff_pos[stdCode];
+    double prevDiff = curDiff;
+    curDiff += diffPos;
+    thisDiff = curDiff;
 
-  /*
-   *	By Sunseeeeeker @ 2023.01.10
-   *	更新差量
-   */
-  double &thisDiff = _diff_pos[stdCode];
-  double prevDiff = thisDiff;
-  thisDiff += diffPos;
+    WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
+                       "[{}] Target position of {} changed additonally: {} -> "
+                       "{}, diff postion changed: {} -> {}",
+                       _name, stdCode, oldVol, targetPos, prevDiff, thisDiff);
+  }
 
-  WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
-                     "[{}] Target position of {} changed additonally: {} -> "
-                     "{}, diff postion changed: {} -> {}",
-                     _name, stdCode, oldVol, targetPos, prevDiff, thisDiff);
+  thisDiff = net_diff(stdCode, thisDiff);
 
   if (_trader && !_trader->checkOrderLimits(stdCode)) {
     WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
@@ -362,20 +526,27 @@ void WtDiffExecuter::set_position(
       continue;
 
     newVol = round(newVol * _scale);
-    double oldVol = _target_pos[stdCode];
-    _target_pos[stdCode] = newVol;
-    if (decimal::eq(oldVol, newVol))
-      continue;
+    double thisDiff = 0;
+    {
+      StdLocker<StdRecurMutex> lock(_mtx_diff);
+      double oldVol = _target_pos[stdCode];
+      _target_pos[stdCode] = newVol;
+      if (decimal::eq(oldVol, newVol))
+        continue;
 
-    // 差量更新
-    double &thisDiff = _diff_pos[stdCode];
-    double prevDiff = thisDiff;
-    thisDiff += (newVol - oldVol);
+      // 差量更新
+      double &curDiff = _diff_pos[stdCode];
+      double prevDiff = curDiff;
+      curDiff += (newVol - oldVol);
+      thisDiff = curDiff;
 
-    WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
-                       "[{}] Target position of {} changed: {} -> {}, diff "
-                       "postion changed: {} -> {}",
-                       _name, stdCode, oldVol, newVol, prevDiff, thisDiff);
+      WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
+                         "[{}] Target position of {} changed: {} -> {}, diff "
+                         "postion changed: {} -> {}",
+                         _name, stdCode, oldVol, newVol, prevDiff, thisDiff);
+    }
+
+    thisDiff = net_diff(stdCode, thisDiff);
 
     if (_trader && !_trader->checkOrderLimits(stdCode)) {
       WTSLogger::log_dyn("executer", _name.c_str(), LL_WARN,
@@ -396,46 +567,49 @@ void WtDiffExecuter::set_position(
   }
 
   // 在原来的目标头寸中，但是不在新的目标头寸中，则需要自动设置为0
-  for (auto it = _target_pos.begin(); it != _target_pos.end(); it++) {
-    const char *stdCode = it->first.c_str();
-    double &pos = (double &)it->second;
-    auto tit = targets.find(stdCode);
-    if (tit != targets.end())
-      continue;
-
-    WTSContractInfo *cInfo = _bd_mgr->getContract(stdCode);
-    if (cInfo == NULL)
-      continue;
-
-    if (pos != 0) {
-      WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
-                         "[{}] {} is not in target, set to 0 automatically",
-                         _name, stdCode);
-
-      ExecuteUnitPtr unit = getUnit(stdCode);
-      if (unit == NULL)
+  // 先在锁里更新差量,轧差和下发放到锁外面
+  std::vector<std::pair<std::string, double>> zeroed;
+  {
+    StdLocker<StdRecurMutex> lock(_mtx_diff);
+    for (auto it = _target_pos.begin(); it != _target_pos.end(); it++) {
+      const char *stdCode = it->first.c_str();
+      double &pos = (double &)it->second;
+      auto tit = targets.find(stdCode);
+      if (tit != targets.end())
         continue;
 
-      // 更新差量
-      double &thisDiff = _diff_pos[stdCode];
-      double prevDiff = thisDiff;
+      WTSContractInfo *cInfo = _bd_mgr->getContract(stdCode);
+      if (cInfo == NULL)
+        continue;
 
-      // WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
-      // "[DiffExecuter][set_position][{}] {} is not in target, thisDiff: {},
-      // prevDiff: {}, pos: {}, new thisDiff: {}", _name, stdCode, thisDiff,
-      // prevDiff, pos, thisDiff + pos);
+      if (pos != 0) {
+        WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
+                           "[{}] {} is not in target, set to 0 automatically",
+                           _name, stdCode);
+
+        // 更新差量
+        double &thisDiff = _diff_pos[stdCode];
+        thisDiff -= -pos;
+        pos = 0;
+        zeroed.emplace_back(it->first, thisDiff);
+      }
+    }
+  }
 
-      thisDiff -= -pos;
-      pos = 0;
+  for (auto &item : zeroed) {
+    const char *stdCode = item.first.c_str();
+    ExecuteUnitPtr unit = getUnit(stdCode);
+    if (unit == NULL)
+      continue;
 
-      if (_pool) {
-        std::string code = stdCode;
-        _pool->schedule([unit, code, thisDiff]() {
-          unit->self()->set_position(code.c_str(), thisDiff);
-        });
-      } else {
-        unit->self()->set_position(stdCode, thisDiff);
-      }
+    double thisDiff = net_diff(stdCode, item.second);
+    if (_pool) {
+      std::string code = stdCode;
+      _pool->schedule([unit, code, thisDiff]() {
+        unit->self()->set_position(code.c_str(), thisDiff);
+      });
+    } else {
+      unit->self()->set_position(stdCode, thisDiff);
     }
   }
 
@@ -469,14 +643,9 @@ void WtDiffExecuter::on_trade(uint32_t localid, const char *stdCode, bool isBuy,
     return;
 
   // 如果localid不为0，则更新差量
-  double &curDiff = _diff_pos[stdCode];
-  double prevDiff = curDiff;
-  curDiff -= vol * (isBuy ? 1 : -1);
-
-  WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
-                     "[{}] Diff of {} updated by trade: {} -> {}", _name,
-                     stdCode, prevDiff, curDiff);
-  save_data();
+  // 开启轧差的时候通道上还有其他执行器，只认自己发出的订单
+  if (_netting == NULL || on_own_trade(localid, stdCode, isBuy, vol))
+    update_diff_by_trade(stdCode, isBuy, vol);
 
   if (_pool) {
     std::string code = stdCode;
@@ -491,6 +660,10 @@ void WtDiffExecuter::on_trade(uint32_t localid, const char *stdCode, bool isBuy,
 void WtDiffExecuter::on_order(uint32_t localid, const char *stdCode, bool isBuy,
                               double totalQty, double leftQty, double price,
                               bool isCanceled /* = false */) {
+  // 订单终结了,本执行器的订单记录就可以清掉了
+  if (_netting && (isCanceled || decimal::eq(leftQty, 0)))
+    on_own_order(localid, totalQty, leftQty);
+
   ExecuteUnitPtr unit = getUnit(stdCode, false);
   if (unit == NULL)
     return;
@@ -525,6 +698,8 @@ void WtDiffExecuter::on_entrust(uint32_t localid, const char *stdCode,
 
 void WtDiffExecuter::on_channel_ready() {
   _channel_ready = true;
+  // 通道重连以后执行单元的状态重置了,下次提交目标仓位走全量
+  require_full_sync();
   // SpinLock lock(_mtx_units);
   for (auto it = _unit_map.begin(); it != _unit_map.end(); it++) {
     ExecuteUnitPtr &unitPtr = (ExecuteUnitPtr &)it->second;
@@ -537,12 +712,19 @@ void WtDiffExecuter::on_channel_ready() {
     }
   }
 
-  for (auto &v : _diff_pos) {
+  std::vector<std::pair<std::string, double>> diffs;
+  {
+    StdLocker<StdRecurMutex> lock(_mtx_diff);
+    for (auto &v : _diff_pos)
+      diffs.emplace_back(v.first, v.second);
+  }
+
+  for (auto &v : diffs) {
     const char *stdCode = v.first.c_str();
     ExecuteUnitPtr unit = getUnit(stdCode);
     if (unit == NULL)
       continue;
-    double thisDiff = _diff_pos[stdCode];
+    double thisDiff = v.second;
 
     if (_pool) {
       std::string code = stdCode;
@@ -605,4 +787,38 @@ void WtDiffExecuter::on_position(const char *stdCode, bool isLong,
                                  double prevol, double preavail, double newvol,
                                  double newavail, uint32_t tradingday) {}
 
+void WtDiffExecuter::on_netted(const char *stdCode, double qty) {
+  // 在发起轧差的执行器的线程里回调,和本执行器的差量更新互斥
+  double thisDiff = 0;
+  {
+    StdLocker<StdRecurMutex> lock(_mtx_diff);
+    double &curDiff = _diff_pos[stdCode];
+    double prevDiff = curDiff;
+    curDiff -= qty;
+    thisDiff = curDiff;
+
+    WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO,
+                       "[{}] {} of {} netted by other executers, diff postion "
+                       "changed: {} -> {}",
+                       _name, qty, stdCode, prevDiff, thisDiff);
+    save_data();
+  }
+
+  ExecuteUnitPtr unit = getUnit(stdCode, false);
+  if (unit == NULL)
+    return;
+
+  if (_trader && !_trader->checkOrderLimits(stdCode))
+    return;
+
+  if (_pool) {
+    std::string code = stdCode;
+    _pool->schedule([unit, code, thisDiff]() {
+      unit->self()->set_position(code.c_str(), thisDiff);
+    });
+  } else {
+    unit->self()->set_position(stdCode, thisDiff);
+  }
+}
+
 #pragma endregion 外部接口
\ No newline at end of file
@@ -11,7 +11,9 @@
 
 #include "../Includes/ExecuteDefs.h"
 #include "../Share/SpinMutex.hpp"
+#include "../Share/StdUtils.hpp"
 #include "../Share/threadpool.hpp"
+#include "ExecNetting.h"
 #include "IExecCommand.h"
 #include "ITrdNotifySink.h"
 #include "WtExecuterFactory.h"
@@ -26,6 +28,7 @@ class IHotMgr;
 // 本地执行器
 class WtDiffExecuter : public ExecuteContext,
                        public ITrdNotifySink,
+                       public INettingSink,
                        public IExecCommand {
 public:
   WtDiffExecuter(WtExecuterFactory *factory, const char *name,
@@ -47,6 +50,27 @@ private:
   void save_data();
   void load_data();
 
+  /*
+   *	差量先和同一通道下的其他执行器轧差,返回扣掉对冲部分以后的差量
+   *	调用的时候不能持有_mtx_diff,对方的on_netted会来加它自己的锁
+   */
+  double net_diff(const char *stdCode, double thisDiff);
+
+  /*
+   *	本执行器发出的订单
+   *	开启轧差以后,只有自己订单的成交才更新差量
+   *	订单终结并且成交都收齐了以后清掉,换交易日的时候全部清掉
+   *	下单返回之前就到的回报先缓存,拿到订单号以后再认领
+   */
+  bool on_own_trade(uint32_t localid, const char *stdCode, bool isBuy,
+                    double vol);
+  void on_own_order(uint32_t localid, double totalQty, double leftQty);
+  void begin_own_orders();
+  void add_own_orders(const OrderIDs &ids);
+
+  // 按成交更新差量并通知轧差模块
+  void update_diff_by_trade(const char *stdCode, bool isBuy, double vol);
+
 public:
   //////////////////////////////////////////////////////////////////////////
   // ExecuteContext
@@ -135,6 +159,16 @@ public:
                           double closeprofit, double dynprofit, double margin,
                           double fee, double deposit, double withdraw) override;
 
+public:
+  //////////////////////////////////////////////////////////////////////////
+  // INettingSink
+  virtual const char *netting_id() override { return _name.c_str(); }
+
+  /*
+   *	差量被其他执行器对冲掉
+   */
+  virtual void on_netted(const char *stdCode, double qty) override;
+
 private:
   ExecuteUnitMap _unit_map;
   TraderAdapter *_trader;
@@ -148,9 +182,30 @@ private:
 
   SpinMutex _mtx_units;
 
+  // 保护目标仓位和差量,轧差的回调在其他执行器的线程里
+  StdRecurMutex _mtx_diff;
   wt_hashmap<std::string, double> _target_pos;
   wt_hashmap<std::string, double> _diff_pos;
 
+  bool _use_netting;     // 是否参与通道轧差
+  ExecNetting *_netting; // 通道的轧差模块,由TraderAdapter管理
+  typedef struct _OwnOrder {
+    double _traded;   // 已收到的成交数量
+    double _expected; // 订单终结时的成交数量,-1表示订单还没终结
+  } OwnOrder;
+  typedef struct _EarlyTrade {
+    uint32_t _localid;
+    std::string _code;
+    bool _isBuy;
+    double _vol;
+  } EarlyTrade;
+  SpinMutex _mtx_ids;
+  wt_hashmap<uint32_t, OwnOrder> _own_ids; // 本执行器发出的订单
+  uint32_t _own_tdate;                     // _own_ids所属的交易日
+  uint32_t _inserting;                     // 正在下单的调用数
+  std::vector<EarlyTrade> _early_trades;   // 下单期间收到的未知成交
+  wt_hashmap<uint32_t, double> _early_done; // 下单期间收到的未知订单终结
+
   typedef std::shared_ptr<boost::threadpool::pool> ThreadPoolPtr;
   ThreadPoolPtr _pool;
 };
@@ -8,6 +8,7 @@
  * \brief
  */
 #include "WtEngine.h"
+#include "TraderAdapter.h"
 #include "WtDtMgr.h"
 #include "WtHelper.h"
 
@@ -107,6 +108,10 @@ WTSSessionInfo *WtEngine::get_session_info(const char *sid,
 void WtEngine::on_tick(const char *stdCode, WTSTickData *curTick) {
   _price_map[stdCode] = curTick->price();
 
+  // 交易通道的价格类风控规则要用最新价
+  if (_adapter_mgr)
+    _adapter_mgr->update_price(stdCode, curTick->price());
+
   // 先检查是否要信号要触发
   {
     bool bTriggered = false;
@@ -263,6 +268,9 @@ void WtEngine::init(WTSVariant *cfg, IBaseDataMgr *bdMgr, WtDtMgr *dataMgr,
 
   init_outputs();
 
+  // 状态落地服务, 不配置则同步写入
+  _state_saver.init(cfg->get("persist"));
+
   WTSVariant *cfgRisk = cfg->get("riskmon");
   if (cfgRisk) {
     init_riskmon(cfgRisk);
@@ -415,14 +423,7 @@ void WtEngine::save_datas() {
     std::string filename = WtHelper::getPortifolioDir();
     filename += "datas.json";
 
-    BoostFile bf;
-    if (bf.create_new_file(filename.c_str())) {
-      rj::StringBuffer sb;
-      rj::PrettyWriter<rj::StringBuffer> writer(sb);
-      root.Accept(writer);
-      bf.write_file(sb.GetString());
-      bf.close_file();
-    }
+    _state_saver.save(filename.c_str(), WtStateSaver::json_serializer(root));
   }
 }
 
@@ -14,6 +14,7 @@
 
 #include "ParserAdapter.h"
 #include "WtFilterMgr.h"
+#include "WtStateSaver.h"
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/RiskMonDefs.h"
@@ -89,6 +90,11 @@ public:
   inline uint32_t get_secs() { return _cur_secs; }
   inline uint32_t get_trading_date() { return _cur_tdate; }
 
+  /*
+   *	状态落地服务
+   */
+  inline WtStateSaver &get_state_saver() { return _state_saver; }
+
   inline IBaseDataMgr *get_basedata_mgr() { return _base_data_mgr; }
   inline IHotMgr *get_hot_mgr() { return _hot_mgr; }
   WTSSessionInfo *get_session_info(const char *sid, bool isCode = false);
@@ -297,6 +303,9 @@ protected:
   StdCondVariable _cond_task;
   bool _terminated;
 
+  // 组合和策略状态的落地服务
+  WtStateSaver _state_saver;
+
   typedef struct _RiskMonFactInfo {
     std::string _module_path;
     DllHandle _module_inst;
@@ -55,6 +55,9 @@ void WtExecuterMgr::set_positions(wt_hashmap<std::string, double> target_pos) {
       continue;
     }
     executer->set_position(target_pos);
+
+    // 全量设置以后,下次提交缓存仓位时也要全量提交
+    _committed_targets.erase(executer->name());
   }
 }
 
@@ -92,10 +95,18 @@ void WtExecuterMgr::handle_pos_change(const char *stdCode, double targetPos,
     }
 
     auto it = _routed_executers.find(executer->name());
-    if (it == _routed_executers.end() && strcmp(execid, "ALL") == 0)
-      executer->on_position_changed(stdCode, diffPos);
-    else if (strcmp(executer->name(), execid) == 0)
-      executer->on_position_changed(stdCode, diffPos);
+    bool bMatched =
+        (it == _routed_executers.end() && strcmp(execid, "ALL") == 0) ||
+        strcmp(executer->name(), execid) == 0;
+    if (!bMatched)
+      continue;
+
+    executer->on_position_changed(stdCode, diffPos);
+
+    // 同步更新已提交的目标仓位,否则下次增量提交会算错
+    auto cit = _committed_targets.find(executer->name());
+    if (cit != _committed_targets.end())
+      cit->second[stdCode] += diffPos;
   }
 }
 
@@ -184,7 +195,65 @@ void WtExecuterMgr::commit_cached_targets(double scale /* = 1.0 */) {
     if (it == _all_cached_targets.end())
       continue;
 
-    executer->set_position(it->second);
+    // 执行器状态重置过,已提交的目标仓位不再可信
+    if (executer->check_full_sync())
+      _committed_targets.erase(executer->name());
+
+    const TargetsMap &targets = it->second;
+    auto cit = _committed_targets.find(executer->name());
+    if (cit == _committed_targets.end()) {
+      // 第一次提交走全量,保留执行器原有的全量同步逻辑
+      executer->set_position(targets);
+      _committed_targets[executer->name()] = targets;
+      continue;
+    }
+
+    // 只把有变化的合约打包提交给执行器
+    // 代码指针只指向targets和_removed_codes,
+    // committed在更新的时候会挪动,指向它的指针会失效
+    TargetsMap &committed = cit->second;
+    _delta_buf.clear();
+    _removed_codes.clear();
+    for (auto &item : targets) {
+      auto pit = committed.find(item.first);
+      if (pit == committed.end() || !decimal::eq(pit->second, item.second))
+        _delta_buf.emplace_back(
+            ExecTargetItem{item.first.c_str(), item.second, true});
+    }
+
+    // 本次不再出现的合约,目标仓位置为0
+    for (auto &item : committed) {
+      if (targets.find(item.first) == targets.end())
+        _removed_codes.emplace_back(item.first);
+    }
+
+    for (const std::string &stdCode : _removed_codes) {
+      if (!decimal::eq(committed[stdCode], 0))
+        _delta_buf.emplace_back(ExecTargetItem{stdCode.c_str(), 0, true});
+    }
+
+    if (!_delta_buf.empty()) {
+      if (!executer->update_targets(_delta_buf.data(),
+                                    (uint32_t)_delta_buf.size())) {
+        // 全量下达,被风控拦下的合约由执行器要求下次再走全量
+        executer->set_position(targets);
+        committed = targets;
+        continue;
+      }
+
+      // 只记下已经下达的合约,被风控拦下的保持原值,下次提交还会再发
+      for (const ExecTargetItem &item : _delta_buf) {
+        if (item._applied)
+          committed[item._code] = item._target;
+      }
+    }
+
+    // 不再出现的合约归零以后就不用再记了
+    for (const std::string &stdCode : _removed_codes) {
+      auto pit = committed.find(stdCode);
+      if (pit != committed.end() && decimal::eq(pit->second, 0))
+        committed.erase(pit);
+    }
   }
 
   // 提交完了以后，清理掉全部缓存的目标仓位
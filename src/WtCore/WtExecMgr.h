@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "WtLocalExecuter.h"
 #include <functional>
+#include <vector>
 
 NS_WTP_BEGIN
 class WtFilterMgr;
@@ -52,6 +53,12 @@ public:
    */
   inline void clear_cached_targets() { _all_cached_targets.clear(); }
 
+  /*
+   *	清除已提交的目标仓位,新交易日开始的时候调用
+   *	之后每个执行器的第一次提交都走全量
+   */
+  inline void clear_committed_targets() { _committed_targets.clear(); }
+
   /*
    *	将目标仓位加入缓存
    *	@stdCode	合约代码
@@ -75,6 +82,12 @@ private:
   typedef wt_hashmap<std::string, double> TargetsMap;
   wt_hashmap<std::string, TargetsMap> _all_cached_targets;
 
+  // 每个执行器最近一次提交的目标仓位,用于计算增量
+  wt_hashmap<std::string, TargetsMap> _committed_targets;
+  // 增量提交时复用的缓冲区
+  std::vector<ExecTargetItem> _delta_buf;
+  std::vector<std::string> _removed_codes;
+
   typedef wt_hashset<std::string> ExecuterSet;
   wt_hashmap<std::string, ExecuterSet> _router_rules;
 
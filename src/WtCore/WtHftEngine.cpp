@@ -29,9 +29,12 @@ namespace rj = rapidjson;
 
 USING_NS_WTP;
 
-WtHftEngine::WtHftEngine() : _cfg(NULL), _tm_ticker(NULL) {}
+WtHftEngine::WtHftEngine()
+    : _cfg(NULL), _tm_ticker(NULL), _busy_loop(false) {}
 
 WtHftEngine::~WtHftEngine() {
+  _loop.stop();
+
   if (_tm_ticker) {
     _tm_ticker->stop();
     delete _tm_ticker;
@@ -48,6 +51,94 @@ void WtHftEngine::init(WTSVariant *cfg, IBaseDataMgr *bdMgr, WtDtMgr *dataMgr,
 
   _cfg = cfg;
   _cfg->retain();
+
+  WTSVariant *cfgLoop = cfg->get("busyloop");
+  if (cfgLoop && cfgLoop->getBoolean("active")) {
+    _busy_loop = true;
+    uint32_t capacity = cfgLoop->getUInt32("capacity");
+    if (capacity == 0)
+      capacity = 8192;
+    int32_t core = cfgLoop->has("core") ? cfgLoop->getInt32("core") : -1;
+    bool bSpin = cfgLoop->has("spin") ? cfgLoop->getBoolean("spin") : true;
+    _loop.init(capacity, core, bSpin);
+    WTSLogger::info("HFT engine runs in busy loop mode, core: {}, spin: {}, "
+                    "capacity: {}",
+                    core, bSpin, capacity);
+  }
+}
+
+ITrdNotifySink *WtHftEngine::get_trd_sink(ITrdNotifySink *sink) {
+  if (!_busy_loop)
+    return sink;
+
+  std::shared_ptr<HftTrdSinkProxy> proxy(new HftTrdSinkProxy(this, sink));
+  _trd_proxies.emplace_back(proxy);
+  return proxy.get();
+}
+
+void WtHftEngine::post_loop_event(const HftLoopEvent &evt) {
+  _loop.post(evt);
+}
+
+bool WtHftEngine::post_timer_event(HftLoopEvtType evtType) {
+  if (!_busy_loop || !_loop.is_running() || _loop.in_loop_thread())
+    return false;
+
+  HftLoopEvent evt;
+  evt._type = evtType;
+  post_loop_event(evt);
+  return true;
+}
+
+void WtHftEngine::on_loop_event(HftLoopEvent &evt) {
+  switch (evt._type) {
+  case HLET_Tick:
+    handle_push_quote((WTSTickData *)evt._data);
+    break;
+  case HLET_OrdDtl:
+    handle_push_order_detail((WTSOrdDtlData *)evt._data);
+    break;
+  case HLET_OrdQue:
+    handle_push_order_queue((WTSOrdQueData *)evt._data);
+    break;
+  case HLET_Trans:
+    handle_push_transaction((WTSTransData *)evt._data);
+    break;
+  case HLET_Trade:
+    evt._sink->on_trade(evt._localid, evt._code, evt._flag_a, evt._values[0],
+                        evt._values[1]);
+    break;
+  case HLET_Order:
+    evt._sink->on_order(evt._localid, evt._code, evt._flag_a, evt._values[0],
+                        evt._values[1], evt._values[2], evt._flag_b);
+    break;
+  case HLET_Entrust:
+    evt._sink->on_entrust(evt._localid, evt._code, evt._flag_b,
+                          evt._message);
+    break;
+  case HLET_Position:
+    evt._sink->on_position(evt._code, evt._flag_a, evt._values[0],
+                           evt._values[1], evt._values[2], evt._values[3],
+                           evt._tradingday);
+    break;
+  case HLET_ChnlReady:
+    evt._sink->on_channel_ready();
+    break;
+  case HLET_ChnlLost:
+    evt._sink->on_channel_lost();
+    break;
+  case HLET_SessBegin:
+    on_session_begin();
+    break;
+  case HLET_SessEnd:
+    on_session_end();
+    break;
+  default:
+    break;
+  }
+
+  if (evt._data)
+    evt._data->release();
 }
 
 void WtHftEngine::run() {
@@ -93,14 +184,35 @@ void WtHftEngine::run() {
   }
 
   _tm_ticker->run();
+
+  if (_busy_loop)
+    _loop.start([this](HftLoopEvent &evt) { on_loop_event(evt); });
 }
 
 void WtHftEngine::handle_push_quote(WTSTickData *newTick) {
+  if (_busy_loop && !_loop.in_loop_thread()) {
+    HftLoopEvent evt;
+    evt._type = HLET_Tick;
+    evt._data = newTick;
+    newTick->retain();
+    _loop.post(evt);
+    return;
+  }
+
   if (_tm_ticker)
     _tm_ticker->on_tick(newTick);
 }
 
 void WtHftEngine::handle_push_order_detail(WTSOrdDtlData *curOrdDtl) {
+  if (_busy_loop && !_loop.in_loop_thread()) {
+    HftLoopEvent evt;
+    evt._type = HLET_OrdDtl;
+    evt._data = curOrdDtl;
+    curOrdDtl->retain();
+    _loop.post(evt);
+    return;
+  }
+
   const char *stdCode = curOrdDtl->code();
   auto sit = _orddtl_sub_map.find(stdCode);
   if (sit != _orddtl_sub_map.end()) {
@@ -120,6 +232,15 @@ void WtHftEngine::handle_push_order_detail(WTSOrdDtlData *curOrdDtl) {
 }
 
 void WtHftEngine::handle_push_order_queue(WTSOrdQueData *curOrdQue) {
+  if (_busy_loop && !_loop.in_loop_thread()) {
+    HftLoopEvent evt;
+    evt._type = HLET_OrdQue;
+    evt._data = curOrdQue;
+    curOrdQue->retain();
+    _loop.post(evt);
+    return;
+  }
+
   const char *stdCode = curOrdQue->code();
   auto sit = _ordque_sub_map.find(stdCode);
   if (sit != _ordque_sub_map.end()) {
@@ -139,6 +260,15 @@ void WtHftEngine::handle_push_order_queue(WTSOrdQueData *curOrdQue) {
 }
 
 void WtHftEngine::handle_push_transaction(WTSTransData *curTrans) {
+  if (_busy_loop && !_loop.in_loop_thread()) {
+    HftLoopEvent evt;
+    evt._type = HLET_Trans;
+    evt._data = curTrans;
+    curTrans->retain();
+    _loop.post(evt);
+    return;
+  }
+
   const char *stdCode = curTrans->code();
   auto sit = _trans_sub_map.find(stdCode);
   if (sit != _trans_sub_map.end()) {
@@ -260,6 +390,9 @@ void WtHftEngine::on_bar(const char *stdCode, const char *period,
 }
 
 void WtHftEngine::on_session_begin() {
+  if (post_timer_event(HLET_SessBegin))
+    return;
+
   WTSLogger::info("Trading day {} begun", _cur_tdate);
   WtEngine::on_session_begin();
 
@@ -275,6 +408,9 @@ void WtHftEngine::on_session_begin() {
 }
 
 void WtHftEngine::on_session_end() {
+  if (post_timer_event(HLET_SessEnd))
+    return;
+
   WtEngine::on_session_end();
 
   for (auto it = _ctx_map.begin(); it != _ctx_map.end(); it++) {
@@ -9,8 +9,11 @@
  */
 #pragma once
 #include "WtEngine.h"
+#include "WtHftLoop.h"
 #include "WtLocalExecuter.h"
 
+#include "../Share/PollingLoop.hpp"
+
 #include "../Includes/IHftStraCtx.h"
 
 NS_WTP_BEGIN
@@ -66,6 +69,25 @@ public:
   void sub_order_detail(uint32_t sid, const char *stdCode);
   void sub_transaction(uint32_t sid, const char *stdCode);
 
+  /*
+   *	获取策略的交易回报接收者
+   *	轮询模式下返回一个代理,把交易通道线程的回报转到事件循环线程
+   */
+  ITrdNotifySink *get_trd_sink(ITrdNotifySink *sink);
+
+  inline bool is_busy_loop() const { return _busy_loop; }
+
+  void post_loop_event(const HftLoopEvent &evt);
+
+private:
+  void on_loop_event(HftLoopEvent &evt);
+
+  /*
+   *	定时器线程触发的事件转到事件循环线程处理
+   *	返回false表示当前线程可以直接处理
+   */
+  bool post_timer_event(HftLoopEvtType evtType);
+
 private:
   typedef wt_hashmap<uint32_t, HftContextPtr> ContextMap;
   ContextMap _ctx_map;
@@ -76,6 +98,14 @@ private:
   StraSubMap _ordque_sub_map; // 委托队列订阅表
   StraSubMap _orddtl_sub_map; // 委托明细订阅表
   StraSubMap _trans_sub_map;  // 成交明细订阅表
+
+  /*
+   *	单线程轮询模式
+   *	行情和交易回报都投递到事件循环,由一个绑核的线程统一处理
+   */
+  bool _busy_loop;
+  PollingLoop<HftLoopEvent> _loop;
+  std::vector<std::shared_ptr<HftTrdSinkProxy>> _trd_proxies;
 };
 
 NS_WTP_END
\ No newline at end of file
@@ -0,0 +1,85 @@
+﻿/*!
+ * \file WtHftLoop.cpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief
+ */
+#include "WtHftLoop.h"
+#include "WtHftEngine.h"
+
+USING_NS_WTP;
+
+void HftTrdSinkProxy::on_trade(uint32_t localid, const char *stdCode,
+                               bool isBuy, double vol, double price) {
+  HftLoopEvent evt;
+  evt._type = HLET_Trade;
+  evt._sink = _sink;
+  evt._localid = localid;
+  evt._flag_a = isBuy;
+  evt._values[0] = vol;
+  evt._values[1] = price;
+  wt_strcpy(evt._code, stdCode);
+  _engine->post_loop_event(evt);
+}
+
+void HftTrdSinkProxy::on_order(uint32_t localid, const char *stdCode,
+                               bool isBuy, double totalQty, double leftQty,
+                               double price, bool isCanceled /* = false */) {
+  HftLoopEvent evt;
+  evt._type = HLET_Order;
+  evt._sink = _sink;
+  evt._localid = localid;
+  evt._flag_a = isBuy;
+  evt._flag_b = isCanceled;
+  evt._values[0] = totalQty;
+  evt._values[1] = leftQty;
+  evt._values[2] = price;
+  wt_strcpy(evt._code, stdCode);
+  _engine->post_loop_event(evt);
+}
+
+void HftTrdSinkProxy::on_position(const char *stdCode, bool isLong,
+                                  double prevol, double preavail,
+                                  double newvol, double newavail,
+                                  uint32_t tradingday) {
+  HftLoopEvent evt;
+  evt._type = HLET_Position;
+  evt._sink = _sink;
+  evt._flag_a = isLong;
+  evt._values[0] = prevol;
+  evt._values[1] = preavail;
+  evt._values[2] = newvol;
+  evt._values[3] = newavail;
+  evt._tradingday = tradingday;
+  wt_strcpy(evt._code, stdCode);
+  _engine->post_loop_event(evt);
+}
+
+void HftTrdSinkProxy::on_channel_ready() {
+  HftLoopEvent evt;
+  evt._type = HLET_ChnlReady;
+  evt._sink = _sink;
+  _engine->post_loop_event(evt);
+}
+
+void HftTrdSinkProxy::on_channel_lost() {
+  HftLoopEvent evt;
+  evt._type = HLET_ChnlLost;
+  evt._sink = _sink;
+  _engine->post_loop_event(evt);
+}
+
+void HftTrdSinkProxy::on_entrust(uint32_t localid, const char *stdCode,
+                                 bool bSuccess, const char *message) {
+  HftLoopEvent evt;
+  evt._type = HLET_Entrust;
+  evt._sink = _sink;
+  evt._localid = localid;
+  evt._flag_b = bSuccess;
+  wt_strcpy(evt._code, stdCode);
+  strncpy(evt._message, message, sizeof(evt._message) - 1);
+  _engine->post_loop_event(evt);
+}
@@ -0,0 +1,90 @@
+﻿/*!
+ * \file WtHftLoop.h
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief HFT引擎单线程轮询模式的事件定义
+ */
+#pragma once
+#include "ITrdNotifySink.h"
+#include <string.h>
+
+#include "../Includes/WTSMarcos.h"
+#include "../Includes/WTSObject.hpp"
+
+NS_WTP_BEGIN
+
+class WtHftEngine;
+
+typedef enum tagHftLoopEvtType {
+  HLET_Tick = 0,   // tick行情
+  HLET_OrdDtl,     // 逐笔委托
+  HLET_OrdQue,     // 委托队列
+  HLET_Trans,      // 逐笔成交
+  HLET_Trade,      // 成交回报
+  HLET_Order,      // 订单回报
+  HLET_Entrust,    // 下单回报
+  HLET_Position,   // 持仓更新
+  HLET_ChnlReady,  // 交易通道就绪
+  HLET_ChnlLost,   // 交易通道丢失
+  HLET_SessBegin,  // 交易日开始
+  HLET_SessEnd     // 交易日结束
+} HftLoopEvtType;
+
+/*
+ *	轮询模式下投递到事件循环的事件
+ *	行情数据投递时retain,处理完以后release
+ *	交易回报直接把参数拷贝进来
+ */
+typedef struct _HftLoopEvent {
+  HftLoopEvtType _type;
+  WTSObject *_data;
+  ITrdNotifySink *_sink;
+
+  uint32_t _localid;
+  uint32_t _tradingday; // 交易日
+  bool _flag_a; // isBuy/isLong
+  bool _flag_b; // isCanceled/bSuccess
+  double _values[4];
+  char _code[MAX_INSTRUMENT_LENGTH];
+  char _message[64];
+
+  _HftLoopEvent() { memset(this, 0, sizeof(_HftLoopEvent)); }
+} HftLoopEvent;
+
+/*
+ *	交易回报代理
+ *	把交易通道线程上的回报转到事件循环线程里再回调给策略
+ */
+class HftTrdSinkProxy : public ITrdNotifySink {
+public:
+  HftTrdSinkProxy(WtHftEngine *engine, ITrdNotifySink *sink)
+      : _engine(engine), _sink(sink) {}
+
+public:
+  virtual void on_trade(uint32_t localid, const char *stdCode, bool isBuy,
+                        double vol, double price) override;
+
+  virtual void on_order(uint32_t localid, const char *stdCode, bool isBuy,
+                        double totalQty, double leftQty, double price,
+                        bool isCanceled = false) override;
+
+  virtual void on_position(const char *stdCode, bool isLong, double prevol,
+                           double preavail, double newvol, double newavail,
+                           uint32_t tradingday) override;
+
+  virtual void on_channel_ready() override;
+
+  virtual void on_channel_lost() override;
+
+  virtual void on_entrust(uint32_t localid, const char *stdCode, bool bSuccess,
+                          const char *message) override;
+
+private:
+  WtHftEngine *_engine;
+  ITrdNotifySink *_sink;
+};
+
+NS_WTP_END
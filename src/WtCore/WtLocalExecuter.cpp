@@ -8,6 +8,7 @@
  * \brief
  */
 #include "WtLocalExecuter.h"
+#include "ExecTargetHelper.h"
 #include "TraderAdapter.h"
 #include "WtEngine.h"
 
@@ -240,6 +241,42 @@ uint64_t WtLocalExecuter::getCurTime() {
   // 100000 + _stub->get_secs());
 }
 
+bool WtLocalExecuter::registerOrderTimer(const char *stdCode, uint32_t localid,
+                                         uint32_t elapse) {
+  ExecuteUnitPtr unit = getUnit(stdCode, false);
+  if (unit == NULL)
+    return false;
+
+  uint64_t now = getCurTime();
+  SpinLock lock(_mtx_timers);
+  _ord_timers.schedule(now, elapse, OrderTimer(localid, unit));
+  return true;
+}
+
+void WtLocalExecuter::checkOrderTimers() {
+  std::vector<OrderTimer> expired;
+  {
+    SpinLock lock(_mtx_timers);
+    if (_ord_timers.empty())
+      return;
+
+    _ord_timers.advance(getCurTime(), [&expired](const OrderTimer &timer) {
+      expired.emplace_back(timer);
+    });
+  }
+
+  for (const OrderTimer &timer : expired) {
+    uint32_t localid = timer.first;
+    ExecuteUnitPtr unit = timer.second;
+    if (_pool) {
+      _pool->schedule(
+          [unit, localid]() { unit->self()->on_order_expired(localid); });
+    } else {
+      unit->self()->on_order_expired(localid);
+    }
+  }
+}
+
 #pragma endregion Context回调接口
 // ExecuteContext
 //////////////////////////////////////////////////////////////////////////
@@ -313,31 +350,10 @@ void WtLocalExecuter::set_position(
 
     double oldVol = _target_pos[stdCode];
     _target_pos[stdCode] = newVol;
-    // 账户的理论持仓要经过修正
-    double traderTarget = round(newVol * _scale);
-
-    if (!decimal::eq(oldVol, newVol)) {
-      WTSLogger::log_dyn(
-          "executer", _name.c_str(), LL_INFO,
-          "Target position of {} changed: {} -> {} : {} with scale{}", stdCode,
-          oldVol, newVol, traderTarget, _scale);
-    }
-
-    if (_trader && !_trader->checkOrderLimits(stdCode)) {
-      WTSLogger::log_dyn("executer", _name.c_str(), LL_WARN,
-                         "{} is disabled due to entrust limit control ",
-                         stdCode);
-      continue;
-    }
-
-    if (_pool) {
-      std::string code = stdCode;
-      _pool->schedule([unit, code, traderTarget]() {
-        unit->self()->set_position(code.c_str(), traderTarget);
-      });
-    } else {
-      unit->self()->set_position(stdCode, traderTarget);
-    }
+    // 被风控拦下的合约没有下达,下次提交还要走全量
+    if (!ExecTargetHelper::dispatch(_name.c_str(), _trader, _pool, unit,
+                                    stdCode, oldVol, newVol, _scale))
+      require_full_sync();
   }
 
   // 在原来的目标头寸中，但是不在新的目标头寸中，则需要自动设置为0
@@ -393,7 +409,28 @@ void WtLocalExecuter::set_position(
   }
 }
 
+bool WtLocalExecuter::update_targets(ExecTargetItem *items, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    ExecTargetItem &item = items[i];
+    ExecuteUnitPtr unit = getUnit(item._code);
+    if (unit == NULL)
+      continue;
+
+    double &curVol = _target_pos[item._code];
+    double oldVol = curVol;
+    curVol = item._target;
+    item._applied = ExecTargetHelper::dispatch(_name.c_str(), _trader, _pool,
+                                               unit, item._code, oldVol,
+                                               item._target, _scale);
+  }
+
+  return true;
+}
+
 void WtLocalExecuter::on_tick(const char *stdCode, WTSTickData *newTick) {
+  // 订单超时跟着行情检查,不用单独的线程
+  checkOrderTimers();
+
   ExecuteUnitPtr unit = getUnit(stdCode, false);
   if (unit == NULL)
     return;
@@ -467,6 +504,8 @@ void WtLocalExecuter::on_entrust(uint32_t localid, const char *stdCode,
 
 void WtLocalExecuter::on_channel_ready() {
   _channel_ready = true;
+  // 通道重连以后执行单元的状态重置了,下次提交目标仓位走全量
+  require_full_sync();
   SpinLock lock(_mtx_units);
   for (auto it = _unit_map.begin(); it != _unit_map.end(); it++) {
     ExecuteUnitPtr &unitPtr = (ExecuteUnitPtr &)it->second;
@@ -10,6 +10,7 @@
 #pragma once
 #include "../Includes/ExecuteDefs.h"
 #include "../Share/SpinMutex.hpp"
+#include "../Share/TimerWheel.hpp"
 #include "../Share/threadpool.hpp"
 #include "IExecCommand.h"
 #include "ITrdNotifySink.h"
@@ -42,6 +43,11 @@ public:
 private:
   ExecuteUnitPtr getUnit(const char *code, bool bAutoCreate = true);
 
+  /*
+   *	检查订单定时器,到期的回调给执行单元
+   */
+  void checkOrderTimers();
+
 public:
   //////////////////////////////////////////////////////////////////////////
   // ExecuteContext
@@ -68,6 +74,9 @@ public:
 
   virtual uint64_t getCurTime() override;
 
+  virtual bool registerOrderTimer(const char *stdCode, uint32_t localid,
+                                  uint32_t elapse) override;
+
 public:
   /*
    *	设置目标仓位
@@ -75,6 +84,11 @@ public:
   virtual void
   set_position(const wt_hashmap<std::string, double> &targets) override;
 
+  /*
+   *	批量更新有变化的目标仓位
+   */
+  virtual bool update_targets(ExecTargetItem *items, uint32_t count) override;
+
   /*
    *	合约仓位变动
    */
@@ -162,6 +176,11 @@ private:
 
   typedef std::shared_ptr<boost::threadpool::pool> ThreadPoolPtr;
   ThreadPoolPtr _pool;
+
+  // 订单定时器,本地单号和所属的执行单元
+  typedef std::pair<uint32_t, ExecuteUnitPtr> OrderTimer;
+  TimerWheel<OrderTimer> _ord_timers;
+  SpinMutex _mtx_timers;
 };
 
 typedef std::shared_ptr<IExecCommand> ExecCmdPtr;
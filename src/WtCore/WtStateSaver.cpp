@@ -0,0 +1,186 @@
+﻿/*!
+ * \file WtStateSaver.cpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief
+ */
+#include "WtStateSaver.h"
+
+#include "../Includes/WTSVariant.hpp"
+#include "../Share/BoostFile.hpp"
+#include "../Share/TimeUtils.hpp"
+
+#include "../WTSTools/WTSLogger.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <memory>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/writer.h>
+#include <stdint.h>
+#include <vector>
+
+USING_NS_WTP;
+
+WtStateSaver::WtStateSaver()
+    : _async(false), _pretty(true), _span(0), _dirty_cnt(0), _stopped(false) {
+}
+
+WtStateSaver::~WtStateSaver() { stop(); }
+
+WtStateSaver::Serializer
+WtStateSaver::json_serializer(rapidjson::Document &root) {
+  namespace rj = rapidjson;
+  std::shared_ptr<rj::Document> doc(new rj::Document(std::move(root)));
+  return [doc](std::string &content, bool pretty) {
+    rj::StringBuffer sb;
+    if (pretty) {
+      rj::PrettyWriter<rj::StringBuffer> writer(sb);
+      doc->Accept(writer);
+    } else {
+      rj::Writer<rj::StringBuffer> writer(sb);
+      doc->Accept(writer);
+    }
+    content.assign(sb.GetString(), sb.GetSize());
+  };
+}
+
+void WtStateSaver::init(WTSVariant *cfg) {
+  if (cfg == NULL)
+    return;
+
+  _async = cfg->getBoolean("async");
+  _span = cfg->getUInt32("span");
+  _pretty = cfg->has("pretty") ? cfg->getBoolean("pretty") : false;
+
+  WTSLogger::info("State saver initialized, async: {}, span: {}ms, pretty: {}",
+                  _async, _span, _pretty);
+}
+
+void WtStateSaver::save(const char *filename, Serializer serializer) {
+  if (!_async) {
+    write_file(filename, serializer);
+    return;
+  }
+
+  {
+    StdUniqueLock lock(_mtx);
+    if (_stopped) {
+      lock.unlock();
+      write_file(filename, serializer);
+      return;
+    }
+
+    // 没落地的旧数据直接丢掉,只保留最新的
+    SaveItem &item = _items[filename];
+    item._serializer = std::move(serializer);
+    if (!item._dirty) {
+      item._dirty = true;
+      _dirty_cnt++;
+    }
+
+    if (_thrd == NULL)
+      _thrd.reset(new StdThread([this]() { save_loop(); }));
+  }
+
+  _cond.notify_all();
+}
+
+void WtStateSaver::stop() {
+  {
+    StdUniqueLock lock(_mtx);
+    if (_stopped)
+      return;
+    _stopped = true;
+  }
+
+  _cond.notify_all();
+  if (_thrd)
+    _thrd->join();
+  _thrd.reset();
+
+  // 后台线程退出以后,把剩下的全部写掉
+  for (auto &v : _items) {
+    SaveItem &item = (SaveItem &)v.second;
+    if (!item._dirty)
+      continue;
+
+    write_file(v.first, item._serializer);
+    item._dirty = false;
+    item._serializer = nullptr;
+  }
+  _dirty_cnt = 0;
+}
+
+void WtStateSaver::save_loop() {
+  typedef std::pair<std::string, Serializer> PendingItem;
+  std::vector<PendingItem> pendings;
+
+  StdUniqueLock lock(_mtx);
+  while (!_stopped) {
+    if (_dirty_cnt == 0) {
+      _cond.wait(lock);
+      continue;
+    }
+
+    // 把已经到了落地间隔的文件取出来,剩下的等下一轮
+    int64_t now = TimeUtils::getLocalTimeNow();
+    int64_t nextTime = INT64_MAX;
+    for (auto &v : _items) {
+      SaveItem &item = (SaveItem &)v.second;
+      if (!item._dirty)
+        continue;
+
+      int64_t dueTime = item._last_write + _span;
+      if (dueTime > now) {
+        nextTime = std::min(nextTime, dueTime);
+        continue;
+      }
+
+      pendings.emplace_back(v.first, std::move(item._serializer));
+      item._serializer = nullptr;
+      item._dirty = false;
+      item._last_write = now;
+      _dirty_cnt--;
+    }
+
+    if (pendings.empty()) {
+      _cond.wait_for(lock, std::chrono::milliseconds(nextTime - now));
+      continue;
+    }
+
+    // 写文件的时候不占用锁,策略线程可以继续提交
+    lock.unlock();
+    for (PendingItem &p : pendings)
+      write_file(p.first, p.second);
+    pendings.clear();
+    lock.lock();
+  }
+}
+
+void WtStateSaver::write_file(const std::string &filename,
+                              Serializer &serializer) {
+  std::string content;
+  serializer(content, _pretty);
+
+  // 先写临时文件再改名,避免进程退出时留下写了一半的文件
+  std::string tmpfile = filename + ".tmp";
+  {
+    BoostFile bf;
+    if (!bf.create_new_file(tmpfile.c_str())) {
+      WTSLogger::error("Creating state file {} failed", tmpfile);
+      return;
+    }
+    bf.write_file(content);
+    bf.close_file();
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmpfile, filename, ec);
+  if (ec)
+    WTSLogger::error("Renaming state file {} failed: {}", filename,
+                     ec.message());
+}
@@ -0,0 +1,88 @@
+﻿/*!
+ * \file WtStateSaver.h
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief 策略和组合状态的异步落地服务
+ * 同一个文件在落地之前的多次保存请求会被合并,只写最新的一份
+ * 序列化和写文件都在后台线程完成,写入时先写临时文件再改名
+ */
+#pragma once
+#include <functional>
+#include <string>
+
+#include "../Includes/FasterDefs.h"
+#include "../Share/StdUtils.hpp"
+
+#include <rapidjson/document.h>
+
+NS_WTP_BEGIN
+class WTSVariant;
+
+class WtStateSaver {
+public:
+  /*
+   *	序列化函数,在落地线程里调用,返回要写入文件的内容
+   *	@pretty	是否输出格式化的内容
+   */
+  typedef std::function<void(std::string &content, bool pretty)> Serializer;
+
+  WtStateSaver();
+  ~WtStateSaver();
+
+  /*
+   *	把json文档包装成序列化函数
+   *	文档的内容会被移走,序列化放到落地线程里做
+   */
+  static Serializer json_serializer(rapidjson::Document &root);
+
+public:
+  /*
+   *	初始化
+   *	配置项: async-是否异步落地, span-同一个文件两次落地的最小间隔(毫秒),
+   *	pretty-是否输出格式化的json
+   */
+  void init(WTSVariant *cfg);
+
+  /*
+   *	提交保存请求
+   *	异步模式下只是登记一下,由后台线程落地
+   */
+  void save(const char *filename, Serializer serializer);
+
+  /*
+   *	把所有未落地的数据写入文件,并停止后台线程
+   */
+  void stop();
+
+private:
+  void save_loop();
+
+  void write_file(const std::string &filename, Serializer &serializer);
+
+private:
+  typedef struct _SaveItem {
+    Serializer _serializer; // 最新的一份数据
+    int64_t _last_write;    // 上一次落地的时间
+    bool _dirty;
+
+    _SaveItem() : _last_write(0), _dirty(false) {}
+  } SaveItem;
+  typedef wt_hashmap<std::string, SaveItem> SaveItems;
+
+  bool _async;
+  bool _pretty;
+  uint32_t _span; // 毫秒
+
+  SaveItems _items;
+  uint32_t _dirty_cnt;
+  bool _stopped;
+
+  StdThreadPtr _thrd;
+  StdUniqueMutex _mtx;
+  StdCondVariable _cond;
+};
+
+NS_WTP_END
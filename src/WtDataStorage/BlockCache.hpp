@@ -0,0 +1,134 @@
+﻿/*!
+ * \file BlockCache.hpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2020/03/30
+ *
+ * \brief 分片的LRU数据块缓存
+ */
+#pragma once
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "../Includes/FasterDefs.h"
+#include "../Share/StdUtils.hpp"
+
+NS_WTP_BEGIN
+/*
+ *	数据块缓存
+ *	按key的hash分片，每个分片一把锁，并发查询不同的数据互不影响
+ *	每个分片按内存预算淘汰最久没有访问的数据块
+ *	数据块用shared_ptr持有，淘汰以后如果还有切片在引用，等切片释放再回收
+ */
+class BlockCache {
+public:
+  static const uint32_t SHARD_COUNT = 16;
+
+  BlockCache() : _shard_budget(0) {}
+
+  /*
+   *	设置内存预算，单位字节，0为不限制
+   */
+  inline void set_budget(std::size_t budget) {
+    _shard_budget = budget / SHARD_COUNT;
+  }
+
+  template <typename T> std::shared_ptr<T> get(const std::string &key) {
+    Shard &shard = get_shard(key);
+    StdUniqueLock lock(shard._mtx);
+    auto it = shard._items.find(key);
+    if (it == shard._items.end())
+      return std::shared_ptr<T>();
+
+    // 移到队头，表示最近访问过
+    CacheItem &item = it->second;
+    shard._lru.splice(shard._lru.begin(), shard._lru, item._pos);
+    return std::static_pointer_cast<T>(item._data);
+  }
+
+  /*
+   *	放入缓存，如果key已经存在则替换
+   *	@size	数据块占用的内存大小
+   */
+  void put(const std::string &key, const std::shared_ptr<void> &data,
+           std::size_t size) {
+    Shard &shard = get_shard(key);
+    StdUniqueLock lock(shard._mtx);
+    auto it = shard._items.find(key);
+    if (it != shard._items.end()) {
+      CacheItem &item = it->second;
+      shard._used -= item._size;
+      item._data = data;
+      item._size = size;
+      shard._lru.splice(shard._lru.begin(), shard._lru, item._pos);
+    } else {
+      shard._lru.push_front(key);
+      CacheItem &item = shard._items[key];
+      item._data = data;
+      item._size = size;
+      item._pos = shard._lru.begin();
+    }
+    shard._used += size;
+
+    // 超出预算，从队尾开始淘汰，刚放进来的不淘汰
+    while (_shard_budget != 0 && shard._used > _shard_budget &&
+           shard._lru.size() > 1) {
+      auto eit = shard._items.find(shard._lru.back());
+      shard._used -= eit->second._size;
+      shard._items.erase(eit);
+      shard._lru.pop_back();
+    }
+  }
+
+  void clear() {
+    for (Shard &shard : _shards) {
+      StdUniqueLock lock(shard._mtx);
+      shard._items.clear();
+      shard._lru.clear();
+      shard._used = 0;
+    }
+  }
+
+  /*
+   *	缓存的数据块占用的内存大小
+   */
+  std::size_t used() {
+    std::size_t ret = 0;
+    for (Shard &shard : _shards) {
+      StdUniqueLock lock(shard._mtx);
+      ret += shard._used;
+    }
+    return ret;
+  }
+
+private:
+  typedef std::list<std::string> KeyList;
+  typedef struct _CacheItem {
+    std::shared_ptr<void> _data;
+    std::size_t _size;
+    KeyList::iterator _pos;
+
+    _CacheItem() : _size(0) {}
+  } CacheItem;
+
+  typedef struct _Shard {
+    StdUniqueMutex _mtx;
+    KeyList _lru; // 队头是最近访问的
+    wt_hashmap<std::string, CacheItem> _items;
+    std::size_t _used;
+
+    _Shard() : _used(0) {}
+  } Shard;
+
+  inline Shard &get_shard(const std::string &key) {
+    return _shards[std::hash<std::string>()(key) % SHARD_COUNT];
+  }
+
+private:
+  Shard _shards[SHARD_COUNT];
+  std::size_t _shard_budget;
+};
+NS_WTP_END
@@ -75,7 +75,7 @@ WtDataWriter::WtDataWriter()
       _disable_day(false), _disable_min1(false), _disable_min5(false),
       _disable_orddtl(false), _disable_ordque(false), _disable_trans(false),
       _disable_tick(false), _disable_his(false), _skip_notrade_tick(false),
-      _skip_notrade_bar(false) {}
+      _skip_notrade_bar(false), _task_size(0) {}
 
 WtDataWriter::~WtDataWriter() {}
 
@@ -536,6 +536,7 @@ void WtDataWriter::pushTask(const TaskInfo &task) {
 
   StdUniqueLock lck(_task_mtx);
   _tasks.emplace(task);
+  _task_size.fetch_add(1, std::memory_order_relaxed);
   _task_cond.notify_all();
 
   if (_task_thrd == NULL) {
@@ -572,6 +573,7 @@ void WtDataWriter::pushTask(const TaskInfo &task) {
             break;
           }
           tempQueue.pop();
+          _task_size.fetch_sub(1, std::memory_order_relaxed);
         }
       }
     }));
@@ -7,6 +7,7 @@
 #include "../Share/SpinMutex.hpp"
 #include "../Share/StdUtils.hpp"
 
+#include <atomic>
 #include <map>
 #include <queue>
 
@@ -66,6 +67,10 @@ public:
   virtual WTSTickData *getCurTick(const char *code,
                                   const char *exchg = "") override;
 
+  virtual uint32_t getQueueSize() override {
+    return _task_size.load(std::memory_order_relaxed);
+  }
+
 private:
   IBaseDataMgr *_bd_mgr;
 
@@ -170,6 +175,7 @@ private:
 
   } TaskInfo;
   std::queue<TaskInfo> _tasks;
+  std::atomic<uint32_t> _task_size; // 已提交还没有处理完的任务数
   StdThreadPtr _task_thrd;
   StdUniqueMutex _task_mtx;
   StdCondVariable _task_cond;
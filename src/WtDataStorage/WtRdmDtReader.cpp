@@ -49,6 +49,22 @@ EXPORT_FLAG void deleteRdmDtReader(IRdmDtReader *reader) {
 extern bool proc_block_data(std::string &content, bool isBar,
                             bool bKeepHead = true);
 
+/*
+ *	释放实时数据块的映射
+ *	@lastTime	最后访问时间早于这个时间的才释放
+ */
+template <typename T>
+static void release_rt_blocks(T &blocks, uint64_t lastTime) {
+  for (auto &m : blocks) {
+    auto &tPair = m.second;
+    StdUniqueLock lock(*tPair._mtx);
+    if (tPair._block != NULL && tPair._last_time < lastTime) {
+      tPair._block = NULL;
+      tPair._file.reset();
+    }
+  }
+}
+
 WtRdmDtReader::WtRdmDtReader()
     : _base_data_mgr(NULL), _hot_mgr(NULL), _stopped(false) {}
 
@@ -75,70 +91,28 @@ void WtRdmDtReader::init(WTSVariant *cfg, IRdmDtReaderSink *sink) {
   if (!bAdjLoaded && cfg->has("adjfactor"))
     loadStkAdjFactorsFromFile(cfg->getCString("adjfactor"));
 
+  // 历史数据块和K线缓存的内存预算，单位MB，0为不限制
+  uint32_t cacheSize = 2048;
+  if (cfg->has("cachesize"))
+    cacheSize = cfg->getUInt32("cachesize");
+  _cache.set_budget((std::size_t)cacheSize * 1024 * 1024);
+  pipe_rdmreader_log(_sink, LL_INFO, "Data cache budget set to {} MB",
+                     cacheSize);
+
   _thrd_check.reset(new StdThread([this]() {
     while (!_stopped) {
       std::this_thread::sleep_for(std::chrono::seconds(5));
       uint64_t now = TimeUtils::getLocalTimeNow();
 
-      for (auto &m : _rt_tick_map) {
-        // 如果5分钟之内没有访问，则释放掉
-        TickBlockPair &tPair = (TickBlockPair &)m.second;
-        if (now > tPair._last_time + 300000 && tPair._block != NULL) {
-          StdUniqueLock lock(*tPair._mtx);
-          tPair._block = NULL;
-          tPair._file.reset();
-        }
-      }
-
-      for (auto &m : _rt_ordque_map) {
-        // 如果5分钟之内没有访问，则释放掉
-        OrdQueBlockPair &tPair = (OrdQueBlockPair &)m.second;
-        if (now > tPair._last_time + 300000 && tPair._block != NULL) {
-          StdUniqueLock lock(*tPair._mtx);
-          tPair._block = NULL;
-          tPair._file.reset();
-        }
-      }
-
-      for (auto &m : _rt_orddtl_map) {
-        // 如果5分钟之内没有访问，则释放掉
-        OrdDtlBlockPair &tPair = (OrdDtlBlockPair &)m.second;
-        if (now > tPair._last_time + 300000 && tPair._block != NULL) {
-          StdUniqueLock lock(*tPair._mtx);
-          tPair._block = NULL;
-          tPair._file.reset();
-        }
-      }
-
-      for (auto &m : _rt_trans_map) {
-        // 如果5分钟之内没有访问，则释放掉
-        TransBlockPair &tPair = (TransBlockPair &)m.second;
-        if (now > tPair._last_time + 300000 && tPair._block != NULL) {
-          StdUniqueLock lock(*tPair._mtx);
-          tPair._block = NULL;
-          tPair._file.reset();
-        }
-      }
-
-      for (auto &m : _rt_min1_map) {
-        // 如果5分钟之内没有访问，则释放掉
-        RTKlineBlockPair &tPair = (RTKlineBlockPair &)m.second;
-        if (now > tPair._last_time + 300000 && tPair._block != NULL) {
-          StdUniqueLock lock(*tPair._mtx);
-          tPair._block = NULL;
-          tPair._file.reset();
-        }
-      }
-
-      for (auto &m : _rt_min5_map) {
-        // 如果5分钟之内没有访问，则释放掉
-        RTKlineBlockPair &tPair = (RTKlineBlockPair &)m.second;
-        if (now > tPair._last_time + 300000 && tPair._block != NULL) {
-          StdUniqueLock lock(*tPair._mtx);
-          tPair._block = NULL;
-          tPair._file.reset();
-        }
-      }
+      // 如果5分钟之内没有访问，则释放掉
+      uint64_t lastTime = now - 300000;
+      StdUniqueLock lock(_mtx_rt);
+      release_rt_blocks(_rt_tick_map, lastTime);
+      release_rt_blocks(_rt_ordque_map, lastTime);
+      release_rt_blocks(_rt_orddtl_map, lastTime);
+      release_rt_blocks(_rt_trans_map, lastTime);
+      release_rt_blocks(_rt_min1_map, lastTime);
+      release_rt_blocks(_rt_min5_map, lastTime);
     }
   }));
 }
@@ -240,11 +214,10 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByDate(const char *stdCode,
       }
     }
 
-    std::string key = fmt::format("{}-{}", stdCode, uDate);
+    std::string key = fmt::format("ticks/{}-{}", stdCode, uDate);
 
-    auto it = _his_tick_map.find(key);
-    bool bHasHisTick = (it != _his_tick_map.end());
-    if (!bHasHisTick) {
+    BlockBufferPtr buffer = _cache.get<std::string>(key);
+    if (!buffer) {
       for (;;) {
         std::string filename;
         bool bHitHot = false;
@@ -268,36 +241,20 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByDate(const char *stdCode,
           }
         }
 
-        HisTBlockPair &tBlkPair = _his_tick_map[key];
-        StdFile::read_file_content(filename.c_str(), tBlkPair._buffer);
-        if (tBlkPair._buffer.size() < sizeof(HisTickBlock)) {
-          pipe_rdmreader_log(_sink, LL_ERROR,
-                             "Sizechecking of tick data file {} failed",
-                             filename.c_str());
-          tBlkPair._buffer.clear();
-          break;
-        }
-
-        proc_block_data(tBlkPair._buffer, false, true);
-        tBlkPair._block = (HisTickBlock *)tBlkPair._buffer.c_str();
-        bHasHisTick = true;
+        buffer = loadHisTickBlock(key, filename);
         break;
       }
     }
 
-    while (bHasHisTick) {
-      HisTBlockPair &tBlkPair = _his_tick_map[key];
-      if (tBlkPair._block == NULL)
-        break;
-
-      HisTickBlock *tBlock = tBlkPair._block;
-
-      uint32_t tcnt = (tBlkPair._buffer.size() - sizeof(HisTickBlock)) /
-                      sizeof(WTSTickStruct);
+    while (buffer) {
+      HisTickBlock *tBlock = (HisTickBlock *)buffer->c_str();
+      uint32_t tcnt =
+          (buffer->size() - sizeof(HisTickBlock)) / sizeof(WTSTickStruct);
       if (tcnt <= 0)
         break;
 
       WTSTickSlice *slice = WTSTickSlice::create(stdCode, tBlock->_ticks, tcnt);
+      slice->keepAlive(buffer);
       return slice;
 
       break;
@@ -318,14 +275,17 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByDate(const char *stdCode,
     }
 
     TickBlockPair *tPair = getRTTickBlock(cInfo._exchg, curCode.c_str());
-    if (tPair == NULL || tPair->_block->_size == 0)
+    if (tPair == NULL)
       break;
 
     StdUniqueLock lock(*tPair->_mtx);
     RTTickBlock *tBlock = tPair->_block;
+    if (tBlock == NULL || tBlock->_size == 0)
+      break;
 
     WTSTickSlice *slice =
         WTSTickSlice::create(stdCode, tBlock->_ticks, tBlock->_size);
+    slice->keepAlive(tPair->_file);
     return slice;
   }
 
@@ -389,11 +349,10 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByRange(const char *stdCode,
       }
     }
 
-    std::string key = fmt::format("{}-{}", stdCode, nowTDate);
+    std::string key = fmt::format("ticks/{}-{}", stdCode, nowTDate);
 
-    auto it = _his_tick_map.find(key);
-    bool bHasHisTick = (it != _his_tick_map.end());
-    if (!bHasHisTick) {
+    BlockBufferPtr buffer = _cache.get<std::string>(key);
+    if (!buffer) {
       for (;;) {
         std::string filename;
         bool bHitHot = false;
@@ -419,24 +378,12 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByRange(const char *stdCode,
           }
         }
 
-        HisTBlockPair &tBlkPair = _his_tick_map[key];
-        StdFile::read_file_content(filename.c_str(), tBlkPair._buffer);
-        if (tBlkPair._buffer.size() < sizeof(HisTickBlock)) {
-          pipe_rdmreader_log(_sink, LL_ERROR,
-                             "Sizechecking of tick data file {} failed",
-                             filename.c_str());
-          tBlkPair._buffer.clear();
-          break;
-        }
-
-        proc_block_data(tBlkPair._buffer, false, true);
-        tBlkPair._block = (HisTickBlock *)tBlkPair._buffer.c_str();
-        bHasHisTick = true;
+        buffer = loadHisTickBlock(key, filename);
         break;
       }
     }
 
-    while (bHasHisTick) {
+    while (buffer) {
       // 比较时间的对象
       WTSTickStruct eTick;
       if (nowTDate == endTDate) {
@@ -447,14 +394,9 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByRange(const char *stdCode,
         eTick.action_time = sInfo->getCloseTime() * 100000 + 59999;
       }
 
-      HisTBlockPair &tBlkPair = _his_tick_map[key];
-      if (tBlkPair._block == NULL)
-        break;
-
-      HisTickBlock *tBlock = tBlkPair._block;
-
-      uint32_t tcnt = (tBlkPair._buffer.size() - sizeof(HisTickBlock)) /
-                      sizeof(WTSTickStruct);
+      HisTickBlock *tBlock = (HisTickBlock *)buffer->c_str();
+      uint32_t tcnt =
+          (buffer->size() - sizeof(HisTickBlock)) / sizeof(WTSTickStruct);
       if (tcnt <= 0)
         break;
 
@@ -474,6 +416,8 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByRange(const char *stdCode,
         eIdx--;
       }
 
+      slice->keepAlive(buffer);
+
       if (beginTDate != nowTDate) {
         // 如果开始的交易日和当前的交易日不一致，则返回全部的tick数据
         // WTSTickSlice* slice = WTSTickSlice::create(stdCode, tBlock->_ticks,
@@ -511,11 +455,15 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByRange(const char *stdCode,
     }
 
     TickBlockPair *tPair = getRTTickBlock(cInfo._exchg, curCode.c_str());
-    if (tPair == NULL || tPair->_block->_size == 0)
+    if (tPair == NULL)
       break;
 
     StdUniqueLock lock(*tPair->_mtx);
     RTTickBlock *tBlock = tPair->_block;
+    if (tBlock == NULL || tBlock->_size == 0)
+      break;
+
+    slice->keepAlive(tPair->_file);
     WTSTickStruct eTick;
     if (curTDate == endTDate) {
       eTick.action_date = rDate;
@@ -619,7 +567,10 @@ WtRdmDtReader::readOrdQueSliceByRange(const char *stdCode, uint64_t stime,
     if (tPair == NULL)
       return NULL;
 
+    StdUniqueLock lock(*tPair->_mtx);
     RTOrdQueBlock *rtBlock = tPair->_block;
+    if (rtBlock == NULL || rtBlock->_size == 0)
+      return NULL;
 
     WTSOrdQueStruct *pItem = std::lower_bound(
         rtBlock->_queues, rtBlock->_queues + (rtBlock->_size - 1), eTick,
@@ -643,6 +594,8 @@ WtRdmDtReader::readOrdQueSliceByRange(const char *stdCode, uint64_t stime,
       // 如果开始的交易日和当前的交易日不一致，则返回全部的tick数据
       WTSOrdQueSlice *slice =
           WTSOrdQueSlice::create(stdCode, rtBlock->_queues, eIdx + 1);
+      if (slice)
+        slice->keepAlive(tPair->_file);
       return slice;
     } else {
       // 如果交易日相同，则查找起始的位置
@@ -658,13 +611,15 @@ WtRdmDtReader::readOrdQueSliceByRange(const char *stdCode, uint64_t stime,
       std::size_t sIdx = pItem - rtBlock->_queues;
       WTSOrdQueSlice *slice = WTSOrdQueSlice::create(
           stdCode, rtBlock->_queues + sIdx, eIdx - sIdx + 1);
+      if (slice)
+        slice->keepAlive(tPair->_file);
       return slice;
     }
   } else {
-    std::string key = fmt::format("{}-{}", stdCode, endTDate);
+    std::string key = fmt::format("queue/{}-{}", stdCode, endTDate);
 
-    auto it = _his_ordque_map.find(key);
-    if (it == _his_ordque_map.end()) {
+    BlockBufferPtr buffer = _cache.get<std::string>(key);
+    if (!buffer) {
       std::stringstream ss;
       ss << _base_dir << "his/queue/" << cInfo._exchg << "/" << endTDate << "/"
          << curCode << ".dsb";
@@ -672,46 +627,14 @@ WtRdmDtReader::readOrdQueSliceByRange(const char *stdCode, uint64_t stime,
       if (!StdFile::exists(filename.c_str()))
         return NULL;
 
-      HisOrdQueBlockPair &hisBlkPair = _his_ordque_map[key];
-      StdFile::read_file_content(filename.c_str(), hisBlkPair._buffer);
-      if (hisBlkPair._buffer.size() < sizeof(HisOrdQueBlockV2)) {
-        pipe_rdmreader_log(_sink, LL_ERROR,
-                           "Sizechecking of orderqueue data file {} failed",
-                           filename.c_str());
-        hisBlkPair._buffer.clear();
-        return NULL;
-      }
-
-      HisOrdQueBlockV2 *tBlockV2 =
-          (HisOrdQueBlockV2 *)hisBlkPair._buffer.c_str();
-
-      if (hisBlkPair._buffer.size() !=
-          (sizeof(HisOrdQueBlockV2) + tBlockV2->_size)) {
-        pipe_rdmreader_log(_sink, LL_ERROR,
-                           "Sizechecking of orderqueue data file {} failed",
-                           filename.c_str());
+      buffer = loadHisL2Block(key, filename, "orderqueue");
+      if (!buffer)
         return NULL;
-      }
-
-      // 需要解压
-      std::string buf = WTSCmpHelper::uncompress_data(
-          tBlockV2->_data, (std::size_t)tBlockV2->_size);
-
-      // 将原来的buffer只保留一个头部,并将所有tick数据追加到尾部
-      hisBlkPair._buffer.resize(sizeof(HisOrdQueBlock));
-      hisBlkPair._buffer.append(buf);
-      tBlockV2->_version = BLOCK_VERSION_RAW;
-
-      hisBlkPair._block = (HisOrdQueBlock *)hisBlkPair._buffer.c_str();
     }
 
-    HisOrdQueBlockPair &tBlkPair = _his_ordque_map[key];
-    if (tBlkPair._block == NULL)
-      return NULL;
-
-    HisOrdQueBlock *tBlock = tBlkPair._block;
+    HisOrdQueBlock *tBlock = (HisOrdQueBlock *)buffer->c_str();
 
-    uint32_t tcnt = (tBlkPair._buffer.size() - sizeof(HisOrdQueBlock)) /
+    uint32_t tcnt = (buffer->size() - sizeof(HisOrdQueBlock)) /
                     sizeof(WTSOrdQueStruct);
     if (tcnt <= 0)
       return NULL;
@@ -736,6 +659,8 @@ WtRdmDtReader::readOrdQueSliceByRange(const char *stdCode, uint64_t stime,
       // 如果开始的交易日和当前的交易日不一致，则返回全部的tick数据
       WTSOrdQueSlice *slice =
           WTSOrdQueSlice::create(stdCode, tBlock->_items, eIdx + 1);
+      if (slice)
+        slice->keepAlive(buffer);
       return slice;
     } else {
       // 如果交易日相同，则查找起始的位置
@@ -751,6 +676,8 @@ WtRdmDtReader::readOrdQueSliceByRange(const char *stdCode, uint64_t stime,
       std::size_t sIdx = pItem - tBlock->_items;
       WTSOrdQueSlice *slice = WTSOrdQueSlice::create(
           stdCode, tBlock->_items + sIdx, eIdx - sIdx + 1);
+      if (slice)
+        slice->keepAlive(buffer);
       return slice;
     }
   }
@@ -805,7 +732,10 @@ WtRdmDtReader::readOrdDtlSliceByRange(const char *stdCode, uint64_t stime,
     if (tPair == NULL)
       return NULL;
 
+    StdUniqueLock lock(*tPair->_mtx);
     RTOrdDtlBlock *rtBlock = tPair->_block;
+    if (rtBlock == NULL || rtBlock->_size == 0)
+      return NULL;
 
     WTSOrdDtlStruct *pItem = std::lower_bound(
         rtBlock->_details, rtBlock->_details + (rtBlock->_size - 1), eTick,
@@ -829,6 +759,8 @@ WtRdmDtReader::readOrdDtlSliceByRange(const char *stdCode, uint64_t stime,
       // 如果开始的交易日和当前的交易日不一致，则返回全部的tick数据
       WTSOrdDtlSlice *slice =
           WTSOrdDtlSlice::create(stdCode, rtBlock->_details, eIdx + 1);
+      if (slice)
+        slice->keepAlive(tPair->_file);
       return slice;
     } else {
       // 如果交易日相同，则查找起始的位置
@@ -844,13 +776,15 @@ WtRdmDtReader::readOrdDtlSliceByRange(const char *stdCode, uint64_t stime,
       std::size_t sIdx = pItem - rtBlock->_details;
       WTSOrdDtlSlice *slice = WTSOrdDtlSlice::create(
           stdCode, rtBlock->_details + sIdx, eIdx - sIdx + 1);
+      if (slice)
+        slice->keepAlive(tPair->_file);
       return slice;
     }
   } else {
-    std::string key = fmt::format("{}-{}", stdCode, endTDate);
+    std::string key = fmt::format("orders/{}-{}", stdCode, endTDate);
 
-    auto it = _his_ordque_map.find(key);
-    if (it == _his_ordque_map.end()) {
+    BlockBufferPtr buffer = _cache.get<std::string>(key);
+    if (!buffer) {
       std::stringstream ss;
       ss << _base_dir << "his/orders/" << cInfo._exchg << "/" << endTDate << "/"
          << curCode << ".dsb";
@@ -858,46 +792,14 @@ WtRdmDtReader::readOrdDtlSliceByRange(const char *stdCode, uint64_t stime,
       if (!StdFile::exists(filename.c_str()))
         return NULL;
 
-      HisOrdDtlBlockPair &hisBlkPair = _his_orddtl_map[key];
-      StdFile::read_file_content(filename.c_str(), hisBlkPair._buffer);
-      if (hisBlkPair._buffer.size() < sizeof(HisOrdDtlBlockV2)) {
-        pipe_rdmreader_log(_sink, LL_ERROR,
-                           "Sizechecking of orderdetail data file {} failed",
-                           filename.c_str());
-        hisBlkPair._buffer.clear();
+      buffer = loadHisL2Block(key, filename, "orderdetail");
+      if (!buffer)
         return NULL;
-      }
-
-      HisOrdDtlBlockV2 *tBlockV2 =
-          (HisOrdDtlBlockV2 *)hisBlkPair._buffer.c_str();
-
-      if (hisBlkPair._buffer.size() !=
-          (sizeof(HisOrdDtlBlockV2) + tBlockV2->_size)) {
-        pipe_rdmreader_log(_sink, LL_ERROR,
-                           "Sizechecking of orderdetail data file {} failed",
-                           filename.c_str());
-        return NULL;
-      }
-
-      // 需要解压
-      std::string buf = WTSCmpHelper::uncompress_data(
-          tBlockV2->_data, (std::size_t)tBlockV2->_size);
-
-      // 将原来的buffer只保留一个头部,并将所有tick数据追加到尾部
-      hisBlkPair._buffer.resize(sizeof(HisOrdDtlBlock));
-      hisBlkPair._buffer.append(buf);
-      tBlockV2->_version = BLOCK_VERSION_RAW;
-
-      hisBlkPair._block = (HisOrdDtlBlock *)hisBlkPair._buffer.c_str();
     }
 
-    HisOrdDtlBlockPair &tBlkPair = _his_orddtl_map[key];
-    if (tBlkPair._block == NULL)
-      return NULL;
+    HisOrdDtlBlock *tBlock = (HisOrdDtlBlock *)buffer->c_str();
 
-    HisOrdDtlBlock *tBlock = tBlkPair._block;
-
-    uint32_t tcnt = (tBlkPair._buffer.size() - sizeof(HisOrdDtlBlock)) /
+    uint32_t tcnt = (buffer->size() - sizeof(HisOrdDtlBlock)) /
                     sizeof(WTSOrdDtlStruct);
     if (tcnt <= 0)
       return NULL;
@@ -922,6 +824,8 @@ WtRdmDtReader::readOrdDtlSliceByRange(const char *stdCode, uint64_t stime,
       // 如果开始的交易日和当前的交易日不一致，则返回全部的tick数据
       WTSOrdDtlSlice *slice =
           WTSOrdDtlSlice::create(stdCode, tBlock->_items, eIdx + 1);
+      if (slice)
+        slice->keepAlive(buffer);
       return slice;
     } else {
       // 如果交易日相同，则查找起始的位置
@@ -937,6 +841,8 @@ WtRdmDtReader::readOrdDtlSliceByRange(const char *stdCode, uint64_t stime,
       std::size_t sIdx = pItem - tBlock->_items;
       WTSOrdDtlSlice *slice = WTSOrdDtlSlice::create(
           stdCode, tBlock->_items + sIdx, eIdx - sIdx + 1);
+      if (slice)
+        slice->keepAlive(buffer);
       return slice;
     }
   }
@@ -991,7 +897,10 @@ WTSTransSlice *WtRdmDtReader::readTransSliceByRange(const char *stdCode,
     if (tPair == NULL)
       return NULL;
 
+    StdUniqueLock lock(*tPair->_mtx);
     RTTransBlock *rtBlock = tPair->_block;
+    if (rtBlock == NULL || rtBlock->_size == 0)
+      return NULL;
 
     WTSTransStruct *pItem = std::lower_bound(
         rtBlock->_trans, rtBlock->_trans + (rtBlock->_size - 1), eTick,
@@ -1015,6 +924,8 @@ WTSTransSlice *WtRdmDtReader::readTransSliceByRange(const char *stdCode,
       // 如果开始的交易日和当前的交易日不一致，则返回全部的tick数据
       WTSTransSlice *slice =
           WTSTransSlice::create(stdCode, rtBlock->_trans, eIdx + 1);
+      if (slice)
+        slice->keepAlive(tPair->_file);
       return slice;
     } else {
       // 如果交易日相同，则查找起始的位置
@@ -1030,13 +941,15 @@ WTSTransSlice *WtRdmDtReader::readTransSliceByRange(const char *stdCode,
       std::size_t sIdx = pItem - rtBlock->_trans;
       WTSTransSlice *slice = WTSTransSlice::create(
           stdCode, rtBlock->_trans + sIdx, eIdx - sIdx + 1);
+      if (slice)
+        slice->keepAlive(tPair->_file);
       return slice;
     }
   } else {
-    std::string key = fmt::format("{}-{}", stdCode, endTDate);
+    std::string key = fmt::format("trans/{}-{}", stdCode, endTDate);
 
-    auto it = _his_ordque_map.find(key);
-    if (it == _his_ordque_map.end()) {
+    BlockBufferPtr buffer = _cache.get<std::string>(key);
+    if (!buffer) {
       std::stringstream ss;
       ss << _base_dir << "his/trans/" << cInfo._exchg << "/" << endTDate << "/"
          << curCode << ".dsb";
@@ -1044,45 +957,14 @@ WTSTransSlice *WtRdmDtReader::readTransSliceByRange(const char *stdCode,
       if (!StdFile::exists(filename.c_str()))
         return NULL;
 
-      HisTransBlockPair &hisBlkPair = _his_trans_map[key];
-      StdFile::read_file_content(filename.c_str(), hisBlkPair._buffer);
-      if (hisBlkPair._buffer.size() < sizeof(HisTransBlockV2)) {
-        pipe_rdmreader_log(_sink, LL_ERROR,
-                           "Sizechecking of transaction data file {} failed",
-                           filename.c_str());
-        hisBlkPair._buffer.clear();
+      buffer = loadHisL2Block(key, filename, "transaction");
+      if (!buffer)
         return NULL;
-      }
-
-      HisTransBlockV2 *tBlockV2 = (HisTransBlockV2 *)hisBlkPair._buffer.c_str();
-
-      if (hisBlkPair._buffer.size() !=
-          (sizeof(HisTransBlockV2) + tBlockV2->_size)) {
-        pipe_rdmreader_log(_sink, LL_ERROR,
-                           "Sizechecking of transaction data file {} failed",
-                           filename.c_str());
-        return NULL;
-      }
-
-      // 需要解压
-      std::string buf = WTSCmpHelper::uncompress_data(
-          tBlockV2->_data, (std::size_t)tBlockV2->_size);
-
-      // 将原来的buffer只保留一个头部,并将所有tick数据追加到尾部
-      hisBlkPair._buffer.resize(sizeof(HisTransBlock));
-      hisBlkPair._buffer.append(buf);
-      tBlockV2->_version = BLOCK_VERSION_RAW;
-
-      hisBlkPair._block = (HisTransBlock *)hisBlkPair._buffer.c_str();
     }
 
-    HisTransBlockPair &tBlkPair = _his_trans_map[key];
-    if (tBlkPair._block == NULL)
-      return NULL;
-
-    HisTransBlock *tBlock = tBlkPair._block;
+    HisTransBlock *tBlock = (HisTransBlock *)buffer->c_str();
 
-    uint32_t tcnt = (tBlkPair._buffer.size() - sizeof(HisTransBlock)) /
+    uint32_t tcnt = (buffer->size() - sizeof(HisTransBlock)) /
                     sizeof(WTSTransStruct);
     if (tcnt <= 0)
       return NULL;
@@ -1107,6 +989,8 @@ WTSTransSlice *WtRdmDtReader::readTransSliceByRange(const char *stdCode,
       // 如果开始的交易日和当前的交易日不一致，则返回全部的tick数据
       WTSTransSlice *slice =
           WTSTransSlice::create(stdCode, tBlock->_items, eIdx + 1);
+      if (slice)
+        slice->keepAlive(buffer);
       return slice;
     } else {
       // 如果交易日相同，则查找起始的位置
@@ -1122,12 +1006,123 @@ WTSTransSlice *WtRdmDtReader::readTransSliceByRange(const char *stdCode,
       std::size_t sIdx = pItem - tBlock->_items;
       WTSTransSlice *slice = WTSTransSlice::create(
           stdCode, tBlock->_items + sIdx, eIdx - sIdx + 1);
+      if (slice)
+        slice->keepAlive(buffer);
       return slice;
     }
   }
 }
 
-bool WtRdmDtReader::cacheHisBarsFromFile(void *codeInfo, const std::string &key,
+WtRdmDtReader::BlockBufferPtr
+WtRdmDtReader::loadHisTickBlock(const std::string &key,
+                                const std::string &filename) {
+  BlockBufferPtr buffer(new std::string());
+  StdFile::read_file_content(filename.c_str(), *buffer);
+  if (buffer->size() < sizeof(HisTickBlock)) {
+    pipe_rdmreader_log(_sink, LL_ERROR,
+                       "Sizechecking of tick data file {} failed",
+                       filename.c_str());
+    return BlockBufferPtr();
+  }
+
+  proc_block_data(*buffer, false, true);
+  _cache.put(key, buffer, buffer->size());
+  return buffer;
+}
+
+WtRdmDtReader::BlockBufferPtr
+WtRdmDtReader::loadHisL2Block(const std::string &key,
+                              const std::string &filename, const char *tag) {
+  std::string content;
+  StdFile::read_file_content(filename.c_str(), content);
+  if (content.size() < sizeof(BlockHeaderV2)) {
+    pipe_rdmreader_log(_sink, LL_ERROR,
+                       "Sizechecking of {} data file {} failed", tag,
+                       filename.c_str());
+    return BlockBufferPtr();
+  }
+
+  BlockHeaderV2 *blkV2 = (BlockHeaderV2 *)content.c_str();
+  if (content.size() != (sizeof(BlockHeaderV2) + blkV2->_size)) {
+    pipe_rdmreader_log(_sink, LL_ERROR,
+                       "Sizechecking of {} data file {} failed", tag,
+                       filename.c_str());
+    return BlockBufferPtr();
+  }
+
+  // 需要解压，只保留一个头部，并将所有数据追加到尾部
+  BlockBufferPtr buffer(new std::string(content.c_str(), sizeof(BlockHeader)));
+  buffer->append(WTSCmpHelper::uncompress_data(
+      (const char *)content.c_str() + sizeof(BlockHeaderV2),
+      (std::size_t)blkV2->_size));
+  ((BlockHeader *)buffer->c_str())->_version = BLOCK_VERSION_RAW;
+
+  _cache.put(key, buffer, buffer->size());
+  return buffer;
+}
+
+WtRdmDtReader::BarsListPtr WtRdmDtReader::getHisBars(void *codeInfo,
+                                                     const char *stdCode,
+                                                     WTSKlinePeriod period) {
+  std::string key = fmtutil::format("bars/{}#{}", stdCode, period);
+  BarsListPtr barsList = _cache.get<BarsList>(key);
+  if (barsList)
+    return barsList;
+
+  // 没有历史数据也要放进缓存，后复权的实时数据也缓存在这里
+  barsList.reset(new BarsList());
+  cacheHisBarsFromFile(codeInfo, *barsList, stdCode, period);
+  _cache.put(key, barsList,
+             sizeof(BarsList) + sizeof(WTSBarStruct) * barsList->_bars.size());
+  return barsList;
+}
+
+std::shared_ptr<std::vector<WTSBarStruct>>
+WtRdmDtReader::syncRTBars(BarsList &barsList, RTKlineBlockPair *kPair) {
+  StdUniqueLock lock(barsList._mtx);
+  std::shared_ptr<std::vector<WTSBarStruct>> rtBars = barsList._rt_bars;
+
+  // 1、先检查缓存中有多少实时数据
+  std::size_t oldSize = rtBars ? rtBars->size() : 0;
+  std::size_t newSize = kPair->_block->_size;
+
+  // 2、再看看原始实时数据有多少，如果不够，就要补充进来
+  if (newSize > oldSize) {
+    // 除了缓存和这里，还有别的查询在引用，就不能原地修改
+    if (!rtBars)
+      rtBars.reset(new std::vector<WTSBarStruct>());
+    else if (rtBars.use_count() > 2)
+      rtBars.reset(new std::vector<WTSBarStruct>(*rtBars));
+
+    rtBars->resize(newSize);
+    std::size_t idx = oldSize;
+    if (oldSize != 0)
+      idx--;
+
+    // 因为每次拷贝，最后一条K线都有可能是未闭合的，所以需要把最后一条K线覆盖
+    memcpy(&(*rtBars)[idx], &kPair->_block->_bars[idx],
+           sizeof(WTSBarStruct) * (newSize - idx));
+
+    // 最后做复权处理
+    double factor = barsList._factor;
+    for (; idx < newSize; idx++) {
+      WTSBarStruct *pBar = &(*rtBars)[idx];
+      pBar->open *= factor;
+      pBar->high *= factor;
+      pBar->low *= factor;
+      pBar->close *= factor;
+    }
+
+    barsList._rt_bars = rtBars;
+  }
+
+  if (rtBars && rtBars->empty())
+    rtBars.reset();
+
+  return rtBars;
+}
+
+bool WtRdmDtReader::cacheHisBarsFromFile(void *codeInfo, BarsList &barList,
                                          const char *stdCode,
                                          WTSKlinePeriod period) {
   CodeHelper::CodeInfo *cInfo = (CodeHelper::CodeInfo *)codeInfo;
@@ -1154,7 +1149,6 @@ bool WtRdmDtReader::cacheHisBarsFromFile(void *codeInfo, const std::string &key,
     break;
   }
 
-  BarsList &barList = _bars_cache[key];
   barList._code = stdCode;
   barList._period = period;
   barList._exchg = cInfo->_exchg;
@@ -1626,7 +1620,7 @@ bool WtRdmDtReader::cacheHisBarsFromFile(void *codeInfo, const std::string &key,
 }
 
 WTSBarStruct *
-WtRdmDtReader::indexBarFromCacheByRange(const std::string &key, uint64_t stime,
+WtRdmDtReader::indexBarFromCacheByRange(BarsList &barsList, uint64_t stime,
                                         uint64_t etime, uint32_t &count,
                                         bool isDay /* = false */) {
   uint32_t rDate, rTime, lDate, lTime;
@@ -1635,7 +1629,6 @@ WtRdmDtReader::indexBarFromCacheByRange(const std::string &key, uint64_t stime,
   lDate = (uint32_t)(stime / 10000);
   lTime = (uint32_t)(stime % 10000);
 
-  BarsList &barsList = _bars_cache[key];
   if (barsList._bars.empty())
     return NULL;
 
@@ -1689,14 +1682,13 @@ WtRdmDtReader::indexBarFromCacheByRange(const std::string &key, uint64_t stime,
 }
 
 WTSBarStruct *
-WtRdmDtReader::indexBarFromCacheByCount(const std::string &key, uint64_t etime,
+WtRdmDtReader::indexBarFromCacheByCount(BarsList &barsList, uint64_t etime,
                                         uint32_t &count,
                                         bool isDay /* = false */) {
   uint32_t rDate, rTime;
   rDate = (uint32_t)(etime / 10000);
   rTime = (uint32_t)(etime % 10000);
 
-  BarsList &barsList = _bars_cache[key];
   if (barsList._bars.empty())
     return NULL;
 
@@ -1731,7 +1723,7 @@ WtRdmDtReader::indexBarFromCacheByCount(const std::string &key, uint64_t etime,
 }
 
 uint32_t WtRdmDtReader::readBarsFromCacheByRange(
-    const std::string &key, uint64_t stime, uint64_t etime,
+    BarsList &barsList, uint64_t stime, uint64_t etime,
     std::vector<WTSBarStruct> &ayBars, bool isDay /* = false */) {
   uint32_t rDate, rTime, lDate, lTime;
   rDate = (uint32_t)(etime / 10000);
@@ -1739,7 +1731,9 @@ uint32_t WtRdmDtReader::readBarsFromCacheByRange(
   lDate = (uint32_t)(stime / 10000);
   lTime = (uint32_t)(stime % 10000);
 
-  BarsList &barsList = _bars_cache[key];
+  if (barsList._bars.empty())
+    return 0;
+
   std::size_t eIdx, sIdx;
   {
     WTSBarStruct eBar;
@@ -1801,14 +1795,7 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByRange(const char *stdCode,
       _base_data_mgr->getCommodity(cInfo._exchg, cInfo._product);
   const char *stdPID = commInfo->getFullPid();
 
-  std::string key = fmt::format("{}#{}", stdCode, period);
-  auto it = _bars_cache.find(key);
-  bool bHasHisData = false;
-  if (it == _bars_cache.end()) {
-    bHasHisData = cacheHisBarsFromFile(&cInfo, key, stdCode, period);
-  } else {
-    bHasHisData = true;
-  }
+  BarsListPtr barsList = getHisBars(&cInfo, stdCode, period);
 
   if (etime == 0)
     etime = 203012312359;
@@ -1825,6 +1812,7 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByRange(const char *stdCode,
 
   WTSBarStruct *hisHead = NULL;
   WTSBarStruct *rtHead = NULL;
+  std::shared_ptr<void> rtHolder; // 实时K线所在的数据块
   uint32_t hisCnt = 0;
   uint32_t rtCnt = 0;
 
@@ -1874,8 +1862,16 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByRange(const char *stdCode,
 
     if (cInfo._exright != 2) {
       RTKlineBlockPair *kPair = getRTKilneBlock(cInfo._exchg, curCode, period);
+      // 查询的同时缓存可能被清理，加锁以后要再检查一下
+      StdUniqueLock lock;
       if (kPair != NULL) {
-        StdUniqueLock lock(*kPair->_mtx);
+        lock = StdUniqueLock(*kPair->_mtx);
+        if (kPair->_block == NULL)
+          kPair = NULL;
+      }
+
+      if (kPair != NULL) {
+        rtHolder = kPair->_file;
         // 读取当日的数据
         WTSBarStruct *pBar = std::lower_bound(
             kPair->_block->_bars,
@@ -1916,63 +1912,44 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByRange(const char *stdCode,
         }
       }
     } else {
+      // 如果是后复权，实时数据是需要单独缓存的，所以这里处理会很复杂
       RTKlineBlockPair *kPair = getRTKilneBlock(cInfo._exchg, curCode, period);
+      std::shared_ptr<std::vector<WTSBarStruct>> rtBars;
       if (kPair != NULL) {
-        // 如果是后复权，实时数据是需要单独缓存的，所以这里处理会很复杂
-        BarsList &barsList = _bars_cache[key];
-
-        // 1、先检查缓存中有多少实时数据
-        std::size_t oldSize = barsList._rt_bars.size();
-        std::size_t newSize = kPair->_block->_size;
-
-        // 2、再看看原始实时数据有多少，如果不够，就要补充进来
-        if (newSize > oldSize) {
-          barsList._rt_bars.resize(newSize);
-          auto idx = oldSize;
-          if (oldSize != 0)
-            idx--;
-
-          // 因为每次拷贝，最后一条K线都有可能是未闭合的，所以需要把最后一条K线覆盖
-          memcpy(&barsList._rt_bars[idx], &kPair->_block->_bars[idx],
-                 sizeof(WTSBarStruct) * (newSize - oldSize + 1));
-
-          // 最后做复权处理
-          double factor = barsList._factor;
-          for (; idx < newSize; idx++) {
-            WTSBarStruct *pBar = &barsList._rt_bars[idx];
-            pBar->open *= factor;
-            pBar->high *= factor;
-            pBar->low *= factor;
-            pBar->close *= factor;
-          }
-        }
+        StdUniqueLock lock(*kPair->_mtx);
+        if (kPair->_block != NULL)
+          rtBars = syncRTBars(*barsList, kPair);
+      }
+
+      if (rtBars) {
+        rtHolder = rtBars;
 
         // 最后做一个定位
         auto it = std::lower_bound(
-            barsList._rt_bars.begin(), barsList._rt_bars.end(), eBar,
+            rtBars->begin(), rtBars->end(), eBar,
             [isDay](const WTSBarStruct &a, const WTSBarStruct &b) {
               if (isDay)
                 return a.date < b.date;
               else
                 return a.time < b.time;
             });
-        std::size_t idx = it - barsList._rt_bars.begin();
-        WTSBarStruct *pBar = &barsList._rt_bars[idx];
+        std::size_t idx = it - rtBars->begin();
+        WTSBarStruct *pBar = &(*rtBars)[idx];
         if ((isDay && pBar->date > eBar.date) ||
             (!isDay && pBar->time > eBar.time)) {
           pBar--;
           idx--;
         }
 
-        pBar = &barsList._rt_bars[0];
+        pBar = &(*rtBars)[0];
         // 如果第一条实时K线的时间大于开始日期，则实时K线要全部包含进去
         if ((isDay && pBar->date > sBar.date) ||
             (!isDay && pBar->time > sBar.time)) {
-          rtHead = &barsList._rt_bars[0];
+          rtHead = &(*rtBars)[0];
           rtCnt = idx + 1;
         } else {
           it = std::lower_bound(
-              barsList._rt_bars.begin(), barsList._rt_bars.begin() + idx, sBar,
+              rtBars->begin(), rtBars->begin() + idx, sBar,
               [isDay](const WTSBarStruct &a, const WTSBarStruct &b) {
                 if (isDay)
                   return a.date < b.date;
@@ -1980,8 +1957,8 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByRange(const char *stdCode,
                   return a.time < b.time;
               });
 
-          std::size_t sIdx = it - barsList._rt_bars.begin();
-          rtHead = &barsList._rt_bars[sIdx];
+          std::size_t sIdx = it - rtBars->begin();
+          rtHead = &(*rtBars)[sIdx];
           rtCnt = idx - sIdx + 1;
           bNeedHisData = false;
         }
@@ -1991,7 +1968,8 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByRange(const char *stdCode,
 
   if (bNeedHisData) {
     hisHead =
-        indexBarFromCacheByRange(key, stime, etime, hisCnt, period == KP_DAY);
+        indexBarFromCacheByRange(*barsList, stime, etime, hisCnt,
+                                 period == KP_DAY);
   }
 
   if (hisCnt + rtCnt > 0) {
@@ -1999,6 +1977,8 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByRange(const char *stdCode,
         WTSKlineSlice::create(stdCode, period, 1, hisHead, hisCnt);
     if (rtCnt > 0)
       slice->appendBlock(rtHead, rtCnt);
+    slice->keepAlive(barsList);
+    slice->keepAlive(rtHolder);
     return slice;
   }
 
@@ -2014,7 +1994,14 @@ WtRdmDtReader::TickBlockPair *WtRdmDtReader::getRTTickBlock(const char *exchg,
   if (!StdFile::exists(path.c_str()))
     return NULL;
 
-  TickBlockPair &block = _rt_tick_map[key];
+  TickBlockPair *pair = NULL;
+  {
+    StdUniqueLock lock(_mtx_rt);
+    pair = &_rt_tick_map[key];
+  }
+
+  TickBlockPair &block = *pair;
+  StdUniqueLock lock(*block._mtx);
   if (block._file == NULL || block._block == NULL) {
     if (block._file == NULL) {
       block._file.reset(new BoostMappingFile());
@@ -2041,6 +2028,9 @@ WtRdmDtReader::TickBlockPair *WtRdmDtReader::getRTTickBlock(const char *exchg,
   }
 
   block._last_time = TimeUtils::getLocalTimeNow();
+  if (block._block->_size == 0)
+    return NULL;
+
   return &block;
 }
 
@@ -2053,7 +2043,14 @@ WtRdmDtReader::getRTOrdDtlBlock(const char *exchg, const char *code) {
   if (!StdFile::exists(path.c_str()))
     return NULL;
 
-  OrdDtlBlockPair &block = _rt_orddtl_map[key];
+  OrdDtlBlockPair *pair = NULL;
+  {
+    StdUniqueLock lock(_mtx_rt);
+    pair = &_rt_orddtl_map[key];
+  }
+
+  OrdDtlBlockPair &block = *pair;
+  StdUniqueLock lock(*block._mtx);
   if (block._file == NULL || block._block == NULL) {
     if (block._file == NULL) {
       block._file.reset(new BoostMappingFile());
@@ -2080,6 +2077,9 @@ WtRdmDtReader::getRTOrdDtlBlock(const char *exchg, const char *code) {
   }
 
   block._last_time = TimeUtils::getLocalTimeNow();
+  if (block._block->_size == 0)
+    return NULL;
+
   return &block;
 }
 
@@ -2092,7 +2092,14 @@ WtRdmDtReader::getRTOrdQueBlock(const char *exchg, const char *code) {
   if (!StdFile::exists(path.c_str()))
     return NULL;
 
-  OrdQueBlockPair &block = _rt_ordque_map[key];
+  OrdQueBlockPair *pair = NULL;
+  {
+    StdUniqueLock lock(_mtx_rt);
+    pair = &_rt_ordque_map[key];
+  }
+
+  OrdQueBlockPair &block = *pair;
+  StdUniqueLock lock(*block._mtx);
   if (block._file == NULL || block._block == NULL) {
     if (block._file == NULL) {
       block._file.reset(new BoostMappingFile());
@@ -2119,6 +2126,9 @@ WtRdmDtReader::getRTOrdQueBlock(const char *exchg, const char *code) {
   }
 
   block._last_time = TimeUtils::getLocalTimeNow();
+  if (block._block->_size == 0)
+    return NULL;
+
   return &block;
 }
 
@@ -2131,7 +2141,14 @@ WtRdmDtReader::getRTTransBlock(const char *exchg, const char *code) {
   if (!StdFile::exists(path.c_str()))
     return NULL;
 
-  TransBlockPair &block = _rt_trans_map[key];
+  TransBlockPair *pair = NULL;
+  {
+    StdUniqueLock lock(_mtx_rt);
+    pair = &_rt_trans_map[key];
+  }
+
+  TransBlockPair &block = *pair;
+  StdUniqueLock lock(*block._mtx);
   if (block._file == NULL || block._block == NULL) {
     if (block._file == NULL) {
       block._file.reset(new BoostMappingFile());
@@ -2158,6 +2175,9 @@ WtRdmDtReader::getRTTransBlock(const char *exchg, const char *code) {
   }
 
   block._last_time = TimeUtils::getLocalTimeNow();
+  if (block._block->_size == 0)
+    return NULL;
+
   return &block;
 }
 
@@ -2187,8 +2207,14 @@ WtRdmDtReader::getRTKilneBlock(const char *exchg, const char *code,
   if (!StdFile::exists(path.c_str()))
     return NULL;
 
-  RTKlineBlockPair &block =
-      (period == KP_Minute1 ? _rt_min1_map[key] : _rt_min5_map[key]);
+  RTKlineBlockPair *pair = NULL;
+  {
+    StdUniqueLock lock(_mtx_rt);
+    pair = (period == KP_Minute1) ? &_rt_min1_map[key] : &_rt_min5_map[key];
+  }
+
+  RTKlineBlockPair &block = *pair;
+  StdUniqueLock lock(*block._mtx);
   if (block._file == NULL || block._block == NULL) {
     if (block._file == NULL) {
       block._file.reset(new BoostMappingFile());
@@ -2215,6 +2241,9 @@ WtRdmDtReader::getRTKilneBlock(const char *exchg, const char *code,
   }
 
   block._last_time = TimeUtils::getLocalTimeNow();
+  if (block._block->_size == 0)
+    return NULL;
+
   return &block;
 }
 
@@ -2229,14 +2258,7 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByCount(const char *stdCode,
       _base_data_mgr->getCommodity(cInfo._exchg, cInfo._product);
   const char *stdPID = commInfo->getFullPid();
 
-  std::string key = fmtutil::format("{}#{}", stdCode, period);
-  auto it = _bars_cache.find(key);
-  bool bHasHisData = false;
-  if (it == _bars_cache.end()) {
-    bHasHisData = cacheHisBarsFromFile(&cInfo, key, stdCode, period);
-  } else {
-    bHasHisData = true;
-  }
+  BarsListPtr barsList = getHisBars(&cInfo, stdCode, period);
 
   if (etime == 0)
     etime = 203012312359;
@@ -2251,6 +2273,7 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByCount(const char *stdCode,
 
   WTSBarStruct *hisHead = NULL;
   WTSBarStruct *rtHead = NULL;
+  std::shared_ptr<void> rtHolder; // 实时K线所在的数据块
   uint32_t hisCnt = 0;
   uint32_t rtCnt = 0;
 
@@ -2293,8 +2316,16 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByCount(const char *stdCode,
     if (cInfo._exright != 2) {
       // 读取实时的
       RTKlineBlockPair *kPair = getRTKilneBlock(cInfo._exchg, curCode, period);
+      // 查询的同时缓存可能被清理，加锁以后要再检查一下
+      StdUniqueLock lock;
       if (kPair != NULL) {
-        StdUniqueLock lock(*(kPair->_mtx));
+        lock = StdUniqueLock(*kPair->_mtx);
+        if (kPair->_block == NULL)
+          kPair = NULL;
+      }
+
+      if (kPair != NULL) {
+        rtHolder = kPair->_file;
         // 读取当日的数据
         WTSBarStruct *pBar = std::lower_bound(
             kPair->_block->_bars,
@@ -2319,48 +2350,29 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByCount(const char *stdCode,
         bNeedHisData = (rtCnt < count);
       }
     } else {
+      // 如果是后复权，实时数据是需要单独缓存的，所以这里处理会很复杂
       RTKlineBlockPair *kPair = getRTKilneBlock(cInfo._exchg, curCode, period);
+      std::shared_ptr<std::vector<WTSBarStruct>> rtBars;
       if (kPair != NULL) {
-        // 如果是后复权，实时数据是需要单独缓存的，所以这里处理会很复杂
-        BarsList &barsList = _bars_cache[key];
-
-        // 1、先检查缓存中有多少实时数据
-        std::size_t oldSize = barsList._rt_bars.size();
-        std::size_t newSize = kPair->_block->_size;
-
-        // 2、再看看原始实时数据有多少，如果不够，就要补充进来
-        if (newSize > oldSize) {
-          barsList._rt_bars.resize(newSize);
-          auto idx = oldSize;
-          if (oldSize != 0)
-            idx--;
-
-          // 因为每次拷贝，最后一条K线都有可能是未闭合的，所以需要把最后一条K线覆盖
-          memcpy(&barsList._rt_bars[idx], &kPair->_block->_bars[idx],
-                 sizeof(WTSBarStruct) * (newSize - idx));
-
-          // 最后做复权处理
-          double factor = barsList._factor;
-          for (; idx < newSize; idx++) {
-            WTSBarStruct *pBar = &barsList._rt_bars[idx];
-            pBar->open *= factor;
-            pBar->high *= factor;
-            pBar->low *= factor;
-            pBar->close *= factor;
-          }
-        }
+        StdUniqueLock lock(*kPair->_mtx);
+        if (kPair->_block != NULL)
+          rtBars = syncRTBars(*barsList, kPair);
+      }
+
+      if (rtBars) {
+        rtHolder = rtBars;
 
         // 最后做一个定位
         auto it = std::lower_bound(
-            barsList._rt_bars.begin(), barsList._rt_bars.end(), eBar,
+            rtBars->begin(), rtBars->end(), eBar,
             [isDay](const WTSBarStruct &a, const WTSBarStruct &b) {
               if (isDay)
                 return a.date < b.date;
               else
                 return a.time < b.time;
             });
-        std::size_t idx = it - barsList._rt_bars.begin();
-        WTSBarStruct *pBar = &barsList._rt_bars[idx];
+        std::size_t idx = it - rtBars->begin();
+        WTSBarStruct *pBar = &(*rtBars)[idx];
         if ((isDay && pBar->date > eBar.date) ||
             (!isDay && pBar->time > eBar.time)) {
           pBar--;
@@ -2370,7 +2382,7 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByCount(const char *stdCode,
         // 如果第一条实时K线的时间大于开始日期，则实时K线要全部包含进去
         rtCnt = min((uint32_t)idx + 1, count);
         std::size_t sIdx = idx + 1 - rtCnt;
-        rtHead = &barsList._rt_bars[sIdx];
+        rtHead = &(*rtBars)[sIdx];
         bNeedHisData = (rtCnt < count);
       }
     }
@@ -2378,7 +2390,8 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByCount(const char *stdCode,
 
   if (bNeedHisData) {
     hisCnt = count - rtCnt;
-    hisHead = indexBarFromCacheByCount(key, etime, hisCnt, period == KP_DAY);
+    hisHead =
+        indexBarFromCacheByCount(*barsList, etime, hisCnt, period == KP_DAY);
   }
 
   pipe_rdmreader_log(
@@ -2391,6 +2404,8 @@ WTSKlineSlice *WtRdmDtReader::readKlineSliceByCount(const char *stdCode,
         WTSKlineSlice::create(stdCode, period, 1, hisHead, hisCnt);
     if (rtCnt > 0)
       slice->appendBlock(rtHead, rtCnt);
+    slice->keepAlive(barsList);
+    slice->keepAlive(rtHolder);
     return slice;
   }
 
@@ -2437,11 +2452,15 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByCount(const char *stdCode,
     }
 
     TickBlockPair *tPair = getRTTickBlock(cInfo._exchg, curCode.c_str());
-    if (tPair == NULL || tPair->_block->_size == 0)
+    if (tPair == NULL)
       break;
 
     StdUniqueLock lock(*tPair->_mtx);
     RTTickBlock *tBlock = tPair->_block;
+    if (tBlock == NULL || tBlock->_size == 0)
+      break;
+
+    slice->keepAlive(tPair->_file);
     WTSTickStruct eTick;
     if (curTDate == endTDate) {
       eTick.action_date = rDate;
@@ -2515,11 +2534,10 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByCount(const char *stdCode,
       // }
     }
 
-    std::string key = fmt::format("{}-{}", stdCode, nowTDate);
+    std::string key = fmt::format("ticks/{}-{}", stdCode, nowTDate);
 
-    auto it = _his_tick_map.find(key);
-    bool bHasHisTick = (it != _his_tick_map.end());
-    if (!bHasHisTick) {
+    BlockBufferPtr buffer = _cache.get<std::string>(key);
+    if (!buffer) {
       for (;;) {
         std::string filename;
         bool bHitHot = false;
@@ -2546,24 +2564,12 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByCount(const char *stdCode,
 
         missingCnt = 0;
 
-        HisTBlockPair &tBlkPair = _his_tick_map[key];
-        StdFile::read_file_content(filename.c_str(), tBlkPair._buffer);
-        if (tBlkPair._buffer.size() < sizeof(HisTickBlock)) {
-          pipe_rdmreader_log(_sink, LL_ERROR,
-                             "Sizechecking of his tick data file {} failed",
-                             filename.c_str());
-          tBlkPair._buffer.clear();
-          break;
-        }
-
-        proc_block_data(tBlkPair._buffer, false, true);
-        tBlkPair._block = (HisTickBlock *)tBlkPair._buffer.c_str();
-        bHasHisTick = true;
+        buffer = loadHisTickBlock(key, filename);
         break;
       }
     }
 
-    while (bHasHisTick) {
+    while (buffer) {
       // 比较时间的对象
       WTSTickStruct eTick;
       if (nowTDate == endTDate) {
@@ -2574,14 +2580,9 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByCount(const char *stdCode,
         eTick.action_time = sInfo->getCloseTime() * 100000 + 59999;
       }
 
-      HisTBlockPair &tBlkPair = _his_tick_map[key];
-      if (tBlkPair._block == NULL)
-        break;
-
-      HisTickBlock *tBlock = tBlkPair._block;
-
-      uint32_t tcnt = (tBlkPair._buffer.size() - sizeof(HisTickBlock)) /
-                      sizeof(WTSTickStruct);
+      HisTickBlock *tBlock = (HisTickBlock *)buffer->c_str();
+      uint32_t tcnt =
+          (buffer->size() - sizeof(HisTickBlock)) / sizeof(WTSTickStruct);
       if (tcnt <= 0)
         break;
 
@@ -2601,6 +2602,8 @@ WTSTickSlice *WtRdmDtReader::readTickSliceByCount(const char *stdCode,
         eIdx--;
       }
 
+      slice->keepAlive(buffer);
+
       uint32_t thisCnt = min((uint32_t)eIdx + 1, left);
       uint32_t sIdx = eIdx + 1 - thisCnt;
       slice->insertBlock(0, tBlock->_ticks + sIdx, thisCnt);
@@ -2627,7 +2630,7 @@ double WtRdmDtReader::getAdjFactorByDate(const char *stdCode,
   std::string key = stdCode;
   if (cInfo.isExright())
     key = key.substr(0, key.size() - 1);
-  const AdjFactorList &factList = _adj_factors[key];
+  const AdjFactorList &factList = getAdjFactors(key);
   if (factList.empty())
     return 1.0;
 
@@ -2649,13 +2652,15 @@ double WtRdmDtReader::getAdjFactorByDate(const char *stdCode,
 }
 
 void WtRdmDtReader::clearCache() {
-  _bars_cache.clear();
+  _cache.clear();
 
-  _rt_min1_map.clear();
-  _rt_min5_map.clear();
+  // 实时数据块表可能正在被查询线程使用，只释放映射，不删除
+  StdUniqueLock lock(_mtx_rt);
+  release_rt_blocks(_rt_min1_map, UINT64_MAX);
+  release_rt_blocks(_rt_min5_map, UINT64_MAX);
 
-  _rt_tick_map.clear();
-  _rt_trans_map.clear();
-  _rt_orddtl_map.clear();
-  _rt_ordque_map.clear();
-}
\ No newline at end of file
+  release_rt_blocks(_rt_tick_map, UINT64_MAX);
+  release_rt_blocks(_rt_trans_map, UINT64_MAX);
+  release_rt_blocks(_rt_orddtl_map, UINT64_MAX);
+  release_rt_blocks(_rt_ordque_map, UINT64_MAX);
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <unordered_map>
 
+#include "BlockCache.hpp"
 #include "DataDefine.h"
 
 #include "../Includes/FasterDefs.h"
@@ -130,66 +131,31 @@ private:
   OrdDtlBlockFilesMap _rt_orddtl_map;
   OrdQueBlockFilesMap _rt_ordque_map;
 
-  typedef struct _HisTBlockPair {
-    HisTickBlock *_block;
-    uint64_t _date;
-    std::string _buffer;
+  StdUniqueMutex _mtx_rt; // 实时数据块表的锁
 
-    _HisTBlockPair() {
-      _block = NULL;
-      _date = 0;
-      _buffer.clear();
-    }
-  } HisTBlockPair;
-
-  typedef std::unordered_map<std::string, HisTBlockPair> HisTickBlockMap;
-
-  typedef struct _HisTransBlockPair {
-    HisTransBlock *_block;
-    uint64_t _date;
-    std::string _buffer;
-
-    _HisTransBlockPair() {
-      _block = NULL;
-      _date = 0;
-      _buffer.clear();
-    }
-  } HisTransBlockPair;
+  // 历史数据块和K线的缓存，按内存预算淘汰
+  BlockCache _cache;
 
-  typedef std::unordered_map<std::string, HisTransBlockPair> HisTransBlockMap;
+  typedef std::shared_ptr<std::string> BlockBufferPtr;
 
-  typedef struct _HisOrdDtlBlockPair {
-    HisOrdDtlBlock *_block;
-    uint64_t _date;
-    std::string _buffer;
-
-    _HisOrdDtlBlockPair() {
-      _block = NULL;
-      _date = 0;
-      _buffer.clear();
-    }
-  } HisOrdDtlBlockPair;
-
-  typedef std::unordered_map<std::string, HisOrdDtlBlockPair> HisOrdDtlBlockMap;
-
-  typedef struct _HisOrdQueBlockPair {
-    HisOrdQueBlock *_block;
-    uint64_t _date;
-    std::string _buffer;
+  typedef struct _BarsList {
+    std::string _exchg;
+    std::string _code;
+    WTSKlinePeriod _period;
+    std::string _raw_code;
+    double _factor;
 
-    _HisOrdQueBlockPair() {
-      _block = NULL;
-      _date = 0;
-      _buffer.clear();
-    }
-  } HisOrdQueBlockPair;
+    _BarsList() : _factor(1.0) {}
 
-  typedef std::unordered_map<std::string, HisOrdQueBlockPair> HisOrdQueBlockMap;
+    // 历史K线加载完以后不再修改
+    std::vector<WTSBarStruct> _bars;
 
-  HisTickBlockMap _his_tick_map;
-  HisOrdDtlBlockMap _his_orddtl_map;
-  HisOrdQueBlockMap _his_ordque_map;
-  HisTransBlockMap _his_trans_map;
+    // 如果是后复权，就需要把实时数据拷贝到这里来
+    // 有切片在引用的时候不能原地修改，要拷贝一份再更新
+    std::shared_ptr<std::vector<WTSBarStruct>> _rt_bars;
+    StdUniqueMutex _mtx;
+  } BarsList;
+  typedef std::shared_ptr<BarsList> BarsListPtr;
 
 private:
   RTKlineBlockPair *getRTKilneBlock(const char *exchg, const char *code,
@@ -199,21 +165,47 @@ private:
   OrdDtlBlockPair *getRTOrdDtlBlock(const char *exchg, const char *code);
   TransBlockPair *getRTTransBlock(const char *exchg, const char *code);
 
+  /*
+   *	读取历史tick数据块并放入缓存
+   */
+  BlockBufferPtr loadHisTickBlock(const std::string &key,
+                                  const std::string &filename);
+
+  /*
+   *	读取历史L2数据块，解压以后放入缓存
+   *	@tag	数据类型，用于输出日志
+   */
+  BlockBufferPtr loadHisL2Block(const std::string &key,
+                                const std::string &filename, const char *tag);
+
+  /*
+   *	获取缓存的历史K线，没有则从文件读取
+   */
+  BarsListPtr getHisBars(void *codeInfo, const char *stdCode,
+                         WTSKlinePeriod period);
+
   /*
    *	将历史数据放入缓存
    */
-  bool cacheHisBarsFromFile(void *codeInfo, const std::string &key,
+  bool cacheHisBarsFromFile(void *codeInfo, BarsList &barList,
                             const char *stdCode, WTSKlinePeriod period);
 
-  uint32_t readBarsFromCacheByRange(const std::string &key, uint64_t stime,
+  /*
+   *	同步后复权的实时K线
+   *	调用方要持有实时K线块的锁
+   */
+  std::shared_ptr<std::vector<WTSBarStruct>>
+  syncRTBars(BarsList &barsList, RTKlineBlockPair *kPair);
+
+  uint32_t readBarsFromCacheByRange(BarsList &barsList, uint64_t stime,
                                     uint64_t etime,
                                     std::vector<WTSBarStruct> &ayBars,
                                     bool isDay = false);
-  WTSBarStruct *indexBarFromCacheByRange(const std::string &key, uint64_t stime,
+  WTSBarStruct *indexBarFromCacheByRange(BarsList &barsList, uint64_t stime,
                                          uint64_t etime, uint32_t &count,
                                          bool isDay = false);
 
-  WTSBarStruct *indexBarFromCacheByCount(const std::string &key, uint64_t etime,
+  WTSBarStruct *indexBarFromCacheByCount(BarsList &barsList, uint64_t etime,
                                          uint32_t &count, bool isDay = false);
 
   bool loadStkAdjFactorsFromFile(const char *adjfile);
@@ -264,23 +256,6 @@ private:
   StdThreadPtr _thrd_check;
   bool _stopped;
 
-  typedef struct _BarsList {
-    std::string _exchg;
-    std::string _code;
-    WTSKlinePeriod _period;
-    std::string _raw_code;
-    double _factor;
-
-    _BarsList() : _factor(1.0) {}
-
-    std::vector<WTSBarStruct> _bars;
-    std::vector<WTSBarStruct>
-        _rt_bars; // 如果是后复权，就需要把实时数据拷贝到这里来
-  } BarsList;
-
-  typedef std::unordered_map<std::string, BarsList> BarsCache;
-  BarsCache _bars_cache;
-
   // 除权因子
   typedef struct _AdjFactor {
     uint32_t _date;
@@ -290,11 +265,20 @@ private:
   typedef std::unordered_map<std::string, AdjFactorList> AdjFactorMap;
   AdjFactorMap _adj_factors;
 
+  // 除权因子加载以后只读，这里不能用[]，否则并发查询时会修改表
+  inline const AdjFactorList &getAdjFactors(const std::string &key) {
+    static const AdjFactorList empty;
+    auto it = _adj_factors.find(key);
+    if (it == _adj_factors.end())
+      return empty;
+    return it->second;
+  }
+
   inline const AdjFactorList &getAdjFactors(const char *code, const char *exchg,
                                             const char *pid) {
-    thread_local static char key[20] = {0};
+    thread_local static char key[64] = {0};
     fmtutil::format_to(key, "{}.{}.{}", exchg, pid, code);
-    return _adj_factors[key];
+    return getAdjFactors(std::string(key));
   }
 };
 
@@ -13,13 +13,15 @@
 #include "UDPCaster.h"
 #include "WtHelper.h"
 
+#include "../Includes/WTSDataDef.hpp"
 #include "../Includes/WTSVariant.hpp"
 #include "../Share/DLLHelper.hpp"
 
 #include "../WTSTools/WTSBaseDataMgr.h"
 #include "../WTSTools/WTSLogger.h"
 
-DataManager::DataManager() : _writer(NULL), _bd_mgr(NULL), _state_mon(NULL) {}
+DataManager::DataManager()
+    : _writer(NULL), _bd_mgr(NULL), _state_mon(NULL), _stat(NULL) {}
 
 DataManager::~DataManager() {}
 
@@ -34,6 +36,7 @@ bool DataManager::init(WTSVariant *params, WTSBaseDataMgr *bdMgr,
                        StateMonitor *stMonitor) {
   _bd_mgr = bdMgr;
   _state_mon = stMonitor;
+  _stat = StatHelper::one().get_channel("writer", StatHelper::CT_Writer);
 
   std::string module = params->getCString("module");
   if (module.empty())
@@ -92,7 +95,9 @@ bool DataManager::writeTick(WTSTickData *curTick, uint32_t procFlag) {
   if (_writer == NULL)
     return false;
 
-  return _writer->writeTick(curTick, procFlag);
+  bool ret = _writer->writeTick(curTick, procFlag);
+  _stat->set_depth(_writer->getQueueSize());
+  return ret;
 }
 
 bool DataManager::writeOrderQueue(WTSOrdQueData *curOrdQue) {
@@ -143,6 +148,12 @@ bool DataManager::canSessionReceive(const char *sid) {
 }
 
 void DataManager::broadcastTick(WTSTickData *curTick) {
+  // 从解析模块收到到落地完成的延迟
+  uint64_t recvTime = curTick->getRecvTime();
+  if (recvTime != 0)
+    _stat->add_latency(StatHelper::now_us() - recvTime);
+  _stat->add_count();
+
   for (IDataCaster *caster : _casters)
     caster->broadcast(curTick);
 }
@@ -12,6 +12,7 @@
 #include "../Includes/IDataWriter.h"
 #include "../Share/BoostMappingFile.hpp"
 #include "../Share/StdUtils.hpp"
+#include "StatHelper.hpp"
 
 NS_WTP_BEGIN
 class WTSTickData;
@@ -93,4 +94,6 @@ private:
   WTSBaseDataMgr *_bd_mgr;
   StateMonitor *_state_mon;
   std::vector<IDataCaster *> _casters;
+
+  StatHelper::ChannelStat *_stat; // 落地统计
 };
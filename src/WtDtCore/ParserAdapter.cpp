@@ -28,7 +28,7 @@
 ParserAdapter::ParserAdapter(WTSBaseDataMgr *bgMgr, DataManager *dtMgr,
                              IndexFactory *idxFactory)
     : _parser_api(NULL), _remover(NULL), _stopped(false), _bd_mgr(bgMgr),
-      _dt_mgr(dtMgr), _idx_fact(idxFactory), _cfg(NULL) {}
+      _dt_mgr(dtMgr), _idx_fact(idxFactory), _cfg(NULL), _stat(NULL) {}
 
 ParserAdapter::~ParserAdapter() {}
 
@@ -38,6 +38,7 @@ bool ParserAdapter::initExt(const char *id, IParserApi *api) {
 
   _parser_api = api;
   _id = id;
+  _stat = StatHelper::one().get_channel(id, StatHelper::CT_Parser);
 
   if (_parser_api) {
     _parser_api->registerSpi(this);
@@ -53,6 +54,7 @@ bool ParserAdapter::initExt(const char *id, IParserApi *api) {
 
       ayContract->release();
 
+      _contracts.build(_bd_mgr, contractSet);
       _parser_api->subscribe(contractSet);
       contractSet.clear();
     } else {
@@ -71,6 +73,7 @@ bool ParserAdapter::init(const char *id, WTSVariant *cfg) {
     return false;
 
   _id = id;
+  _stat = StatHelper::one().get_channel(id, StatHelper::CT_Parser);
 
   if (_cfg != NULL)
     return false;
@@ -208,6 +211,7 @@ bool ParserAdapter::init(const char *id, WTSVariant *cfg) {
         ayContract->release();
       }
 
+      _contracts.build(_bd_mgr, contractSet);
       _parser_api->subscribe(contractSet);
       contractSet.clear();
     } else {
@@ -298,16 +302,28 @@ void ParserAdapter::handleOrderQueue(WTSOrdQueData *ordQueData) {
   _dt_mgr->writeOrderQueue(ordQueData);
 }
 
+WTSContractInfo *ParserAdapter::getContract(const char *code,
+                                             const char *exchg /* = "" */) {
+  WTSContractInfo *cInfo = _contracts.get(code, exchg);
+  if (cInfo == NULL)
+    cInfo = _bd_mgr->getContract(code, exchg);
+  return cInfo;
+}
+
 void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag) {
   if (_stopped)
     return;
 
+  // 先打上接收时间，落地以后统计延迟
+  quote->setRecvTime(StatHelper::now_us());
+  _stat->add_count();
+
   if (quote->actiondate() == 0 || quote->tradingdate() == 0)
     return;
 
   WTSContractInfo *contract = quote->getContractInfo();
   if (contract == NULL) {
-    contract = _bd_mgr->getContract(quote->code(), quote->exchg());
+    contract = getContract(quote->code(), quote->exchg());
     quote->setContractInfo(contract);
   }
 
@@ -9,6 +9,8 @@
  */
 #pragma once
 #include "../Includes/IParserApi.h"
+#include "../Share/ContractTable.hpp"
+#include "StatHelper.hpp"
 #include <boost/core/noncopyable.hpp>
 #include <memory>
 #include <set>
@@ -56,6 +58,12 @@ public:
 
   virtual IBaseDataMgr *getBaseDataMgr() override;
 
+  /*
+   *	先查订阅时预先解析好的合约表,查不到再到基础数据里查找
+   */
+  virtual WTSContractInfo *getContract(const char *code,
+                                       const char *exchg = "") override;
+
 private:
   IParserApi *_parser_api;
   FuncDeleteParser _remover;
@@ -70,6 +78,10 @@ private:
   ExchgFilter _code_filter;
   WTSVariant *_cfg;
   std::string _id;
+
+  StatHelper::ChannelStat *_stat; // 接收统计
+
+  ContractTable _contracts; // 订阅的合约表
 };
 
 typedef std::shared_ptr<ParserAdapter> ParserAdapterPtr;
@@ -14,91 +14,65 @@ bool ShmCaster::init(WTSVariant *cfg) {
 
   _path = cfg->getCString("path");
 
+  // 队列容量, 会被调整为2的整数次幂
+  uint64_t capacity = cfg->getUInt64("capacity");
+  if (capacity == 0)
+    capacity = 8 * 1024;
+  std::size_t memSize = ShmCastQueue::mem_size(capacity);
+
   // 每次启动都重置该队列
   {
     BoostFile bf;
     bf.create_or_open_file(_path.c_str());
-    bf.truncate_file(sizeof(CastQueue));
+    bf.truncate_file(memSize);
     bf.close_file();
   }
 
   _mapfile.reset(new BoostMappingFile);
   _mapfile->map(_path.c_str());
-  _queue = (CastQueue *)_mapfile->addr();
-  new (_mapfile->addr()) CastQueue();
 
 #ifdef _MSC_VER
-  _queue->_pid = _getpid();
+  uint32_t pid = _getpid();
 #else
-  _queue->_pid = getpid();
+  uint32_t pid = getpid();
 #endif
+  _queue.create(_mapfile->addr(), capacity, pid);
 
   _inited = true;
-  WTSLogger::info("ShmCaste initialized @ {}", _path.c_str());
+  WTSLogger::info("ShmCaster initialized @ {}, capacity: {}, size: {}",
+                  _path.c_str(), _queue.capacity(), memSize);
 
   return true;
 }
 
 void ShmCaster::broadcast(WTSTickData *curTick) {
-  if (curTick == NULL || _queue == NULL || !_inited)
+  if (curTick == NULL || !_inited)
     return;
 
-  /*
-   *	先移动写的下标，然后写入数据
-   *	写完了以后，再移动读的下标
-   */
-  uint64_t wIdx = _queue->_writable++;
-  uint64_t realIdx = wIdx % _queue->_capacity;
-  _queue->_items[realIdx]._type = 0;
-  memcpy(&_queue->_items[realIdx]._tick, &curTick->getTickStruct(),
-         sizeof(WTSTickStruct));
-  _queue->_readable = wIdx;
+  _queue.publish(0, &curTick->getTickStruct(), sizeof(WTSTickStruct));
+  _stat->add_count();
 }
 
 void ShmCaster::broadcast(WTSOrdQueData *curOrdQue) {
-  if (curOrdQue == NULL || _queue == NULL || !_inited)
+  if (curOrdQue == NULL || !_inited)
     return;
 
-  /*
-   *	先移动写的下标，然后写入数据
-   *	写完了以后，再移动读的下标
-   */
-  uint64_t wIdx = _queue->_writable++;
-  uint64_t realIdx = wIdx % _queue->_capacity;
-  _queue->_items[realIdx]._type = 1;
-  memcpy(&_queue->_items[realIdx]._queue, &curOrdQue->getOrdQueStruct(),
-         sizeof(WTSOrdQueStruct));
-  _queue->_readable = wIdx;
+  _queue.publish(1, &curOrdQue->getOrdQueStruct(), sizeof(WTSOrdQueStruct));
+  _stat->add_count();
 }
 
 void ShmCaster::broadcast(WTSOrdDtlData *curOrdDtl) {
-  if (curOrdDtl == NULL || _queue == NULL || !_inited)
+  if (curOrdDtl == NULL || !_inited)
     return;
 
-  /*
-   *	先移动写的下标，然后写入数据
-   *	写完了以后，再移动读的下标
-   */
-  uint64_t wIdx = _queue->_writable++;
-  uint64_t realIdx = wIdx % _queue->_capacity;
-  _queue->_items[realIdx]._type = 2;
-  memcpy(&_queue->_items[realIdx]._order, &curOrdDtl->getOrdDtlStruct(),
-         sizeof(WTSOrdDtlStruct));
-  _queue->_readable = wIdx;
+  _queue.publish(2, &curOrdDtl->getOrdDtlStruct(), sizeof(WTSOrdDtlStruct));
+  _stat->add_count();
 }
 
 void ShmCaster::broadcast(WTSTransData *curTrans) {
-  if (curTrans == NULL || _queue == NULL || !_inited)
+  if (curTrans == NULL || !_inited)
     return;
 
-  /*
-   *	先移动写的下标，然后写入数据
-   *	写完了以后，再移动读的下标
-   */
-  uint64_t wIdx = _queue->_writable++;
-  uint64_t realIdx = wIdx % _queue->_capacity;
-  _queue->_items[realIdx]._type = 3;
-  memcpy(&_queue->_items[realIdx]._trans, &curTrans->getTransStruct(),
-         sizeof(WTSTransStruct));
-  _queue->_readable = wIdx;
+  _queue.publish(3, &curTrans->getTransStruct(), sizeof(WTSTransStruct));
+  _stat->add_count();
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 ﻿#pragma once
 #include "../Includes/WTSStruct.h"
 #include "../Share/BoostMappingFile.hpp"
+#include "../Share/ShmCastQueue.hpp"
 #include "IDataCaster.h"
+#include "StatHelper.hpp"
 #include <stdint.h>
 
 NS_WTP_BEGIN
@@ -12,35 +14,9 @@ USING_NS_WTP;
 
 class ShmCaster : public IDataCaster {
 public:
-#pragma pack(push, 8)
-  typedef struct _DataItem {
-    uint32_t _type; // 数据类型， 0-tick,1-委托队列,2-逐笔委托,3-逐笔成交
-    union {
-      WTSTickStruct _tick;
-      WTSOrdQueStruct _queue;
-      WTSOrdDtlStruct _order;
-      WTSTransStruct _trans;
-    };
-
-    _DataItem() { memset(this, 0, sizeof(_DataItem)); }
-  } DataItem;
-
-  template <int N = 8 * 1024> struct _DataQueue {
-    uint64_t _capacity = N;
-    volatile uint64_t _readable;
-    volatile uint64_t _writable;
-    uint32_t _pid;
-    DataItem _items[N];
-
-    _DataQueue() : _readable(UINT64_MAX), _writable(0), _pid(0) {}
-  };
-
-  typedef _DataQueue<8 * 1024> CastQueue;
-
-#pragma pack(pop)
-
-public:
-  ShmCaster() : _queue(NULL), _inited(false) {}
+  ShmCaster()
+      : _inited(false),
+        _stat(StatHelper::one().get_channel("shm", StatHelper::CT_Caster)) {}
 
   bool init(WTSVariant *cfg);
 
@@ -53,6 +29,9 @@ private:
   std::string _path;
   typedef std::shared_ptr<BoostMappingFile> MappedFilePtr;
   MappedFilePtr _mapfile;
-  CastQueue *_queue;
+  ShmCastQueue _queue;
   bool _inited;
+
+  // 队列是覆盖写的,写入方没有丢弃,只统计发送条数
+  StatHelper::ChannelStat *_stat;
 };
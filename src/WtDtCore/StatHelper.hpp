@@ -8,8 +8,18 @@
  * \brief 数据统计辅助类
  */
 #pragma once
-#include <boost/atomic.hpp>
-#include <boost/interprocess/detail/atomic.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../Includes/FasterDefs.h"
+#include "../Share/BoostFile.hpp"
+#include "../Share/StdUtils.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+USING_NS_WTP;
 
 class StatHelper {
 public:
@@ -18,6 +28,8 @@ public:
     return only;
   }
 
+  ~StatHelper() { stop_export(); }
+
 public:
   typedef struct _StatInfo {
     uint32_t _recv_packs;
@@ -35,10 +47,75 @@ public:
 
   typedef enum { UF_Recv = 0x0001, UF_Send = 0x0002 } UpdateFlag;
 
+  /*
+   *	统计通道类型
+   */
+  typedef enum {
+    CT_Parser, // 行情解析模块，统计接收速率
+    CT_Writer, // 数据落地模块，统计解析到落地的延迟和队列深度
+    CT_Caster  // 广播模块，统计发送速率和丢弃条数
+  } ChannelType;
+
+  /*
+   *	通道统计
+   *	计数器都是原子变量，数据线程直接累加，不用加锁
+   */
+  typedef struct _ChannelStat {
+    std::string _name;
+    ChannelType _type;
+    std::atomic<uint64_t> _count;   // 接收或者发送的条数
+    std::atomic<uint64_t> _dropped; // 丢弃的条数
+    std::atomic<uint64_t> _lat_sum; // 延迟累计，单位微秒
+    std::atomic<uint64_t> _lat_cnt;
+    std::atomic<uint64_t> _lat_max;
+    std::atomic<uint64_t> _depth; // 队列深度
+
+    // 以下由导出线程使用，用来计算区间速率和区间延迟
+    uint64_t _last_count;
+    uint64_t _last_lat_sum;
+    uint64_t _last_lat_cnt;
+
+    _ChannelStat(const char *name, ChannelType cType)
+        : _name(name), _type(cType), _count(0), _dropped(0), _lat_sum(0),
+          _lat_cnt(0), _lat_max(0), _depth(0), _last_count(0),
+          _last_lat_sum(0), _last_lat_cnt(0) {}
+
+    inline void add_count(uint64_t cnt = 1) {
+      _count.fetch_add(cnt, std::memory_order_relaxed);
+    }
+
+    inline void add_dropped(uint64_t cnt = 1) {
+      _dropped.fetch_add(cnt, std::memory_order_relaxed);
+    }
+
+    inline void set_depth(uint64_t depth) {
+      _depth.store(depth, std::memory_order_relaxed);
+    }
+
+    inline void add_latency(uint64_t us) {
+      _lat_sum.fetch_add(us, std::memory_order_relaxed);
+      _lat_cnt.fetch_add(1, std::memory_order_relaxed);
+
+      uint64_t curMax = _lat_max.load(std::memory_order_relaxed);
+      while (us > curMax && !_lat_max.compare_exchange_weak(
+                                curMax, us, std::memory_order_relaxed))
+        ;
+    }
+  } ChannelStat;
+
+  /*
+   *	统计用的时钟，单调递增，单位微秒
+   */
+  static inline uint64_t now_us() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
 public:
   void updateStatInfo(StatType sType, uint32_t recvPacks, uint32_t sendPacks,
                       uint64_t sendBytes) {
-    BoostWriteLock lock(_mutexes[sType]);
+    StdUniqueLock lock(_mutexes[sType]);
     StatInfo &sInfo = _stats[sType];
     sInfo._recv_packs += recvPacks;
     sInfo._send_packs += sendPacks;
@@ -46,20 +123,137 @@ public:
       sInfo._send_bytes = sendBytes;
     else
       sInfo._send_bytes += sendBytes;
-
-    uint32_t flag = 0;
-    if (recvPacks > 0)
-      flag |= UF_Recv;
-    if (sendPacks > 0)
-      flag |= UF_Send;
   }
 
   StatInfo getStatInfo(StatType sType) {
-    BoostReadLock lock(_mutexes[sType]);
+    StdUniqueLock lock(_mutexes[sType]);
     return _stats[sType];
   }
 
+  /*
+   *	获取统计通道，不存在则创建
+   *	返回的指针一直有效，调用方初始化的时候保存下来，热路径上直接使用
+   */
+  ChannelStat *get_channel(const char *name, ChannelType cType) {
+    StdUniqueLock lock(_mtx_channels);
+    for (ChannelStat *chnl : _channels) {
+      if (chnl->_type == cType && chnl->_name == name)
+        return chnl;
+    }
+
+    ChannelStat *chnl = new ChannelStat(name, cType);
+    _channels.emplace_back(chnl);
+    return chnl;
+  }
+
+  /*
+   *	启动定时导出
+   *	@path		快照文件路径，每次导出覆盖
+   *	@interval	导出间隔，单位秒
+   */
+  void start_export(const char *path, uint32_t interval) {
+    if (_thrd_export)
+      return;
+
+    _path = path;
+    _interval = (interval == 0) ? 5 : interval;
+    _stopped = false;
+    _last_export = now_us();
+    _thrd_export.reset(new StdThread([this]() {
+      StdUniqueLock lock(_mtx_export);
+      while (!_stopped) {
+        _cond_export.wait_for(lock, std::chrono::seconds(_interval));
+        if (_stopped)
+          break;
+
+        export_snapshot();
+      }
+    }));
+  }
+
+  void stop_export() {
+    if (!_thrd_export)
+      return;
+
+    {
+      StdUniqueLock lock(_mtx_export);
+      _stopped = true;
+      _cond_export.notify_all();
+    }
+    _thrd_export->join();
+    _thrd_export.reset();
+  }
+
+  /*
+   *	生成一份文本快照，每个通道一行
+   *	速率和平均延迟都是上一次快照以来的区间值
+   */
+  std::string snapshot() {
+    static const char *TYPE_NAMES[] = {"parser", "writer", "caster"};
+
+    uint64_t now = now_us();
+    double elapse = (now - _last_export) / 1000000.0;
+    _last_export = now;
+
+    std::string ret = fmt::format("# {} {:06d}\n", TimeUtils::getCurDate(),
+                                  TimeUtils::getCurMin());
+    ret += "type,channel,count,rate,dropped,lat_avg_us,lat_max_us,depth\n";
+
+    StdUniqueLock lock(_mtx_channels);
+    for (ChannelStat *chnl : _channels) {
+      uint64_t cnt = chnl->_count.load(std::memory_order_relaxed);
+      uint64_t latSum = chnl->_lat_sum.load(std::memory_order_relaxed);
+      uint64_t latCnt = chnl->_lat_cnt.load(std::memory_order_relaxed);
+      uint64_t latMax = chnl->_lat_max.exchange(0, std::memory_order_relaxed);
+
+      double rate = (elapse > 0) ? (cnt - chnl->_last_count) / elapse : 0.0;
+      uint64_t latAvg =
+          (latCnt > chnl->_last_lat_cnt)
+              ? (latSum - chnl->_last_lat_sum) / (latCnt - chnl->_last_lat_cnt)
+              : 0;
+
+      chnl->_last_count = cnt;
+      chnl->_last_lat_sum = latSum;
+      chnl->_last_lat_cnt = latCnt;
+
+      ret += fmt::format("{},{},{},{:.1f},{},{},{},{}\n",
+                         TYPE_NAMES[chnl->_type], chnl->_name, cnt, rate,
+                         chnl->_dropped.load(std::memory_order_relaxed),
+                         latAvg, latMax,
+                         chnl->_depth.load(std::memory_order_relaxed));
+    }
+
+    return ret;
+  }
+
+private:
+  StatHelper() : _interval(5), _stopped(true), _last_export(now_us()) {}
+
+  void export_snapshot() {
+    std::string content = snapshot();
+
+    // 先写临时文件再改名，读取方不会读到写了一半的文件
+    std::string tmpPath = _path + ".tmp";
+    if (!BoostFile::write_file_contents(tmpPath.c_str(), content.data(),
+                                        (uint32_t)content.size()))
+      return;
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmpPath, _path, ec);
+  }
+
 private:
   StatInfo _stats[5];
-  BoostRWMutex _mutexes[5];
+  StdUniqueMutex _mutexes[5];
+
+  std::vector<ChannelStat *> _channels; // 通道只增不删，指针一直有效
+  StdUniqueMutex _mtx_channels;
+
+  std::string _path;
+  uint32_t _interval;
+  bool _stopped;
+  uint64_t _last_export;
+  StdThreadPtr _thrd_export;
+  StdUniqueMutex _mtx_export;
+  StdCondVariable _cond_export;
 };
@@ -18,11 +18,24 @@
 #include "../WTSTools/WTSBaseDataMgr.h"
 #include "../WTSTools/WTSLogger.h"
 
+#include <algorithm>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/socket.h>
+#endif
+
 #define UDP_MSG_SUBSCRIBE 0x100
+#define UDP_MSG_RETRANSMIT 0x110    // 重传请求
 #define UDP_MSG_PUSHTICK 0x200
-#define UDP_MSG_PUSHORDQUE 0x201 // 委托队列
-#define UDP_MSG_PUSHORDDTL 0x202 // 委托明细
-#define UDP_MSG_PUSHTRANS 0x203  // 逐笔成交
+#define UDP_MSG_PUSHORDQUE 0x201    // 委托队列
+#define UDP_MSG_PUSHORDDTL 0x202    // 委托明细
+#define UDP_MSG_PUSHTRANS 0x203     // 逐笔成交
+#define UDP_MSG_PUSHTICKDELTA 0x204 // 增量编码的tick
+#define UDP_MSG_PUSHBATCH 0x300     // 批量数据
+#define UDP_MSG_PUSHSEQ 0x301       // 带序号的数据
+
+#define MAX_RETRANS_COUNT 256 // 单次重传的最大数据包个数
 
 #pragma pack(push, 1)
 // UDP请求包
@@ -31,6 +44,33 @@ typedef struct _UDPReqPacket {
   char _data[1020];
 } UDPReqPacket;
 
+// 批量数据包头,后面跟着_count个UDPDataPacket
+typedef struct _UDPBatchHead {
+  uint32_t _type;
+  uint16_t _count;
+  uint16_t _reserved;
+} UDPBatchHead;
+
+// 序号包头,后面跟着一个普通数据包或者批量数据包
+typedef struct _UDPSeqHead {
+  uint32_t _type;
+  uint32_t _channel;
+  uint64_t _seq;
+} UDPSeqHead;
+
+// 增量tick包头,后面跟着_len字节的编码数据
+typedef struct _UDPDeltaHead {
+  uint32_t _type;
+  uint16_t _len;
+} UDPDeltaHead;
+
+// 重传请求,放在UDPReqPacket的_data里
+typedef struct _UDPRetransReq {
+  uint32_t _channel;
+  uint64_t _from;
+  uint32_t _count;
+} UDPRetransReq;
+
 // UDPTick数据包
 template <typename T> struct UDPDataPacket {
   uint32_t _type;
@@ -42,7 +82,11 @@ typedef UDPDataPacket<WTSOrdQueStruct> UDPOrdQuePacket;
 typedef UDPDataPacket<WTSOrdDtlStruct> UDPOrdDtlPacket;
 typedef UDPDataPacket<WTSTransStruct> UDPTransPacket;
 
-UDPCaster::UDPCaster() : m_bTerminated(false), m_bdMgr(NULL), m_dtMgr(NULL) {}
+UDPCaster::UDPCaster()
+    : m_bTerminated(false), m_bdMgr(NULL), m_dtMgr(NULL), m_bBatch(false),
+      m_uMaxPktSize(1400), m_pktCnt(0), m_bSeqNo(false), m_uChannel(0),
+      m_uNextSeq(1), m_bDelta(false),
+      m_stat(StatHelper::one().get_channel("udp", StatHelper::CT_Caster)) {}
 
 UDPCaster::~UDPCaster() {}
 
@@ -54,6 +98,44 @@ bool UDPCaster::init(WTSVariant *cfg, WTSBaseDataMgr *bdMgr,
   if (!cfg->getBoolean("active"))
     return false;
 
+  // 批量模式下,单个数据报的最大长度,默认按照以太网MTU留出余量
+  m_bBatch = cfg->getBoolean("batch");
+  if (cfg->has("pktsize"))
+    m_uMaxPktSize = std::min(cfg->getUInt32("pktsize"), (uint32_t)65000);
+
+  // 序号模式,每个数据报都带上通道号和序号,并缓存最近的数据报用于重传
+  m_bSeqNo = cfg->getBoolean("seqno");
+  m_uChannel = cfg->getUInt32("channel");
+  if (m_bSeqNo) {
+    uint32_t cacheSize = cfg->getUInt32("cachesize");
+    if (cacheSize == 0)
+      cacheSize = 4096;
+    m_cachePkts.resize(cacheSize);
+    m_cacheSeqs.resize(cacheSize, 0);
+    WTSLogger::info("UDPCaster sequencing packets on channel {}, {} packets "
+                    "cached for retransmission",
+                    m_uChannel, cacheSize);
+  }
+
+  // 增量模式,每个合约每隔keyframe笔发送一个完整的关键帧
+  m_bDelta = cfg->getBoolean("delta");
+  if (m_bDelta) {
+    uint32_t keyframe = cfg->getUInt32("keyframe");
+    if (keyframe == 0)
+      keyframe = 100;
+    m_tickEncoder.set_keyframe_span(keyframe);
+    WTSLogger::info("UDPCaster sending delta encoded ticks, keyframe span: {}",
+                    keyframe);
+  }
+
+  uint32_t minSize = sizeof(UDPBatchHead) + sizeof(UDPTickPacket) +
+                     (m_bSeqNo ? sizeof(UDPSeqHead) : 0);
+  if (m_uMaxPktSize < minSize)
+    m_uMaxPktSize = minSize;
+  if (m_bBatch)
+    WTSLogger::info("UDPCaster running in batch mode, max packet size: {}",
+                    m_uMaxPktSize);
+
   WTSVariant *cfgBC = cfg->get("broadcast");
   if (cfgBC) {
     for (uint32_t idx = 0; idx < cfgBC->size(); idx++) {
@@ -93,6 +175,9 @@ void UDPCaster::start(int sport) {
     m_sktBroadcast->set_option(option);
   }
 
+  for (const UDPReceiverPtr &receiver : m_listRawRecver)
+    m_rawEPs.emplace_back(receiver->_ep);
+
   try {
     m_sktSubscribe.reset(new UDPSocket(
         m_ioservice,
@@ -138,7 +223,9 @@ void UDPCaster::do_receive() {
 
           std::string data;
           // 处理请求
-          if (req->_type == UDP_MSG_SUBSCRIBE) {
+          if (req->_type == UDP_MSG_RETRANSMIT) {
+            do_retransmit(*(UDPRetransReq *)req->_data, m_senderEP);
+          } else if (req->_type == UDP_MSG_SUBSCRIBE) {
             const StringVector &ay = StrUtil::split(req->_data, ",");
             std::string code, exchg;
             for (const std::string &fullcode : ay) {
@@ -196,6 +283,44 @@ void UDPCaster::do_receive() {
       });
 }
 
+void UDPCaster::do_retransmit(const UDPRetransReq &req, EndPoint ep) {
+  if (!m_bSeqNo || req._channel != m_uChannel)
+    return;
+
+  // 重传的增量帧接不上接收端的解码状态,下一笔全部发关键帧
+  if (m_bDelta)
+    m_tickEncoder.request_keyframes();
+
+  uint32_t count = std::min(req._count, (uint32_t)MAX_RETRANS_COUNT);
+  uint32_t sent = 0;
+  for (uint64_t seq = req._from; seq < req._from + count; seq++) {
+    std::string *data = NULL;
+    {
+      SpinLock lock(m_mtxCache);
+      std::size_t idx = seq % m_cachePkts.size();
+      // 已经被新的数据覆盖了,就没法重传了
+      if (m_cacheSeqs[idx] != seq)
+        continue;
+      data = new std::string(m_cachePkts[idx]);
+    }
+
+    sent++;
+    m_sktSubscribe->async_send_to(
+        boost::asio::buffer(*data, data->size()), ep,
+        [data](const boost::system::error_code &ec,
+               std::size_t /*bytes_sent*/) {
+          delete data;
+          if (ec) {
+            WTSLogger::error("Sending data on UDP failed: {}",
+                             ec.message().c_str());
+          }
+        });
+  }
+
+  WTSLogger::debug("{} of {} packets from #{} retransmitted to {}:{}", sent,
+                   req._count, req._from, ep.address().to_string(), ep.port());
+}
+
 bool UDPCaster::addBRecver(const char *remote, int port, int type /* = 0 */) {
   try {
     boost::asio::ip::address_v4 addr =
@@ -261,6 +386,7 @@ void UDPCaster::do_broadcast(WTSObject *data, uint32_t dataType) {
   {
     StdUniqueLock lock(m_mtxCast);
     m_dataQue.push(CastData(data, dataType));
+    m_stat->set_depth(m_dataQue.size());
   }
 
   if (m_thrdCast == NULL) {
@@ -276,81 +402,61 @@ void UDPCaster::do_broadcast(WTSObject *data, uint32_t dataType) {
         {
           StdUniqueLock lock(m_mtxCast);
           tmpQue.swap(m_dataQue);
+          m_stat->set_depth(0);
         }
 
+        if (m_listRawGroup.empty() && m_listRawRecver.empty())
+          continue;
+
+        // 先把这一轮的数据全部打包
+        m_pktCnt = 0;
+        std::string *curPkt = NULL;
+        std::size_t hdrLen = m_bSeqNo ? sizeof(UDPSeqHead) : 0;
         while (!tmpQue.empty()) {
           const CastData &castData = tmpQue.front();
-
           if (castData._data == NULL)
             break;
 
-          // 直接广播
-          if (!m_listRawGroup.empty() || !m_listRawRecver.empty()) {
-            std::string buf_raw;
-            if (castData._datatype == UDP_MSG_PUSHTICK) {
-              buf_raw.resize(sizeof(UDPTickPacket));
-              UDPTickPacket *pack = (UDPTickPacket *)buf_raw.data();
-              pack->_type = castData._datatype;
-              WTSTickData *curObj = (WTSTickData *)castData._data;
-              memcpy(&pack->_data, &curObj->getTickStruct(),
-                     sizeof(WTSTickStruct));
-            } else if (castData._datatype == UDP_MSG_PUSHORDDTL) {
-              buf_raw.resize(sizeof(UDPOrdDtlPacket));
-              UDPOrdDtlPacket *pack = (UDPOrdDtlPacket *)buf_raw.data();
-              pack->_type = castData._datatype;
-              WTSOrdDtlData *curObj = (WTSOrdDtlData *)castData._data;
-              memcpy(&pack->_data, &curObj->getOrdDtlStruct(),
-                     sizeof(WTSOrdDtlStruct));
-            } else if (castData._datatype == UDP_MSG_PUSHORDQUE) {
-              buf_raw.resize(sizeof(UDPOrdQuePacket));
-              UDPOrdQuePacket *pack = (UDPOrdQuePacket *)buf_raw.data();
-              pack->_type = castData._datatype;
-              WTSOrdQueData *curObj = (WTSOrdQueData *)castData._data;
-              memcpy(&pack->_data, &curObj->getOrdQueStruct(),
-                     sizeof(WTSOrdQueStruct));
-            } else if (castData._datatype == UDP_MSG_PUSHTRANS) {
-              buf_raw.resize(sizeof(UDPTransPacket));
-              UDPTransPacket *pack = (UDPTransPacket *)buf_raw.data();
-              pack->_type = castData._datatype;
-              WTSTransData *curObj = (WTSTransData *)castData._data;
-              memcpy(&pack->_data, &curObj->getTransStruct(),
-                     sizeof(WTSTransStruct));
-            } else {
-              break;
-            }
-
-            // 广播
-            boost::system::error_code ec;
-            for (auto it = m_listRawRecver.begin(); it != m_listRawRecver.end();
-                 it++) {
-              const UDPReceiverPtr &receiver = (*it);
-              m_sktBroadcast->send_to(boost::asio::buffer(buf_raw),
-                                      receiver->_ep, 0, ec);
-              if (ec) {
-                WTSLogger::error(
-                    "Error occured while sending to ({}:{}): {}({})",
-                    receiver->_ep.address().to_string(), receiver->_ep.port(),
-                    ec.value(), ec.message());
-              }
-            }
-
-            // 组播
-            for (auto it = m_listRawGroup.begin(); it != m_listRawGroup.end();
-                 it++) {
-              const MulticastPair &item = *it;
-              it->first->send_to(boost::asio::buffer(buf_raw), item.second->_ep,
-                                 0, ec);
-              if (ec) {
-                WTSLogger::error(
-                    "Error occured while sending to ({}:{}): {}({})",
-                    item.second->_ep.address().to_string(),
-                    item.second->_ep.port(), ec.value(), ec.message());
-              }
-            }
+          // 增量编码的tick是最大的数据包
+          char buf[sizeof(UDPDeltaHead) + TICK_DELTA_MAX_SIZE];
+          uint32_t len = pack_data(castData._data, castData._datatype, buf);
+          tmpQue.pop();
+          if (len == 0)
+            continue;
+
+          // 非批量模式,或者当前包放不下了,就新开一个包
+          if (!m_bBatch || curPkt == NULL ||
+              curPkt->size() + len > m_uMaxPktSize) {
+            if (m_pktCnt == m_packets.size())
+              m_packets.emplace_back();
+            curPkt = &m_packets[m_pktCnt++];
+            curPkt->clear();
+            curPkt->append(hdrLen, 0);
+            if (m_bBatch)
+              curPkt->append(sizeof(UDPBatchHead), 0);
           }
 
-          tmpQue.pop();
+          curPkt->append(buf, len);
+          if (m_bBatch) {
+            UDPBatchHead *head = (UDPBatchHead *)(curPkt->data() + hdrLen);
+            head->_type = UDP_MSG_PUSHBATCH;
+            head->_count++;
+          }
         }
+
+        if (m_pktCnt == 0)
+          continue;
+
+        if (m_bSeqNo)
+          stamp_packets();
+
+        // 广播
+        if (!m_rawEPs.empty())
+          send_packets(*m_sktBroadcast, m_rawEPs.data(), m_rawEPs.size());
+
+        // 组播
+        for (const MulticastPair &item : m_listRawGroup)
+          send_packets(*item.first, &item.second->_ep, 1);
       }
     }));
   } else {
@@ -358,6 +464,120 @@ void UDPCaster::do_broadcast(WTSObject *data, uint32_t dataType) {
   }
 }
 
+void UDPCaster::stamp_packets() {
+  SpinLock lock(m_mtxCache);
+  std::size_t cacheSize = m_cachePkts.size();
+  for (std::size_t i = 0; i < m_pktCnt; i++) {
+    std::string &pkt = m_packets[i];
+    UDPSeqHead *head = (UDPSeqHead *)pkt.data();
+    head->_type = UDP_MSG_PUSHSEQ;
+    head->_channel = m_uChannel;
+    head->_seq = m_uNextSeq++;
+
+    // 缓存下来,用于重传
+    std::size_t idx = head->_seq % cacheSize;
+    m_cachePkts[idx] = pkt;
+    m_cacheSeqs[idx] = head->_seq;
+  }
+}
+
+uint32_t UDPCaster::pack_data(WTSObject *data, uint32_t dataType, char *buf) {
+  if (dataType == UDP_MSG_PUSHTICK && m_bDelta) {
+    UDPDeltaHead *head = (UDPDeltaHead *)buf;
+    head->_type = UDP_MSG_PUSHTICKDELTA;
+    head->_len = (uint16_t)m_tickEncoder.encode(
+        ((WTSTickData *)data)->getTickStruct(), buf + sizeof(UDPDeltaHead));
+    return sizeof(UDPDeltaHead) + head->_len;
+  } else if (dataType == UDP_MSG_PUSHTICK) {
+    UDPTickPacket *pack = (UDPTickPacket *)buf;
+    pack->_type = dataType;
+    memcpy(&pack->_data, &((WTSTickData *)data)->getTickStruct(),
+           sizeof(WTSTickStruct));
+    return sizeof(UDPTickPacket);
+  } else if (dataType == UDP_MSG_PUSHORDDTL) {
+    UDPOrdDtlPacket *pack = (UDPOrdDtlPacket *)buf;
+    pack->_type = dataType;
+    memcpy(&pack->_data, &((WTSOrdDtlData *)data)->getOrdDtlStruct(),
+           sizeof(WTSOrdDtlStruct));
+    return sizeof(UDPOrdDtlPacket);
+  } else if (dataType == UDP_MSG_PUSHORDQUE) {
+    UDPOrdQuePacket *pack = (UDPOrdQuePacket *)buf;
+    pack->_type = dataType;
+    memcpy(&pack->_data, &((WTSOrdQueData *)data)->getOrdQueStruct(),
+           sizeof(WTSOrdQueStruct));
+    return sizeof(UDPOrdQuePacket);
+  } else if (dataType == UDP_MSG_PUSHTRANS) {
+    UDPTransPacket *pack = (UDPTransPacket *)buf;
+    pack->_type = dataType;
+    memcpy(&pack->_data, &((WTSTransData *)data)->getTransStruct(),
+           sizeof(WTSTransStruct));
+    return sizeof(UDPTransPacket);
+  }
+
+  return 0;
+}
+
+void UDPCaster::send_packets(UDPSocket &skt, const EndPoint *eps,
+                             std::size_t epCnt) {
+#ifdef __linux__
+  // 所有包和所有地址的组合,一次sendmmsg发出去
+  std::size_t total = m_pktCnt * epCnt;
+  thread_local static std::vector<struct mmsghdr> msgs;
+  thread_local static std::vector<struct iovec> iovs;
+  msgs.resize(total);
+  iovs.resize(total);
+
+  std::size_t idx = 0;
+  for (std::size_t i = 0; i < m_pktCnt; i++) {
+    std::string &pkt = m_packets[i];
+    for (std::size_t k = 0; k < epCnt; k++, idx++) {
+      iovs[idx].iov_base = (void *)pkt.data();
+      iovs[idx].iov_len = pkt.size();
+
+      struct mmsghdr &msg = msgs[idx];
+      memset(&msg, 0, sizeof(struct mmsghdr));
+      msg.msg_hdr.msg_name = (void *)eps[k].data();
+      msg.msg_hdr.msg_namelen = (socklen_t)eps[k].size();
+      msg.msg_hdr.msg_iov = &iovs[idx];
+      msg.msg_hdr.msg_iovlen = 1;
+    }
+  }
+
+  int fd = skt.native_handle();
+  std::size_t sent = 0;
+  while (sent < total) {
+    int ret = sendmmsg(fd, &msgs[sent], (unsigned int)(total - sent), 0);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+
+      WTSLogger::error("Error occured while sending {} packets: {}({})",
+                       total - sent, strerror(errno), errno);
+      break;
+    }
+    sent += ret;
+  }
+  m_stat->add_count(sent);
+  m_stat->add_dropped(total - sent);
+#else
+  boost::system::error_code ec;
+  for (std::size_t i = 0; i < m_pktCnt; i++) {
+    const std::string &pkt = m_packets[i];
+    for (std::size_t k = 0; k < epCnt; k++) {
+      skt.send_to(boost::asio::buffer(pkt), eps[k], 0, ec);
+      if (ec) {
+        m_stat->add_dropped();
+        WTSLogger::error("Error occured while sending to ({}:{}): {}({})",
+                         eps[k].address().to_string(), eps[k].port(),
+                         ec.value(), ec.message());
+      } else {
+        m_stat->add_count();
+      }
+    }
+  }
+#endif
+}
+
 void UDPCaster::handle_send_broad(const EndPoint &ep,
                                   const boost::system::error_code &error,
                                   std::size_t bytes_transferred) {
@@ -9,8 +9,11 @@
  */
 #pragma once
 #include "../Includes/WTSObject.hpp"
+#include "../Share/SpinMutex.hpp"
 #include "../Share/StdUtils.hpp"
+#include "../Share/TickDeltaCodec.hpp"
 #include "IDataCaster.h"
+#include "StatHelper.hpp"
 
 #include <boost/asio.hpp>
 #include <queue>
@@ -23,6 +26,7 @@ USING_NS_WTP;
 
 class WTSBaseDataMgr;
 class DataManager;
+struct _UDPRetransReq;
 
 class UDPCaster : public IDataCaster {
 public:
@@ -43,6 +47,9 @@ public:
   typedef std::shared_ptr<UDPReceiver> UDPReceiverPtr;
   typedef std::vector<UDPReceiverPtr> ReceiverList;
 
+  typedef boost::asio::ip::udp::socket UDPSocket;
+  typedef std::shared_ptr<UDPSocket> UDPSocketPtr;
+
 private:
   void handle_send_broad(const EndPoint &ep,
                          const boost::system::error_code &error,
@@ -55,6 +62,28 @@ private:
 
   void do_broadcast(WTSObject *data, uint32_t dataType);
 
+  /*
+   *	把一条数据按照UDPDataPacket的格式写到buf里
+   *	返回写入的字节数,不支持的数据类型返回0
+   */
+  uint32_t pack_data(WTSObject *data, uint32_t dataType, char *buf);
+
+  /*
+   *	把一批数据包发送到一组地址
+   *	linux下用sendmmsg一次系统调用发出去,其他平台逐个发送
+   */
+  void send_packets(UDPSocket &skt, const EndPoint *eps, std::size_t epCnt);
+
+  /*
+   *	给待发送的数据包打上序号,并放入重传缓存
+   */
+  void stamp_packets();
+
+  /*
+   *	处理重传请求,从缓存里找到对应序号的数据包单播给请求方
+   */
+  void do_retransmit(const _UDPRetransReq &req, EndPoint ep);
+
 public:
   bool init(WTSVariant *cfg, WTSBaseDataMgr *bdMgr, DataManager *dtMgr);
   void start(int bport);
@@ -69,10 +98,6 @@ public:
   virtual void broadcast(WTSOrdDtlData *curOrdDtl) override;
   virtual void broadcast(WTSTransData *curTrans) override;
 
-private:
-  typedef boost::asio::ip::udp::socket UDPSocket;
-  typedef std::shared_ptr<UDPSocket> UDPSocketPtr;
-
   enum { max_length = 2048 };
 
   boost::asio::ip::udp::endpoint m_senderEP;
@@ -126,4 +151,30 @@ private:
   } CastData;
 
   std::queue<CastData> m_dataQue;
+
+  // 批量模式,多条数据打包到一个数据报里
+  bool m_bBatch;
+  uint32_t m_uMaxPktSize; // 单个数据报的最大长度
+
+  // 待发送的数据包,只在广播线程里使用
+  std::vector<std::string> m_packets;
+  std::size_t m_pktCnt;
+  std::vector<EndPoint> m_rawEPs;
+
+  // 序号模式
+  bool m_bSeqNo;
+  uint32_t m_uChannel;
+  uint64_t m_uNextSeq;
+
+  // 重传缓存,按照序号取模存放最近的数据包
+  SpinMutex m_mtxCache;
+  std::vector<std::string> m_cachePkts;
+  std::vector<uint64_t> m_cacheSeqs;
+
+  // 增量模式,tick只发送和上一笔相比变化的字段
+  bool m_bDelta;
+  TickDeltaEncoder m_tickEncoder;
+
+  // 发送统计,按数据包和地址的组合计数
+  StatHelper::ChannelStat *m_stat;
 };
\ No newline at end of file
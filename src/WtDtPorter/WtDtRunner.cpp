@@ -10,6 +10,7 @@
 #include "WtDtRunner.h"
 #include "ExpParser.h"
 
+#include "../WtDtCore/StatHelper.hpp"
 #include "../WtDtCore/WtHelper.h"
 
 #include "../Includes/WTSContractInfo.hpp"
@@ -152,6 +153,17 @@ void WtDtRunner::initialize(const char *cfgFile, const char *logCfg,
     _data_mgr.add_caster(&_udp_caster);
   }
 
+  // 运行统计,定时导出各个通道的速率和延迟
+  WTSVariant *cfgStat = config->get("stats");
+  if (cfgStat && cfgStat->getBoolean("active")) {
+    std::string path = cfgStat->getCString("path");
+    if (path.empty())
+      path = "./stats.csv";
+    StatHelper::one().start_export(path.c_str(),
+                                   cfgStat->getUInt32("interval"));
+    WTSLogger::info("Runtime stats will be exported to {}", path);
+  }
+
   // By Wesley @ 2021.12.27
   // 全天候模式，不需要再使用状态机
   bool bAlldayMode = config->getBoolean("allday");
@@ -52,6 +52,7 @@ bool ParserAdapter::initExt(const char *id, IParserApi *api) {
 
       ayContract->release();
 
+      _contracts.build(_bd_mgr, contractSet);
       _parser_api->subscribe(contractSet);
       contractSet.clear();
     } else {
@@ -207,6 +208,7 @@ bool ParserAdapter::init(const char *id, WTSVariant *cfg) {
         ayContract->release();
       }
 
+      _contracts.build(_bd_mgr, contractSet);
       _parser_api->subscribe(contractSet);
       contractSet.clear();
     } else {
@@ -285,6 +287,14 @@ void ParserAdapter::handleOrderQueue(WTSOrdQueData *ordQueData) {
     return;
 }
 
+WTSContractInfo *ParserAdapter::getContract(const char *code,
+                                             const char *exchg /* = "" */) {
+  WTSContractInfo *cInfo = _contracts.get(code, exchg);
+  if (cInfo == NULL)
+    cInfo = _bd_mgr->getContract(code, exchg);
+  return cInfo;
+}
+
 void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag) {
   if (quote == NULL || _stopped || quote->actiondate() == 0 ||
       quote->tradingdate() == 0)
@@ -29,3 +29,7 @@ typedef void(PORTER_FLAG *FuncOnTickCallback)(const char *stdCode,
 typedef void(PORTER_FLAG *FuncOnBarCallback)(const char *stdCode,
                                              const char *period,
                                              WTSBarStruct *bar);
+typedef void(PORTER_FLAG *FuncOnBarStreamCallback)(const char *stdCode,
+                                                   const char *period,
+                                                   WTSBarStruct *bar,
+                                                   bool isClosed);
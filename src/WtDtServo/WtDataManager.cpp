@@ -31,10 +31,18 @@ WtDataManager::WtDataManager()
 
 WtDataManager::~WtDataManager() {
   for (auto &m : _bars_cache) {
-    if (m.second._bars != NULL)
-      m.second._bars->release();
+    if (m.second->_bars != NULL)
+      m.second->_bars->release();
   }
   _bars_cache.clear();
+
+  for (auto &m : _streams) {
+    for (auto &s : m.second) {
+      if (s.second._bars != NULL)
+        s.second._bars->release();
+    }
+  }
+  _streams.clear();
 }
 
 bool WtDataManager::initStore(WTSVariant *cfg) {
@@ -149,6 +157,43 @@ WTSSessionInfo *WtDataManager::get_session_info(const char *sid,
   return cInfo->getSessionInfo();
 }
 
+/*
+ *	缓存的K线还被切片引用的时候，先复制一份再修改
+ */
+static void detach_bars(WTSKlineData *&kData) {
+  if (kData->retainCount() <= 1)
+    return;
+
+  WTSKlineData *newData = WTSKlineData::create(kData->code(), 0);
+  newData->setPeriod(kData->period(), kData->times());
+  newData->setClosed(kData->isClosed());
+  newData->setUnixTime(kData->isUnixTime());
+  newData->getDataRef() = kData->getDataRef();
+  kData->release();
+  kData = newData;
+}
+
+WtDataManager::BarCachePtr
+WtDataManager::get_bar_cache(const std::string &key) {
+  StdUniqueLock lock(_mtx_cache);
+  BarCachePtr &barCache = _bars_cache[key];
+  if (!barCache)
+    barCache.reset(new BarCache);
+  return barCache;
+}
+
+WTSKlineSlice *WtDataManager::make_cached_slice(const char *stdCode,
+                                                BarCache &barCache,
+                                                uint32_t sIdx, uint32_t count) {
+  WTSKlineData *kData = barCache._bars;
+  WTSKlineSlice *slice = WTSKlineSlice::create(
+      stdCode, barCache._period, barCache._times, kData->at(sIdx), count);
+  kData->retain();
+  slice->keepAlive(std::shared_ptr<void>(
+      kData, [](void *p) { ((WTSKlineData *)p)->release(); }));
+  return slice;
+}
+
 WTSKlineSlice *
 WtDataManager::get_skline_slice_by_date(const char *stdCode, uint32_t secs,
                                         uint32_t uDate /* = 0 */) {
@@ -156,7 +201,9 @@ WtDataManager::get_skline_slice_by_date(const char *stdCode, uint32_t secs,
 
   // 只有非基础周期的会进到下面的步骤
   WTSSessionInfo *sInfo = get_session_info(stdCode, true);
-  BarCache &barCache = _bars_cache[key];
+  BarCachePtr cachePtr = get_bar_cache(key);
+  BarCache &barCache = *cachePtr;
+  StdUniqueLock lock(barCache._mtx);
   barCache._period = KP_Tick;
   barCache._times = secs;
   if (barCache._bars == NULL) {
@@ -175,10 +222,7 @@ WtDataManager::get_skline_slice_by_date(const char *stdCode, uint32_t secs,
   if (barCache._bars == NULL)
     return NULL;
 
-  WTSBarStruct *rtHead = barCache._bars->at(0);
-  WTSKlineSlice *slice = WTSKlineSlice::create(stdCode, KP_Tick, secs, rtHead,
-                                               barCache._bars->size());
-  return slice;
+  return make_cached_slice(stdCode, barCache, 0, barCache._bars->size());
 }
 
 WTSKlineSlice *
@@ -203,7 +247,9 @@ WTSKlineSlice *WtDataManager::get_kline_slice_by_range(
   // 只有非基础周期的会进到下面的步骤
   WTSSessionInfo *sInfo = get_session_info(stdCode, true);
   std::string key = StrUtil::printf("%s-%u-%u", stdCode, period, times);
-  BarCache &barCache = _bars_cache[key];
+  BarCachePtr cachePtr = get_bar_cache(key);
+  BarCache &barCache = *cachePtr;
+  StdUniqueLock lock(barCache._mtx);
   barCache._period = period;
   barCache._times = times;
   if (barCache._bars == NULL) {
@@ -238,6 +284,8 @@ WTSKlineSlice *WtDataManager::get_kline_slice_by_range(
     WTSKlineSlice *rawData = _reader->readKlineSliceByRange(
         stdCode, period, barCache._last_bartime, 0);
     if (rawData != NULL) {
+      // 还有切片在引用的话，先复制一份再更新
+      detach_bars(barCache._bars);
       for (int32_t idx = 0; idx < rawData->size(); idx++) {
         uint64_t barTime = 0;
         if (period == KP_DAY)
@@ -318,10 +366,7 @@ WTSKlineSlice *WtDataManager::get_kline_slice_by_range(
                        });
   sIdx = sit - bars.begin();
   uint32_t rtCnt = eIdx - sIdx + 1;
-  WTSBarStruct *rtHead = barCache._bars->at(sIdx);
-  WTSKlineSlice *slice =
-      WTSKlineSlice::create(stdCode, period, times, rtHead, rtCnt);
-  return slice;
+  return make_cached_slice(stdCode, barCache, sIdx, rtCnt);
 }
 
 WTSKlineSlice *WtDataManager::get_kline_slice_by_count(
@@ -334,7 +379,9 @@ WTSKlineSlice *WtDataManager::get_kline_slice_by_count(
   // 只有非基础周期的会进到下面的步骤
   WTSSessionInfo *sInfo = get_session_info(stdCode, true);
   std::string key = StrUtil::printf("%s-%u-%u", stdCode, period, times);
-  BarCache &barCache = _bars_cache[key];
+  BarCachePtr cachePtr = get_bar_cache(key);
+  BarCache &barCache = *cachePtr;
+  StdUniqueLock lock(barCache._mtx);
   barCache._period = period;
   barCache._times = times;
 
@@ -383,6 +430,8 @@ WTSKlineSlice *WtDataManager::get_kline_slice_by_count(
     if (rawData != NULL) {
       WTSLogger::info("{} {} bars of {} updated, adding to cache...",
                       rawData->size(), tag, stdCode);
+      // 还有切片在引用的话，先复制一份再更新
+      detach_bars(barCache._bars);
       for (int32_t idx = 0; idx < rawData->size(); idx++) {
         uint64_t barTime = 0;
         if (period == KP_DAY)
@@ -455,10 +504,7 @@ WTSKlineSlice *WtDataManager::get_kline_slice_by_count(
 
   sIdx = (eIdx + 1 >= count) ? (eIdx + 1 - count) : 0;
   uint32_t rtCnt = eIdx - sIdx + 1;
-  WTSBarStruct *rtHead = barCache._bars->at(sIdx);
-  WTSKlineSlice *slice =
-      WTSKlineSlice::create(stdCode, period, times, rtHead, rtCnt);
-  return slice;
+  return make_cached_slice(stdCode, barCache, sIdx, rtCnt);
 }
 
 WTSTickSlice *WtDataManager::get_tick_slice_by_count(const char *stdCode,
@@ -485,19 +531,17 @@ WtDataManager::get_exright_factor(const char *stdCode,
   return 1.0;
 }
 
-void WtDataManager::subscribe_bar(const char *stdCode, WTSKlinePeriod period,
-                                  uint32_t times) {
-  std::string key =
-      fmtutil::format("{}-{}-{}", stdCode, (uint32_t)period, times);
-
-  uint32_t curDate = TimeUtils::getCurDate();
-  uint64_t etime = (uint64_t)curDate * 10000 + 2359;
-
+WTSKlineData *WtDataManager::load_rt_kline(const char *stdCode,
+                                           WTSKlinePeriod period,
+                                           uint32_t times, uint32_t count) {
   if (times == 1) {
+    uint32_t curDate = TimeUtils::getCurDate();
+    uint64_t etime = (uint64_t)curDate * 10000 + 2359;
+
     WTSKlineSlice *slice =
-        _reader->readKlineSliceByCount(stdCode, period, 10, etime);
+        _reader->readKlineSliceByCount(stdCode, period, count, etime);
     if (slice == NULL)
-      return;
+      return NULL;
 
     WTSKlineData *kline = WTSKlineData::create(stdCode, slice->size());
     kline->setPeriod(period);
@@ -507,37 +551,113 @@ void WtDataManager::subscribe_bar(const char *stdCode, WTSKlinePeriod period,
              sizeof(WTSBarStruct) * slice->get_block_size(blkIdx));
       offset += slice->get_block_size(blkIdx);
     }
-
-    {
-      StdUniqueLock lock(_mtx_rtbars);
-      if (_rt_bars == NULL)
-        _rt_bars = RtBarMap::create();
-
-      _rt_bars->add(key, kline, false);
-    }
-
     slice->release();
+    return kline;
   } else {
     // 只有非基础周期的会进到下面的步骤
     WTSSessionInfo *sInfo = get_session_info(stdCode, true);
     WTSKlineSlice *rawData =
-        _reader->readKlineSliceByCount(stdCode, period, 10 * times, 0);
-    if (rawData != NULL) {
-      WTSKlineData *kData =
-          g_dataFact.extractKlineData(rawData, period, times, sInfo, true);
-      {
-        StdUniqueLock lock(_mtx_rtbars);
-        if (_rt_bars == NULL)
-          _rt_bars = RtBarMap::create();
-        _rt_bars->add(key, kData, false);
-      }
-      rawData->release();
-    }
+        _reader->readKlineSliceByCount(stdCode, period, count * times, 0);
+    if (rawData == NULL)
+      return NULL;
+
+    WTSKlineData *kData =
+        g_dataFact.extractKlineData(rawData, period, times, sInfo, true);
+    rawData->release();
+    return kData;
+  }
+}
+
+void WtDataManager::subscribe_bar(const char *stdCode, WTSKlinePeriod period,
+                                  uint32_t times) {
+  std::string key =
+      fmtutil::format("{}-{}-{}", stdCode, (uint32_t)period, times);
+
+  WTSKlineData *kline = load_rt_kline(stdCode, period, times, 10);
+  if (kline == NULL)
+    return;
+
+  {
+    StdUniqueLock lock(_mtx_rtbars);
+    if (_rt_bars == NULL)
+      _rt_bars = RtBarMap::create();
+
+    _rt_bars->add(key, kline, false);
   }
 
   WTSLogger::info("Realtime bar {} has subscribed", key);
 }
 
+bool WtDataManager::subscribe_bar_stream(const char *stdCode,
+                                         WTSKlinePeriod period, uint32_t times,
+                                         const char *speriod,
+                                         uint32_t cacheCount) {
+  if (cacheCount == 0)
+    cacheCount = 1;
+
+  WTSKlineData *kline = load_rt_kline(stdCode, period, times, cacheCount);
+  if (kline == NULL) {
+    WTSLogger::error("Loading bars of {}-{} failed, bar stream not subscribed",
+                     stdCode, speriod);
+    return false;
+  }
+
+  StdUniqueLock lock(_mtx_streams);
+  BarStream &stream = _streams[stdCode][speriod];
+  if (stream._bars != NULL)
+    stream._bars->release();
+
+  stream._bars = kline;
+  stream._cache_count = cacheCount;
+  stream._last_count = kline->size();
+  stream._pushed = kline->size() > 0;
+  if (stream._pushed)
+    stream._last = *kline->at(-1);
+
+  WTSLogger::info("Bar stream {}-{} has subscribed with {} bars cached",
+                  stdCode, speriod, cacheCount);
+  return true;
+}
+
+uint32_t WtDataManager::unsubscribe_bar_stream(const char *stdCode,
+                                               const char *speriod) {
+  StdUniqueLock lock(_mtx_streams);
+  auto it = _streams.find(stdCode);
+  if (it == _streams.end())
+    return 0;
+
+  StreamMap &streams = it->second;
+  auto sit = streams.find(speriod);
+  if (sit == streams.end())
+    return (uint32_t)streams.size();
+
+  if (sit->second._bars != NULL)
+    sit->second._bars->release();
+  streams.erase(sit);
+  WTSLogger::info("Bar stream {}-{} has unsubscribed", stdCode, speriod);
+
+  uint32_t left = (uint32_t)streams.size();
+  if (left == 0)
+    _streams.erase(it);
+  return left;
+}
+
+uint32_t WtDataManager::get_stream_bars(const char *stdCode,
+                                        const char *speriod,
+                                        std::vector<WTSBarStruct> &bars) {
+  StdUniqueLock lock(_mtx_streams);
+  auto it = _streams.find(stdCode);
+  if (it == _streams.end())
+    return 0;
+
+  auto sit = it->second.find(speriod);
+  if (sit == it->second.end() || sit->second._bars == NULL)
+    return 0;
+
+  bars = sit->second._bars->getDataRef();
+  return (uint32_t)bars.size();
+}
+
 void WtDataManager::clear_subbed_bars() {
   StdUniqueLock lock(_mtx_rtbars);
   if (_rt_bars)
@@ -545,6 +665,8 @@ void WtDataManager::clear_subbed_bars() {
 }
 
 void WtDataManager::update_bars(const char *stdCode, WTSTickData *newTick) {
+  update_streams(stdCode, newTick);
+
   if (_rt_bars == NULL)
     return;
 
@@ -581,6 +703,64 @@ void WtDataManager::update_bars(const char *stdCode, WTSTickData *newTick) {
   }
 }
 
+void WtDataManager::update_streams(const char *stdCode,
+                                   WTSTickData *newTick) {
+  // 推送放到锁外面做,回调里可能会再来订阅或者拉取缓存
+  thread_local static std::vector<StreamPush> pushes;
+  pushes.clear();
+  {
+    StdUniqueLock lock(_mtx_streams);
+    auto it = _streams.find(stdCode);
+    if (it == _streams.end())
+      return;
+
+    WTSSessionInfo *sInfo = NULL;
+    if (newTick->getContractInfo())
+      sInfo = newTick->getContractInfo()->getCommInfo()->getSessionInfo();
+    else
+      sInfo = get_session_info(stdCode, true);
+
+    for (auto &v : it->second) {
+      const std::string &speriod = v.first;
+      BarStream &stream = v.second;
+      WTSKlineData *kData = stream._bars;
+      g_dataFact.updateKlineData(kData, newTick, sInfo, _align_by_section);
+      uint32_t cnt = kData->size();
+      if (cnt == 0)
+        continue;
+
+      // 条数增加了，说明前面的K线已经闭合，一个tick可能闭合多条，都要推出去
+      if (cnt > stream._last_count) {
+        uint32_t from = (stream._last_count == 0) ? 0 : stream._last_count - 1;
+        for (uint32_t idx = from; idx + 1 < cnt; idx++)
+          pushes.emplace_back(StreamPush{speriod, *kData->at(idx), true});
+      }
+
+      // 最新的K线没有变化就不推送了
+      WTSBarStruct *lastBar = kData->at(-1);
+      if (cnt == stream._last_count && stream._pushed &&
+          memcmp(lastBar, &stream._last, sizeof(WTSBarStruct)) == 0)
+        continue;
+
+      pushes.emplace_back(StreamPush{speriod, *lastBar, false});
+      stream._last = *lastBar;
+      stream._pushed = true;
+
+      // 只保留最近的cacheCount条
+      if (cnt > stream._cache_count) {
+        WTSKlineData::WTSBarList &bars = kData->getDataRef();
+        bars.erase(bars.begin(), bars.begin() + (cnt - stream._cache_count));
+        cnt = stream._cache_count;
+      }
+      stream._last_count = cnt;
+    }
+  }
+
+  for (StreamPush &item : pushes)
+    _runner->trigger_bar_stream(stdCode, item._period.c_str(), &item._bar,
+                                item._closed);
+}
+
 void WtDataManager::clear_cache() {
   if (_reader == NULL) {
     WTSLogger::warn("DataReader not initialized, clearing canceled");
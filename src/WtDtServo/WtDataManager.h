@@ -8,12 +8,14 @@
  * \brief
  */
 #pragma once
+#include <memory>
 #include <stdint.h>
 #include <vector>
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/IDataManager.h"
 #include "../Includes/IRdmDtReader.h"
+#include "../Includes/WTSStruct.h"
 #include "../Includes/WTSCollection.hpp"
 #include "../Share/StdUtils.hpp"
 
@@ -101,16 +103,32 @@ public:
   void clear_subbed_bars();
   void update_bars(const char *stdCode, WTSTickData *newTick);
 
+  /*
+   *	订阅K线推送流，只推送新闭合或者有变化的K线
+   *	@period		周期字符串，如m5、d1，推送的时候原样带回
+   *	@cacheCount	服务端缓存的K线条数
+   */
+  bool subscribe_bar_stream(const char *stdCode, WTSKlinePeriod period,
+                            uint32_t times, const char *speriod,
+                            uint32_t cacheCount);
+  /*
+   *	退订K线推送流,返回该代码剩下的推送流个数
+   */
+  uint32_t unsubscribe_bar_stream(const char *stdCode, const char *speriod);
+
+  /*
+   *	获取推送流缓存的K线，用于客户端订阅以后拉取初始快照
+   */
+  uint32_t get_stream_bars(const char *stdCode, const char *speriod,
+                           std::vector<WTSBarStruct> &bars);
+
   void clear_cache();
 
 private:
-  IRdmDtReader *_reader;
-  FuncDeleteRdmDtReader _remover;
+  WTSKlineData *load_rt_kline(const char *stdCode, WTSKlinePeriod period,
+                              uint32_t times, uint32_t count);
 
-  IBaseDataMgr *_bd_mgr;
-  IHotMgr *_hot_mgr;
-  WtDtRunner *_runner;
-  bool _align_by_section;
+  void update_streams(const char *stdCode, WTSTickData *newTick);
 
   // K线缓存
   typedef struct _BarCache {
@@ -118,15 +136,60 @@ private:
     uint64_t _last_bartime;
     WTSKlinePeriod _period;
     uint32_t _times;
+    StdUniqueMutex _mtx; // 同一份缓存的重采样和增量更新要串行
 
     _BarCache() : _last_bartime(0), _period(KP_DAY), _times(1), _bars(NULL) {}
   } BarCache;
-  typedef wt_hashmap<std::string, BarCache> BarCacheMap;
+  typedef std::shared_ptr<BarCache> BarCachePtr;
+
+  BarCachePtr get_bar_cache(const std::string &key);
+
+  /*
+   *	从缓存的K线生成切片，切片持有K线数据的引用
+   */
+  static WTSKlineSlice *make_cached_slice(const char *stdCode,
+                                          BarCache &barCache, uint32_t sIdx,
+                                          uint32_t count);
+
+private:
+  IRdmDtReader *_reader;
+  FuncDeleteRdmDtReader _remover;
+
+  IBaseDataMgr *_bd_mgr;
+  IHotMgr *_hot_mgr;
+  WtDtRunner *_runner;
+  bool _align_by_section;
+
+  typedef wt_hashmap<std::string, BarCachePtr> BarCacheMap;
   BarCacheMap _bars_cache;
+  StdUniqueMutex _mtx_cache;
 
   typedef WTSHashMap<std::string> RtBarMap;
   RtBarMap *_rt_bars;
   StdUniqueMutex _mtx_rtbars;
+
+  // K线推送流
+  typedef struct _BarStream {
+    WTSKlineData *_bars;
+    uint32_t _cache_count;
+    uint32_t _last_count;  // 上次推送时的K线条数
+    WTSBarStruct _last;    // 上次推送的K线
+    bool _pushed;
+
+    _BarStream()
+        : _bars(NULL), _cache_count(0), _last_count(0), _pushed(false) {}
+  } BarStream;
+  typedef wt_hashmap<std::string, BarStream> StreamMap;   // 周期->推送流
+  typedef wt_hashmap<std::string, StreamMap> CodeStreams; // 代码->推送流
+  CodeStreams _streams;
+  StdUniqueMutex _mtx_streams;
+
+  // 待推送的K线,在锁里收集,出锁以后再回调
+  typedef struct _StreamPush {
+    std::string _period;
+    WTSBarStruct _bar;
+    bool _closed;
+  } StreamPush;
 };
 
 NS_WTP_END
\ No newline at end of file
@@ -25,7 +25,9 @@
 
 USING_NS_WTP;
 
-WtDtRunner::WtDtRunner() : _data_store(NULL), _is_inited(false) {
+WtDtRunner::WtDtRunner()
+    : _cb_tick(NULL), _cb_bar(NULL), _cb_stream(NULL), _data_store(NULL),
+      _is_inited(false) {
   install_signal_hooks([](const char *message) { WTSLogger::error(message); });
 }
 
@@ -128,6 +130,13 @@ void WtDtRunner::initialize(const char *cfgFile, bool isFile /* = true */,
 
   initDataMgr(config->get("data"));
 
+  // 查询线程池，多个调用方并发查询的时候可以限制并发数
+  uint32_t poolsize = config->getUInt32("poolsize");
+  if (poolsize > 0) {
+    _pool.reset(new boost::threadpool::pool(poolsize));
+  }
+  WTSLogger::info("Query poolsize is {}", poolsize);
+
   WTSVariant *cfgParser = config->get("parsers");
   if (cfgParser) {
     if (cfgParser->type() == WTSVariant::VT_String) {
@@ -198,8 +207,10 @@ WTSKlineSlice *WtDtRunner::get_bars_by_range(const char *stdCode,
     endTime = (uint64_t)curDate * 10000 + 2359;
   }
 
-  return _data_mgr.get_kline_slice_by_range(stdCode, kp, realTimes, beginTime,
-                                            endTime);
+  return run_query<WTSKlineSlice *>([&]() {
+    return _data_mgr.get_kline_slice_by_range(stdCode, kp, realTimes,
+                                              beginTime, endTime);
+  });
 }
 
 WTSKlineSlice *WtDtRunner::get_bars_by_date(const char *stdCode,
@@ -235,7 +246,9 @@ WTSKlineSlice *WtDtRunner::get_bars_by_date(const char *stdCode,
     uDate = TimeUtils::getCurDate();
   }
 
-  return _data_mgr.get_kline_slice_by_date(stdCode, kp, realTimes, uDate);
+  return run_query<WTSKlineSlice *>([&]() {
+    return _data_mgr.get_kline_slice_by_date(stdCode, kp, realTimes, uDate);
+  });
 }
 
 WTSTickSlice *WtDtRunner::get_ticks_by_range(const char *stdCode,
@@ -250,7 +263,9 @@ WTSTickSlice *WtDtRunner::get_ticks_by_range(const char *stdCode,
     uint32_t curDate = TimeUtils::getCurDate();
     endTime = (uint64_t)curDate * 10000 + 2359;
   }
-  return _data_mgr.get_tick_slices_by_range(stdCode, beginTime, endTime);
+  return run_query<WTSTickSlice *>([&]() {
+    return _data_mgr.get_tick_slices_by_range(stdCode, beginTime, endTime);
+  });
 }
 
 WTSTickSlice *WtDtRunner::get_ticks_by_date(const char *stdCode,
@@ -260,7 +275,8 @@ WTSTickSlice *WtDtRunner::get_ticks_by_date(const char *stdCode,
     return NULL;
   }
 
-  return _data_mgr.get_tick_slice_by_date(stdCode, uDate);
+  return run_query<WTSTickSlice *>(
+      [&]() { return _data_mgr.get_tick_slice_by_date(stdCode, uDate); });
 }
 
 WTSKlineSlice *WtDtRunner::get_bars_by_count(const char *stdCode,
@@ -294,8 +310,10 @@ WTSKlineSlice *WtDtRunner::get_bars_by_count(const char *stdCode,
     endTime = (uint64_t)curDate * 10000 + 2359;
   }
 
-  return _data_mgr.get_kline_slice_by_count(stdCode, kp, realTimes, count,
-                                            endTime);
+  return run_query<WTSKlineSlice *>([&]() {
+    return _data_mgr.get_kline_slice_by_count(stdCode, kp, realTimes, count,
+                                              endTime);
+  });
 }
 
 WTSTickSlice *WtDtRunner::get_ticks_by_count(const char *stdCode,
@@ -310,7 +328,9 @@ WTSTickSlice *WtDtRunner::get_ticks_by_count(const char *stdCode,
     uint32_t curDate = TimeUtils::getCurDate();
     endTime = (uint64_t)curDate * 10000 + 2359;
   }
-  return _data_mgr.get_tick_slice_by_count(stdCode, count, endTime);
+  return run_query<WTSTickSlice *>([&]() {
+    return _data_mgr.get_tick_slice_by_count(stdCode, count, endTime);
+  });
 }
 
 WTSKlineSlice *WtDtRunner::get_sbars_by_date(const char *stdCode, uint32_t secs,
@@ -320,7 +340,9 @@ WTSKlineSlice *WtDtRunner::get_sbars_by_date(const char *stdCode, uint32_t secs,
     return NULL;
   }
 
-  return _data_mgr.get_skline_slice_by_date(stdCode, secs, uDate);
+  return run_query<WTSKlineSlice *>([&]() {
+    return _data_mgr.get_skline_slice_by_date(stdCode, secs, uDate);
+  });
 }
 
 void WtDtRunner::initParsers(WTSVariant *cfg) {
@@ -535,28 +557,79 @@ void WtDtRunner::sub_tick(const char *codes, bool bReplace,
   }
 }
 
-void WtDtRunner::sub_bar(const char *stdCode, const char *period) {
-  thread_local static char basePeriod[2] = {0};
-  basePeriod[0] = period[0];
-  uint32_t times = 1;
+WTSKlinePeriod WtDtRunner::parse_period(const char *period, uint32_t &times) {
+  times = 1;
   if (strlen(period) > 1)
     times = strtoul(period + 1, NULL, 10);
 
-  WTSKlinePeriod kp;
-  uint32_t realTimes = times;
-  if (basePeriod[0] == 'm') {
+  if (period[0] == 'm') {
     if (times % 5 == 0) {
-      kp = KP_Minute5;
-      realTimes /= 5;
-    } else {
-      kp = KP_Minute1;
+      times /= 5;
+      return KP_Minute5;
     }
-  } else
-    kp = KP_DAY;
+    return KP_Minute1;
+  }
+
+  return KP_DAY;
+}
+
+void WtDtRunner::sub_bar(const char *stdCode, const char *period) {
+  uint32_t realTimes;
+  WTSKlinePeriod kp = parse_period(period, realTimes);
 
   _data_mgr.clear_subbed_bars();
   _data_mgr.subscribe_bar(stdCode, kp, realTimes);
   sub_tick(stdCode, true, true);
+
+  // 内部tick订阅被替换了，推送流的代码要重新订阅
+  StdUniqueLock lock(_mtx_innersubs);
+  for (const std::string &code : _stream_codes) {
+    const char *sCode = code.c_str();
+    std::size_t length = code.size();
+    uint32_t flag = 0;
+    if (sCode[length - 1] == SUFFIX_QFQ || sCode[length - 1] == SUFFIX_HFQ) {
+      length--;
+      flag = (sCode[length] == SUFFIX_QFQ) ? 1 : 2;
+    }
+    _tick_innersub_map[std::string(sCode, length)].insert(flag);
+  }
+}
+
+bool WtDtRunner::sub_bar_stream(const char *stdCode, const char *period,
+                                uint32_t cacheCount) {
+  uint32_t realTimes;
+  WTSKlinePeriod kp = parse_period(period, realTimes);
+  if (!_data_mgr.subscribe_bar_stream(stdCode, kp, realTimes, period,
+                                      cacheCount))
+    return false;
+
+  sub_tick(stdCode, false, true);
+  StdUniqueLock lock(_mtx_innersubs);
+  _stream_codes.insert(stdCode);
+  return true;
+}
+
+void WtDtRunner::unsub_bar_stream(const char *stdCode, const char *period) {
+  // 内部tick订阅不退，没有推送流的时候update_bars会直接跳过
+  if (_data_mgr.unsubscribe_bar_stream(stdCode, period) > 0)
+    return;
+
+  // 最后一个推送流退订了，重建内部订阅的时候不用再带上这个代码
+  StdUniqueLock lock(_mtx_innersubs);
+  _stream_codes.erase(stdCode);
+}
+
+uint32_t WtDtRunner::get_stream_bars(const char *stdCode, const char *period,
+                                     std::vector<WTSBarStruct> &bars) {
+  return _data_mgr.get_stream_bars(stdCode, period, bars);
+}
+
+void WtDtRunner::trigger_bar_stream(const char *stdCode, const char *period,
+                                    WTSBarStruct *bar, bool isClosed) {
+  if (_cb_stream == NULL)
+    return;
+
+  _cb_stream(stdCode, period, bar, isClosed);
 }
 
 void WtDtRunner::trigger_bar(const char *stdCode, const char *period,
@@ -8,7 +8,11 @@
  * \brief
  */
 #pragma once
+#include <functional>
+#include <future>
+
 #include "../Share/StdUtils.hpp"
+#include "../Share/threadpool.hpp"
 #include "../WTSTools/WTSBaseDataMgr.h"
 #include "../WTSTools/WTSHotMgr.h"
 
@@ -46,6 +50,21 @@ public:
   void sub_tick(const char *stdCode, bool bReplace, bool bInner = false);
   void sub_bar(const char *stdCode, const char *period);
 
+  /*
+   *	K线推送流
+   *	和sub_bar不同，可以同时订阅多个，只推送闭合或者有变化的K线
+   */
+  inline void reg_bar_stream(FuncOnBarStreamCallback cbStream) {
+    _cb_stream = cbStream;
+  }
+  bool sub_bar_stream(const char *stdCode, const char *period,
+                      uint32_t cacheCount);
+  void unsub_bar_stream(const char *stdCode, const char *period);
+  uint32_t get_stream_bars(const char *stdCode, const char *period,
+                           std::vector<WTSBarStruct> &bars);
+  void trigger_bar_stream(const char *stdCode, const char *period,
+                          WTSBarStruct *bar, bool isClosed);
+
   void clear_cache();
 
 public:
@@ -73,9 +92,26 @@ private:
   void initDataMgr(WTSVariant *config);
   void initParsers(WTSVariant *cfg);
 
+  static WTSKlinePeriod parse_period(const char *period, uint32_t &times);
+
+  /*
+   *	在查询线程池中执行查询，调用线程等待结果
+   *	没有配置线程池则直接在调用线程执行
+   */
+  template <typename T> T run_query(std::function<T()> task) {
+    if (!_pool)
+      return task();
+
+    auto job = std::make_shared<std::packaged_task<T()>>(task);
+    std::future<T> ret = job->get_future();
+    _pool->schedule([job]() { (*job)(); });
+    return ret.get();
+  }
+
 private:
   FuncOnTickCallback _cb_tick;
   FuncOnBarCallback _cb_bar;
+  FuncOnBarStreamCallback _cb_stream;
   WTSBaseDataMgr _bd_mgr;
   WTSHotMgr _hot_mgr;
 
@@ -92,4 +128,9 @@ private:
 
   StraSubMap _tick_innersub_map; // tick数据订阅表
   StdUniqueMutex _mtx_innersubs;
+
+  std::set<std::string> _stream_codes; // 推送流订阅的代码
+
+  typedef std::shared_ptr<boost::threadpool::pool> ThreadPoolPtr;
+  ThreadPoolPtr _pool; // 查询线程池
 };
@@ -222,4 +222,29 @@ void subscribe_bar(const char *stdCode, const char *period) {
   getRunner().sub_bar(stdCode, period);
 }
 
+void register_bar_stream(FuncOnBarStreamCallback cbStream) {
+  getRunner().reg_bar_stream(cbStream);
+}
+
+bool subscribe_bar_stream(const char *stdCode, const char *period,
+                          WtUInt32 cacheCount) {
+  return getRunner().sub_bar_stream(stdCode, period, cacheCount);
+}
+
+void unsubscribe_bar_stream(const char *stdCode, const char *period) {
+  getRunner().unsub_bar_stream(stdCode, period);
+}
+
+WtUInt32 get_stream_bars(const char *stdCode, const char *period,
+                         FuncGetBarsCallback cb, FuncCountDataCallback cbCnt) {
+  std::vector<WTSBarStruct> bars;
+  uint32_t reaCnt = getRunner().get_stream_bars(stdCode, period, bars);
+  if (reaCnt == 0)
+    return 0;
+
+  cbCnt(reaCnt);
+  cb(bars.data(), reaCnt, true);
+  return reaCnt;
+}
+
 void clear_cache() { getRunner().clear_cache(); }
\ No newline at end of file
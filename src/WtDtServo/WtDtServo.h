@@ -55,6 +55,23 @@ EXPORT_FLAG void subscribe_tick(const char *stdCode, bool bReplace);
 
 EXPORT_FLAG void subscribe_bar(const char *stdCode, const char *period);
 
+/*
+ *	K线推送流，可以同时订阅多个代码和周期
+ *	只推送新闭合(isClosed为true)或者有变化的K线
+ *	服务端缓存最近cacheCount条，订阅以后用get_stream_bars拉取初始快照
+ */
+EXPORT_FLAG void register_bar_stream(FuncOnBarStreamCallback cbStream);
+
+EXPORT_FLAG bool subscribe_bar_stream(const char *stdCode, const char *period,
+                                      WtUInt32 cacheCount);
+
+EXPORT_FLAG void unsubscribe_bar_stream(const char *stdCode,
+                                        const char *period);
+
+EXPORT_FLAG WtUInt32 get_stream_bars(const char *stdCode, const char *period,
+                                     FuncGetBarsCallback cb,
+                                     FuncCountDataCallback cbCnt);
+
 EXPORT_FLAG void clear_cache();
 
 #ifdef __cplusplus
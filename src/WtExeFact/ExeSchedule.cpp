@@ -0,0 +1,141 @@
+﻿#include "ExeSchedule.h"
+
+#include "../Includes/FasterDefs.h"
+#include "../Includes/WTSSessionInfo.hpp"
+#include "../Share/StdUtils.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+void ExeCurve::build(const std::vector<double> &volumes, bool bCumulative) {
+  std::size_t cnt = volumes.size();
+  _cum.resize(cnt);
+  if (cnt == 0)
+    return;
+
+  // 累计成交量出现回落的,按前一分钟的值处理,保证曲线单调不减
+  double total = 0;
+  for (std::size_t i = 0; i < cnt; i++) {
+    total = bCumulative ? std::max(total, volumes[i]) : (total + volumes[i]);
+    _cum[i] = total;
+  }
+
+  if (total <= 0) {
+    build_uniform((uint32_t)cnt);
+    return;
+  }
+
+  double scale = 1.0 / total;
+  for (std::size_t i = 0; i < cnt; i++)
+    _cum[i] *= scale;
+}
+
+void ExeCurve::build_uniform(uint32_t minutes) {
+  _cum.resize(minutes);
+  for (uint32_t i = 0; i < minutes; i++)
+    _cum[i] = (double)(i + 1) / minutes;
+}
+
+void MinuteTable::build(WTSSessionInfo *sInfo) {
+  _total = sInfo->getTradingMins();
+  for (uint32_t mins = 0; mins < 1440; mins++) {
+    uint32_t hhmm = (mins / 60) * 100 + mins % 60;
+    uint32_t idx = sInfo->timeToMinutes(hhmm, true);
+    // 收盘以后对齐到最后一分钟
+    if (idx == INVALID_UINT32 || idx >= _total)
+      idx = (_total == 0) ? 0 : _total - 1;
+    _index[mins] = idx;
+  }
+}
+
+void ExeSchedule::init(ExeCurvePtr curve, MinuteTablePtr table,
+                       WTSSessionInfo *sInfo, uint32_t beginTime,
+                       uint32_t endTime) {
+  _curve = curve;
+  _table = table;
+  if (!is_valid())
+    return;
+
+  uint32_t total = _curve->size();
+  _begin = (beginTime == 0) ? 0 : sInfo->timeToMinutes(beginTime, true);
+  _end = (endTime == 0) ? total : sInfo->timeToMinutes(endTime, true);
+  if (_begin == INVALID_UINT32)
+    _begin = 0;
+  if (_end == INVALID_UINT32 || _end > total)
+    _end = total;
+  if (_begin >= _end)
+    _begin = (_end == 0) ? 0 : _end - 1;
+
+  // 执行时段外的部分不计入,时段内重新归一
+  _base = (_begin == 0) ? 0 : _curve->at(_begin - 1);
+  _range = (_end == 0) ? 1.0 : (_curve->at(_end - 1) - _base);
+  if (_range <= 0)
+    _range = 1.0;
+}
+
+static StdUniqueMutex _mtx_schedule;
+static wt_hashmap<std::string, ExeCurvePtr> _curves;
+static wt_hashmap<uint32_t, ExeCurvePtr> _uniform_curves;
+static wt_hashmap<std::string, MinuteTablePtr> _minute_tables;
+
+ExeCurvePtr ExeScheduleMgr::load_curve(const char *filename,
+                                      bool bCumulative) {
+  // 同一个文件按两种格式读出来的曲线不同,分开缓存
+  std::string key = filename;
+  if (bCumulative)
+    key += "#cum";
+
+  StdUniqueLock lock(_mtx_schedule);
+  auto it = _curves.find(key);
+  if (it != _curves.end())
+    return it->second;
+
+  if (!StdFile::exists(filename))
+    return ExeCurvePtr();
+
+  std::vector<double> volumes;
+  std::ifstream file(filename);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::stringstream ss(line);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      if (!item.empty())
+        volumes.emplace_back(strtod(item.c_str(), NULL));
+    }
+  }
+
+  if (volumes.empty())
+    return ExeCurvePtr();
+
+  ExeCurvePtr curve(new ExeCurve);
+  curve->build(volumes, bCumulative);
+  _curves[key] = curve;
+  return curve;
+}
+
+ExeCurvePtr ExeScheduleMgr::uniform_curve(uint32_t minutes) {
+  StdUniqueLock lock(_mtx_schedule);
+  ExeCurvePtr &curve = _uniform_curves[minutes];
+  if (curve == NULL) {
+    curve.reset(new ExeCurve);
+    curve->build_uniform(minutes);
+  }
+
+  return curve;
+}
+
+MinuteTablePtr ExeScheduleMgr::minute_table(WTSSessionInfo *sInfo) {
+  if (sInfo == NULL)
+    return MinuteTablePtr();
+
+  StdUniqueLock lock(_mtx_schedule);
+  MinuteTablePtr &table = _minute_tables[sInfo->id()];
+  if (table == NULL) {
+    table.reset(new MinuteTable);
+    table->build(sInfo);
+  }
+
+  return table;
+}
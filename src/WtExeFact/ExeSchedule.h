@@ -0,0 +1,143 @@
+﻿#pragma once
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "../Includes/WTSMarcos.h"
+
+NS_WTP_BEGIN
+class WTSSessionInfo;
+NS_WTP_END
+
+USING_NS_WTP;
+
+/*
+ *	执行进度曲线
+ *	交易时段内每分钟一个点,_cum[m]为第m分钟结束时应该完成的累计比例
+ *	最后一个点为1,同一个成交量分布的执行单元共用一条曲线
+ */
+class ExeCurve {
+public:
+  /*
+   *	按成交量分布生成曲线
+   *	@volumes	成交量序列,每分钟一个
+   *	@bCumulative	true为累计成交量,false为逐分钟成交量
+   */
+  void build(const std::vector<double> &volumes, bool bCumulative);
+
+  /*
+   *	均匀分布的曲线,没有成交量分布的时候使用
+   */
+  void build_uniform(uint32_t minutes);
+
+  inline double at(uint32_t idx) const {
+    if (idx >= _cum.size())
+      return 1.0;
+
+    return _cum[idx];
+  }
+
+  inline uint32_t size() const { return (uint32_t)_cum.size(); }
+
+private:
+  std::vector<double> _cum;
+};
+typedef std::shared_ptr<ExeCurve> ExeCurvePtr;
+
+/*
+ *	分钟下标表
+ *	一天1440分钟对应到交易时段内的分钟序号,每个tick直接查表
+ *	开盘前对齐到0,收盘后对齐到最后一分钟
+ */
+class MinuteTable {
+public:
+  void build(WTSSessionInfo *sInfo);
+
+  /*
+   *	@actiontime	行情时间,格式如93015500
+   */
+  inline uint32_t index(uint32_t actiontime) const {
+    uint32_t hhmm = actiontime / 100000;
+    uint32_t mins = (hhmm / 100) * 60 + hhmm % 100;
+    return (mins < 1440) ? _index[mins] : _total;
+  }
+
+  inline uint32_t total() const { return _total; }
+
+private:
+  uint32_t _index[1440];
+  uint32_t _total;
+};
+typedef std::shared_ptr<MinuteTable> MinuteTablePtr;
+
+/*
+ *	执行单元的执行进度
+ *	曲线和分钟表在初始化的时候确定,目标仓位变化的时候只更新起点,
+ *	每个tick按分钟下标查表,不用重新计算整条曲线
+ */
+class ExeSchedule {
+public:
+  ExeSchedule()
+      : _begin(0), _end(0), _base(0), _range(1.0), _start_pos(0) {}
+
+  /*
+   *	@beginTime	执行开始时间,格式如0930,为0时从开盘开始
+   *	@endTime	执行结束时间,格式如1130,为0时到收盘结束
+   */
+  void init(ExeCurvePtr curve, MinuteTablePtr table, WTSSessionInfo *sInfo,
+            uint32_t beginTime, uint32_t endTime);
+
+  inline bool is_valid() const { return _curve != NULL && _table != NULL; }
+
+  /*
+   *	目标仓位变化,以当前仓位作为新的起点
+   */
+  inline void reset(double startPos) { _start_pos = startPos; }
+
+  /*
+   *	到actiontime所在分钟结束时应该完成的比例
+   */
+  inline double progress(uint32_t actiontime) const {
+    uint32_t idx = _table->index(actiontime);
+    if (idx < _begin)
+      return 0;
+    if (idx >= _end)
+      return 1.0;
+
+    return (_curve->at(idx) - _base) / _range;
+  }
+
+  /*
+   *	到actiontime所在分钟结束时的目标仓位
+   */
+  inline double target(uint32_t actiontime, double targetPos) const {
+    return _start_pos + (targetPos - _start_pos) * progress(actiontime);
+  }
+
+private:
+  ExeCurvePtr _curve;
+  MinuteTablePtr _table;
+  uint32_t _begin;   // 执行时段的第一分钟
+  uint32_t _end;     // 执行时段结束的分钟,不含
+  double _base;      // 执行开始前曲线已经走过的比例
+  double _range;     // 执行时段内曲线走过的比例
+  double _start_pos; // 本轮执行的起始仓位
+};
+
+/*
+ *	曲线和分钟表的缓存
+ *	同一个分布文件只读一次,同一个交易时段只生成一张分钟表
+ */
+class ExeScheduleMgr {
+public:
+  /*
+   *	读取成交量分布文件,逗号或者换行分隔,文件不存在返回空
+   *	@bCumulative	文件里是累计成交量还是逐分钟成交量,由配置指定
+   */
+  static ExeCurvePtr load_curve(const char *filename, bool bCumulative);
+
+  static ExeCurvePtr uniform_curve(uint32_t minutes);
+
+  static MinuteTablePtr minute_table(WTSSessionInfo *sInfo);
+};
@@ -65,6 +65,8 @@ void WtMinImpactExeUnit::init(ExecuteContext *ctx, const char *stdCode,
 
   _price_offset = cfg->getInt32("offset"); // 价格偏移跳数，一般和订单同方向
   _expire_secs = cfg->getUInt32("expire"); // 订单超时秒数
+  if (_expire_secs != 0)
+    _orders_mon.use_timer(ctx, stdCode, _expire_secs);
   _price_mode = cfg->getInt32(
       "pricemode"); // 价格类型,0-最新价,-1-最优价,1-对手价,2-自动,默认为0
   _entrust_span = cfg->getUInt32("span"); // 发单时间间隔，单位毫秒
@@ -173,6 +175,27 @@ void WtMinImpactExeUnit::on_channel_ready() {
  *	交易通道丢失回调
  */
 void WtMinImpactExeUnit::on_channel_lost() {}
+
+void WtMinImpactExeUnit::on_order_expired(uint32_t localid) {
+  // 还有撤单在途的时候先不撤,稍后再检查,和扫描的逻辑保持一致
+  _orders_mon.on_expired(localid, [this](uint32_t localid) {
+    if (_cancel_cnt != 0)
+      return false;
+
+    return cancel_expired(localid);
+  });
+}
+
+bool WtMinImpactExeUnit::cancel_expired(uint32_t localid) {
+  if (!_ctx->cancel(localid))
+    return false;
+
+  _cancel_cnt++;
+  _ctx->writeLog(fmtutil::format(
+      "[{}@{}] Expired order of {} canceled, cancelcnt -> {}", __FILE__,
+      __LINE__, _code.c_str(), _cancel_cnt));
+  return true;
+}
 /*
  *	tick数据回调
  *	newTick	最新的tick数据
@@ -201,18 +224,15 @@ void WtMinImpactExeUnit::on_tick(WTSTickData *newTick) {
    *	那么在新的行情数据进来的时候可以再次触发核心逻辑
    */
   //*********在ontick中对订单管理进行校验。 例如有不活跃合约，校验减少  反之增多
-  if (_expire_secs != 0 && _orders_mon.has_order() &&
+  // 启用了订单定时器的,超时由on_order_expired处理
+  if (_expire_secs != 0 && !_orders_mon.has_timer() &&
+      _orders_mon.has_order() &&
       _cancel_cnt == 0) // 订单超时秒数！=0&&hasorder && 撤单量==0
   {
     uint64_t now = _ctx->getCurTime();
 
     _orders_mon.check_orders(_expire_secs, now, [this](uint32_t localid) {
-      if (_ctx->cancel(localid)) {
-        _cancel_cnt++;
-        _ctx->writeLog(fmtutil::format(
-            "[{}@{}] Expired order of {} canceled, cancelcnt -> {}", __FILE__,
-            __LINE__, _code.c_str(), _cancel_cnt));
-      }
+      cancel_expired(localid);
     });
   }
 
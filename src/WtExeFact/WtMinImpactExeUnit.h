@@ -19,6 +19,7 @@ public:
 
 private:
   void do_calc();
+  bool cancel_expired(uint32_t localid);
 
 public:
   /*
@@ -97,6 +98,11 @@ public:
    */
   virtual void on_channel_lost() override;
 
+  /*
+   *	订单超时回调
+   */
+  virtual void on_order_expired(uint32_t localid) override;
+
 private:
   WTSTickData *_last_tick; // 上一笔行情
   double _target_pos;      // 目标仓位
@@ -1,13 +1,32 @@
 ﻿#include "WtOrdMon.h"
 
+void WtOrdMon::use_timer(ExecuteContext *ctx, const char *stdCode,
+                         uint32_t expiresecs) {
+  _ctx = ctx;
+  _code = stdCode;
+  _expire_secs = expiresecs;
+}
+
 void WtOrdMon::push_order(const uint32_t *ids, uint32_t cnt, uint64_t curTime,
                           bool bCanCancel /* = true */) {
+  // 定时器按执行器的时钟计时,订单时间也统一用执行器的时钟
+  if (_ctx != NULL)
+    curTime = _ctx->getCurTime();
+
   StdLocker<StdRecurMutex> lock(_mtx_ords);
   for (uint32_t idx = 0; idx < cnt; idx++) {
     uint32_t localid = ids[idx];
     OrderPair &ordInfo = _orders[localid];
     ordInfo.first = curTime;
     ordInfo.second = bCanCancel;
+
+    if (_ctx == NULL || !bCanCancel)
+      continue;
+
+    // 执行器不支持定时器,退回到扫描
+    if (!_ctx->registerOrderTimer(_code.c_str(), localid,
+                                  _expire_secs * 1000))
+      _ctx = NULL;
   }
 }
 
@@ -41,6 +60,29 @@ void WtOrdMon::check_orders(uint32_t expiresecs, uint64_t curTime,
   }
 }
 
+void WtOrdMon::on_expired(uint32_t localid,
+                          std::function<bool(uint32_t)> cb) {
+  if (_ctx == NULL)
+    return;
+
+  StdLocker<StdRecurMutex> lock(_mtx_ords);
+  auto it = _orders.find(localid);
+  if (it == _orders.end())
+    return;
+
+  const OrderPair &ordInfo = it->second;
+  if (!ordInfo.second)
+    return;
+
+  // 同一个单号重新登记过,以新的定时器为准
+  uint64_t now = _ctx->getCurTime();
+  if (now - ordInfo.first < _expire_secs * 1000)
+    return;
+
+  if (!cb(localid))
+    _ctx->registerOrderTimer(_code.c_str(), localid, 1000);
+}
+
 void WtOrdMon::enumOrder(EnumAllOrderCallback cb) {
   if (_orders.empty())
     return;
@@ -3,8 +3,11 @@
 #include <stdint.h>
 #include <unordered_map>
 
+#include "../Includes/ExecuteDefs.h"
 #include "../Share/StdUtils.hpp"
 
+USING_NS_WTP;
+
 typedef std::function<void(uint32_t)> EnumOrderCallback;
 typedef std::function<void(uint32_t, uint64_t, bool)> EnumAllOrderCallback;
 
@@ -13,6 +16,20 @@ typedef std::function<void(uint32_t, uint64_t, bool)> EnumAllOrderCallback;
  */
 class WtOrdMon {
 public:
+  WtOrdMon() : _ctx(NULL), _expire_secs(0) {}
+
+  /*
+   *	启用订单定时器
+   *	启用以后每笔可撤订单下单时向执行器登记一个超时定时器,
+   *	到期由执行单元的on_order_expired调用on_expired,不用每个tick扫描
+   *	执行器不支持定时器的时候自动退回到check_orders扫描
+   *	@expiresecs	订单超时秒数
+   */
+  void use_timer(ExecuteContext *ctx, const char *stdCode,
+                 uint32_t expiresecs);
+
+  inline bool has_timer() const { return _ctx != NULL; }
+
   /*
    *	添加订单
    *
@@ -40,6 +57,13 @@ public:
   void check_orders(uint32_t expiresecs, uint64_t curTime,
                     EnumOrderCallback callback);
 
+  /*
+   *	订单定时器到期
+   *	订单已经结束、不可撤或者重新登记过的直接忽略
+   *	@cb	撤单回调,返回false时1秒以后再检查一次
+   */
+  void on_expired(uint32_t localid, std::function<bool(uint32_t)> cb);
+
   inline void clear_orders() { _orders.clear(); }
 
   void enumOrder(EnumAllOrderCallback cb);
@@ -50,4 +74,8 @@ private:
   typedef std::unordered_map<uint32_t, OrderPair> IDMap;
   IDMap _orders;
   StdRecurMutex _mtx_ords;
+
+  ExecuteContext *_ctx;
+  std::string _code;
+  uint32_t _expire_secs;
 };
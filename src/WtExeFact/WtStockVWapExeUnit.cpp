@@ -33,30 +33,6 @@ inline uint32_t calTmSecs(uint32_t begintime,
   return ((endtime / 100) * 3600 + (endtime % 100) * 60) -
          ((begintime / 100) * 3600 + (begintime % 100) * 60);
 }
-inline double calTmStamp(uint32_t actiontime) // 计算tick时间属于哪个时间单元
-{
-  string timestamp = to_string(actiontime);
-  int hour = stoi(timestamp.substr(0, 2));
-  int minute = stoi(timestamp.substr(2, 2));
-  double total_minute = 0;
-  if (hour < 9 || (hour == 9 && minute < 30)) {
-    total_minute = 0;
-  } else if (hour < 11 || (hour == 11 && minute <= 30)) {
-    total_minute = (hour - 9) * 60 + minute - 30;
-  } else if (hour < 13 || (hour == 13 && minute < 30)) {
-    total_minute = 120 + (hour - 11) * 60 + minute;
-  } else if (hour < 15 || (hour == 15 && minute <= 0)) {
-    total_minute = 240 + (hour - 13) * 60 + minute - 30;
-  } else {
-    total_minute = 240;
-  }
-  if (timestamp >= "113000000" && timestamp < "130000000") {
-    total_minute = 120;
-  }
-  total_minute += stoi(timestamp.substr(4, 2)) / 60;
-  total_minute += stoi(timestamp.substr(6, 3)) / 60000;
-  return total_minute; // 这里应该+1，对应vector 所以再-1
-}
 const char *WtStockVWapExeUnit::getFactName() { return FACT_NAME; }
 
 const char *WtStockVWapExeUnit::getName() { return "WtStockVWapExeUnit"; }
@@ -108,27 +84,20 @@ void WtStockVWapExeUnit::init(ExecuteContext *ctx, const char *stdCode,
   // 确定T0交易模式
   if (_comm_info->getTradingMode() == TradingMode::TM_Long)
     _is_t0 = true;
+  // 同一品种的执行单元共用一条曲线,没有分布文件的按均匀分布执行
+  // 分布文件默认是逐分钟成交量,cum_volume为true时按累计成交量读取
   std::string filename = "Vwap_";
   filename += _comm_info->getName();
   filename += ".txt";
-  if (!StdFile::exists(filename.c_str())) {
-    _ctx->writeLog(fmtutil::format("Vwap file {} not exists ,check and return.",
-                                   filename.c_str()));
-    return;
-  }
-
-  ifstream file(filename.c_str());
-  if (file.is_open()) {
-    string line;
-    while (getline(file, line)) {
-      stringstream s(line);
-      string prz;
-      while (getline(s, prz, ',')) {
-        VwapAim.push_back(stod(prz));
-      }
-    }
-    file.close();
+  ExeCurvePtr curve = ExeScheduleMgr::load_curve(
+      filename.c_str(), cfg->getBoolean("cum_volume"));
+  if (curve == NULL && _sess_info != NULL) {
+    _ctx->writeLog(fmtutil::format(
+        "Vwap file {} not exists, uniform schedule used", filename.c_str()));
+    curve = ExeScheduleMgr::uniform_curve(_sess_info->getTradingMins());
   }
+  _schedule.init(curve, ExeScheduleMgr::minute_table(_sess_info), _sess_info,
+                 _begin_time, _end_time);
 }
 
 void WtStockVWapExeUnit::on_order(uint32_t localid, const char *stdCode,
@@ -386,21 +355,35 @@ void WtStockVWapExeUnit::do_calc() {
     return;
   }
   _last_tick_time = curTickTime;
-  double InminsTm = calTmStamp(
-      _last_tick->actiontime()); // 当前tick属于vwap240分钟内的第几(-1)分钟
-  double aimQty = VwapAim[InminsTm]; // 取到对应时刻的目标vwapaim （递增）
+  if (!_schedule.is_valid()) {
+    _ctx->writeLog(
+        fmt::format("{}没有可用的执行进度，退出执行逻辑", _code).c_str());
+    return;
+  }
+  // 当前分钟结束时的目标仓位,查表得到
+  double aimQty = _schedule.target(_last_tick->actiontime(), newVol);
 
   uint32_t leftTimes = _total_times - _fired_times;
   _ctx->writeLog(fmt::format("第 {} 次发单", _fired_times + 1).c_str());
-  _Vwap_vol = aimQty - curPos; // 若在本分钟发单，对应的VWapVol
+  // 若在本分钟发单，对应的VWapVol,只算和总体方向一致的缺口
+  // 已经超前于进度的不再追加
+  double sign = decimal::gt(diffQty, 0) ? 1.0 : -1.0;
+  _Vwap_vol = max((aimQty - curPos) * sign, 0.0);
+  if (leftTimes != 0 && decimal::eq(_Vwap_vol, 0)) {
+    _ctx->writeLog(fmtutil::format(
+        "{} is ahead of schedule, {} -> {}, skip this slice", _code.c_str(),
+        curPos, aimQty));
+    return;
+  }
+
   bool bNeedShowHand = false;
   double curQty = 0;
   if (leftTimes == 0 && !decimal::eq(diffQty, 0)) {
     bNeedShowHand = true;
     curQty = max(diffQty, _min_open_lots);
   } else {
-    curQty = max(_Vwap_vol, _min_open_lots) * abs(diffQty) /
-             diffQty; // curqty=单位预测量sum
+    curQty = min(max(_Vwap_vol, _min_open_lots), abs(diffQty)) *
+             abs(diffQty) / diffQty; // curqty=单位预测量sum
   }
 
   // 买
@@ -544,6 +527,8 @@ void WtStockVWapExeUnit::set_position(const char *stdCode, double newVol) {
     return;
   }
   _target_pos = newVol;
+  // 以当前仓位作为新一轮执行的起点
+  _schedule.reset(_ctx->getPosition(stdCode));
 
   _target_mode = TargetMode::stocks;
   _is_finish = false;
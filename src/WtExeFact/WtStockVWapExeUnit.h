@@ -10,6 +10,7 @@
 #include "../Share/TimeUtils.hpp"
 #include "../Share/decimal.h"
 #include "../Share/fmtlib.h"
+#include "ExeSchedule.h"
 #include "WtOrdMon.h"
 #include <fstream>
 USING_NS_WTP;
@@ -131,7 +132,7 @@ private:
   // 执行参数
   WtOrdMon _orders_mon;
   uint32_t _cancel_cnt;
-  vector<double> VwapAim; // 分钟记，目标VWap预测 总报单量
+  ExeSchedule _schedule; // 按成交量分布的执行进度,按分钟查表
   //////////////////////////////////////////////////////////////////////////
   // 参数
   uint32_t _total_secs;  // 执行总时间,单位s
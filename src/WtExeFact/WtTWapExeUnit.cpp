@@ -55,6 +55,8 @@ void WtTWapExeUnit::init(ExecuteContext *ctx, const char *stdCode,
   if (_sess_info)
     _sess_info->retain();
   _ord_sticky = cfg->getUInt32("ord_sticky");
+  if (_ord_sticky != 0)
+    _orders_mon.use_timer(ctx, stdCode, _ord_sticky);
   _begin_time = cfg->getUInt32("begin_time");
   _end_time = cfg->getUInt32("end_time");
   _total_secs = cfg->getUInt32("total_secs");
@@ -174,6 +176,22 @@ void WtTWapExeUnit::on_channel_ready() {
 
 void WtTWapExeUnit::on_channel_lost() {}
 
+void WtTWapExeUnit::on_order_expired(uint32_t localid) {
+  _orders_mon.on_expired(
+      localid, [this](uint32_t localid) { return cancel_expired(localid); });
+}
+
+bool WtTWapExeUnit::cancel_expired(uint32_t localid) {
+  if (!_ctx->cancel(localid))
+    return false;
+
+  _cancel_cnt++;
+  _ctx->writeLog(
+      fmt::format("Order expired, cancelcnt updated to {}", _cancel_cnt)
+          .c_str());
+  return true;
+}
+
 void WtTWapExeUnit::on_tick(WTSTickData *newTick) {
   if (newTick == NULL || _code.compare(newTick->code()) != 0)
     return;
@@ -216,17 +234,12 @@ void WtTWapExeUnit::on_tick(WTSTickData *newTick) {
   } else {
     uint64_t now = TimeUtils::getLocalTimeNow();
     bool hasCancel = false;
-    if (_ord_sticky != 0 && _orders_mon.has_order()) {
+    if (_ord_sticky != 0 && !_orders_mon.has_timer() &&
+        _orders_mon.has_order()) {
       _orders_mon.check_orders(
           _ord_sticky, now, [this, &hasCancel](uint32_t localid) {
-            if (_ctx->cancel(localid)) {
-              _cancel_cnt++;
-              _ctx->writeLog(
-                  fmt::format("Order expired, cancelcnt updated to {}",
-                              _cancel_cnt)
-                      .c_str());
+            if (cancel_expired(localid))
               hasCancel = true;
-            }
           });
     }
 
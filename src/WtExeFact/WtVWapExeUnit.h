@@ -4,6 +4,7 @@
 */
 #include "../Includes/ExecuteDefs.h"
 #include "../Share/StdUtils.hpp"
+#include "ExeSchedule.h"
 #include "WtOrdMon.h"
 #include "rapidjson/document.h"
 #include <fstream>
@@ -18,6 +19,7 @@ public:
 private:
   void do_calc();
   void fire_at_once(double qty);
+  bool cancel_expired(uint32_t localid);
 
 public:
   /*
@@ -90,6 +92,11 @@ public:
    */
   virtual void on_channel_lost() override;
 
+  /*
+   *	订单超时回调
+   */
+  virtual void on_order_expired(uint32_t localid) override;
+
 private:
   WTSTickData *_last_tick; // 上一笔行情
   double _target_pos;      // 目标仓位
@@ -104,7 +111,7 @@ private:
   // 执行参数
   WtOrdMon _orders_mon;
   uint32_t _cancel_cnt;
-  vector<double> VwapAim; // 分钟记，目标VWap预测 总报单量
+  ExeSchedule _schedule; // 按成交量分布的执行进度,按分钟查表
   //////////////////////////////////////////////////////////////////////////
   // 参数
   uint32_t _total_secs;  // 执行总时间,单位s
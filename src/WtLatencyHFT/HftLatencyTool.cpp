@@ -13,12 +13,14 @@
 #include "../Includes/IParserApi.h"
 #include "../Includes/ITraderApi.h"
 #include "../Includes/WTSContractInfo.hpp"
+#include "../Includes/WTSTradeDef.hpp"
 #include "../Includes/WTSVariant.hpp"
 
 #include "../WTSTools/WTSLogger.h"
 #include "../WTSUtils/WTSCfgLoader.h"
 
 #include "../Share/CpuHelper.hpp"
+#include "../Share/LatencyRecorder.hpp"
 #include "../Share/StrUtil.hpp"
 #include "../Share/TimeUtils.hpp"
 
@@ -26,7 +28,8 @@ USING_NS_WTP;
 
 void test_hft() {
   hft::HftLatencyTool runner;
-  runner.init();
+  if (!runner.init())
+    return;
 
   runner.run();
 }
@@ -52,12 +55,28 @@ inline uint32_t strToTime(const char *strTime) {
   return strtoul(str, NULL, 10);
 }
 
+// 打点位置
+enum {
+  LP_Tick = 0, // 行情推给ParserAdapter之前
+  LP_Strategy, // 策略收到行情
+  LP_Trader,   // 交易接口收到委托
+  LP_Ack,      // 策略收到回环的订单回报
+  LP_Return,   // 行情回调返回
+  LP_COUNT
+};
+
+LatencyRecorder theRecorder;
+
 class TestParser : public IParserApi {
 public:
-  void run(uint32_t times) {
+  void run(uint32_t times, uint32_t warmup) {
     srand(time(NULL));
     TimeUtils::Ticker ticker;
-    for (uint32_t i = 0; i < times; i++) {
+    for (uint32_t i = 0; i < warmup + times; i++) {
+      // 预热结束以后再开始计时
+      if (i == warmup)
+        ticker.reset();
+
       uint32_t actDate = 20220303; // strtoul("20220303", NULL, 10);
       uint32_t actTime =
           100523 * 1000 + 500; // strToTime("10:05:23") * 1000 + 500;
@@ -124,7 +143,11 @@ public:
       quote.bid_qty[3] = 0;
       quote.bid_qty[4] = 0;
 
+      theRecorder.begin_round();
+      theRecorder.stamp(LP_Tick);
       _parser_spi->handleQuote(tick, 0);
+      theRecorder.stamp(LP_Return);
+      theRecorder.end_round();
       tick->release();
     }
     auto total = ticker.nano_seconds();
@@ -149,19 +172,42 @@ TestParser *theParser = NULL;
 
 class TestTrader : public ITraderApi {
 public:
+  /*
+   *	@loopback	是否回环订单回报,回报直接在下单线程里推回去
+   */
+  TestTrader(bool loopback) : _loopback(loopback), _auto_id(0) {}
+
   virtual void registerSpi(ITraderSpi *listener) override {
     _trader_spi = listener;
   }
 
   virtual bool makeEntrustID(char *buffer, int length) override {
-    wt_strcpy(buffer, "123456");
+    fmtutil::format_to(buffer, "{}", ++_auto_id);
     return true;
   }
 
-  virtual int orderInsert(WTSEntrust *eutrust) override { return 0; }
+  virtual int orderInsert(WTSEntrust *eutrust) override {
+    theRecorder.stamp(LP_Trader);
+    if (_loopback)
+      loopback(eutrust);
+    return 0;
+  }
+
+private:
+  // 回环的订单直接撤销,TraderAdapter里不会积压未完成订单
+  void loopback(WTSEntrust *entrust) {
+    WTSOrderInfo *ordInfo = WTSOrderInfo::create(entrust);
+    ordInfo->setOrderID(entrust->getEntrustID());
+    ordInfo->setOrderState(WOS_Canceled);
+    ordInfo->setStateMsg("loopback");
+    _trader_spi->onPushOrder(ordInfo);
+    ordInfo->release();
+  }
 
 private:
   ITraderSpi *_trader_spi;
+  bool _loopback;
+  uint64_t _auto_id;
 };
 
 class TestStrategy : public HftStrategy {
@@ -184,9 +230,17 @@ public:
 
   virtual void on_tick(IHftStraCtx *ctx, const char *code,
                        WTSTickData *newTick) {
+    theRecorder.stamp(LP_Strategy);
     // ctx->stra_sell("SHFE.rb.2205", 2300, 1, "", HFT_OrderFlag_Nor);
     ctx->stra_buy("SHFE.rb.2205", 2300, 1, "", HFT_OrderFlag_Nor);
   }
+
+  virtual void on_order(IHftStraCtx *ctx, uint32_t localid,
+                        const char *stdCode, bool isBuy, double totalQty,
+                        double leftQty, double price, bool isCanceled,
+                        const char *userTag) override {
+    theRecorder.stamp(LP_Ack);
+  }
 };
 
 HftLatencyTool::HftLatencyTool() {}
@@ -243,7 +297,18 @@ bool HftLatencyTool::init() {
   _core = _config->getUInt32("core");
   WTSLogger::warn("Testing thread will be bind to core {}", _core);
 
-  initEngine(_config->get("env"));
+  _warmup = _config->getUInt32("warmup");
+  _loopback = _config->getBoolean("loopback");
+  _output = _config->getString("output");
+  if (_output.empty())
+    _output = "latency_hft.json";
+  WTSLogger::warn("Warmup rounds: {}, loopback: {}, output: {}", _warmup,
+                  _loopback, _output);
+
+  if (!initEngine(_config->get("env"))) {
+    _config->release();
+    return false;
+  }
   initModules();
   initStrategies();
 
@@ -257,7 +322,7 @@ bool HftLatencyTool::initStrategies() {
 
   TraderAdapterPtr trader = _traders.getAdapter("trader");
   ctx->setTrader(trader.get());
-  trader->addSink(ctx);
+  trader->addSink(_engine.get_trd_sink(ctx));
 
   _engine.addContext(HftContextPtr(ctx));
 
@@ -265,6 +330,15 @@ bool HftLatencyTool::initStrategies() {
 }
 
 bool HftLatencyTool::initEngine(WTSVariant *cfg) {
+  // 打点记在全局的记录器里,按单线程同步回调设计
+  // 开了忙轮询以后行情和回报在事件循环线程里处理,和测试线程的打点会互相覆盖
+  WTSVariant *cfgLoop = (cfg != NULL) ? cfg->get("busyloop") : NULL;
+  if (cfgLoop && cfgLoop->getBoolean("active")) {
+    WTSLogger::error("Busy loop is not supported by latency test, please "
+                     "deactivate env.busyloop");
+    return false;
+  }
+
   WTSLogger::warn("Trading enviroment initialzied with engine: HFT");
   _engine.init(cfg, &_bd_mgr, &_dt_mgr, &_hot_mgr, NULL);
   _engine.set_adapter_mgr(&_traders);
@@ -281,7 +355,7 @@ bool HftLatencyTool::initModules() {
   }
 
   {
-    TestTrader *tester = new TestTrader();
+    TestTrader *tester = new TestTrader(_loopback);
     TraderAdapterPtr adapter(new TraderAdapter());
     adapter->initExt("trader", tester, &_bd_mgr, &_act_mgr);
     _traders.addAdapter("trader", adapter);
@@ -303,8 +377,35 @@ void HftLatencyTool::run() {
 
     _engine.run();
 
-    theParser->run(_times);
+    theRecorder.init(LP_COUNT, _times, _warmup);
+    theRecorder.add_stage("tick_to_strategy", LP_Tick, LP_Strategy);
+    theRecorder.add_stage("strategy_to_trader", LP_Strategy, LP_Trader);
+    theRecorder.add_stage("tick_to_trader", LP_Tick, LP_Trader);
+    theRecorder.add_stage("trader_to_ack", LP_Trader, LP_Ack);
+    theRecorder.add_stage("round_trip", LP_Tick, LP_Return);
+
+    theParser->run(_times, _warmup);
+    report();
   } catch (...) {
   }
 }
+
+void HftLatencyTool::report() {
+  WTSLogger::warn("TSC frequency: {:.3f} cycles/ns",
+                  theRecorder.cycles_per_ns());
+  for (const auto &stat : theRecorder.summary()) {
+    if (stat._count == 0)
+      continue;
+
+    WTSLogger::warn("{}: {} samples, mean {:.1f} ns, p50 {:.1f} ns, "
+                    "p99 {:.1f} ns, p99.9 {:.1f} ns, max {:.1f} ns",
+                    stat._name, stat._count, stat._mean, stat._p50, stat._p99,
+                    stat._p999, stat._max);
+  }
+
+  if (theRecorder.dump(_output.c_str(), "HFT", _core))
+    WTSLogger::warn("Latency results dumped to {}", _output);
+  else
+    WTSLogger::error("Dumping latency results to {} failed", _output);
+}
 } // namespace hft
\ No newline at end of file
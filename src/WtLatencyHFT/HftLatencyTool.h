@@ -42,6 +42,11 @@ private:
 
   bool initEngine(WTSVariant *cfg);
 
+  /*
+   *	输出各阶段的延迟分布
+   */
+  void report();
+
 private:
   TraderAdapterMgr _traders;
   ParserAdapterMgr _parsers;
@@ -56,5 +61,8 @@ private:
 
   uint32_t _times;
   uint32_t _core;
+  uint32_t _warmup;    // 预热轮数,不计入统计
+  bool _loopback;      // 是否回环订单回报
+  std::string _output; // 结果文件
 };
 } // namespace hft
@@ -12,6 +12,7 @@
 
 #include "../Share/TimeUtils.hpp"
 #include "../Share/fmtlib.h"
+#include <algorithm>
 #include <atomic>
 
 #ifndef NN_STATIC_LIB
@@ -33,7 +34,8 @@ inline uint32_t makeMQCientId() {
 
 MQClient::MQClient(MQManager *mgr)
     : _sock(-1), m_bReady(false), _mgr(mgr), m_bTerminated(false),
-      _cb_message(NULL), m_iCheckTime(0), m_bNeedCheck(false) {
+      _cb_message(NULL), m_iCheckTime(0), m_bNeedCheck(false),
+      _conflate(false), _conflated(0) {
   _id = makeMQCientId();
 }
 
@@ -45,6 +47,10 @@ MQClient::~MQClient() {
   if (m_thrdRecv)
     m_thrdRecv->join();
 
+  _cond_pending.notify_all();
+  if (m_thrdDispatch)
+    m_thrdDispatch->join();
+
   if (_sock != 0)
     nn_close(_sock);
 }
@@ -84,6 +90,22 @@ bool MQClient::init(const char *url, FuncMQCallback cb) {
   return true;
 }
 
+void MQClient::sub_topic(const char *topic) {
+  if (_topics.find(topic) != _topics.end())
+    return;
+
+  // 第一次订阅具体的主题,要先取消初始化时订阅的全部主题
+  if (_topics.empty() && _sock >= 0)
+    nn_setsockopt(_sock, NN_SUB, NN_SUB_UNSUBSCRIBE, "", 0);
+
+  _topics.insert(topic);
+
+  // 服务端每一帧只有一个主题,帧头就是定长的主题字段,带上结尾的0就是精确匹配
+  if (_sock >= 0)
+    nn_setsockopt(_sock, NN_SUB, NN_SUB_SUBSCRIBE, topic,
+                  std::min(strlen(topic) + 1, (std::size_t)32));
+}
+
 void MQClient::start() {
   if (m_bTerminated)
     return;
@@ -94,6 +116,9 @@ void MQClient::start() {
     return;
   }
 
+  if (_conflate && m_thrdDispatch == NULL)
+    m_thrdDispatch.reset(new StdThread([this]() { dispatch_loop(); }));
+
   if (m_thrdRecv == NULL) {
     m_thrdRecv.reset(new StdThread([this]() {
       while (!m_bTerminated) {
@@ -118,7 +143,7 @@ void MQClient::start() {
             int64_t elapse = now - m_iCheckTime;
             if (elapse >= 60 * 1000) {
               // 只通知一次，防止重复通知
-              _cb_message(_id, "TIMEOUT", "", 0);
+              dispatch("TIMEOUT", "", 0);
               m_bNeedCheck = false;
             }
           }
@@ -151,11 +176,67 @@ void MQClient::extract_buffer() {
     char *data = packet->_data;
 
     if (is_allowed(packet->_topic))
-      _cb_message(_id, packet->_topic, packet->_data, packet->_length);
+      dispatch(packet->_topic, packet->_data, packet->_length);
 
     proc_len += sizeof(MQPacket) + packet->_length;
   }
 
   if (proc_len > 0)
     _buffer.erase(0, proc_len);
-}
\ No newline at end of file
+}
+
+void MQClient::dispatch(const char *topic, const char *data,
+                        uint32_t dataLen) {
+  if (!_conflate) {
+    _cb_message(_id, topic, data, dataLen);
+    return;
+  }
+
+  {
+    StdUniqueLock lock(_mtx_pending);
+    auto it = _pending_idx.find(topic);
+    if (it != _pending_idx.end()) {
+      // 上一条还没分发出去,直接用新的覆盖
+      _pending[it->second]._data.assign(data, dataLen);
+      _conflated++;
+    } else {
+      _pending_idx[topic] = _pending.size();
+      _pending.emplace_back();
+      PendingMsg &msg = _pending.back();
+      msg._topic = topic;
+      msg._data.assign(data, dataLen);
+    }
+  }
+  _cond_pending.notify_all();
+}
+
+void MQClient::dispatch_loop() {
+  PendingList msgs;
+  uint64_t lastConflated = 0;
+  while (!m_bTerminated) {
+    uint64_t conflated = 0;
+    {
+      StdUniqueLock lock(_mtx_pending);
+      if (_pending.empty()) {
+        _cond_pending.wait_for(lock, std::chrono::seconds(1));
+        continue;
+      }
+
+      msgs.swap(_pending);
+      _pending_idx.clear();
+      conflated = _conflated;
+    }
+
+    for (const PendingMsg &msg : msgs)
+      _cb_message(_id, msg._topic.c_str(), msg._data.data(),
+                  (uint32_t)msg._data.size());
+    msgs.clear();
+
+    if (conflated - lastConflated >= 1000) {
+      lastConflated = conflated;
+      _mgr->log_client(
+          _id, fmtutil::format("MQClient {} is lagging, {} messages conflated",
+                               _id, conflated));
+    }
+  }
+}
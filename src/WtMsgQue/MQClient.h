@@ -10,6 +10,7 @@
 #pragma once
 #include "PorterDefs.h"
 #include <queue>
+#include <vector>
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/WTSMarcos.h"
@@ -26,6 +27,14 @@ public:
 private:
   void extract_buffer();
 
+  /*
+   *	把消息交给回调
+   *	合并模式下先放到待分发队列里,同一个主题只保留最新的一条
+   */
+  void dispatch(const char *topic, const char *data, uint32_t dataLen);
+
+  void dispatch_loop();
+
   inline bool is_allowed(const char *topic) {
     if (_topics.empty())
       return true;
@@ -44,7 +53,17 @@ public:
 
   void start();
 
-  inline void sub_topic(const char *topic) { _topics.insert(topic); }
+  /*
+   *	订阅主题,没有订阅任何主题则接收全部主题
+   *	订阅会设置到nanomsg的socket上,不需要的主题不会进入接收缓存
+   */
+  void sub_topic(const char *topic);
+
+  /*
+   *	设置合并模式,要在start之前调用
+   *	回调处理不过来的时候,同一个主题只保留最新的一条消息
+   */
+  inline void set_conflation(bool bConflate) { _conflate = bConflate; }
 
 private:
   std::string m_strURL;
@@ -63,6 +82,21 @@ private:
 
   wt_hashset<std::string> _topics;
   char _recv_buf[1024 * 1024];
+
+  // 合并模式,接收和回调分到两个线程
+  bool _conflate;
+  StdThreadPtr m_thrdDispatch;
+  StdUniqueMutex _mtx_pending;
+  StdCondVariable _cond_pending;
+
+  typedef struct _PendingMsg {
+    std::string _topic;
+    std::string _data;
+  } PendingMsg;
+  typedef std::vector<PendingMsg> PendingList;
+  PendingList _pending;
+  wt_hashmap<std::string, std::size_t> _pending_idx; // 主题在待分发队列里的位置
+  uint64_t _conflated;                               // 被合并掉的消息条数
 };
 
 NS_WTP_END
\ No newline at end of file
@@ -39,6 +39,29 @@ void MQManager::publish_message(WtUInt32 id, const char *topic,
   server->publish(topic, data, dataLen);
 }
 
+char *MQManager::reserve_message(WtUInt32 id, const char *topic,
+                                 WtUInt32 maxLen) {
+  auto it = _servers.find(id);
+  if (it == _servers.end()) {
+    log_server(id, fmt::format("MQServer {} not exists", id).c_str());
+    return NULL;
+  }
+
+  MQServerPtr &server = (MQServerPtr &)it->second;
+  return server->reserve(topic, maxLen);
+}
+
+void MQManager::commit_message(WtUInt32 id, char *data, WtUInt32 dataLen) {
+  auto it = _servers.find(id);
+  if (it == _servers.end()) {
+    log_server(id, fmt::format("MQServer {} not exists", id).c_str());
+    return;
+  }
+
+  MQServerPtr &server = (MQServerPtr &)it->second;
+  server->commit(data, dataLen);
+}
+
 void MQManager::log_server(WtUInt32 id, const char *message) {
   if (_cb_log)
     _cb_log(id, message, true);
@@ -81,6 +104,17 @@ void MQManager::sub_topic(WtUInt32 id, const char *topic) {
   client->sub_topic(topic);
 }
 
+void MQManager::set_conflation(WtUInt32 id, bool bConflate) {
+  auto it = _clients.find(id);
+  if (it == _clients.end()) {
+    log_client(id, fmt::format("MQClient {} not exists", id).c_str());
+    return;
+  }
+
+  MQClientPtr &client = (MQClientPtr &)it->second;
+  client->set_conflation(bConflate);
+}
+
 void MQManager::start_client(WtUInt32 id) {
   auto it = _clients.find(id);
   if (it == _clients.end()) {
@@ -33,10 +33,13 @@ public:
   void destroy_server(WtUInt32 id);
   void publish_message(WtUInt32 id, const char *topic, const void *data,
                        WtUInt32 dataLen);
+  char *reserve_message(WtUInt32 id, const char *topic, WtUInt32 maxLen);
+  void commit_message(WtUInt32 id, char *data, WtUInt32 dataLen);
 
   WtUInt32 create_client(const char *url, FuncMQCallback cb);
   void destroy_client(WtUInt32 id);
   void sub_topic(WtUInt32 id, const char *topic);
+  void set_conflation(WtUInt32 id, bool bConflate);
   void start_client(WtUInt32 id);
 
   void log_server(WtUInt32 id, const char *message);
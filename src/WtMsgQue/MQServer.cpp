@@ -30,8 +30,18 @@ inline uint32_t makeMQSvrId() {
 
 MQServer::MQServer(MQManager *mgr)
     : _sock(-1), _ready(false), _mgr(mgr), _confirm(false),
-      m_bTerminated(false), m_bTimeout(false) {
+      m_bTerminated(false), m_bWaiting(false), _write_pos(0), _read_pos(0),
+      _dropped(0) {
   _id = makeMQSvrId();
+
+  // 预先分配好全部槽位,发布的时候不再分配内存
+  _slots.reset(new MQSlot[MQ_RING_CAPACITY]);
+  _mask = MQ_RING_CAPACITY - 1;
+  for (uint64_t i = 0; i < MQ_RING_CAPACITY; i++) {
+    _slots[i]._seq.store(i, std::memory_order_relaxed);
+    _slots[i]._len = 0;
+    _slots[i]._packet = NULL;
+  }
 }
 
 MQServer::~MQServer() {
@@ -39,7 +49,10 @@ MQServer::~MQServer() {
     return;
 
   m_bTerminated = true;
-  m_condCast.notify_all();
+  {
+    StdUniqueLock lock(m_mtxCast);
+    m_condCast.notify_all();
+  }
   if (m_thrdCast)
     m_thrdCast->join();
 
@@ -79,81 +92,163 @@ bool MQServer::init(const char *url, bool confirm /* = false */) {
 
   _ready = true;
 
+  m_thrdCast.reset(new StdThread([this]() { cast_loop(); }));
+
   _mgr->log_server(_id, fmt::format("MQServer {} ready", _id).c_str());
   return true;
 }
 
 void MQServer::publish(const char *topic, const void *data, uint32_t dataLen) {
+  if (data == NULL || dataLen == 0)
+    return;
+
+  char *buf = reserve(topic, dataLen);
+  if (buf == NULL)
+    return;
+
+  memcpy(buf, data, dataLen);
+  commit(buf, dataLen);
+}
+
+char *MQServer::reserve(const char *topic, uint32_t maxLen) {
   if (_sock < 0) {
     _mgr->log_server(
         _id,
         fmt::format("MQServer {} has not been initialized yet", _id).c_str());
-    return;
+    return NULL;
   }
 
-  if (data == NULL || dataLen == 0 || m_bTerminated)
-    return;
-
-  {
-    StdUniqueLock lock(m_mtxCast);
-    m_dataQue.push(PubData(topic, data, dataLen));
-    m_bTimeout = false;
+  if (m_bTerminated)
+    return NULL;
+
+  // 抢占一个空闲的槽位,多个线程同时发布也是安全的
+  MQSlot *slot = NULL;
+  uint64_t pos = _write_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot = &_slots[pos & _mask];
+    uint64_t seq = slot->_seq.load(std::memory_order_acquire);
+    int64_t diff = (int64_t)seq - (int64_t)pos;
+    if (diff == 0) {
+      if (_write_pos.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      // 队列满了,发送线程跟不上,丢掉这条消息
+      uint64_t dropped = _dropped.fetch_add(1) + 1;
+      if (dropped == 1 || dropped % 1000 == 0)
+        _mgr->log_server(
+            _id, fmt::format("MQServer {} queue is full, {} messages dropped",
+                             _id, dropped)
+                     .c_str());
+      return NULL;
+    } else {
+      pos = _write_pos.load(std::memory_order_relaxed);
+    }
   }
 
-  if (m_thrdCast == NULL) {
-    m_thrdCast.reset(new StdThread([this]() {
-      if (m_sendBuf.empty())
-        m_sendBuf.resize(1024 * 1024, 0);
-      while (!m_bTerminated) {
-        int cnt = (int)nn_get_statistic(_sock, NN_STAT_CURRENT_CONNECTIONS);
-        if (m_dataQue.empty() || (cnt == 0 && _confirm)) {
-          StdUniqueLock lock(m_mtxCast);
-          m_bTimeout = true;
-          m_condCast.wait_for(lock, std::chrono::seconds(60));
-          // 如果有新的数据进来，timeout会被改为false
-          // 如果没有新的数据进来，timeout会保持为true
-          if (m_bTimeout) {
-            // 等待超时以后，广播心跳包
-            m_dataQue.push(PubData("HEARTBEAT", "", 0));
-          } else {
-            continue;
-          }
-        }
-
-        PubDataQue tmpQue;
-        {
-          StdUniqueLock lock(m_mtxCast);
-          tmpQue.swap(m_dataQue);
-        }
-
-        while (!tmpQue.empty()) {
-          const PubData &pubData = tmpQue.front();
-
-          if (!pubData._data.empty()) {
-            std::size_t len = sizeof(MQPacket) + pubData._data.size();
-            if (m_sendBuf.size() < len)
-              m_sendBuf.resize(m_sendBuf.size() * 2);
-            MQPacket *pack = (MQPacket *)m_sendBuf.data();
-            strncpy(pack->_topic, pubData._topic.c_str(), 32);
-            pack->_length = (uint32_t)pubData._data.size();
-            memcpy(&pack->_data, pubData._data.data(), pubData._data.size());
-            int bytes_snd = 0;
-            for (;;) {
-              int bytes = nn_send(_sock, m_sendBuf.data() + bytes_snd,
-                                  len - bytes_snd, 0);
-              if (bytes >= 0) {
-                bytes_snd += bytes;
-                if (bytes_snd == len)
-                  break;
-              } else
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            }
-          }
-          tmpQue.pop();
-        }
-      }
-    }));
+  std::size_t needed = sizeof(MQSlot *) + sizeof(MQPacket) + maxLen;
+  if (needed <= MQ_SLOT_SIZE) {
+    slot->_packet = slot->_buf + sizeof(MQSlot *);
   } else {
+    if (slot->_large.size() < needed)
+      slot->_large.resize(needed);
+    slot->_packet = (char *)slot->_large.data() + sizeof(MQSlot *);
+  }
+  *(MQSlot **)(slot->_packet - sizeof(MQSlot *)) = slot;
+
+  MQPacket *pack = (MQPacket *)slot->_packet;
+  strncpy(pack->_topic, topic, 32);
+  pack->_length = 0;
+  return pack->_data;
+}
+
+void MQServer::commit(char *data, uint32_t dataLen) {
+  MQPacket *pack = (MQPacket *)(data - sizeof(MQPacket));
+  MQSlot *slot = *(MQSlot **)((char *)pack - sizeof(MQSlot *));
+  pack->_length = dataLen;
+  slot->_len = (uint32_t)sizeof(MQPacket) + dataLen;
+
+  // 提交和检查等待标记都要用顺序一致的原子操作,否则可能漏掉唤醒
+  uint64_t seq = slot->_seq.load(std::memory_order_relaxed);
+  slot->_seq.store(seq + 1);
+  if (m_bWaiting.load()) {
+    StdUniqueLock lock(m_mtxCast);
     m_condCast.notify_all();
   }
-}
\ No newline at end of file
+}
+
+bool MQServer::send_batch() {
+  struct nn_iovec iovs[MQ_BATCH_COUNT];
+  int iovCnt = 0;
+  std::size_t bytes = 0;
+
+  uint64_t pos = _read_pos;
+  const char *topic = NULL;
+  while (iovCnt < MQ_BATCH_COUNT) {
+    MQSlot &slot = _slots[pos & _mask];
+    if (slot._seq.load(std::memory_order_acquire) != pos + 1)
+      break;
+
+    // 大消息可以单独成帧,但不能和其他消息合并超过上限
+    if (iovCnt > 0 && bytes + slot._len > MQ_BATCH_SIZE)
+      break;
+
+    // 一帧里只放同一个主题的消息,客户端才能按照帧的前缀订阅
+    const char *curTopic = ((MQPacket *)slot._packet)->_topic;
+    if (iovCnt > 0 && strncmp(topic, curTopic, 32) != 0)
+      break;
+
+    // 空消息不用发送
+    if (slot._len > sizeof(MQPacket)) {
+      topic = curTopic;
+      iovs[iovCnt].iov_base = slot._packet;
+      iovs[iovCnt].iov_len = slot._len;
+      iovCnt++;
+      bytes += slot._len;
+    }
+    pos++;
+  }
+
+  if (pos == _read_pos)
+    return false;
+
+  // 直接把槽位的内存交给nanomsg,多条消息拼成一帧,接收端会逐条拆开
+  if (iovCnt > 0) {
+    struct nn_msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = iovs;
+    hdr.msg_iovlen = iovCnt;
+    while (nn_sendmsg(_sock, &hdr, 0) < 0) {
+      if (m_bTerminated)
+        break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  // 发送完了,槽位还给发布线程
+  for (; _read_pos < pos; _read_pos++) {
+    MQSlot &slot = _slots[_read_pos & _mask];
+    slot._seq.store(_read_pos + _mask + 1, std::memory_order_release);
+  }
+
+  return true;
+}
+
+void MQServer::cast_loop() {
+  while (!m_bTerminated) {
+    int cnt = (int)nn_get_statistic(_sock, NN_STAT_CURRENT_CONNECTIONS);
+    if (!(cnt == 0 && _confirm) && send_batch())
+      continue;
+
+    // 先设置等待标记再检查一次,发布线程看到标记才会去唤醒
+    StdUniqueLock lock(m_mtxCast);
+    m_bWaiting = true;
+    if (!has_ready() || (cnt == 0 && _confirm))
+      m_condCast.wait_for(lock, std::chrono::seconds(1));
+    m_bWaiting = false;
+  }
+
+  // 退出前把剩余的数据发出去
+  while (send_batch())
+    ;
+}
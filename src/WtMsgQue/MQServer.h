@@ -9,11 +9,18 @@
  */
 #pragma once
 
-#include <queue>
+#include <atomic>
+#include <memory>
+#include <string>
 
 #include "../Includes/WTSMarcos.h"
 #include "../Share/StdUtils.hpp"
 
+#define MQ_SLOT_SIZE 1024         // 每个槽位的缓存大小,放不下的单独分配
+#define MQ_RING_CAPACITY 4096     // 槽位个数
+#define MQ_BATCH_SIZE (64 * 1024) // 合并到一帧里发送的最大字节数
+#define MQ_BATCH_COUNT 64         // 合并到一帧里发送的最大消息条数
+
 NS_WTP_BEGIN
 class MQManager;
 
@@ -29,6 +36,34 @@ public:
 
   void publish(const char *topic, const void *data, uint32_t dataLen);
 
+  /*
+   *	预留一条消息的空间,调用方直接把数据序列化到返回的地址
+   *	写完以后调用commit提交,队列满了返回NULL
+   *	@maxLen	数据的最大长度
+   */
+  char *reserve(const char *topic, uint32_t maxLen);
+
+  /*
+   *	提交reserve预留的消息
+   *	@data		reserve返回的地址
+   *	@dataLen	实际写入的长度,不能超过预留的长度
+   */
+  void commit(char *data, uint32_t dataLen);
+
+private:
+  void cast_loop();
+
+  /*
+   *	把已经提交的消息合并成一帧发送出去
+   *	返回是否发送了数据
+   */
+  bool send_batch();
+
+  inline bool has_ready() const {
+    const MQSlot &slot = _slots[_read_pos & _mask];
+    return slot._seq.load() == _read_pos + 1;
+  }
+
 private:
   std::string _url;
   bool _ready;
@@ -40,24 +75,27 @@ private:
   StdThreadPtr m_thrdCast;
   StdCondVariable m_condCast;
   StdUniqueMutex m_mtxCast;
-  bool m_bTerminated;
-  bool m_bTimeout;
-
-  typedef struct _PubData {
-    std::string _topic;
-    std::string _data;
-
-    _PubData(const char *topic, const void *data, uint32_t dataLen)
-        : _topic(topic) {
-      if (data != NULL && dataLen != 0) {
-        _data.append((const char *)data, dataLen);
-      }
-    }
-  } PubData;
-  typedef std::queue<PubData> PubDataQue;
-
-  PubDataQue m_dataQue;
-  std::string m_sendBuf;
+  std::atomic<bool> m_bTerminated;
+  std::atomic<bool> m_bWaiting; // 发送线程是否在等待
+
+  /*
+   *	消息槽位
+   *	_seq等于pos表示空闲,等于pos+1表示已经提交,发送完以后改为pos+capacity
+   *	数据包前面放一个指向槽位的指针,commit的时候据此找到槽位
+   */
+  typedef struct alignas(64) _MQSlot {
+    std::atomic<uint64_t> _seq;
+    uint32_t _len;      // 整个数据包的长度
+    char *_packet;      // 数据包地址,指向_buf或者_large
+    std::string _large; // 大消息单独分配的缓存
+    char _buf[MQ_SLOT_SIZE];
+  } MQSlot;
+
+  std::unique_ptr<MQSlot[]> _slots;
+  uint64_t _mask;
+  alignas(64) std::atomic<uint64_t> _write_pos;
+  alignas(64) uint64_t _read_pos;
+  std::atomic<uint64_t> _dropped;
 };
 
 NS_WTP_END
\ No newline at end of file
@@ -39,6 +39,14 @@ void publish_message(WtUInt32 id, const char *topic, const char *data,
   getMgr().publish_message(id, topic, data, dataLen);
 }
 
+char *reserve_message(WtUInt32 id, const char *topic, WtUInt32 maxLen) {
+  return getMgr().reserve_message(id, topic, maxLen);
+}
+
+void commit_message(WtUInt32 id, char *data, WtUInt32 dataLen) {
+  getMgr().commit_message(id, data, dataLen);
+}
+
 WtUInt32 create_client(const char *url, FuncMQCallback cb) {
   return getMgr().create_client(url, cb);
 }
@@ -49,4 +57,8 @@ void subscribe_topic(WtUInt32 id, const char *topic) {
   return getMgr().sub_topic(id, topic);
 }
 
+void set_conflation(WtUInt32 id, bool bConflate) {
+  getMgr().set_conflation(id, bConflate);
+}
+
 void start_client(WtUInt32 id) { getMgr().start_client(id); }
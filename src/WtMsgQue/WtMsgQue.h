@@ -19,10 +19,16 @@ EXPORT_FLAG WtUInt32 create_server(const char *url, bool confirm);
 EXPORT_FLAG void destroy_server(WtUInt32 id);
 EXPORT_FLAG void publish_message(WtUInt32 id, const char *topic,
                                  const char *data, WtUInt32 dataLen);
+// 预留消息空间,调用方直接写入数据以后再提交,省掉一次拷贝
+EXPORT_FLAG char *reserve_message(WtUInt32 id, const char *topic,
+                                  WtUInt32 maxLen);
+EXPORT_FLAG void commit_message(WtUInt32 id, char *data, WtUInt32 dataLen);
 
 EXPORT_FLAG WtUInt32 create_client(const char *url, FuncMQCallback cb);
 EXPORT_FLAG void destroy_client(WtUInt32 id);
 EXPORT_FLAG void subscribe_topic(WtUInt32 id, const char *topic);
+// 合并模式,处理不过来的时候同一个主题只保留最新的消息,要在start_client之前调用
+EXPORT_FLAG void set_conflation(WtUInt32 id, bool bConflate);
 EXPORT_FLAG void start_client(WtUInt32 id);
 #ifdef __cplusplus
 }
@@ -297,7 +297,7 @@ uint32_t WtRtRunner::createHftContext(const char *name, const char *trader,
   TraderAdapterPtr trdPtr = _traders.getAdapter(trader);
   if (trdPtr) {
     ctx->setTrader(trdPtr.get());
-    trdPtr->addSink(ctx);
+    trdPtr->addSink(_hft_engine.get_trd_sink(ctx));
   } else {
     WTSLogger::error(
         "Trader {} not exists, Binding trader to HFT strategy failed", trader);
@@ -784,7 +784,7 @@ bool WtRtRunner::initHftStrategies() {
     TraderAdapterPtr trader = _traders.getAdapter(traderid);
     if (trader) {
       ctx->setTrader(trader.get());
-      trader->addSink(ctx);
+      trader->addSink(_hft_engine.get_trd_sink(ctx));
     } else {
       WTSLogger::error(
           "Trader {} not exists, Binding trader to HFT strategy failed",
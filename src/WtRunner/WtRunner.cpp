@@ -288,7 +288,7 @@ bool WtRunner::initHftStrategies() {
     TraderAdapterPtr trader = _traders.getAdapter(traderid);
     if (trader) {
       ctx->setTrader(trader.get());
-      trader->addSink(ctx);
+      trader->addSink(_hft_engine.get_trd_sink(ctx));
     } else {
       WTSLogger::error(
           "Trader {} not exists, binding trader to HFT strategy failed",
@@ -3,6 +3,14 @@
 #include "../Share/StdUtils.hpp"
 #include "../Share/TimeUtils.hpp"
 
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <limits.h>
+
 using namespace shareblock;
 
 bool ShareBlocks::init_master(const char *name, const char *path /* = ""*/) {
@@ -19,12 +27,36 @@ bool ShareBlocks::init_master(const char *name, const char *path /* = ""*/) {
     bf.create_new_file(filename.c_str());
     bf.truncate_file(sizeof(ShmBlock));
     bf.close_file();
+  } else if (BoostFile::get_file_size(filename.c_str()) < sizeof(ShmBlock)) {
+    // 老版本的文件没有扩展区，扩展出来的部分都是0
+    BoostFile bf;
+    bf.open_existing_file(filename.c_str());
+    bf.truncate_file(sizeof(ShmBlock));
+    bf.close_file();
   }
 
   shm._domain.reset(new BoostMappingFile);
   shm._domain->map(filename.c_str());
   shm._master = true;
   shm._block = (ShmBlock *)shm._domain->addr();
+  shm._ext = true;
+
+  if (shm._block->_ext_flag != SHM_EXT_FLAG) {
+    shm._block->_notify = 0;
+    shm._block->_waiters = 0;
+    for (uint32_t i = 0; i < MAX_SEC_CNT; i++) {
+      shm._block->_states[i]._seq = 0;
+      shm._block->_states[i]._version = 0;
+    }
+    shm._block->_ext_flag = SHM_EXT_FLAG;
+  } else {
+    // 上一次的写进程可能在写入过程中退出了，这里把序号恢复成偶数
+    for (uint32_t i = 0; i < MAX_SEC_CNT; i++) {
+      SecState &state = shm._block->_states[i];
+      if (state._seq & 1)
+        state._seq++;
+    }
+  }
 
   /*
    *	By Wesley @ 2023.09.20
@@ -46,6 +78,12 @@ bool ShareBlocks::init_master(const char *name, const char *path /* = ""*/) {
       memcpy(shm._block->_sections, aySecs.data(),
              sizeof(SecInfo) * shm._block->_count);
 
+    // 小节的位置变了，版本号也要跟着重置
+    for (uint32_t i = 0; i < MAX_SEC_CNT; i++) {
+      shm._block->_states[i]._seq = 0;
+      shm._block->_states[i]._version = 0;
+    }
+
     shm._blocktime = shm._block->_updatetime;
   }
 
@@ -90,6 +128,8 @@ bool ShareBlocks::init_slave(const char *name, const char *path /* = ""*/) {
   shm._master = false;
   shm._block = (ShmBlock *)shm._domain->addr();
   shm._blocktime = shm._block->_updatetime;
+  shm._ext = shm._domain->size() >= sizeof(ShmBlock) &&
+             shm._block->_ext_flag == SHM_EXT_FLAG;
 
   // slave模式下，应该需要加载一下
   // if (strcmp(shm._block->_flag, BLK_FLAG) == 0)
@@ -192,9 +232,150 @@ bool ShareBlocks::commit_section(const char *domain, const char *section) {
   ShmPair::KVPair &kvPair = (ShmPair::KVPair &)sit->second;
   SecInfo &secInfo = shm._block->_sections[kvPair._index];
   secInfo._updatetime = TimeUtils::getLocalTimeNow();
+
+  if (shm._ext) {
+    SecState &state = shm._block->_states[kvPair._index];
+    if (shm._batching[kvPair._index]) {
+      write_unlock(&state);
+      shm._batching[kvPair._index] = false;
+    }
+    state._version++;
+    notify_change(shm);
+  }
+  return true;
+}
+
+bool ShareBlocks::begin_section(const char *domain, const char *section) {
+  auto it = _shm_blocks.find(domain);
+  if (it == _shm_blocks.end())
+    return false;
+
+  ShmPair &shm = (ShmPair &)it->second;
+  auto sit = shm._sections.find(section);
+  if (sit == shm._sections.end())
+    return false;
+
+  uint32_t idx = sit->second._index;
+  if (!shm._ext || shm._batching[idx])
+    return true;
+
+  write_lock(&shm._block->_states[idx]);
+  shm._batching[idx] = true;
   return true;
 }
 
+uint64_t ShareBlocks::get_section_version(const char *domain,
+                                          const char *section) {
+  auto it = _shm_blocks.find(domain);
+  if (it == _shm_blocks.end())
+    return 0;
+
+  const ShmPair &shm = (ShmPair &)it->second;
+  if (!shm._ext)
+    return 0;
+
+  auto sit = shm._sections.find(section);
+  if (sit == shm._sections.end())
+    return 0;
+
+  return shm._block->_states[sit->second._index]._version;
+}
+
+void ShareBlocks::notify_change(ShmPair &shm) {
+  if (!shm._ext)
+    return;
+
+  shm._block->_notify++;
+#ifdef __linux__
+  // 没有等待的进程就不用进内核了
+  if (shm._block->_waiters > 0)
+    syscall(SYS_futex, (uint32_t *)&shm._block->_notify, FUTEX_WAKE, INT_MAX,
+            NULL, NULL, 0);
+#endif
+}
+
+uint32_t ShareBlocks::wait_for_change(const char *domain, uint32_t lastSeq,
+                                      uint32_t timeout) {
+  auto it = _shm_blocks.find(domain);
+  if (it == _shm_blocks.end() || !it->second._ext) {
+    // 老版本的文件没有变更通知，只能等超时
+    std::this_thread::sleep_for(std::chrono::microseconds(timeout));
+    return lastSeq;
+  }
+
+  ShmBlock *block = it->second._block;
+  uint32_t curSeq = block->_notify;
+  if (curSeq != lastSeq)
+    return curSeq;
+
+#ifdef __linux__
+  // 文件映射的内存是进程间共享的，不能用FUTEX_PRIVATE_FLAG
+  struct timespec ts;
+  ts.tv_sec = timeout / 1000000;
+  ts.tv_nsec = (timeout % 1000000) * 1000;
+  block->_waiters++;
+  syscall(SYS_futex, (uint32_t *)&block->_notify, FUTEX_WAIT, lastSeq, &ts,
+          NULL, 0);
+  block->_waiters--;
+#else
+  // 其他平台没有跨进程的futex，退化成短间隔的检查
+  TimeUtils::Ticker ticker;
+  while (block->_notify == lastSeq &&
+         ticker.micro_seconds() < (int64_t)timeout)
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+#endif
+
+  return block->_notify;
+}
+
+const KeyHandle *ShareBlocks::get_key_handle(const char *domain,
+                                             const char *section,
+                                             const char *key) {
+  std::string fullKey = domain;
+  fullKey += ".";
+  fullKey += section;
+  fullKey += ".";
+  fullKey += key;
+  auto hit = _handles.find(fullKey);
+  if (hit != _handles.end())
+    return hit->second.get();
+
+  auto it = _shm_blocks.find(domain);
+  if (it == _shm_blocks.end())
+    return NULL;
+
+  ShmPair &shm = (ShmPair &)it->second;
+  auto sit = shm._sections.find(section);
+  if (sit == shm._sections.end())
+    return NULL;
+
+  const ShmPair::KVPair &kvPair = sit->second;
+  auto kit = kvPair._keys.find(key);
+  if (kit == kvPair._keys.end())
+    return NULL;
+
+  KeyHandlePtr handle(new KeyHandle);
+  handle->_sec = &shm._block->_sections[kvPair._index];
+  handle->_state = shm._ext ? &shm._block->_states[kvPair._index] : NULL;
+  handle->_key = kit->second;
+  _handles[fullKey] = handle;
+  return handle.get();
+}
+
+uint32_t ShareBlocks::read_by_handle(const KeyHandle *handle, void *buf,
+                                     uint32_t len) {
+  if (handle == NULL || handle->_key->_type > SMVT_STRING)
+    return 0;
+
+  uint32_t realLen =
+      std::min(len, (uint32_t)SMVT_SIZES[handle->_key->_type]);
+  if (!read_locked(handle->_state, handle->_sec->_data + handle->_key->_offset,
+                   buf, realLen))
+    return 0;
+
+  return realLen;
+}
+
 bool ShareBlocks::delete_section(const char *domain, const char *section) {
   auto it = _shm_blocks.find(domain);
   if (it == _shm_blocks.end())
@@ -209,12 +390,14 @@ bool ShareBlocks::delete_section(const char *domain, const char *section) {
   shm._sections.erase(sit);
   shm._block->_sections[idx]._state = 2;
   shm._block->_updatetime = TimeUtils::getLocalTimeNow();
+  notify_change(shm);
   return true;
 }
 
 void *ShareBlocks::make_valid(const char *domain, const char *section,
                               const char *key, ValueType vType,
-                              SecInfo *&secInfo) {
+                              SecInfo *&secInfo,
+                              SecState **secState /* = NULL */) {
   auto it = _shm_blocks.find(domain);
   if (it == _shm_blocks.end())
     return nullptr;
@@ -248,6 +431,12 @@ void *ShareBlocks::make_valid(const char *domain, const char *section,
   secInfo = &shm._block->_sections[kvPair->_index];
   secInfo->_state = 1;
 
+  // 批量写入的时候已经加过锁了
+  if (secState)
+    *secState = (shm._ext && !shm._batching[kvPair->_index])
+                    ? &shm._block->_states[kvPair->_index]
+                    : NULL;
+
   auto kit = kvPair->_keys.find(key);
   if (kit == kvPair->_keys.end()) {
     // 如果不是master，就不能创建
@@ -278,7 +467,8 @@ void *ShareBlocks::make_valid(const char *domain, const char *section,
 
 void *ShareBlocks::check_valid(const char *domain, const char *section,
                                const char *key, ValueType vType,
-                               SecInfo *&secInfo) {
+                               SecInfo *&secInfo,
+                               SecState **secState /* = NULL */) {
   auto it = _shm_blocks.find(domain);
   if (it == _shm_blocks.end())
     return nullptr;
@@ -294,6 +484,8 @@ void *ShareBlocks::check_valid(const char *domain, const char *section,
   }
 
   secInfo = &shm._block->_sections[kvPair->_index];
+  if (secState)
+    *secState = shm._ext ? &shm._block->_states[kvPair->_index] : NULL;
 
   auto kit = kvPair->_keys.find(key);
   if (kit == kvPair->_keys.end()) {
@@ -467,13 +659,16 @@ double *ShareBlocks::allocate_double(const char *domain, const char *section,
 bool ShareBlocks::set_string(const char *domain, const char *section,
                              const char *key, const char *val) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)make_valid(domain, section, key, SMVT_STRING, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)make_valid(domain, section, key, SMVT_STRING,
+                                           secInfo, &secState);
   if (keyInfo == nullptr)
     return false;
 
+  write_lock(secState);
   keyInfo->_type = SMVT_STRING;
   wt_strcpy(secInfo->_data + keyInfo->_offset, val, SMVT_SIZES[SMVT_STRING]);
+  write_unlock(secState);
 
   return true;
 }
@@ -481,13 +676,16 @@ bool ShareBlocks::set_string(const char *domain, const char *section,
 bool ShareBlocks::set_int32(const char *domain, const char *section,
                             const char *key, int32_t val) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)make_valid(domain, section, key, SMVT_INT32, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)make_valid(domain, section, key, SMVT_INT32,
+                                           secInfo, &secState);
   if (keyInfo == nullptr)
     return false;
 
+  write_lock(secState);
   keyInfo->_type = SMVT_INT32;
   *secInfo->get<int32_t>(keyInfo->_offset) = val;
+  write_unlock(secState);
 
   return true;
 }
@@ -495,13 +693,16 @@ bool ShareBlocks::set_int32(const char *domain, const char *section,
 bool ShareBlocks::set_int64(const char *domain, const char *section,
                             const char *key, int64_t val) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)make_valid(domain, section, key, SMVT_INT64, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)make_valid(domain, section, key, SMVT_INT64,
+                                           secInfo, &secState);
   if (keyInfo == nullptr)
     return false;
 
+  write_lock(secState);
   keyInfo->_type = SMVT_INT64;
   *secInfo->get<int64_t>(keyInfo->_offset) = val;
+  write_unlock(secState);
 
   return true;
 }
@@ -509,13 +710,16 @@ bool ShareBlocks::set_int64(const char *domain, const char *section,
 bool ShareBlocks::set_uint32(const char *domain, const char *section,
                              const char *key, uint32_t val) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)make_valid(domain, section, key, SMVT_UINT32, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)make_valid(domain, section, key, SMVT_UINT32,
+                                           secInfo, &secState);
   if (keyInfo == nullptr)
     return false;
 
+  write_lock(secState);
   keyInfo->_type = SMVT_UINT32;
   *secInfo->get<uint32_t>(keyInfo->_offset) = val;
+  write_unlock(secState);
 
   return true;
 }
@@ -523,13 +727,16 @@ bool ShareBlocks::set_uint32(const char *domain, const char *section,
 bool ShareBlocks::set_uint64(const char *domain, const char *section,
                              const char *key, uint64_t val) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)make_valid(domain, section, key, SMVT_UINT64, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)make_valid(domain, section, key, SMVT_UINT64,
+                                           secInfo, &secState);
   if (keyInfo == nullptr)
     return false;
 
+  write_lock(secState);
   keyInfo->_type = SMVT_UINT64;
   *secInfo->get<uint64_t>(keyInfo->_offset) = val;
+  write_unlock(secState);
 
   return true;
 }
@@ -537,13 +744,16 @@ bool ShareBlocks::set_uint64(const char *domain, const char *section,
 bool ShareBlocks::set_double(const char *domain, const char *section,
                              const char *key, double val) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)make_valid(domain, section, key, SMVT_DOUBLE, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)make_valid(domain, section, key, SMVT_DOUBLE,
+                                           secInfo, &secState);
   if (keyInfo == nullptr)
     return false;
 
+  write_lock(secState);
   keyInfo->_type = SMVT_DOUBLE;
   *secInfo->get<double>(keyInfo->_offset) = val;
+  write_unlock(secState);
 
   return true;
 }
@@ -563,56 +773,81 @@ const char *ShareBlocks::get_string(const char *domain, const char *section,
 int32_t ShareBlocks::get_int32(const char *domain, const char *section,
                                const char *key, int32_t defVal /* = 0 */) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)check_valid(domain, section, key, SMVT_INT32, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)check_valid(domain, section, key, SMVT_INT32,
+                                            secInfo, &secState);
   if (keyInfo == nullptr)
     return defVal;
 
-  return *(int32_t *)(secInfo->_data + keyInfo->_offset);
+  int32_t val;
+  if (!read_value(secState, secInfo->_data + keyInfo->_offset, val))
+    return defVal;
+
+  return val;
 }
 
 uint32_t ShareBlocks::get_uint32(const char *domain, const char *section,
                                  const char *key, uint32_t defVal /* = 0 */) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)check_valid(domain, section, key, SMVT_UINT32, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)check_valid(domain, section, key, SMVT_UINT32,
+                                            secInfo, &secState);
   if (keyInfo == nullptr)
     return defVal;
 
-  return *(uint32_t *)(secInfo->_data + keyInfo->_offset);
+  uint32_t val;
+  if (!read_value(secState, secInfo->_data + keyInfo->_offset, val))
+    return defVal;
+
+  return val;
 }
 
 int64_t ShareBlocks::get_int64(const char *domain, const char *section,
                                const char *key, int64_t defVal /* = 0 */) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)check_valid(domain, section, key, SMVT_INT64, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)check_valid(domain, section, key, SMVT_INT64,
+                                            secInfo, &secState);
   if (keyInfo == nullptr)
     return defVal;
 
-  return *(int64_t *)(secInfo->_data + keyInfo->_offset);
+  int64_t val;
+  if (!read_value(secState, secInfo->_data + keyInfo->_offset, val))
+    return defVal;
+
+  return val;
 }
 
 uint64_t ShareBlocks::get_uint64(const char *domain, const char *section,
                                  const char *key, uint64_t defVal /* = 0 */) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)check_valid(domain, section, key, SMVT_UINT64, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)check_valid(domain, section, key, SMVT_UINT64,
+                                            secInfo, &secState);
   if (keyInfo == nullptr)
     return defVal;
 
-  return *(uint64_t *)(secInfo->_data + keyInfo->_offset);
+  uint64_t val;
+  if (!read_value(secState, secInfo->_data + keyInfo->_offset, val))
+    return defVal;
+
+  return val;
 }
 
 double ShareBlocks::get_double(const char *domain, const char *section,
                                const char *key, double defVal /* = 0 */) {
   SecInfo *secInfo = nullptr;
-  KeyInfo *keyInfo =
-      (KeyInfo *)check_valid(domain, section, key, SMVT_DOUBLE, secInfo);
+  SecState *secState = nullptr;
+  KeyInfo *keyInfo = (KeyInfo *)check_valid(domain, section, key, SMVT_DOUBLE,
+                                            secInfo, &secState);
   if (keyInfo == nullptr)
     return defVal;
 
-  return *(double *)(secInfo->_data + keyInfo->_offset);
+  double val;
+  if (!read_value(secState, secInfo->_data + keyInfo->_offset, val))
+    return defVal;
+
+  return val;
 }
 
 bool ShareBlocks::init_cmder(const char *name, bool isCmder /* = false */,
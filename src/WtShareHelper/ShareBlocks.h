@@ -1,9 +1,13 @@
 ﻿#pragma once
+#include <atomic>
 #include <memory>
+#include <stddef.h>
 #include <stdint.h>
+#include <thread>
 
 #include "../Includes/FasterDefs.h"
 #include "../Share/BoostMappingFile.hpp"
+#include "../Share/TimeUtils.hpp"
 
 USING_NS_WTP;
 
@@ -17,6 +21,9 @@ const int MAX_SEC_CNT = 64;
 const int MAX_KEY_CNT = 64;
 const int MAX_CMD_SIZE = 64;
 
+const uint32_t SHM_EXT_FLAG = 0x57545345; // 扩展区标记
+const uint32_t MAX_READ_SPIN = 1000;      // 读取时等待写入的最多尝试次数
+
 typedef uint64_t ValueType;
 const ValueType SMVT_INT32 = 1;
 const ValueType SMVT_UINT32 = 2;
@@ -54,6 +61,15 @@ typedef struct _SectionInfo {
   _SectionInfo() { memset(this, 0, sizeof(_SectionInfo)); }
 } SecInfo;
 
+/*
+ *	小节的并发控制信息
+ *	同一个小节同时只能有一个写进程
+ */
+typedef struct _SecState {
+  std::atomic<uint64_t> _seq;     // seqlock序号，奇数表示正在写入
+  std::atomic<uint64_t> _version; // 提交次数，每次commit_section加1
+} SecState;
+
 typedef struct _ShmBlock {
   char _flag[8];
   char _name[32];
@@ -61,7 +77,13 @@ typedef struct _ShmBlock {
   uint64_t _updatetime;
   uint32_t _count;
 
-  _ShmBlock() { memset(this, 0, sizeof(_ShmBlock)); }
+  // 以下为扩展区，老版本的文件没有这部分，要根据_ext_flag判断
+  uint32_t _ext_flag;
+  std::atomic<uint32_t> _notify;  // 变更序号，linux下用作futex
+  std::atomic<uint32_t> _waiters; // 等待变更通知的线程数
+  SecState _states[MAX_SEC_CNT];
+
+  _ShmBlock() { memset((void *)this, 0, sizeof(_ShmBlock)); }
 } ShmBlock;
 
 typedef struct _CmdInfo {
@@ -85,6 +107,21 @@ typedef _CmdBlock<128> CmdBlock;
 
 #pragma pack(pop)
 
+// 扩展区的原子变量要对齐，futex也要求4字节对齐
+static_assert(offsetof(ShmBlock, _notify) % 4 == 0,
+              "notify word must be 4-byte aligned");
+static_assert(offsetof(ShmBlock, _states) % 8 == 0,
+              "section states must be 8-byte aligned");
+
+/*
+ *	预先解析好的key句柄，读取的时候不用再查找
+ */
+typedef struct _KeyHandle {
+  SecInfo *_sec;
+  SecState *_state; // 老版本的文件为NULL
+  KeyInfo *_key;
+} KeyHandle;
+
 class ShareBlocks {
 private:
   ShareBlocks() {}
@@ -105,8 +142,40 @@ public:
   std::vector<KeyInfo *> get_keys(const char *domain, const char *section);
 
   uint64_t get_section_updatetime(const char *domain, const char *section);
+
+  /*
+   *	开始批量写入一个小节，直到commit_section才算完成
+   *	读取方在这期间会等待，不会读到写了一半的数据
+   */
+  bool begin_section(const char *domain, const char *section);
   bool commit_section(const char *domain, const char *section);
 
+  /*
+   *	获取小节的版本号，每次提交都会加1
+   */
+  uint64_t get_section_version(const char *domain, const char *section);
+
+  /*
+   *	等待变更通知
+   *	@lastSeq	上一次拿到的变更序号
+   *	@timeout	超时时间，单位微秒
+   *	返回最新的变更序号，和lastSeq不同说明有变更
+   */
+  uint32_t wait_for_change(const char *domain, uint32_t lastSeq,
+                           uint32_t timeout);
+
+  /*
+   *	获取key的句柄，高频读取的时候可以省掉查找的开销
+   */
+  const KeyHandle *get_key_handle(const char *domain, const char *section,
+                                  const char *key);
+
+  /*
+   *	通过句柄读取数据，读取的过程受seqlock保护
+   *	返回读取的字节数，小节正在写入的时候返回0，buf的内容不可用
+   */
+  uint32_t read_by_handle(const KeyHandle *handle, void *buf, uint32_t len);
+
   bool delete_section(const char *domain, const char *section);
 
   const char *allocate_string(const char *domain, const char *section,
@@ -141,6 +210,9 @@ public:
   bool set_double(const char *domain, const char *section, const char *key,
                   double val);
 
+  /*
+   *	数值类型的读取受seqlock保护，小节正在写入的时候返回defVal
+   */
   const char *get_string(const char *domain, const char *section,
                          const char *key, const char *defVal = "");
   int32_t get_int32(const char *domain, const char *section, const char *key,
@@ -161,10 +233,60 @@ public:
   const char *get_cmd(const char *name, uint32_t &lastIdx);
 
 private:
+  /*
+   *	@secState	需要加锁的小节状态，批量写入中或者老版本的文件为NULL
+   */
   void *make_valid(const char *domain, const char *section, const char *key,
-                   ValueType vType, SecInfo *&secInfo);
+                   ValueType vType, SecInfo *&secInfo,
+                   SecState **secState = NULL);
   void *check_valid(const char *domain, const char *section, const char *key,
-                    ValueType vType, SecInfo *&secInfo);
+                    ValueType vType, SecInfo *&secInfo,
+                    SecState **secState = NULL);
+
+  static inline void write_lock(SecState *state) {
+    if (state == NULL)
+      return;
+
+    state->_seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  static inline void write_unlock(SecState *state) {
+    if (state == NULL)
+      return;
+
+    state->_seq.fetch_add(1, std::memory_order_release);
+  }
+
+  /*
+   *	seqlock读取
+   *	自旋有限次数，还在写入的返回false，不返回写了一半的数据
+   *	批量写入可能持续很久，写进程也可能在写入过程中退出，所以不一直等
+   */
+  static inline bool read_locked(const SecState *state, const void *src,
+                                 void *dst, std::size_t len) {
+    for (uint32_t i = 0; i < MAX_READ_SPIN; i++) {
+      uint64_t s1 = state ? state->_seq.load(std::memory_order_acquire) : 0;
+      if ((s1 & 1) != 0)
+        continue;
+
+      memcpy(dst, src, len);
+      if (state == NULL)
+        return true;
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (state->_seq.load(std::memory_order_relaxed) == s1)
+        return true;
+    }
+
+    return false;
+  }
+
+  template <typename T>
+  static inline bool read_value(const SecState *state, const void *src,
+                                T &val) {
+    return read_locked(state, src, &val, sizeof(T));
+  }
 
 private:
   typedef struct _ShmPair {
@@ -172,6 +294,8 @@ private:
     ShmBlock *_block;
     bool _master;
     uint64_t _blocktime;
+    bool _ext;                   // 是否有扩展区
+    bool _batching[MAX_SEC_CNT]; // 小节是否正在批量写入
 
     typedef wt_hashmap<std::string, KeyInfo *> KVMap;
     typedef struct _KVPair {
@@ -181,11 +305,18 @@ private:
     typedef wt_hashmap<std::string, KVPair> SectionMap;
     SectionMap _sections;
 
-    _ShmPair() : _block(nullptr), _master(false) {}
+    _ShmPair() : _block(nullptr), _master(false), _ext(false) {
+      memset(_batching, 0, sizeof(_batching));
+    }
   } ShmPair;
   typedef wt_hashmap<std::string, ShmPair> ShmBlockMap;
   ShmBlockMap _shm_blocks;
 
+  typedef std::shared_ptr<KeyHandle> KeyHandlePtr;
+  wt_hashmap<std::string, KeyHandlePtr> _handles;
+
+  void notify_change(ShmPair &shm);
+
   typedef struct _CmdPair {
     MappedFilePtr _domain;
     CmdBlock *_block;
@@ -39,10 +39,33 @@ uint64_t get_section_updatetime(const char *domain, const char *section) {
   return ShareBlocks::one().get_section_updatetime(domain, section);
 }
 
+bool begin_section(const char *domain, const char *section) {
+  return ShareBlocks::one().begin_section(domain, section);
+}
+
 bool commit_section(const char *domain, const char *section) {
   return ShareBlocks::one().commit_section(domain, section);
 }
 
+uint64_t get_section_version(const char *domain, const char *section) {
+  return ShareBlocks::one().get_section_version(domain, section);
+}
+
+uint32_t wait_for_change(const char *domain, uint32_t lastSeq,
+                         uint32_t timeout) {
+  return ShareBlocks::one().wait_for_change(domain, lastSeq, timeout);
+}
+
+const void *get_key_handle(const char *domain, const char *section,
+                           const char *key) {
+  return ShareBlocks::one().get_key_handle(domain, section, key);
+}
+
+uint32_t read_by_handle(const void *handle, void *buf, uint32_t len) {
+  return ShareBlocks::one().read_by_handle((const KeyHandle *)handle, buf,
+                                           len);
+}
+
 bool delete_section(const char *domain, const char *section) {
   return ShareBlocks::one().delete_section(domain, section);
 }
@@ -27,8 +27,22 @@ EXPORT_FLAG uint32_t get_keys(const char *domain, const char *section,
 EXPORT_FLAG uint64_t get_section_updatetime(const char *domain,
                                             const char *section);
 
+EXPORT_FLAG bool begin_section(const char *domain, const char *section);
+
 EXPORT_FLAG bool commit_section(const char *domain, const char *section);
 
+EXPORT_FLAG uint64_t get_section_version(const char *domain,
+                                         const char *section);
+
+EXPORT_FLAG uint32_t wait_for_change(const char *domain, uint32_t lastSeq,
+                                     uint32_t timeout);
+
+EXPORT_FLAG const void *get_key_handle(const char *domain, const char *section,
+                                       const char *key);
+
+EXPORT_FLAG uint32_t read_by_handle(const void *handle, void *buf,
+                                    uint32_t len);
+
 EXPORT_FLAG bool delete_section(const char *domain, const char *section);
 
 EXPORT_FLAG const char *allocate_string(const char *domain, const char *section,
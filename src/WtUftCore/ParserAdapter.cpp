@@ -145,6 +145,7 @@ bool ParserAdapter::init(const char *id, WTSVariant *cfg, IParserStub *stub,
       }
       ay->release();
 
+      _contracts.build(_bd_mgr, contractSet);
       _parser_api->subscribe(contractSet);
       contractSet.clear();
     } else {
@@ -207,6 +208,7 @@ bool ParserAdapter::initExt(const char *id, IParserApi *api, IParserStub *stub,
       }
       ay->release();
 
+      _contracts.build(_bd_mgr, contractSet);
       _parser_api->subscribe(contractSet);
       contractSet.clear();
     } else {
@@ -240,13 +242,21 @@ bool ParserAdapter::run() {
   return true;
 }
 
+WTSContractInfo *ParserAdapter::getContract(const char *code,
+                                             const char *exchg /* = "" */) {
+  WTSContractInfo *cInfo = _contracts.get(code, exchg);
+  if (cInfo == NULL)
+    cInfo = _bd_mgr->getContract(code, exchg);
+  return cInfo;
+}
+
 void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag) {
   if (quote == NULL || _stopped || quote->actiondate() == 0)
     return;
 
   WTSContractInfo *cInfo = quote->getContractInfo();
   if (cInfo == NULL)
-    cInfo = _bd_mgr->getContract(quote->code(), quote->exchg());
+    cInfo = getContract(quote->code(), quote->exchg());
   if (cInfo == NULL)
     return;
 
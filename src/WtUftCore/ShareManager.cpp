@@ -24,6 +24,14 @@ bool ShareManager::initialize(const char *module) {
       _inst, "get_section_updatetime");
   _commit_section =
       (func_commit_section)DLLHelper::get_symbol(_inst, "commit_section");
+  _get_section_version = (func_get_section_version)DLLHelper::get_symbol(
+      _inst, "get_section_version");
+  _wait_for_change =
+      (func_wait_for_change)DLLHelper::get_symbol(_inst, "wait_for_change");
+  _get_key_handle =
+      (func_get_key_handle)DLLHelper::get_symbol(_inst, "get_key_handle");
+  _read_by_handle =
+      (func_read_by_handle)DLLHelper::get_symbol(_inst, "read_by_handle");
 
   _set_double = (func_set_double)DLLHelper::get_symbol(_inst, "set_double");
   _set_int32 = (func_set_int32)DLLHelper::get_symbol(_inst, "set_int32");
@@ -59,7 +67,32 @@ bool ShareManager::start_watching(uint32_t microsecs) {
   if (!_inited)
     return false;
 
-  if (_inited && !_stopped && _worker == nullptr) {
+  if (_inited && !_stopped && _worker == nullptr &&
+      _wait_for_change != NULL && _get_section_version != NULL) {
+    // 新版本的模块支持变更通知，不用再轮询了
+    _worker.reset(new StdThread([this]() {
+      uint32_t notifySeq = 0;
+      while (!_stopped) {
+        for (auto &v : _secnames) {
+          if (_stopped)
+            break;
+
+          const char *section = v.first.c_str();
+          uint64_t &lastVer = (uint64_t &)v.second;
+          uint64_t curVer = _get_section_version(_exchg.c_str(), section);
+          if (curVer != lastVer) {
+            _engine->notify_params_update(section);
+            lastVer = curVer;
+          }
+        }
+
+        // 超时只是为了能及时退出
+        notifySeq = _wait_for_change(_exchg.c_str(), notifySeq, 100000);
+      }
+    }));
+
+    WTSLogger::info("Share domain is on watch with change notification");
+  } else if (_inited && !_stopped && _worker == nullptr) {
     _worker.reset(new StdThread([this, microsecs]() {
       while (!_stopped) {
         for (auto &v : _secnames) {
@@ -112,7 +145,10 @@ bool ShareManager::commit_param_watcher(const char *section) {
     return false;
 
   bool ret = _commit_section(_exchg.c_str(), section);
-  _secnames[section] = TimeUtils::getLocalTimeNow();
+  if (_get_section_version != NULL && _wait_for_change != NULL)
+    _secnames[section] = _get_section_version(_exchg.c_str(), section);
+  else
+    _secnames[section] = TimeUtils::getLocalTimeNow();
   return ret;
 }
 
@@ -211,6 +247,14 @@ double ShareManager::get_value(const char *section, const char *key,
   return _get_double(_exchg.c_str(), section, key, defVal);
 }
 
+const void *ShareManager::get_key_handle(const char *section,
+                                        const char *key) {
+  if (!_inited || _get_key_handle == NULL)
+    return NULL;
+
+  return _get_key_handle(_exchg.c_str(), section, key);
+}
+
 const char *ShareManager::allocate_value(const char *section, const char *key,
                                          const char *initVal /* = ""*/,
                                          bool bForceWrite /* = false*/,
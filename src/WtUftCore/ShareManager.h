@@ -14,6 +14,11 @@ USING_NS_WTP;
 typedef bool (*func_init_master)(const char *, const char *);
 typedef uint64_t (*func_get_section_updatetime)(const char *, const char *);
 typedef bool (*func_commit_section)(const char *, const char *);
+typedef uint64_t (*func_get_section_version)(const char *, const char *);
+typedef uint32_t (*func_wait_for_change)(const char *, uint32_t, uint32_t);
+typedef const void *(*func_get_key_handle)(const char *, const char *,
+                                           const char *);
+typedef uint32_t (*func_read_by_handle)(const void *, void *, uint32_t);
 typedef const char *(*func_allocate_string)(const char *, const char *,
                                             const char *, const char *, bool);
 typedef int32_t *(*func_allocate_int32)(const char *, const char *,
@@ -102,6 +107,27 @@ public:
 
   double get_value(const char *section, const char *key, double defVal = 0);
 
+  /*
+   *	获取交换区字段的句柄,高频读取的时候省掉查找的开销
+   *	老版本的模块或者字段还没有分配的时候返回NULL
+   */
+  const void *get_key_handle(const char *section, const char *key);
+
+  /*
+   *	通过句柄读取,小节正在写入的时候返回false,val保持不变
+   */
+  template <typename T> bool read_by_handle(const void *handle, T &val) {
+    if (handle == NULL || _read_by_handle == NULL)
+      return false;
+
+    T buf;
+    if (_read_by_handle(handle, &buf, sizeof(T)) != sizeof(T))
+      return false;
+
+    val = buf;
+    return true;
+  }
+
   /*
    *	在单向同步区分配字段
    */
@@ -141,6 +167,10 @@ private:
   func_init_master _init_master;
   func_get_section_updatetime _get_section_updatetime;
   func_commit_section _commit_section;
+  func_get_section_version _get_section_version; // 老版本的模块没有
+  func_wait_for_change _wait_for_change;         // 老版本的模块没有
+  func_get_key_handle _get_key_handle;           // 老版本的模块没有
+  func_read_by_handle _read_by_handle;           // 老版本的模块没有
 
   func_set_double _set_double;
   func_set_int32 _set_int32;
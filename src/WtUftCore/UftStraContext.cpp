@@ -669,34 +669,55 @@ void UftStraContext::on_params_updated() {
     _strategy->on_params_updated();
 }
 
+template <typename T>
+T UftStraContext::read_param_value(const char *name, T defVal) {
+  ParamSlot &slot = _param_slots[name];
+  if (slot._handle == NULL) {
+    slot._handle = ShareManager::self().get_key_handle(_name.c_str(), name);
+    // 老版本的模块或者参数还没有分配,按名称读取
+    if (slot._handle == NULL)
+      return ShareManager::self().get_value(_name.c_str(), name, defVal);
+  }
+
+  T val = defVal;
+  if (ShareManager::self().read_by_handle(slot._handle, val)) {
+    memcpy(&slot._last, &val, sizeof(T));
+    slot._valid = true;
+  } else if (slot._valid) {
+    memcpy(&val, &slot._last, sizeof(T));
+  }
+
+  return val;
+}
+
 const char *UftStraContext::watch_param(const char *name, const char *val) {
   return ShareManager::self().allocate_value(_name.c_str(), name, val, false,
                                              true);
 }
 
 int64_t UftStraContext::watch_param(const char *name, int64_t val) {
-  return *ShareManager::self().allocate_value(_name.c_str(), name, val, false,
-                                              true);
+  ShareManager::self().allocate_value(_name.c_str(), name, val, false, true);
+  return read_param_value(name, val);
 }
 
 int32_t UftStraContext::watch_param(const char *name, int32_t val) {
-  return *ShareManager::self().allocate_value(_name.c_str(), name, val, false,
-                                              true);
+  ShareManager::self().allocate_value(_name.c_str(), name, val, false, true);
+  return read_param_value(name, val);
 }
 
 uint64_t UftStraContext::watch_param(const char *name, uint64_t val) {
-  return *ShareManager::self().allocate_value(_name.c_str(), name, val, false,
-                                              true);
+  ShareManager::self().allocate_value(_name.c_str(), name, val, false, true);
+  return read_param_value(name, val);
 }
 
 uint32_t UftStraContext::watch_param(const char *name, uint32_t val) {
-  return *ShareManager::self().allocate_value(_name.c_str(), name, val, false,
-                                              true);
+  ShareManager::self().allocate_value(_name.c_str(), name, val, false, true);
+  return read_param_value(name, val);
 }
 
 double UftStraContext::watch_param(const char *name, double val) {
-  return *ShareManager::self().allocate_value(_name.c_str(), name, val, false,
-                                              true);
+  ShareManager::self().allocate_value(_name.c_str(), name, val, false, true);
+  return read_param_value(name, val);
 }
 
 void UftStraContext::commit_param_watcher() {
@@ -709,25 +730,25 @@ const char *UftStraContext::read_param(const char *name,
 }
 
 int32_t UftStraContext::read_param(const char *name, int32_t defVal /* = 0 */) {
-  return ShareManager::self().get_value(_name.c_str(), name, defVal);
+  return read_param_value(name, defVal);
 }
 
 uint32_t UftStraContext::read_param(const char *name,
                                     uint32_t defVal /* = 0 */) {
-  return ShareManager::self().get_value(_name.c_str(), name, defVal);
+  return read_param_value(name, defVal);
 }
 
 int64_t UftStraContext::read_param(const char *name, int64_t defVal /* = 0 */) {
-  return ShareManager::self().get_value(_name.c_str(), name, defVal);
+  return read_param_value(name, defVal);
 }
 
 uint64_t UftStraContext::read_param(const char *name,
                                     uint64_t defVal /* = 0 */) {
-  return ShareManager::self().get_value(_name.c_str(), name, defVal);
+  return read_param_value(name, defVal);
 }
 
 double UftStraContext::read_param(const char *name, double defVal /* = 0 */) {
-  return ShareManager::self().get_value(_name.c_str(), name, defVal);
+  return read_param_value(name, defVal);
 }
 
 int32_t *UftStraContext::sync_param(const char *name, int32_t initVal /* = 0 */,
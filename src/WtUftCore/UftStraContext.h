@@ -333,6 +333,21 @@ private:
     return it != _order_ids.end();
   }
 
+  /*
+   *	交换区的数值参数,第一次读取的时候解析句柄
+   *	小节正在批量写入的时候返回上一次读到的值
+   */
+  typedef struct _ParamSlot {
+    const void *_handle;
+    uint64_t _last; // 上一次读到的值,按类型拷贝
+    bool _valid;
+
+    _ParamSlot() : _handle(NULL), _last(0), _valid(false) {}
+  } ParamSlot;
+  wt_hashmap<std::string, ParamSlot> _param_slots;
+
+  template <typename T> T read_param_value(const char *name, T defVal);
+
 private:
   uint32_t _context_id;
   WtUftEngine *_engine;
@@ -27,7 +27,8 @@
 
 USING_NS_WTP;
 
-WtUftEngine::WtUftEngine() : _cfg(NULL), _tm_ticker(NULL), _notifier(NULL) {
+WtUftEngine::WtUftEngine()
+    : _cfg(NULL), _tm_ticker(NULL), _notifier(NULL), _busy_loop(false) {
   TimeUtils::getDateTime(_cur_date, _cur_time);
   _cur_secs = _cur_time % 100000;
   _cur_time /= 100000;
@@ -38,6 +39,8 @@ WtUftEngine::WtUftEngine() : _cfg(NULL), _tm_ticker(NULL), _notifier(NULL) {
 }
 
 WtUftEngine::~WtUftEngine() {
+  _loop.stop();
+
   if (_tm_ticker) {
     _tm_ticker->stop();
     delete _tm_ticker;
@@ -172,6 +175,95 @@ void WtUftEngine::init(WTSVariant *cfg, IBaseDataMgr *bdMgr,
   _cfg = cfg;
   if (_cfg)
     _cfg->retain();
+
+  WTSVariant *cfgLoop = (_cfg != NULL) ? _cfg->get("busyloop") : NULL;
+  if (cfgLoop && cfgLoop->getBoolean("active")) {
+    _busy_loop = true;
+    uint32_t capacity = cfgLoop->getUInt32("capacity");
+    if (capacity == 0)
+      capacity = 8192;
+    int32_t core = cfgLoop->has("core") ? cfgLoop->getInt32("core") : -1;
+    bool bSpin = cfgLoop->has("spin") ? cfgLoop->getBoolean("spin") : true;
+    _loop.init(capacity, core, bSpin);
+    WTSLogger::info("UFT engine runs in busy loop mode, core: {}, spin: {}, "
+                    "capacity: {}",
+                    core, bSpin, capacity);
+  }
+}
+
+ITrdNotifySink *WtUftEngine::get_trd_sink(ITrdNotifySink *sink) {
+  if (!_busy_loop)
+    return sink;
+
+  std::shared_ptr<UftTrdSinkProxy> proxy(new UftTrdSinkProxy(this, sink));
+  _trd_proxies.emplace_back(proxy);
+  return proxy.get();
+}
+
+void WtUftEngine::post_loop_event(const UftLoopEvent &evt) {
+  _loop.post(evt);
+}
+
+bool WtUftEngine::post_timer_event(UftLoopEvtType evtType) {
+  if (!_busy_loop || !_loop.is_running() || _loop.in_loop_thread())
+    return false;
+
+  UftLoopEvent evt;
+  evt._type = evtType;
+  post_loop_event(evt);
+  return true;
+}
+
+void WtUftEngine::on_loop_event(UftLoopEvent &evt) {
+  switch (evt._type) {
+  case ULET_Tick:
+    handle_push_quote((WTSTickData *)evt._data);
+    break;
+  case ULET_OrdDtl:
+    handle_push_order_detail((WTSOrdDtlData *)evt._data);
+    break;
+  case ULET_OrdQue:
+    handle_push_order_queue((WTSOrdQueData *)evt._data);
+    break;
+  case ULET_Trans:
+    handle_push_transaction((WTSTransData *)evt._data);
+    break;
+  case ULET_Trade:
+    evt._sink->on_trade(evt._localid, evt._code, evt._flag_a, evt._offset,
+                        evt._values[0], evt._values[1]);
+    break;
+  case ULET_Order:
+    evt._sink->on_order(evt._localid, evt._code, evt._flag_a, evt._offset,
+                        evt._values[0], evt._values[1], evt._values[2],
+                        evt._flag_b);
+    break;
+  case ULET_Entrust:
+    evt._sink->on_entrust(evt._localid, evt._code, evt._flag_b,
+                          evt._message);
+    break;
+  case ULET_Position:
+    evt._sink->on_position(evt._code, evt._flag_a, evt._values[0],
+                           evt._values[1], evt._values[2], evt._values[3],
+                           evt._tradingday);
+    break;
+  case ULET_ChnlReady:
+    evt._sink->on_channel_ready(evt._tradingday);
+    break;
+  case ULET_ChnlLost:
+    evt._sink->on_channel_lost();
+    break;
+  case ULET_SessBegin:
+    on_session_begin();
+    break;
+  case ULET_SessEnd:
+    on_session_end();
+    break;
+  default:
+    break;
+  }
+
+  if (evt._data)
+    evt._data->release();
 }
 
 void WtUftEngine::run() {
@@ -189,14 +281,35 @@ void WtUftEngine::run() {
   }
 
   _tm_ticker->run();
+
+  if (_busy_loop)
+    _loop.start([this](UftLoopEvent &evt) { on_loop_event(evt); });
 }
 
 void WtUftEngine::handle_push_quote(WTSTickData *newTick) {
+  if (_busy_loop && !_loop.in_loop_thread()) {
+    UftLoopEvent evt;
+    evt._type = ULET_Tick;
+    evt._data = newTick;
+    newTick->retain();
+    _loop.post(evt);
+    return;
+  }
+
   if (_tm_ticker)
     _tm_ticker->on_tick(newTick);
 }
 
 void WtUftEngine::handle_push_order_detail(WTSOrdDtlData *curOrdDtl) {
+  if (_busy_loop && !_loop.in_loop_thread()) {
+    UftLoopEvent evt;
+    evt._type = ULET_OrdDtl;
+    evt._data = curOrdDtl;
+    curOrdDtl->retain();
+    _loop.post(evt);
+    return;
+  }
+
   const char *stdCode = curOrdDtl->code();
   auto sit = _orddtl_sub_map.find(stdCode);
   if (sit != _orddtl_sub_map.end()) {
@@ -216,6 +329,15 @@ void WtUftEngine::handle_push_order_detail(WTSOrdDtlData *curOrdDtl) {
 }
 
 void WtUftEngine::handle_push_order_queue(WTSOrdQueData *curOrdQue) {
+  if (_busy_loop && !_loop.in_loop_thread()) {
+    UftLoopEvent evt;
+    evt._type = ULET_OrdQue;
+    evt._data = curOrdQue;
+    curOrdQue->retain();
+    _loop.post(evt);
+    return;
+  }
+
   const char *stdCode = curOrdQue->code();
   auto sit = _ordque_sub_map.find(stdCode);
   if (sit != _ordque_sub_map.end()) {
@@ -235,6 +357,15 @@ void WtUftEngine::handle_push_order_queue(WTSOrdQueData *curOrdQue) {
 }
 
 void WtUftEngine::handle_push_transaction(WTSTransData *curTrans) {
+  if (_busy_loop && !_loop.in_loop_thread()) {
+    UftLoopEvent evt;
+    evt._type = ULET_Trans;
+    evt._data = curTrans;
+    curTrans->retain();
+    _loop.post(evt);
+    return;
+  }
+
   const char *stdCode = curTrans->code();
   auto sit = _trans_sub_map.find(stdCode);
   if (sit != _trans_sub_map.end()) {
@@ -269,6 +400,9 @@ void WtUftEngine::sub_transaction(uint32_t sid, const char *stdCode) {
 }
 
 void WtUftEngine::on_session_begin() {
+  if (post_timer_event(ULET_SessBegin))
+    return;
+
   WTSLogger::info("Trading day {} begun", _cur_tdate);
 
   for (auto it = _ctx_map.begin(); it != _ctx_map.end(); it++) {
@@ -278,6 +412,9 @@ void WtUftEngine::on_session_begin() {
 }
 
 void WtUftEngine::on_session_end() {
+  if (post_timer_event(ULET_SessEnd))
+    return;
+
   for (auto it = _ctx_map.begin(); it != _ctx_map.end(); it++) {
     UftContextPtr &ctx = (UftContextPtr &)it->second;
     ctx->on_session_end(_cur_tdate);
@@ -14,11 +14,13 @@
 #include <stdint.h>
 
 #include "ParserAdapter.h"
+#include "WtUftLoop.h"
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/RiskMonDefs.h"
 
 #include "../Share/DLLHelper.hpp"
+#include "../Share/PollingLoop.hpp"
 #include "../Share/StdUtils.hpp"
 
 #include "../Share/BoostFile.hpp"
@@ -132,6 +134,25 @@ public:
   void sub_order_detail(uint32_t sid, const char *stdCode);
   void sub_transaction(uint32_t sid, const char *stdCode);
 
+  /*
+   *	获取策略的交易回报接收者
+   *	轮询模式下返回一个代理,把交易通道线程的回报转到事件循环线程
+   */
+  ITrdNotifySink *get_trd_sink(ITrdNotifySink *sink);
+
+  inline bool is_busy_loop() const { return _busy_loop; }
+
+  void post_loop_event(const UftLoopEvent &evt);
+
+private:
+  void on_loop_event(UftLoopEvent &evt);
+
+  /*
+   *	定时器线程触发的事件转到事件循环线程处理
+   *	返回false表示当前线程可以直接处理
+   */
+  bool post_timer_event(UftLoopEvtType evtType);
+
 private:
   uint32_t _cur_date; // 当前日期
   uint32_t
@@ -165,6 +186,14 @@ private:
   bool _dependent; // 子策略独立记账
 
   EventNotifier *_notifier;
+
+  /*
+   *	单线程轮询模式
+   *	行情和交易回报都投递到事件循环,由一个绑核的线程统一处理
+   */
+  bool _busy_loop;
+  PollingLoop<UftLoopEvent> _loop;
+  std::vector<std::shared_ptr<UftTrdSinkProxy>> _trd_proxies;
 };
 
 NS_WTP_END
\ No newline at end of file
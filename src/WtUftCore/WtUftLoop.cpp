@@ -0,0 +1,90 @@
+﻿/*!
+ * \file WtUftLoop.cpp
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief
+ */
+#include "WtUftLoop.h"
+#include "WtUftEngine.h"
+
+USING_NS_WTP;
+
+void UftTrdSinkProxy::on_trade(uint32_t localid, const char *stdCode,
+                               bool isLong, uint32_t offset, double vol,
+                               double price) {
+  UftLoopEvent evt;
+  evt._type = ULET_Trade;
+  evt._sink = _sink;
+  evt._localid = localid;
+  evt._flag_a = isLong;
+  evt._offset = offset;
+  evt._values[0] = vol;
+  evt._values[1] = price;
+  wt_strcpy(evt._code, stdCode);
+  _engine->post_loop_event(evt);
+}
+
+void UftTrdSinkProxy::on_order(uint32_t localid, const char *stdCode,
+                               bool isLong, uint32_t offset, double totalQty,
+                               double leftQty, double price,
+                               bool isCanceled /* = false */) {
+  UftLoopEvent evt;
+  evt._type = ULET_Order;
+  evt._sink = _sink;
+  evt._localid = localid;
+  evt._flag_a = isLong;
+  evt._flag_b = isCanceled;
+  evt._offset = offset;
+  evt._values[0] = totalQty;
+  evt._values[1] = leftQty;
+  evt._values[2] = price;
+  wt_strcpy(evt._code, stdCode);
+  _engine->post_loop_event(evt);
+}
+
+void UftTrdSinkProxy::on_position(const char *stdCode, bool isLong,
+                                  double prevol, double preavail,
+                                  double newvol, double newavail,
+                                  uint32_t tradingday) {
+  UftLoopEvent evt;
+  evt._type = ULET_Position;
+  evt._sink = _sink;
+  evt._flag_a = isLong;
+  evt._values[0] = prevol;
+  evt._values[1] = preavail;
+  evt._values[2] = newvol;
+  evt._values[3] = newavail;
+  evt._tradingday = tradingday;
+  wt_strcpy(evt._code, stdCode);
+  _engine->post_loop_event(evt);
+}
+
+void UftTrdSinkProxy::on_channel_ready(uint32_t tradingday) {
+  UftLoopEvent evt;
+  evt._type = ULET_ChnlReady;
+  evt._sink = _sink;
+  evt._tradingday = tradingday;
+  _engine->post_loop_event(evt);
+}
+
+void UftTrdSinkProxy::on_channel_lost() {
+  UftLoopEvent evt;
+  evt._type = ULET_ChnlLost;
+  evt._sink = _sink;
+  _engine->post_loop_event(evt);
+}
+
+void UftTrdSinkProxy::on_entrust(uint32_t localid, const char *stdCode,
+                                 bool bSuccess, const char *message) {
+  UftLoopEvent evt;
+  evt._type = ULET_Entrust;
+  evt._sink = _sink;
+  evt._localid = localid;
+  evt._flag_b = bSuccess;
+  wt_strcpy(evt._code, stdCode);
+  strncpy(evt._message, message, sizeof(evt._message) - 1);
+  _engine->post_loop_event(evt);
+}
@@ -0,0 +1,91 @@
+﻿/*!
+ * \file WtUftLoop.h
+ * \project	WonderTrader
+ *
+ * \author Wesley
+ * \date 2024/03/18
+ *
+ * \brief UFT引擎单线程轮询模式的事件定义
+ */
+#pragma once
+#include "ITrdNotifySink.h"
+#include <string.h>
+
+#include "../Includes/WTSMarcos.h"
+#include "../Includes/WTSObject.hpp"
+
+NS_WTP_BEGIN
+
+class WtUftEngine;
+
+typedef enum tagUftLoopEvtType {
+  ULET_Tick = 0,   // tick行情
+  ULET_OrdDtl,     // 逐笔委托
+  ULET_OrdQue,     // 委托队列
+  ULET_Trans,      // 逐笔成交
+  ULET_Trade,      // 成交回报
+  ULET_Order,      // 订单回报
+  ULET_Entrust,    // 下单回报
+  ULET_Position,   // 持仓更新
+  ULET_ChnlReady,  // 交易通道就绪
+  ULET_ChnlLost,   // 交易通道丢失
+  ULET_SessBegin,  // 交易日开始
+  ULET_SessEnd     // 交易日结束
+} UftLoopEvtType;
+
+/*
+ *	轮询模式下投递到事件循环的事件
+ *	行情数据投递时retain,处理完以后release
+ *	交易回报直接把参数拷贝进来
+ */
+typedef struct _UftLoopEvent {
+  UftLoopEvtType _type;
+  WTSObject *_data;
+  ITrdNotifySink *_sink;
+
+  uint32_t _localid;
+  uint32_t _offset;
+  uint32_t _tradingday; // 交易日
+  bool _flag_a; // isLong
+  bool _flag_b; // isCanceled/bSuccess
+  double _values[4];
+  char _code[MAX_INSTRUMENT_LENGTH];
+  char _message[64];
+
+  _UftLoopEvent() { memset(this, 0, sizeof(_UftLoopEvent)); }
+} UftLoopEvent;
+
+/*
+ *	交易回报代理
+ *	把交易通道线程上的回报转到事件循环线程里再回调给策略
+ */
+class UftTrdSinkProxy : public ITrdNotifySink {
+public:
+  UftTrdSinkProxy(WtUftEngine *engine, ITrdNotifySink *sink)
+      : _engine(engine), _sink(sink) {}
+
+public:
+  virtual void on_trade(uint32_t localid, const char *stdCode, bool isLong,
+                        uint32_t offset, double vol, double price) override;
+
+  virtual void on_order(uint32_t localid, const char *stdCode, bool isLong,
+                        uint32_t offset, double totalQty, double leftQty,
+                        double price, bool isCanceled = false) override;
+
+  virtual void on_position(const char *stdCode, bool isLong, double prevol,
+                           double preavail, double newvol, double newavail,
+                           uint32_t tradingday) override;
+
+  virtual void on_channel_ready(uint32_t tradingday) override;
+
+  virtual void on_channel_lost() override;
+
+  virtual void on_entrust(uint32_t localid, const char *stdCode, bool bSuccess,
+                          const char *message) override;
+
+private:
+  WtUftEngine *_engine;
+  ITrdNotifySink *_sink;
+};
+
+NS_WTP_END
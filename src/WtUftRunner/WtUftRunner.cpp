@@ -187,7 +187,7 @@ bool WtUftRunner::initUftStrategies() {
     TraderAdapterPtr trader = _traders.getAdapter(traderid);
     if (trader) {
       ctx->setTrader(trader.get());
-      trader->addSink(ctx);
+      trader->addSink(_uft_engine.get_trd_sink(ctx));
     } else {
       WTSLogger::error(
           "Trader {} not exists, binding trader to UFT strategy failed",